@@ -46,6 +46,13 @@
 
 std::string AppSupport::inferReaderDriver(const std::string& filename, pdal::Options& options)
 {
+    // "-" is a point stream on standard input
+    if (filename == "-")
+    {
+        options.getOptionByRef("filename").setValue<std::string>(filename);
+        return "drivers.stream.reader";
+    }
+
     std::string ext = boost::filesystem::extension(filename);
     if (ext == "") return "";
     ext = ext.substr(1, ext.length()-1);
@@ -73,6 +80,13 @@ std::string AppSupport::inferReaderDriver(const std::string& filename, pdal::Opt
 
 std::string AppSupport::inferWriterDriver(const std::string& filename, pdal::Options& options)
 {
+    // "-" is a point stream on standard output
+    if (filename == "-")
+    {
+        options.add<std::string>("filename", filename);
+        return "drivers.stream.writer";
+    }
+
     std::string ext = boost::filesystem::extension(filename);
     if (ext == "") return "";
     ext = ext.substr(1, ext.length()-1);
@@ -102,7 +116,7 @@ pdal::Stage* AppSupport::makeReader(pdal::Options& options)
 {
     const std::string inputFile = options.getValueOrThrow<std::string>("filename");
 
-    if (!pdal::FileUtils::fileExists(inputFile))
+    if (inputFile != "-" && !pdal::FileUtils::fileExists(inputFile))
     {
         throw app_runtime_error("file not found: " + inputFile);
     }
@@ -145,8 +159,9 @@ pdal::Writer* AppSupport::makeWriter(pdal::Options& options, pdal::Stage& stage)
 }
 
 
-PercentageCallback::PercentageCallback()
-    : m_lastMajorPerc(-10.0)
+PercentageCallback::PercentageCallback(std::ostream& out)
+    : m_out(out)
+    , m_lastMajorPerc(-10.0)
     , m_lastMinorPerc(-2.0)
     , m_done(false)
 {
@@ -162,18 +177,18 @@ void PercentageCallback::callback()
     
     if (pdal::Utils::compare_distance<double>(currPerc, 100.0))
     {
-        std::cout << "100\n";
+        m_out << "100\n";
         m_done = true;
     }
     else if (currPerc >= m_lastMajorPerc + 10.0)
     {
-        std::cout << (int)currPerc;
+        m_out << (int)currPerc;
         m_lastMajorPerc = currPerc;
         m_lastMinorPerc = currPerc;
     }
     else if (currPerc >= m_lastMinorPerc + 2.0)
     {
-        std::cout << '.';
+        m_out << '.';
         m_lastMinorPerc = currPerc;
     }
 
@@ -181,7 +196,8 @@ void PercentageCallback::callback()
 }
 
 
-HeartbeatCallback::HeartbeatCallback()
+HeartbeatCallback::HeartbeatCallback(std::ostream& out)
+    : m_out(out)
 {
     return;
 }
@@ -189,7 +205,7 @@ HeartbeatCallback::HeartbeatCallback()
 
 void HeartbeatCallback::callback()
 {
-    std::cout << '.';
+    m_out << '.';
 
     return;
 }
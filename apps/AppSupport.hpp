@@ -35,6 +35,7 @@
 #ifndef INCLUDED_APPSUPPORT_HPP
 #define INCLUDED_APPSUPPORT_HPP
 
+#include <iostream>
 #include <string>
 
 #include <pdal/Options.hpp>
@@ -77,9 +78,10 @@ private:
 class PercentageCallback : public pdal::UserCallback
 {
 public:
-    PercentageCallback();
+    PercentageCallback(std::ostream& out = std::cout);
     virtual void callback();
 private:
+    std::ostream& m_out;
     double m_lastMajorPerc;
     double m_lastMinorPerc;
     bool m_done;
@@ -89,9 +91,10 @@ private:
 class HeartbeatCallback : public pdal::UserCallback
 {
 public:
-    HeartbeatCallback();
+    HeartbeatCallback(std::ostream& out = std::cout);
     virtual void callback();
 private:
+    std::ostream& m_out;
 };
 
 #endif
@@ -55,6 +55,7 @@ Application::Application(int argc, char* argv[], const std::string& appName)
     , m_argv(argv)
     , m_appName(appName)
     , m_hardCoreDebug(false)
+    , m_messages(&std::cout)
 {
     return;
 }
@@ -229,7 +230,7 @@ int Application::innerRun()
     if (status == 0 && m_showTime)
     {
         const double t = timer.elapsed();
-        std::cout << "Elapsed time: " << t << " seconds" << std::endl;
+        getMessageStream() << "Elapsed time: " << t << " seconds" << std::endl;
     }
 
     return status;
@@ -238,8 +239,20 @@ int Application::innerRun()
 
 void Application::printError(const std::string& err) const
 {
-    std::cout << err << std::endl;
-    std::cout << std::endl;
+    getMessageStream() << err << std::endl;
+    getMessageStream() << std::endl;
+}
+
+
+std::ostream& Application::getMessageStream() const
+{
+    return *m_messages;
+}
+
+
+void Application::setMessageStream(std::ostream& stream)
+{
+    m_messages = &stream;
 }
 
 
@@ -38,6 +38,8 @@
 #include <pdal/pdal_error.hpp>
 #include <boost/cstdint.hpp>
 
+#include <iostream>
+
 
 
 #ifdef PDAL_COMPILER_MSVC
@@ -103,6 +105,11 @@ protected:
     void addSwitchSet(boost::program_options::options_description* options);
     void addPositionalSwitch(const char* name, int max_count);
 
+    // where errors, timings and progress go: stdout unless the app
+    // moves them, e.g. because it writes its results there
+    std::ostream& getMessageStream() const;
+    void setMessageStream(std::ostream& stream);
+
 private:
     int innerRun();
     void parseSwitches();
@@ -124,6 +131,7 @@ private:
     char** m_argv;
     const std::string m_appName;
     bool m_hardCoreDebug;
+    std::ostream* m_messages;
 
     std::vector<boost::program_options::options_description*> m_options;
     boost::program_options::positional_options_description m_positionalOptions;
@@ -33,6 +33,7 @@
 ****************************************************************************/
 
 #include <pdal/FileUtils.hpp>
+#include <pdal/Tracer.hpp>
 
 #include <pdal/drivers/las/Reader.hpp>
 #include <pdal/drivers/las/Writer.hpp>
@@ -70,6 +71,7 @@ private:
     std::string m_srs;
     bool m_bCompress;
     boost::uint32_t m_chunkSize;
+    std::string m_traceFile;
 };
 
 
@@ -80,6 +82,7 @@ Pc2Pc::Pc2Pc(int argc, char* argv[])
     , m_srs("")
     , m_bCompress(false)
     , m_chunkSize(0)
+    , m_traceFile("")
 {
     return;
 }
@@ -97,6 +100,12 @@ void Pc2Pc::validateSwitches()
         throw app_usage_error("--output/-o required");
     }
 
+    // the points go to stdout, so everything else goes to stderr
+    if (m_outputFile == "-")
+    {
+        setMessageStream(std::cerr);
+    }
+
     return;
 }
 
@@ -108,11 +117,12 @@ void Pc2Pc::addSwitches()
     po::options_description* file_options = new po::options_description("file options");
 
     file_options->add_options()
-        ("input,i", po::value<std::string>(&m_inputFile)->default_value(""), "input file name")
-        ("output,o", po::value<std::string>(&m_outputFile)->default_value(""), "output file name")
+        ("input,i", po::value<std::string>(&m_inputFile)->default_value(""), "input file name, or - for a point stream on stdin")
+        ("output,o", po::value<std::string>(&m_outputFile)->default_value(""), "output file name, or - for a point stream on stdout")
         ("a_srs", po::value<std::string>(&m_srs)->default_value(""), "Assign output coordinate system (if supported by output format)")
         ("compress,z", po::value<bool>(&m_bCompress)->zero_tokens()->implicit_value(true), "Compress output data (if supported by output format)")
         ("chunk_size", po::value<boost::uint32_t>(&m_chunkSize), "Size of buffer, for blocked/chunked/tiled transfers")
+        ("trace", po::value<std::string>(&m_traceFile)->default_value(""), "Write a timeline of the execution to this file, in Chrome trace-event format")
         ;
 
     addSwitchSet(file_options);
@@ -161,13 +171,24 @@ int Pc2Pc::execute()
 
     const boost::uint64_t numPointsToRead = stage->getNumPoints();
     boost::scoped_ptr<pdal::UserCallback> callback((numPointsToRead == 0) ? 
-        (pdal::UserCallback*)(new HeartbeatCallback) :
-        (pdal::UserCallback*)(new PercentageCallback));
+        (pdal::UserCallback*)(new HeartbeatCallback(getMessageStream())) :
+        (pdal::UserCallback*)(new PercentageCallback(getMessageStream())));
     writer->setUserCallback(callback.get());
 
+    if (m_traceFile != "")
+    {
+        Tracer::enable();
+    }
+
     const boost::uint64_t numPointsRead = writer->write(numPointsToRead);
 
-    std::cout << "Wrote " << numPointsRead << " points\n";
+    if (m_traceFile != "")
+    {
+        Tracer::disable();
+        Tracer::write(m_traceFile);
+    }
+
+    getMessageStream() << "Wrote " << numPointsRead << " points\n";
 
     delete writer;
     delete stage;
@@ -33,6 +33,7 @@
 ****************************************************************************/
 
 
+#include <algorithm>
 #include <iostream>
 
 #include <boost/scoped_ptr.hpp>
@@ -41,8 +42,12 @@
 #include <pdal/StageIterator.hpp>
 #include <pdal/FileUtils.hpp>
 #include <pdal/PointBuffer.hpp>
+#include <pdal/drivers/las/Reader.hpp>
 #include <pdal/filters/Stats.hpp>
 
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
@@ -64,6 +69,9 @@ private:
 
     void dumpOnePoint(const Stage&) const;
     void dumpStats(pdal::filters::Stats& filter) const;
+    boost::property_tree::ptree getHeaderStats(const Stage&) const;
+    boost::property_tree::ptree getSampleStats(pdal::filters::Stats& filter) const;
+    boost::property_tree::ptree getFullStats(pdal::filters::Stats& filter) const;
     void dumpSchema(const Stage&) const;
     void dumpStage(const Stage&) const;
     void dumpMetadata(const Stage&) const;
@@ -79,6 +87,8 @@ private:
     std::ostream* m_outputStream;
     boost::uint32_t m_seed;
     boost::uint32_t m_sample_size;
+    std::string m_statsMode;
+    boost::uint32_t m_samplePoints;
     bool m_useXML;
 };
 
@@ -93,6 +103,8 @@ PcInfo::PcInfo(int argc, char* argv[])
     , m_showMetadata(false)
     , m_pointNumber((std::numeric_limits<boost::uint64_t>::max)())
     , m_outputStream(0)
+    , m_statsMode("full")
+    , m_samplePoints(10000)
     , m_useXML(false)
 {
     return;
@@ -117,6 +129,11 @@ void PcInfo::validateSwitches()
         throw app_usage_error("no action option specified");
     }
 
+    if (m_statsMode != "header" && m_statsMode != "sample" && m_statsMode != "full")
+    {
+        throw app_usage_error("stats_mode must be one of header, sample or full");
+    }
+
     return;
 }
 
@@ -138,7 +155,9 @@ void PcInfo::addSwitches()
     
     processing_options->add_options()
         ("point,p", po::value<boost::uint64_t>(&m_pointNumber)->implicit_value(0), "point to dump")
-        ("stats,a", po::value<bool>(&m_showStats)->zero_tokens()->implicit_value(true), "dump stats on all points (reads entire dataset)")
+        ("stats,a", po::value<bool>(&m_showStats)->zero_tokens()->implicit_value(true), "dump stats on all points (reads entire dataset unless --stats_mode is given)")
+        ("stats_mode", po::value<std::string>(&m_statsMode)->default_value("full"), "how --stats are gathered: 'header' (header/metadata only), 'sample' (random runs of points) or 'full' (every point)")
+        ("sample_points", po::value<boost::uint32_t>(&m_samplePoints)->default_value(10000), "number of points read for --stats_mode sample")
         ("schema,s", po::value<bool>(&m_showSchema)->zero_tokens()->implicit_value(true), "dump the schema")
         ("metadata,m", po::value<bool>(&m_showMetadata)->zero_tokens()->implicit_value(true), "dump the metadata")
         ("stage,r", po::value<bool>(&m_showStage)->zero_tokens()->implicit_value(true), "dump the stage info")
@@ -183,9 +202,116 @@ void PcInfo::dumpOnePoint(const Stage& stage) const
 }
 
 
-void PcInfo::dumpStats(pdal::filters::Stats& filter) const
+// --stats_mode sample reads runs of this many consecutive points, starting
+// at random positions in file order, so each run costs one seek.
+static const boost::uint32_t s_sampleRunLength = 100;
+
+
+// Every dimension's stats are labeled with how they were obtained:
+//   "header"   copied from the file header or stage metadata, no points read
+//   "estimate" computed from a random subset of the points
+//   "exact"    computed from every point
+static void labelStats(boost::property_tree::ptree& tree, const std::string& accuracy)
 {
+    boost::property_tree::ptree::iterator i;
+    for (i = tree.begin(); i != tree.end(); ++i)
+    {
+        i->second.put("accuracy", accuracy);
+    }
+    return;
+}
+
+
+boost::property_tree::ptree PcInfo::getHeaderStats(const Stage& stage) const
+{
+    boost::property_tree::ptree tree;
+
+    const boost::uint64_t count = stage.getNumPoints();
+    const Bounds<double>& bounds = stage.getBounds();
+
+    const char* names[] = { "X", "Y", "Z" };
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        boost::property_tree::ptree dim;
+        dim.put("count", count);
+        if (!bounds.empty() && i < bounds.dimensions().size())
+        {
+            dim.put("minimum", bounds.getMinimum(i));
+            dim.put("maximum", bounds.getMaximum(i));
+        }
+        tree.add_child(names[i], dim);
+    }
+
+    const pdal::drivers::las::Reader* las = dynamic_cast<const pdal::drivers::las::Reader*>(&stage);
+    if (las)
+    {
+        const pdal::drivers::las::LasHeader::RecordsByReturnArray& returns = las->getLasHeader().GetPointRecordsByReturnCount();
+
+        boost::property_tree::ptree bins;
+        for (std::size_t i = 0; i < returns.size(); ++i)
+        {
+            boost::property_tree::ptree bin;
+            bin.add("lower_bound", i + 1);
+            bin.add("count", returns[i]);
+            std::ostringstream binname;
+            binname << "bin-" << i;
+            bins.add_child(binname.str(), bin);
+        }
+
+        boost::property_tree::ptree dim;
+        dim.put("count", count);
+        dim.add_child("histogram", bins);
+        tree.add_child("ReturnNumber", dim);
+    }
+
+    labelStats(tree, "header");
+    return tree;
+}
+
+
+boost::property_tree::ptree PcInfo::getSampleStats(pdal::filters::Stats& filter) const
+{
+    const boost::uint32_t runLength = s_sampleRunLength;
 
+    const Schema& schema = filter.getSchema();
+    const boost::uint64_t numPoints = filter.getNumPoints();
+    const boost::uint32_t numRuns = (m_samplePoints + runLength - 1) / runLength;
+
+    boost::random::mt19937 rng;
+    if (m_seed != 0)
+        rng.seed(m_seed);
+    boost::random::uniform_int_distribution<boost::uint64_t> position(0, numPoints - runLength);
+
+    std::vector<boost::uint64_t> starts;
+    for (boost::uint32_t i = 0; i < numRuns; ++i)
+        starts.push_back(position(rng));
+    std::sort(starts.begin(), starts.end());
+
+    PointBuffer data(schema, runLength);
+    boost::scoped_ptr<StageRandomIterator> iter(filter.createRandomIterator(data));
+
+    for (std::vector<boost::uint64_t>::const_iterator i = starts.begin(); i != starts.end(); ++i)
+    {
+        iter->seek(*i);
+        data.setNumPoints(0);
+        iter->read(data);
+    }
+
+    boost::property_tree::ptree tree = static_cast<pdal::filters::iterators::random::Stats*>(iter.get())->toPTree();
+
+    boost::property_tree::ptree::iterator i;
+    for (i = tree.begin(); i != tree.end(); ++i)
+    {
+        i->second.put("total_points", numPoints);
+    }
+
+    labelStats(tree, "estimate");
+    return tree;
+}
+
+
+boost::property_tree::ptree PcInfo::getFullStats(pdal::filters::Stats& filter) const
+{
     const Schema& schema = filter.getSchema();
 
     PointBuffer data(schema);
@@ -202,6 +328,37 @@ void PcInfo::dumpStats(pdal::filters::Stats& filter) const
 
     boost::property_tree::ptree tree = static_cast<pdal::filters::iterators::sequential::Stats*>(iter.get())->toPTree();
 
+    labelStats(tree, "exact");
+    return tree;
+}
+
+
+void PcInfo::dumpStats(pdal::filters::Stats& filter) const
+{
+    boost::property_tree::ptree tree;
+
+    const Stage& stage = filter.getPrevStage();
+
+    // Sampling needs to seek, and only pays off when there are more
+    // points than we would sample; otherwise read everything.
+    const bool canSample = stage.supportsIterator(StageIterator_Random) &&
+                           stage.getPointCountType() == PointCount_Fixed &&
+                           stage.getNumPoints() > 2 * static_cast<boost::uint64_t>(m_samplePoints + s_sampleRunLength) &&
+                           m_samplePoints > 0;
+
+    if (m_statsMode == "header")
+    {
+        tree = getHeaderStats(stage);
+    }
+    else if (m_statsMode == "sample" && canSample)
+    {
+        tree = getSampleStats(filter);
+    }
+    else
+    {
+        tree = getFullStats(filter);
+    }
+
     std::ostream& ostr = m_outputStream ? *m_outputStream : std::cout;
 
     if (m_useXML)
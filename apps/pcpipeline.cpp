@@ -38,12 +38,17 @@
 #include <pdal/PipelineManager.hpp>
 #include <pdal/PipelineWriter.hpp>
 #include <pdal/FileUtils.hpp>
+#include <pdal/Tracer.hpp>
+
+#include <boost/foreach.hpp>
+#include <boost/property_tree/ptree.hpp>
 
 #include "AppSupport.hpp"
 
 #include "Application.hpp"
 
 #include <iostream>
+#include <iomanip>
 
 using namespace pdal;
 namespace po = boost::program_options;
@@ -58,10 +63,13 @@ public:
 private:
     void addSwitches();
     void validateSwitches();
+    void printProfile(const boost::property_tree::ptree& profile) const;
 
     std::string m_inputFile;
     std::string m_pipelineFile;
     bool m_usestdin;
+    bool m_profile;
+    std::string m_traceFile;
 };
 
 
@@ -69,6 +77,8 @@ PcPipeline::PcPipeline(int argc, char* argv[])
     : Application(argc, argv, "pcpipeline")
     , m_inputFile("")
     , m_usestdin(false)
+    , m_profile(false)
+    , m_traceFile("")
 {
     return;
 }
@@ -93,6 +103,8 @@ void PcPipeline::addSwitches()
         ("input,i", po::value<std::string>(&m_inputFile)->default_value(""), "input file name")
         ("pipeline-serialization", po::value<std::string>(&m_pipelineFile)->default_value(""), "")
         ("stdin,s", po::value<bool>(&m_usestdin)->zero_tokens()->implicit_value(true), "Read pipeline XML from stdin")
+        ("profile", po::value<bool>(&m_profile)->zero_tokens()->implicit_value(true), "Print the time and throughput of each stage after executing")
+        ("trace", po::value<std::string>(&m_traceFile)->default_value(""), "Write a timeline of the execution to this file, in Chrome trace-event format")
         ;
 
     addSwitchSet(file_options);
@@ -120,8 +132,24 @@ int PcPipeline::execute()
     if (!isWriter)
         throw app_runtime_error("pipeline file is not a Writer");
 
+    if (m_traceFile.size() > 0)
+    {
+        Tracer::enable();
+    }
+
     manager.execute();
 
+    if (m_traceFile.size() > 0)
+    {
+        Tracer::disable();
+        Tracer::write(m_traceFile);
+    }
+
+    if (m_profile)
+    {
+        printProfile(manager.getProfile());
+    }
+
     if (m_pipelineFile.size() > 0)
     {
         pdal::PipelineWriter writer(manager);
@@ -131,6 +159,52 @@ int PcPipeline::execute()
 }
 
 
+void PcPipeline::printProfile(const boost::property_tree::ptree& profile) const
+{
+    std::ostream& ostr = std::cout;
+
+    const std::ios::fmtflags flags = ostr.flags();
+    const std::streamsize prec = ostr.precision();
+    ostr << std::fixed << std::setprecision(3);
+
+    ostr << "Pipeline profile: "
+         << profile.get<double>("wall_time") << "s wall, "
+         << profile.get<double>("cpu_time") << "s cpu" << std::endl;
+
+    ostr << std::left << std::setw(32) << "stage" << std::right
+         << std::setw(10) << "wall (s)"
+         << std::setw(10) << "cpu (s)"
+         << std::setw(12) << "blocked (s)"
+         << std::setw(12) << "points in"
+         << std::setw(12) << "points out"
+         << std::setw(14) << "bytes"
+         << std::setw(9) << "buffers"
+         << std::setw(8) << "allocs"
+         << std::endl;
+
+    BOOST_FOREACH(const boost::property_tree::ptree::value_type& v, profile.get_child("stages"))
+    {
+        const boost::property_tree::ptree& stage = v.second;
+
+        ostr << std::left << std::setw(32) << stage.get<std::string>("name") << std::right
+             << std::setw(10) << stage.get<double>("wall_time")
+             << std::setw(10) << stage.get<double>("cpu_time")
+             << std::setw(12) << stage.get<double>("blocked_time")
+             << std::setw(12) << stage.get<boost::uint64_t>("points_in")
+             << std::setw(12) << stage.get<boost::uint64_t>("points_out")
+             << std::setw(14) << stage.get<boost::uint64_t>("bytes")
+             << std::setw(9) << stage.get<boost::uint64_t>("buffers")
+             << std::setw(8) << stage.get<boost::uint64_t>("buffers_allocated")
+             << std::endl;
+    }
+
+    ostr.flags(flags);
+    ostr.precision(prec);
+
+    return;
+}
+
+
 int main(int argc, char* argv[])
 {
     PcPipeline app(argc, argv);
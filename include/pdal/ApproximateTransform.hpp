@@ -0,0 +1,151 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_APPROXIMATETRANSFORM_HPP
+#define INCLUDED_APPROXIMATETRANSFORM_HPP
+
+#include <pdal/pdal_internal.hpp>
+#include <pdal/Bounds.hpp>
+
+#include <boost/function.hpp>
+
+#include <vector>
+
+namespace pdal
+{
+
+// Approximates an expensive coordinate transformation (e.g. an OGR/PROJ
+// reprojection) by interpolation, to within a given error.
+//
+// The extent of the points is covered by a quadtree of cells.  For each
+// cell the exact transform is evaluated at the four corners, at the lowest
+// and highest Z of the extent, and points inside the cell are interpolated
+// (bilinearly in X/Y, linearly in Z) from those eight values.  A cell is
+// accepted when the interpolated and exact values at its centre agree to
+// within maxError in every output coordinate; otherwise it is split into
+// four, down to maxDepth levels, below which its points are transformed
+// exactly.  Cells are only evaluated once points land in them, and are
+// kept for later calls; all the cells a call needs at one level of the
+// tree are evaluated in a single call to the exact transform.
+//
+// Points outside the extent are transformed exactly.  If no extent is
+// given, each call to transform() uses the extent of its own points.
+class PDAL_DLL ApproximateTransform
+{
+public:
+    // transforms count points in place
+    typedef boost::function<void(double*, double*, double*, boost::uint32_t)> Function;
+
+    ApproximateTransform(Function exact,
+                         double maxError,
+                         const Bounds<double>& extent = Bounds<double>(),
+                         boost::uint32_t maxDepth = 10);
+
+    void transform(double* x, double* y, double* z, boost::uint32_t count);
+
+    // points transformed exactly, and calls made to the exact transform
+    // (including those used to build cells), so far
+    boost::uint64_t getNumExactPoints() const
+    {
+        return m_numExactPoints;
+    }
+    boost::uint64_t getNumExactCalls() const
+    {
+        return m_numExactCalls;
+    }
+    // points interpolated so far
+    boost::uint64_t getNumInterpolatedPoints() const
+    {
+        return m_numInterpolatedPoints;
+    }
+
+private:
+    enum CellState
+    {
+        Cell_Unevaluated,
+        Cell_Pending,
+        Cell_Interpolate,
+        Cell_Split,
+        Cell_Exact
+    };
+
+    struct Cell
+    {
+        double minx;
+        double miny;
+        double maxx;
+        double maxy;
+        boost::uint32_t depth;
+        CellState state;
+        std::size_t firstChild;
+
+        // transformed corners: [low/high z][(0,0) (1,0) (0,1) (1,1)][x y z]
+        double corners[2][4][3];
+    };
+
+    void setExtent(double minx, double miny, double minz,
+                   double maxx, double maxy, double maxz);
+    std::size_t findCell(double x, double y) const;
+    void evaluate(const std::vector<std::size_t>& cells);
+    void classify(std::size_t cell, const double* x, const double* y, const double* z);
+    void interpolate(const Cell& cell, double& x, double& y, double& z) const;
+    void exact(double* x, double* y, double* z, boost::uint32_t count);
+
+    Function m_exact;
+    double m_maxError;
+    boost::uint32_t m_maxDepth;
+    bool m_fixedExtent;
+    double m_minz;
+    double m_maxz;
+    std::vector<Cell> m_cells;
+
+    std::vector<boost::uint32_t> m_pendingIndex;
+    std::vector<boost::uint32_t> m_exactIndex;
+    std::vector<std::size_t> m_evaluate;
+    std::vector<double> m_exactX;
+    std::vector<double> m_exactY;
+    std::vector<double> m_exactZ;
+
+    boost::uint64_t m_numExactPoints;
+    boost::uint64_t m_numExactCalls;
+    boost::uint64_t m_numInterpolatedPoints;
+
+    ApproximateTransform& operator=(const ApproximateTransform&); // not implemented
+    ApproximateTransform(const ApproximateTransform&); // not implemented
+};
+
+
+} // namespace pdal
+
+#endif
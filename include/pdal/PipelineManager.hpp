@@ -37,6 +37,7 @@
 
 #include <pdal/pdal_internal.hpp>
 #include <pdal/StageFactory.hpp>
+#include <pdal/StageProfile.hpp>
 
 #include <boost/shared_ptr.hpp>
 
@@ -76,6 +77,11 @@ public:
     // the user doesn't even need to know anything about the Writer class
     boost::uint64_t execute();
 
+    // returns the performance counters gathered by execute(): the
+    // total time taken, plus the profile of each stage (see
+    // StageBase::getProfilePTree), starting with the readers
+    boost::property_tree::ptree getProfile() const;
+
 private:
     StageFactory m_factory;
 
@@ -91,6 +97,7 @@ private:
     Stage* m_lastStage;
     Writer* m_lastWriter;
     bool m_isWriterPipeline;
+    StageProfile m_profile;
 
     PipelineManager& operator=(const PipelineManager&); // not implemented
     PipelineManager(const PipelineManager&); // not implemented
@@ -198,6 +198,18 @@ public:
         return m_index.get<schema::name>().size();
     }
 
+    /*! returns a new Schema with all ignored dimensions removed.
+        \verbatim embed:rst
+        .. note::
+
+            Byte offsets and positions are recomputed, so a pdal::PointBuffer
+            allocated with the packed Schema only carries the dimensions that
+            are actually going to be consumed.
+
+        \endverbatim
+    */
+    Schema pack() const;
+
 /// @name Summary and serialization
     /// @return  a boost::property_tree representing the Schema
     /*!
@@ -41,6 +41,7 @@
 #include <pdal/Log.hpp>
 #include <pdal/Options.hpp>
 #include <pdal/Metadata.hpp>
+#include <pdal/StageProfile.hpp>
 
 #include <string>
 #include <vector>
@@ -231,6 +232,28 @@ public:
 
     virtual Metadata getMetadata() const;
 
+    /// Gets the performance counters for the stage.
+    ///
+    /// The counters are filled in by the framework as points move through
+    /// the stage, so this is non-const even on a const stage.
+    ///
+    /// @return the profile for the stage
+    StageProfile& getProfile() const
+    {
+        return m_profile;
+    }
+
+    /// Gets the profile of the stage as a ptree.
+    ///
+    /// Alongside the raw counters, this reports the time spent in this
+    /// stage alone (with the time spent in the input stages subtracted
+    /// out), the number of points it consumed from its inputs, and an
+    /// estimate of the time it spent blocked (wall time not spent on the
+    /// CPU, which for readers and writers is mostly I/O).
+    ///
+    /// @return the ptree for the profile
+    boost::property_tree::ptree getProfilePTree() const;
+
 
 protected:
 
@@ -292,6 +315,7 @@ private:
     StageOperationType m_dimensionsType;
     LogPtr m_log;
     Metadata m_metadata;
+    mutable StageProfile m_profile;
 
     StageBase& operator=(const StageBase& rhs); // not implemented
     StageBase(const StageBase&); // not implemented
@@ -176,9 +176,31 @@ public:
     // end of the stage was reached first).
     boost::uint64_t seek(boost::uint64_t position);
 
+    // read every step'th point, starting at the current position, until the
+    // buffer is full or the end of the stage is reached
+    //
+    // The points in between are never read, so for a reader this is much
+    // cheaper than reading everything and throwing most of it away.  On
+    // return the iterator is positioned one step past the last point read,
+    // so that repeated calls walk the whole stage with the same stride.
+    //
+    // (Like read(), this performs the readBegin..readEnd sequence.)
+    //
+    // Returns the number of valid points read.
+    boost::uint32_t readStrided(PointBuffer& buffer, boost::uint32_t step);
+
 protected:
     // from Iterator
     virtual boost::uint64_t seekImpl(boost::uint64_t position) = 0;
+
+    // Stages that can read a subset of their points directly (e.g. readers
+    // with fixed-size records) should override this. The default just
+    // uses naiveReadStridedImpl().
+    virtual boost::uint32_t readStridedImpl(PointBuffer& buffer, boost::uint32_t step);
+
+    // This is provided as a sample implementation: it seeks to each wanted
+    // point and reads it on its own, which works for any random iterator.
+    boost::uint32_t naiveReadStridedImpl(PointBuffer& buffer, boost::uint32_t step);
 };
 
 
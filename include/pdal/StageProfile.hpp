@@ -0,0 +1,138 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_STAGEPROFILE_HPP
+#define INCLUDED_STAGEPROFILE_HPP
+
+#include <pdal/pdal_internal.hpp>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace pdal
+{
+
+// Performance counters for a single stage.
+//
+// Every stage carries one of these.  The framework fills it in as data
+// moves through the pipeline: StageIterator::readBuffer() records the
+// points and bytes each stage hands out, Writer::write() records what the
+// writer consumes, and both time themselves.
+//
+// The times are inclusive: a filter's read time includes the time its
+// previous stage spent producing the points.  StageBase::getProfilePTree()
+// subtracts the input stages back out to get the time spent in the stage
+// itself.
+class PDAL_DLL StageProfile
+{
+public:
+    StageProfile();
+
+    // clear all the counters
+    void reset();
+
+    // Times the enclosing scope and adds it to the profile.  Nested timers
+    // on the same profile (e.g. a skip() implemented with read()) only
+    // count once, in the outermost scope.
+    class PDAL_DLL Timer
+    {
+    public:
+        Timer(StageProfile& profile);
+        ~Timer();
+
+    private:
+        StageProfile& m_profile;
+        double m_wallStart;
+        double m_cpuStart;
+        bool m_outermost;
+
+        Timer& operator=(const Timer&); // not implemented
+        Timer(const Timer&); // not implemented
+    };
+
+    // a buffer of numPoints points, of pointSize bytes each, was produced
+    void addBuffer(boost::uint32_t numPoints, boost::uint32_t pointSize);
+
+    // the stage (or the framework on its behalf) allocated a PointBuffer
+    void addBufferAllocation()
+    {
+        ++m_buffersAllocated;
+    }
+
+    double getWallTime() const
+    {
+        return m_wallTime;
+    }
+    double getCpuTime() const
+    {
+        return m_cpuTime;
+    }
+    boost::uint64_t getNumPoints() const
+    {
+        return m_numPoints;
+    }
+    boost::uint64_t getNumBytes() const
+    {
+        return m_numBytes;
+    }
+    boost::uint64_t getNumBuffers() const
+    {
+        return m_numBuffers;
+    }
+    boost::uint64_t getNumBuffersAllocated() const
+    {
+        return m_buffersAllocated;
+    }
+
+    // raw (inclusive) counters
+    boost::property_tree::ptree toPTree() const;
+
+    // seconds since some fixed point in the past, suitable for differencing
+    static double getWallClock();
+    // seconds of CPU time used by this process so far
+    static double getCpuClock();
+
+private:
+    double m_wallTime;
+    double m_cpuTime;
+    boost::uint64_t m_numPoints;
+    boost::uint64_t m_numBytes;
+    boost::uint64_t m_numBuffers;
+    boost::uint64_t m_buffersAllocated;
+    boost::uint32_t m_depth;
+};
+
+
+} // namespace pdal
+
+#endif
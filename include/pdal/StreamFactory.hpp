@@ -48,6 +48,9 @@
 #  pragma warning(pop)
 #endif
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <ostream>
 #include <istream>
 #include <vector>
@@ -144,6 +147,53 @@ private:
 };
 
 
+// Hands out any number of streams over one open file, or over the part of
+// it from offset to offset+length, which each stream sees as the whole
+// file.  The streams read with positional reads (pread), so they don't
+// share a file position and can be used on different threads at once,
+// each by one thread.  allocate() and deallocate() may be called from
+// any thread.  Deallocated streams are kept for reuse.
+class PDAL_DLL PositionalStreamFactory : public StreamFactory
+{
+public:
+    static const std::streamsize s_defaultBufferSize = 1 << 20;
+
+    PositionalStreamFactory(const std::string& file,
+                            std::streamsize bufferSize = s_defaultBufferSize);
+    PositionalStreamFactory(const std::string& file,
+                            boost::uint64_t offset,
+                            boost::uint64_t length,
+                            std::streamsize bufferSize = s_defaultBufferSize);
+    virtual ~PositionalStreamFactory();
+
+    // the file is opened by the first call
+    virtual std::istream& allocate();
+    virtual void deallocate(std::istream&);
+
+    std::streamsize getBufferSize() const
+    {
+        return m_bufferSize;
+    }
+
+    // the streams allocated or kept for reuse
+    std::size_t getNumStreams() const;
+
+    class File;
+
+private:
+    const std::string m_filename;
+    const boost::uint64_t m_offset;
+    boost::uint64_t m_length;
+    const bool m_wholeFile;
+    const std::streamsize m_bufferSize;
+
+    mutable boost::mutex m_mutex;
+    boost::shared_ptr<File> m_file;
+    std::set<std::istream*> m_allocated;
+    std::vector<std::istream*> m_free;
+};
+
+
 // Many of our writer classes want to take a filename or a stream
 // in their ctors, which means that we need a common piece of code that
 // creates and takes ownership of the stream, if needed.
@@ -0,0 +1,129 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_TRACER_HPP
+#define INCLUDED_TRACER_HPP
+
+#include <pdal/pdal_internal.hpp>
+
+#include <string>
+#include <iosfwd>
+
+namespace pdal
+{
+
+class StageBase;
+
+// Records a timeline of what the pipeline is doing, as begin/end (well,
+// start/duration) events for each stage's readBegin, readBuffer and
+// writeBuffer calls and for the readers' bulk I/O, tagged with the thread
+// that ran them and the PointBuffer involved.  The result can be written
+// out in the Chrome trace-event format and loaded into chrome://tracing
+// (or any other viewer that speaks it).
+//
+// Tracing is off by default.  While it is off, a Tracer::Scope costs one
+// locked read of a flag: no clock is read and no strings are built.
+//
+// Usage:
+//     Tracer::enable();
+//     ... run the pipeline ...
+//     Tracer::write("out.json");
+class PDAL_DLL Tracer
+{
+public:
+    // start recording events (clearing anything recorded before)
+    static void enable();
+
+    // stop recording events (what was recorded is kept, for write())
+    static void disable();
+
+    static bool isEnabled();
+
+    // throw away all recorded events
+    static void clear();
+
+    // number of events recorded so far
+    static boost::uint64_t getNumEvents();
+
+    // record one event; start and duration are in seconds, as returned
+    // by StageProfile::getWallClock()
+    static void record(const std::string& name,
+                       const char* category,
+                       double start,
+                       double duration,
+                       const void* buffer);
+
+    // write the recorded events as a Chrome trace-event JSON document
+    static void write(std::ostream& ostr);
+    static void write(const std::string& filename);
+
+    // Records an event covering the lifetime of the scope.
+    class PDAL_DLL Scope
+    {
+    public:
+        // the event is named after the stage, e.g. "drivers.las.reader readBuffer"
+        Scope(const char* event, const StageBase* stage, const void* buffer = 0)
+            : m_active(isEnabled())
+            , m_event(event)
+            , m_stage(stage)
+            , m_buffer(buffer)
+            , m_start(0.0)
+        {
+            if (m_active) begin();
+        }
+
+        ~Scope()
+        {
+            if (m_active) end();
+        }
+
+    private:
+        void begin();
+        void end();
+
+        const bool m_active;
+        const char* const m_event;
+        const StageBase* const m_stage;
+        const void* const m_buffer;
+        double m_start;
+
+        Scope& operator=(const Scope&); // not implemented
+        Scope(const Scope&); // not implemented
+    };
+};
+
+
+} // namespace pdal
+
+#endif
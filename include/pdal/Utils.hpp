@@ -122,6 +122,30 @@ public:
         assert(check_stream_state(src));
     }
 
+    // reads count fixed-size records into dest, skipping over (step-1)
+    // records in the stream between each one that is kept. The stream is
+    // left just past the last record read.
+    static inline void read_n_strided(boost::uint8_t* dest, std::istream& src,
+                                      std::streamsize recordSize,
+                                      boost::uint32_t count,
+                                      boost::uint32_t step)
+    {
+        if (step <= 1)
+        {
+            read_n(dest, src, recordSize * count);
+            return;
+        }
+
+        const std::streamoff gap = recordSize * static_cast<std::streamoff>(step - 1);
+        for (boost::uint32_t i = 0; i < count; ++i)
+        {
+            if (i != 0)
+                src.seekg(gap, std::ios::cur);
+            read_n(dest, src, recordSize);
+            dest += recordSize;
+        }
+    }
+
     template <typename T>
     static inline void write_n(std::ostream& dest, T const& src, std::streamsize const& num)
     {
@@ -0,0 +1,89 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_DRIVERS_COLUMNAR_CODEC_HPP
+#define INCLUDED_DRIVERS_COLUMNAR_CODEC_HPP
+
+#include <pdal/drivers/columnar/Support.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace columnar
+{
+
+//
+// The codecs a column of the columnar format may be stored with. Each
+// works on the column's values as unsigned integers of the dimension's
+// size, so all of them are lossless for every type of 1, 2, 4 or 8 bytes.
+//
+//   delta    each value minus the one before it, zigzagged so that small
+//            negative steps stay small, then bit packed in blocks of 128
+//            at the width of the block's widest step. Good for X/Y/Z in
+//            file order and for time, even stored as a double.
+//   rle      runs of equal values. Good for classification and flags.
+//   deflate  zlib at its fastest level. Needs PDAL built with zlib.
+//   shuffle  the values' bytes grouped by significance, then deflate.
+//            Good for floating point. Needs PDAL built with zlib.
+//
+
+// the codec named name, which may be "auto"; throws on a name it doesn't know
+PDAL_DLL codec::Type getCodec(std::string const& name);
+PDAL_DLL std::string getCodecName(codec::Type type);
+
+// false for the zlib codecs when PDAL is built without zlib
+PDAL_DLL bool isCodecAvailable(codec::Type type);
+
+// the codec "auto" stands for, for dim
+PDAL_DLL codec::Type chooseCodec(Dimension const& dim);
+
+// Encodes count values of size bytes into encoded, replacing what it held.
+PDAL_DLL void encodeColumn(codec::Type type, const char* values, boost::uint32_t count,
+                           std::size_t size, std::vector<char>& encoded);
+
+// Decodes encodedSize bytes back into count values of size bytes, throwing
+// if they are not what encodeColumn wrote.
+PDAL_DLL void decodeColumn(codec::Type type, const char* encoded, std::size_t encodedSize,
+                           boost::uint32_t count, std::size_t size, char* values);
+
+}
+}
+} // namespaces
+
+#endif
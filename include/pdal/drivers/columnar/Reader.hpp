@@ -0,0 +1,216 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_DRIVERS_COLUMNAR_READER_HPP
+#define INCLUDED_DRIVERS_COLUMNAR_READER_HPP
+
+#include <pdal/Reader.hpp>
+#include <pdal/ReaderIterator.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/drivers/columnar/Support.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <limits>
+#include <vector>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace columnar
+{
+
+
+//
+// The columns of one chunk that an iterator has decoded, kept while it
+// reads on through the chunk.
+//
+class PDAL_DLL DecodedChunk
+{
+public:
+    DecodedChunk()
+        : chunk(std::numeric_limits<std::size_t>::max())
+    {}
+
+    std::size_t chunk;
+    // by column, empty until decoded
+    std::vector<std::vector<char> > columns;
+};
+
+
+//
+// Reads the columnar scratch format (see Support.hpp). The file is memory
+// mapped; the columns of each chunk stored without a codec can be had as
+// they are through getColumn(), the others through decodeColumn(), and
+// the iterators copy only the columns in the buffer's schema.
+//
+// supported options:
+//   <string>filename  [required]
+//   <string>dimensions  comma separated names of the dimensions to read
+//                       (default: all of them)
+//
+
+class PDAL_DLL Reader : public pdal::Reader
+{
+public:
+    SET_STAGE_NAME("drivers.columnar.reader", "Columnar Reader")
+
+    Reader(const Options& options);
+    ~Reader();
+
+    virtual void initialize();
+    virtual const Options getDefaultOptions() const;
+
+    std::string getFileName() const;
+
+    bool supportsIterator(StageIteratorType t) const
+    {
+        if (t == StageIterator_Sequential) return true;
+        if (t == StageIterator_Random) return true;
+
+        return false;
+    }
+
+    pdal::StageSequentialIterator* createSequentialIterator(PointBuffer& buffer) const;
+    pdal::StageRandomIterator* createRandomIterator(PointBuffer& buffer) const;
+
+    std::size_t getNumChunks() const
+    {
+        return m_footer.chunks.size();
+    }
+    boost::uint32_t getChunkNumPoints(std::size_t chunk) const
+    {
+        return m_footer.chunks[chunk].numPoints;
+    }
+    // the index of the chunk's first point
+    boost::uint64_t getChunkStart(std::size_t chunk) const
+    {
+        return m_chunkStarts[chunk];
+    }
+    // the X/Y/Z bounds of the chunk, empty when it has no X, Y and Z
+    Bounds<double> const& getChunkBounds(std::size_t chunk) const
+    {
+        return m_footer.chunks[chunk].bounds;
+    }
+    // the XMLSchema document of the file's schema, empty when it was
+    // written without libxml2
+    std::string const& getXMLSchema() const
+    {
+        return m_footer.xmlSchema;
+    }
+
+    codec::Type getColumnCodec(std::size_t chunk, Dimension const& dim) const;
+
+    // The chunk's values of dim, one after the other with no padding,
+    // straight from the mapped file. Throws if the column has a codec.
+    const boost::uint8_t* getColumn(std::size_t chunk, Dimension const& dim) const;
+
+    // The chunk's values of dim, one after the other with no padding,
+    // whatever the codec.
+    void decodeColumn(std::size_t chunk, Dimension const& dim, std::vector<boost::uint8_t>& values) const;
+
+    // this is called by the stage's iterators
+    //
+    // Fills the buffer with the points from pointIndex on, up to its
+    // capacity or the last point, decoding columns into decoded.
+    boost::uint32_t processBuffer(PointBuffer& data, boost::uint64_t pointIndex, DecodedChunk& decoded) const;
+
+    // for dumping
+    virtual boost::property_tree::ptree toPTree() const;
+
+private:
+
+    Reader& operator=(const Reader&); // not implemented
+    Reader(const Reader&); // not implemented
+
+    // the index of dim in the file's dimensions, or -1
+    int findColumn(Dimension const& dim) const;
+    // the index of dim in the file's dimensions; throws if it has none
+    std::size_t getColumnIndex(Dimension const& dim) const;
+    const char* getColumnData(std::size_t chunk, std::size_t column) const;
+
+    boost::iostreams::mapped_file_source m_file;
+    Footer m_footer;
+    std::vector<boost::uint64_t> m_chunkStarts;
+};
+
+namespace iterators
+{
+
+namespace sequential
+{
+
+class Reader : public pdal::ReaderSequentialIterator
+{
+public:
+    Reader(const pdal::drivers::columnar::Reader& reader, PointBuffer& buffer);
+
+private:
+    boost::uint64_t skipImpl(boost::uint64_t);
+    boost::uint32_t readBufferImpl(PointBuffer&);
+    bool atEndImpl() const;
+
+    const pdal::drivers::columnar::Reader& m_reader;
+    DecodedChunk m_decoded;
+};
+
+
+} // sequential
+
+namespace random
+{
+
+class Reader : public pdal::ReaderRandomIterator
+{
+public:
+    Reader(const pdal::drivers::columnar::Reader& reader, PointBuffer& buffer);
+
+private:
+    boost::uint64_t seekImpl(boost::uint64_t);
+    boost::uint32_t readBufferImpl(PointBuffer&);
+
+    const pdal::drivers::columnar::Reader& m_reader;
+    DecodedChunk m_decoded;
+};
+
+} // random
+} // iterators
+
+}
+}
+} // namespaces
+
+#endif
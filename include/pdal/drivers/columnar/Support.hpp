@@ -0,0 +1,168 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_DRIVERS_COLUMNAR_SUPPORT_HPP
+#define INCLUDED_DRIVERS_COLUMNAR_SUPPORT_HPP
+
+#include <pdal/pdal_internal.hpp>
+#include <pdal/Bounds.hpp>
+#include <pdal/Dimension.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace columnar
+{
+
+//
+// The columnar format is a scratch format for passing point data between
+// pipeline runs without losing dimensions or paying for a full encode and
+// decode. Points are stored in chunks, one per buffer written, and each
+// chunk holds one column per dimension, so a reader can map the file and
+// hand out columns as they are.
+//
+// Layout, in the byte order of the machine that wrote it:
+//
+//   header   "PDALCOLS", uint32 version, uint32 byte order mark
+//   chunks   the columns of each chunk in schema order, each encoded with
+//            its codec (see Codec.hpp) and padded to a multiple of 8 bytes
+//   footer   the dimensions, the XMLSchema document (empty when PDAL is
+//            built without libxml2), the spatial reference WKT, then per
+//            chunk its offset, point count, X/Y/Z bounds and the offset,
+//            size and codec of each column
+//   trailer  uint64 footer offset, "PDALCOLS"
+//
+
+class columnar_error : public pdal_error
+{
+public:
+    columnar_error(std::string const& msg)
+        : pdal_error(msg)
+    {}
+};
+
+
+namespace codec
+{
+
+enum Type
+{
+    None = 0,     // the values as they are
+    Delta,        // delta, zigzag and bit packing
+    RunLength,    // runs of equal values
+    Deflate,      // zlib
+    Shuffle,      // bytes grouped by significance, then zlib
+    Auto          // chosen per dimension by the writer, never stored
+};
+
+}
+
+
+class PDAL_DLL ColumnInfo
+{
+public:
+    ColumnInfo()
+        : offset(0)
+        , size(0)
+        , codec(codec::None)
+    {}
+
+    // from the start of the chunk
+    boost::uint64_t offset;
+    // the encoded bytes, without the padding
+    boost::uint64_t size;
+    codec::Type codec;
+};
+
+
+class PDAL_DLL ChunkInfo
+{
+public:
+    ChunkInfo()
+        : offset(0)
+        , numPoints(0)
+    {}
+
+    boost::uint64_t offset;
+    boost::uint32_t numPoints;
+    Bounds<double> bounds;
+    // one per dimension of the footer
+    std::vector<ColumnInfo> columns;
+};
+
+
+class PDAL_DLL Footer
+{
+public:
+    static const char s_magic[8];
+    static const boost::uint32_t s_version;
+    static const boost::uint32_t s_byteOrderMark;
+    static const std::size_t s_headerSize;
+    static const std::size_t s_trailerSize;
+
+    std::vector<Dimension> dimensions;
+    std::string xmlSchema;
+    std::string spatialReference;
+    std::vector<ChunkInfo> chunks;
+
+    // size rounded up to the column alignment
+    static boost::uint64_t getPaddedSize(boost::uint64_t size);
+
+    static void writeHeader(std::ostream& stream);
+
+    // writes the footer and the trailer; position is the stream offset
+    void write(std::ostream& stream, boost::uint64_t position) const;
+
+    // reads the header, footer and trailer of a whole mapped file
+    void read(const char* data, std::size_t size);
+
+    // The footer's fields alone, without the file around them, for other
+    // formats that describe points the same way (see drivers.stream).
+    void encode(std::vector<char>& bytes) const;
+    // returns the end of the fields
+    const char* decode(const char* first, const char* last);
+};
+
+
+}
+}
+} // namespaces
+
+#endif
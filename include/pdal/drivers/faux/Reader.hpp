@@ -101,7 +101,10 @@ public:
     pdal::StageRandomIterator* createRandomIterator(PointBuffer& buffer) const;
 
     // this is called by the stage's iterator
-    boost::uint32_t processBuffer(PointBuffer& data, boost::uint64_t index) const;
+    //
+    // With a step greater than one, only every step'th point from index
+    // onwards is made up.
+    boost::uint32_t processBuffer(PointBuffer& data, boost::uint64_t index, boost::uint32_t step = 1) const;
 
     // for dumping
     virtual boost::property_tree::ptree toPTree() const;
@@ -152,6 +155,7 @@ public:
 private:
     boost::uint64_t seekImpl(boost::uint64_t);
     boost::uint32_t readBufferImpl(PointBuffer&);
+    boost::uint32_t readStridedImpl(PointBuffer&, boost::uint32_t);
 
     pdal::drivers::faux::Reader const& m_reader;
 };
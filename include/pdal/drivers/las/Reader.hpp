@@ -93,12 +93,17 @@ public:
     pdal::StageRandomIterator* createRandomIterator(PointBuffer& buffer) const;
 
     // this is called by the stage's iterator
+    //
+    // With a step greater than one only every step'th record is read
+    // (uncompressed data only), and numPointsLeft still counts every
+    // record left in the file.
     boost::uint32_t processBuffer(PointBuffer& PointBuffer,
                                   std::istream& stream,
                                   boost::uint64_t numPointsLeft,
                                   LASunzipper* unzipper,
                                   ZipPoint* zipPoint,
-                                  PointDimensions* dimensions) const;
+                                  PointDimensions* dimensions,
+                                  boost::uint32_t step = 1) const;
 
     PointFormat getPointFormat() const;
     boost::uint8_t getVersionMajor() const;
@@ -219,6 +224,7 @@ protected:
 private:
     boost::uint64_t seekImpl(boost::uint64_t);
     boost::uint32_t readBufferImpl(PointBuffer&);
+    boost::uint32_t readStridedImpl(PointBuffer&, boost::uint32_t);
 
 };
 
@@ -0,0 +1,155 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_DRIVERS_STREAM_READER_HPP
+#define INCLUDED_DRIVERS_STREAM_READER_HPP
+
+#include <pdal/Reader.hpp>
+#include <pdal/ReaderIterator.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/drivers/stream/Support.hpp>
+
+#include <iosfwd>
+#include <vector>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace stream
+{
+
+
+//
+// Reads the stream format (see Support.hpp), from standard input when the
+// filename is "-". Standard input can be read through once only; a file
+// can be read by any number of iterators.
+//
+// supported options:
+//   <string>filename  [required] the file to read, or "-"
+//
+
+class PDAL_DLL Reader : public pdal::Reader
+{
+public:
+    SET_STAGE_NAME("drivers.stream.reader", "Stream Reader")
+
+    Reader(const Options& options);
+    ~Reader();
+
+    virtual void initialize();
+    virtual const Options getDefaultOptions() const;
+
+    std::string getFileName() const;
+
+    bool supportsIterator(StageIteratorType t) const
+    {
+        if (t == StageIterator_Sequential) return true;
+
+        return false;
+    }
+
+    pdal::StageSequentialIterator* createSequentialIterator(PointBuffer& buffer) const;
+    pdal::StageRandomIterator* createRandomIterator(PointBuffer&) const
+    {
+        return NULL;
+    }
+
+    // the XMLSchema document the writer sent, empty when it was built
+    // without libxml2
+    std::string const& getXMLSchema() const
+    {
+        return m_header.schema.xmlSchema;
+    }
+
+    // these are called by the stage's iterators
+    //
+    // Opens a stream positioned at the first frame. The caller passes it
+    // back to closeFrames().
+    std::istream* openFrames() const;
+    void closeFrames(std::istream* stream) const;
+
+    // for dumping
+    virtual boost::property_tree::ptree toPTree() const;
+
+private:
+
+    Reader& operator=(const Reader&); // not implemented
+    Reader(const Reader&); // not implemented
+
+    Header m_header;
+    // the stream opened by initialize(), until an iterator takes it
+    mutable std::istream* m_stream;
+};
+
+namespace iterators
+{
+
+namespace sequential
+{
+
+class Reader : public pdal::ReaderSequentialIterator
+{
+public:
+    Reader(const pdal::drivers::stream::Reader& reader, PointBuffer& buffer);
+    ~Reader();
+
+private:
+    boost::uint64_t skipImpl(boost::uint64_t);
+    boost::uint32_t readBufferImpl(PointBuffer&);
+    bool atEndImpl() const;
+
+    // Reads up to count points into dest, pointSize bytes apiece, from
+    // the frames; returns how many there were.
+    boost::uint32_t readPoints(char* dest, boost::uint32_t count);
+
+    const pdal::drivers::stream::Reader& m_reader;
+    std::istream* m_stream;
+    std::size_t m_pointSize;
+    // the points left in the current frame
+    boost::uint32_t m_remaining;
+    bool m_atEnd;
+    std::vector<char> m_scratch;
+};
+
+
+} // sequential
+} // iterators
+
+}
+}
+} // namespaces
+
+#endif
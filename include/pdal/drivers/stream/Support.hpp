@@ -0,0 +1,112 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_DRIVERS_STREAM_SUPPORT_HPP
+#define INCLUDED_DRIVERS_STREAM_SUPPORT_HPP
+
+#include <pdal/pdal_internal.hpp>
+#include <pdal/Bounds.hpp>
+#include <pdal/drivers/columnar/Support.hpp>
+
+#include <cstdio>
+#include <iosfwd>
+#include <string>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace stream
+{
+
+//
+// The stream format carries points from one process to another, over a
+// pipe or anything else that can only be read once, front to back. The
+// points go as they are laid out in a PointBuffer, so neither end has to
+// encode or decode them.
+//
+// Layout, in the byte order of the machine that wrote it:
+//
+//   header  "PDALSTRM", uint32 version, uint32 byte order mark, uint64
+//           point count, uint32 point count type, the X/Y/Z bounds as a
+//           uint32 count of min/max pairs, then a uint64 size followed by
+//           the schema as a columnar footer without chunks: the
+//           dimensions, the XMLSchema document and the spatial reference
+//   frames  uint32 number of points, then the points
+//   end     a frame of no points
+//
+
+class stream_error : public pdal_error
+{
+public:
+    stream_error(std::string const& msg)
+        : pdal_error(msg)
+    {}
+};
+
+
+class PDAL_DLL Header
+{
+public:
+    static const char s_magic[8];
+    static const boost::uint32_t s_version;
+    static const boost::uint32_t s_byteOrderMark;
+
+    Header()
+        : numPoints(0)
+        , pointCountType(PointCount_Unknown)
+    {}
+
+    boost::uint64_t numPoints;
+    PointCountType pointCountType;
+    Bounds<double> bounds;
+    // dimensions, xmlSchema and spatialReference; no chunks
+    columnar::Footer schema;
+
+    void write(std::ostream& stream) const;
+    void read(std::istream& stream);
+};
+
+
+// Puts stdin or stdout into binary mode where the C runtime would otherwise
+// translate line endings and stop at ^Z, as on Windows.
+PDAL_DLL void setBinaryMode(std::FILE* file);
+
+
+}
+}
+} // namespaces
+
+#endif
@@ -170,7 +170,10 @@ public:
     }
 
     // this is called by the stage's iterator
-    boost::uint32_t processBuffer(PointBuffer& PointBuffer, std::istream& stream, boost::uint64_t numPointsLeft) const;
+    //
+    // With a step greater than one only every step'th record is read, and
+    // numPointsLeft still counts every record left in the file.
+    boost::uint32_t processBuffer(PointBuffer& PointBuffer, std::istream& stream, boost::uint64_t numPointsLeft, boost::uint32_t step = 1) const;
 
     // for dumping
     virtual boost::property_tree::ptree toPTree() const;
@@ -235,6 +238,7 @@ public:
 private:
     boost::uint64_t seekImpl(boost::uint64_t);
     boost::uint32_t readBufferImpl(PointBuffer&);
+    boost::uint32_t readStridedImpl(PointBuffer&, boost::uint32_t);
 
     const pdal::drivers::terrasolid::Reader& m_reader;
     std::istream* m_istream;
@@ -0,0 +1,203 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_DRIVERS_TEXT_READER_HPP
+#define INCLUDED_DRIVERS_TEXT_READER_HPP
+
+#include <pdal/Reader.hpp>
+#include <pdal/ReaderIterator.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/drivers/text/Writer.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <vector>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace text
+{
+
+
+//
+// Reads delimited ASCII point data: CSV, whitespace separated XYZ and PTS.
+//
+// The file is memory mapped and every buffer's worth of lines is split
+// into runs that are parsed on separate threads. Numbers are parsed with a
+// locale-free parser, so "1.5" is read the same under any global locale.
+//
+// supported options:
+//   <string>filename  [required]
+//   <string>delimiter  a single character, or " " for runs of whitespace
+//                      (default: detected from the first line)
+//   <uint32>skip       number of lines to ignore before the header/data
+//   <bool>header       whether the first line holds column names
+//                      (default: detected, a line with any non-number is
+//                      taken as a header)
+//   <string>columns    comma separated column names, each optionally
+//                      followed by a type, as in "X,Y,Z,Intensity:uint16".
+//                      Overrides the header. Types are int8 ... uint64,
+//                      float and double.
+//   <double>scale_x, scale_y, scale_z, offset_x, offset_y, offset_z
+//                      when a scale is given X/Y/Z are stored as scaled
+//                      32 bit integers, as LAS does
+//   <uint32>threads    number of parsing threads (default: one per core)
+//
+// Without a header or columns option, three columns are X Y Z, four add
+// Intensity, six add Red Green Blue and seven (PTS) add Intensity and
+// Red Green Blue. A PTS point count line is skipped.
+//
+
+class PDAL_DLL Reader : public pdal::Reader
+{
+public:
+    SET_STAGE_NAME("drivers.text.reader", "Text Reader")
+
+    Reader(const Options& options);
+    ~Reader();
+
+    virtual void initialize();
+    virtual const Options getDefaultOptions() const;
+
+    std::string getFileName() const;
+
+    bool supportsIterator(StageIteratorType t) const
+    {
+        if (t == StageIterator_Sequential) return true;
+        if (t == StageIterator_Random) return true;
+
+        return false;
+    }
+
+    pdal::StageSequentialIterator* createSequentialIterator(PointBuffer& buffer) const;
+    pdal::StageRandomIterator* createRandomIterator(PointBuffer& buffer) const;
+
+    // the character separating columns, or zero for runs of whitespace
+    char getDelimiter() const
+    {
+        return m_delimiter;
+    }
+    boost::uint32_t getNumThreads() const
+    {
+        return m_numThreads;
+    }
+
+    // byte offset in the file of the line holding the given point
+    std::size_t findPoint(boost::uint64_t pointIndex) const;
+
+    // this is called by the stage's iterators
+    //
+    // Parses up to the buffer's capacity of points starting at the byte
+    // offset position, which is moved past the last line read. pointIndex
+    // is the index of the first of those points, and is only used to
+    // report errors.
+    boost::uint32_t processBuffer(PointBuffer& data,
+                                  std::size_t& position,
+                                  boost::uint64_t pointIndex) const;
+
+    // for dumping
+    virtual boost::property_tree::ptree toPTree() const;
+
+private:
+
+    Reader& operator=(const Reader&); // not implemented
+    Reader(const Reader&); // not implemented
+
+    void readLayout(std::size_t& position);
+    std::vector<std::string> splitLine(std::size_t begin, std::size_t end) const;
+    Dimension makeDimension(std::string const& name, std::string type) const;
+
+    boost::iostreams::mapped_file_source m_file;
+    const char* m_data;
+    std::size_t m_size;
+
+    char m_delimiter;
+    boost::uint32_t m_numThreads;
+    std::vector<std::string> m_columns;
+
+    // byte offsets of every s_indexStride'th point, for seeking
+    std::vector<std::size_t> m_index;
+    static const boost::uint64_t s_indexStride;
+};
+
+namespace iterators
+{
+
+namespace sequential
+{
+
+class Reader : public pdal::ReaderSequentialIterator
+{
+public:
+    Reader(const pdal::drivers::text::Reader& reader, PointBuffer& buffer);
+
+private:
+    boost::uint64_t skipImpl(boost::uint64_t);
+    boost::uint32_t readBufferImpl(PointBuffer&);
+    bool atEndImpl() const;
+
+    const pdal::drivers::text::Reader& m_reader;
+    std::size_t m_position;
+};
+
+
+} // sequential
+
+namespace random
+{
+
+class Reader : public pdal::ReaderRandomIterator
+{
+public:
+    Reader(const pdal::drivers::text::Reader& reader, PointBuffer& buffer);
+
+private:
+    boost::uint64_t seekImpl(boost::uint64_t);
+    boost::uint32_t readBufferImpl(PointBuffer&);
+
+    const pdal::drivers::text::Reader& m_reader;
+    std::size_t m_position;
+};
+
+} // random
+} // iterators
+
+}
+}
+} // namespaces
+
+#endif
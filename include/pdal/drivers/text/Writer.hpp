@@ -71,6 +71,19 @@ PDAL_C_END
 
 typedef boost::shared_ptr<std::ostream> FileStreamPtr;
 
+//
+// supported options:
+//   <string>filename  [required]
+//   <string>delimiter
+//   <string>newline
+//   <bool>quote_header
+//   <string>float_format  "fixed" writes floats with the precision of the
+//                         dimension's scale, "shortest" with the fewest
+//                         digits that read back to the same value
+//   <uint32>threads       number of formatting threads (default: one per
+//                         core); the output order is unchanged
+//
+
 class PDAL_DLL Writer : public pdal::Writer
 {
 public:
@@ -96,13 +109,11 @@ private:
     Writer& operator=(const Writer&); // not implemented
     Writer(const Writer&); // not implemented
 
-    std::string getStringRepresentation(PointBuffer const& data,
-                                        Dimension const& d,
-                                        std::size_t pointIndex) const;
-
     void WriteHeader(pdal::Schema const& schema);
     FileStreamPtr m_stream;
     bool m_wrote_header;
+    boost::uint32_t m_numThreads;
+    bool m_shortestFloats;
 };
 
 }
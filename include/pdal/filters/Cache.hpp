@@ -38,28 +38,43 @@
 #include <pdal/Filter.hpp>
 #include <pdal/FilterIterator.hpp>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <map>
+
 namespace pdal
 {
 
 class PointBufferCache;
+class PointBufferSpill;
 class PointBuffer;
 
 namespace filters
 {
 
 //
-// This is just a very simple MRU cache filter. It has the following constraints:
-//   - up to 'numBlocks' will be cached
-//   - we cache blocks of points, of size 'blockSize'
-//   - we only cache full blocks
-//   - we only cache on 'blockSize' boundaries
-//   - we only look into the cache if 1 point is being requested
+// An LRU cache of blocks of points, shared by all the iterators of the
+// filter, including ones on different threads:
+//   - the points are cached in blocks of 'cache_block_size' points,
+//     starting on multiples of the block size
+//   - up to 'max_cache_blocks' blocks are kept, and if 'max_cache_bytes'
+//     is set, no more than that many bytes of them
+//   - the cache is split into 'cache_shards' independently locked shards
+//   - reads of any size and position are put together from the blocks
+//     they cover, reading missing blocks from the previous stage
+//   - after a miss, the 'prefetch_blocks' blocks following it are read too
+//   - if 'spill_bytes' is set, blocks evicted from memory are kept in a
+//     scratch file of up to that size in 'spill_directory', and read back
+//     from it instead of from the previous stage
 //
 class PDAL_DLL Cache : public Filter
 {
 public:
     SET_STAGE_NAME("filters.cache", "Cache Filter")
 
+    typedef boost::shared_ptr<PointBuffer> Block;
+
     Cache(Stage& prevStage, const Options&);
     Cache(Stage& prevStage, boost::uint32_t numBlocks, boost::uint32_t blockSize);
     ~Cache();
@@ -68,12 +83,32 @@ public:
     virtual const Options getDefaultOptions() const;
 
     boost::uint32_t getCacheBlockSize() const;
+    boost::uint64_t getMaxCacheBytes() const;
+    boost::uint32_t getPrefetchBlocks() const;
+    boost::uint32_t getNumCacheShards() const;
+
+    // the bytes held by the cached blocks
+    boost::uint64_t getCacheBytes() const;
 
-    // this is const only because the m_cache itself is mutable
+    // the disk tier, or NULL if there is none
+    const PointBufferSpill* getSpill() const;
+
+    // this is const only because the m_cache itself is mutable;
+    // data must start on a block boundary
     void addToCache(boost::uint64_t pointIndex, const PointBuffer& data) const;
 
+    // the cached block holding pointIndex, or NULL; only safe to use
+    // while no other thread is reading through the filter
     const PointBuffer* lookupInCache(boost::uint64_t pointIndex) const;
 
+    // the cached block with the given number, or an empty pointer
+    Block lookupBlock(boost::uint64_t blockNum) const;
+
+    // caches a block the caller allocated and filled, taking ownership;
+    // returns the block now cached under blockNum, which is an earlier
+    // one if another iterator got there first
+    Block insertBlock(boost::uint64_t blockNum, PointBuffer* block) const;
+
     // clear cache (but leave cache params unchanged)
     void resetCache();
 
@@ -106,16 +141,20 @@ public:
 
 private:
     // these are mutable to allow const-ness for updating stats
-    // BUG: need to make thread-safe
     mutable boost::uint64_t m_numPointsRequested;
     mutable boost::uint64_t m_numPointsRead;
+    mutable boost::mutex m_statsMutex;
 
-    // these is mutable to allow const-ness for updating stats
-    // BUG: need to make thread-safe
-    mutable PointBufferCache* m_cache;
+    // the cache does its own locking
+    PointBufferCache* m_cache;
 
     boost::uint32_t m_maxCacheBlocks;
     boost::uint32_t m_cacheBlockSize;
+    boost::uint64_t m_maxCacheBytes;
+    boost::uint32_t m_numCacheShards;
+    boost::uint32_t m_prefetchBlocks;
+    boost::uint64_t m_maxSpillBytes;
+    std::string m_spillDirectory;
 
     Cache& operator=(const Cache&); // not implemented
     Cache(const Cache&); // not implemented
@@ -131,12 +170,24 @@ class PDAL_DLL Cache : public pdal::FilterSequentialIterator
 public:
     Cache(const pdal::filters::Cache& filter, PointBuffer& buffer);
 
+    // the block with the given number, from the cache or else read from
+    // the previous stage; empty past the end of the points
+    pdal::filters::Cache::Block getBlock(boost::uint64_t blockNum);
+
 private:
     boost::uint64_t skipImpl(boost::uint64_t);
     boost::uint32_t readBufferImpl(PointBuffer&);
     bool atEndImpl() const;
 
+    boost::uint32_t readUncached(PointBuffer&, boost::uint64_t index);
+    pdal::filters::Cache::Block fetchBlock(boost::uint64_t blockNum);
+
     const pdal::filters::Cache& m_filter;
+
+    // The previous stage can't go back, so the blocks from the current one
+    // on that it has already passed are held here until we are done with
+    // them, whatever the cache evicts meanwhile.
+    std::map<boost::uint64_t, pdal::filters::Cache::Block> m_held;
 };
 
 }
@@ -153,11 +204,22 @@ class PDAL_DLL Cache : public pdal::FilterRandomIterator
 public:
     Cache(const pdal::filters::Cache& filter, PointBuffer& buffer);
 
+    // the block with the given number, from the cache or else read from
+    // the previous stage; empty past the end of the points
+    pdal::filters::Cache::Block getBlock(boost::uint64_t blockNum);
+
 private:
     boost::uint64_t seekImpl(boost::uint64_t);
     boost::uint32_t readBufferImpl(PointBuffer&);
 
+    boost::uint32_t readUncached(PointBuffer&, boost::uint64_t index);
+    pdal::filters::Cache::Block fetchBlock(boost::uint64_t blockNum);
+
     const pdal::filters::Cache& m_filter;
+
+    // the last block used, which small reads mostly hit again
+    boost::uint64_t m_lastBlockNum;
+    pdal::filters::Cache::Block m_lastBlock;
 };
 
 
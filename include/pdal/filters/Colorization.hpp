@@ -38,9 +38,12 @@
 #include <pdal/Filter.hpp>
 #include <pdal/FilterIterator.hpp>
 
+#include <list>
 #include <map>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 #include <boost/array.hpp>
+#include <boost/function.hpp>
 
 
 namespace pdal
@@ -62,6 +65,96 @@ namespace colorization
 
 typedef boost::shared_ptr<void> DataSourcePtr;
 
+// A least-recently-used cache of raster blocks, each holding every band
+// being read, and pixel lookups from it.  Pixel and line positions are
+// fractional raster coordinates, with (0, 0) the top left corner of the
+// top left pixel.
+class PDAL_DLL TileCache
+{
+public:
+    // Fills data with the block at (blockX, blockY): one plane of
+    // blockXSize * blockYSize doubles per band, rows in order.  Blocks at
+    // the right and bottom edges are only partly filled.
+    typedef boost::function<void(boost::int32_t, boost::int32_t, double*)> Loader;
+
+    TileCache(Loader loader,
+              boost::int32_t rasterXSize,
+              boost::int32_t rasterYSize,
+              boost::int32_t blockXSize,
+              boost::int32_t blockYSize,
+              boost::uint32_t numBands,
+              boost::uint32_t maxTiles);
+
+    bool contains(double pixel, double line) const
+    {
+        return pixel >= 0.0 && line >= 0.0 &&
+               pixel < m_rasterXSize && line < m_rasterYSize;
+    }
+
+    // The values of the pixel containing (pixel, line), one per band.
+    // Returns false if the position is outside the raster.
+    bool getNearest(double pixel, double line, double* values);
+
+    // Values interpolated between the four pixel centres around
+    // (pixel, line), extending the edge pixels outwards.  Returns false
+    // if the position is outside the raster.
+    bool getBilinear(double pixel, double line, double* values);
+
+    // The block at (blockX, blockY), loading it if needed.
+    const double* getTile(boost::int32_t blockX, boost::int32_t blockY);
+
+    // A key for the block containing (pixel, line), which must be inside
+    // the raster; sorting points on it groups them by block.
+    boost::uint64_t getTileIndex(double pixel, double line) const;
+
+    boost::int32_t getBlockXSize() const
+    {
+        return m_blockXSize;
+    }
+    boost::int32_t getBlockYSize() const
+    {
+        return m_blockYSize;
+    }
+    boost::uint64_t getNumHits() const
+    {
+        return m_numHits;
+    }
+    boost::uint64_t getNumMisses() const
+    {
+        return m_numMisses;
+    }
+
+private:
+    typedef std::pair<boost::int32_t, boost::int32_t> Key;
+    struct Tile
+    {
+        std::vector<double> data;
+        std::list<Key>::iterator lru;
+    };
+
+    double getPixel(boost::int32_t pixel, boost::int32_t line, boost::uint32_t band);
+
+    Loader m_loader;
+    boost::int32_t m_rasterXSize;
+    boost::int32_t m_rasterYSize;
+    boost::int32_t m_blockXSize;
+    boost::int32_t m_blockYSize;
+    boost::uint32_t m_numBands;
+    boost::uint32_t m_maxTiles;
+
+    std::map<Key, Tile> m_tiles;
+    std::list<Key> m_lru;
+    // the most recently used tile, which most lookups hit
+    Key m_lastKey;
+    const double* m_lastTile;
+
+    boost::uint64_t m_numHits;
+    boost::uint64_t m_numMisses;
+
+    TileCache& operator=(const TileCache&); // not implemented
+    TileCache(const TileCache&); // not implemented
+};
+
 } // colorization
 
 // Provides GDAL-based raster overlay that places output data in
@@ -112,6 +205,14 @@ public:
     {
         return m_scale_map;
     }
+    boost::uint32_t getTileCacheSize() const
+    {
+        return m_tileCacheSize;
+    }
+    bool isBilinear() const
+    {
+        return m_bilinear;
+    }
 
 private:
     void collectOptions();
@@ -124,6 +225,8 @@ private:
     boost::array<double, 6> m_forward_transform;
     boost::array<double, 6> m_inverse_transform;
     boost::uint32_t m_scale;
+    boost::uint32_t m_tileCacheSize;
+    bool m_bilinear;
 
 
     Colorization& operator=(const Colorization&); // not implemented
@@ -155,20 +258,24 @@ private:
                         double value,
                         Dimension const& d,
                         std::size_t pointIndex) const;
-    bool getPixelAndLinePosition(double x,
-                                 double y,
-                                 boost::array<double, 6> const& inverse,
-                                 boost::int32_t& pixel,
-                                 boost::int32_t& line,
-                                 colorization::DataSourcePtr ds);
+    void loadTile(boost::int32_t blockX, boost::int32_t blockY, double* data);
 
     Dimension const* m_dimX;
     Dimension const* m_dimY;
 
+    std::vector<std::string> m_names;
     std::vector<Dimension const*> m_dimensions;
-    std::vector<boost::uint32_t> m_bands;
+    std::vector<int> m_bands;
     std::vector<double> m_scales;
     const pdal::filters::Colorization& m_stage;
+
+    boost::shared_ptr<colorization::TileCache> m_cache;
+    // (tile, point) pairs for the current buffer, and the pixel and line
+    // of each point
+    std::vector<std::pair<boost::uint64_t, boost::uint32_t> > m_order;
+    std::vector<double> m_pixels;
+    std::vector<double> m_lines;
+    std::vector<double> m_values;
 };
 
 
@@ -39,9 +39,15 @@
 #include <pdal/FilterIterator.hpp>
 #include <pdal/Bounds.hpp>
 
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
 namespace pdal
 {
 class PointBuffer;
+class Schema;
 }
 
 namespace pdal
@@ -49,7 +55,222 @@ namespace pdal
 namespace filters
 {
 
-// removes any points outside of the given range
+namespace crop
+{
+
+// A polygon or multipolygon, read from WKT.  Holes and multiple parts
+// are handled with the even-odd rule.
+//
+// A uniform grid covers the polygon's extent.  Grid cells that no edge
+// passes through are known to be inside or outside, so most points cost
+// about as much as a bounding box test; points in the other cells are
+// tested against only the edges crossing their row of the grid.
+class PDAL_DLL Polygon
+{
+public:
+    Polygon();
+
+    // Accepts POLYGON and MULTIPOLYGON, with or without Z and M values,
+    // which are ignored.
+    explicit Polygon(std::string const& wkt);
+
+    bool empty() const
+    {
+        return m_edges.empty();
+    }
+
+    // The two-dimensional extent of the polygon.
+    Bounds<double> const& getBounds() const
+    {
+        return m_bounds;
+    }
+
+    bool contains(double x, double y) const;
+
+private:
+    struct Edge
+    {
+        double x0;
+        double y0;
+        double x1;
+        double y1;
+    };
+
+    enum CellState
+    {
+        Cell_Outside,
+        Cell_Inside,
+        Cell_Boundary
+    };
+
+    void addRing(std::vector<double> const& ring);
+    void buildIndex();
+    bool crossings(double x, double y, boost::uint32_t row) const;
+    boost::uint32_t getColumn(double x) const;
+    boost::uint32_t getRow(double y) const;
+
+    std::vector<Edge> m_edges;
+    Bounds<double> m_bounds;
+
+    double m_minX;
+    double m_minY;
+    double m_cellWidth;
+    double m_cellHeight;
+    boost::uint32_t m_numColumns;
+    boost::uint32_t m_numRows;
+    std::vector<boost::uint8_t> m_cells;
+    // the edges overlapping row r are m_rowEdges[m_rowStart[r]] up to
+    // m_rowEdges[m_rowStart[r + 1]]
+    std::vector<boost::uint32_t> m_rowStart;
+    std::vector<boost::uint32_t> m_rowEdges;
+};
+
+
+// Finds which of a set of regions contain a point, using a grid over the
+// regions' extents, and routes the points of a buffer to one output
+// buffer per region in a single pass.
+class PDAL_DLL Router
+{
+public:
+    explicit Router(std::vector<Polygon> const& regions);
+
+    std::size_t getNumRegions() const
+    {
+        return m_regions.size();
+    }
+    std::vector<Polygon> const& getRegions() const
+    {
+        return m_regions;
+    }
+    // The two-dimensional extent of all the regions.
+    Bounds<double> const& getBounds() const
+    {
+        return m_bounds;
+    }
+
+    // Is (x, y) inside any of the regions?
+    bool contains(double x, double y) const;
+
+    // Sets regions to the indices of the regions containing (x, y).
+    void find(double x, double y, std::vector<std::size_t>& regions) const;
+
+    // Appends each point of src to outputs[i] for every region i that
+    // contains it.  The outputs must have src's schema and room for the
+    // points.  Returns the number of points inside any region.
+    boost::uint32_t route(PointBuffer const& src, std::vector<PointBuffer*> const& outputs) const;
+
+private:
+    boost::uint32_t getCell(double x, double y) const;
+
+    std::vector<Polygon> m_regions;
+    Bounds<double> m_bounds;
+
+    double m_minX;
+    double m_minY;
+    double m_cellWidth;
+    double m_cellHeight;
+    boost::uint32_t m_numColumns;
+    boost::uint32_t m_numRows;
+    // the regions overlapping cell c are m_cellRegions[m_cellStart[c]] up
+    // to m_cellRegions[m_cellStart[c + 1]]
+    std::vector<boost::uint32_t> m_cellStart;
+    std::vector<boost::uint32_t> m_cellRegions;
+};
+
+
+// Reads a scaled X or Y value from the bytes of a point.
+struct PDAL_DLL Coordinate
+{
+    typedef double (*Function)(boost::uint8_t const* point, Coordinate const& coordinate);
+
+    Coordinate();
+    explicit Coordinate(Dimension const& dimension);
+
+    double read(boost::uint8_t const* point) const
+    {
+        return function(point, *this);
+    }
+
+    Function function;
+    std::size_t offset;
+    double scale;
+    double shift;
+};
+
+
+// A crop box compiled against a schema.  The bounds are converted once
+// into the raw storage domain of the X, Y and Z dimensions, so points are
+// tested on their stored integers without applying scale and offset.
+// Buffers whose spatial bounds are known and lie entirely inside or
+// outside the box are accepted or rejected without looking at points.
+//
+// Bounds with two dimensions crop on X and Y only.  Points that pass the
+// box may additionally be tested against a set of regions, and the
+// selection may be inverted to keep the points outside.
+class PDAL_DLL Plan
+{
+public:
+    Plan();
+
+    void compile(Bounds<double> const& bounds,
+                 Schema const& schema,
+                 boost::shared_ptr<Router> regions = boost::shared_ptr<Router>(),
+                 bool outside = false);
+    bool isCompiled() const
+    {
+        return m_compiled;
+    }
+
+    // Appends the points of src inside the bounds to dst, which must have
+    // the same schema and room for them.  Returns the number appended.
+    boost::uint32_t apply(PointBuffer& dst, PointBuffer const& src);
+
+    // A range of raw values for one dimension, and the test that checks it.
+    struct Test
+    {
+        typedef void (*Function)(boost::uint8_t const* data,
+                                 std::size_t stride,
+                                 boost::uint32_t count,
+                                 Test const& test,
+                                 boost::uint8_t* mask);
+
+        Function function;
+        std::size_t offset;
+        boost::int64_t lowerSigned;
+        boost::int64_t upperSigned;
+        boost::uint64_t lowerUnsigned;
+        boost::uint64_t upperUnsigned;
+        double lower;
+        double upper;
+    };
+
+private:
+    enum Coverage
+    {
+        Coverage_None,
+        Coverage_Partial,
+        Coverage_All
+    };
+
+    Coverage getCoverage(Bounds<double> const& extent) const;
+    boost::uint32_t copy(PointBuffer& dst, PointBuffer const& src, boost::uint8_t keep);
+
+    Bounds<double> m_bounds;
+    boost::shared_ptr<Router> m_regions;
+    bool m_outside;
+    Coordinate m_x;
+    Coordinate m_y;
+    bool m_compiled;
+    // no raw value of some dimension can be inside the bounds
+    bool m_empty;
+    std::vector<Test> m_tests;
+    std::vector<boost::uint8_t> m_mask;
+};
+
+} // crop
+
+// removes any points outside of the given range, or of the given
+// polygons, or (with the 'outside' option) any points inside them
 // updates the header accordingly
 class PDAL_DLL Crop : public Filter
 {
@@ -58,6 +279,7 @@ public:
 
     Crop(Stage& prevStage, const Options&);
     Crop(Stage& prevStage, Bounds<double> const& bounds);
+    Crop(Stage& prevStage, std::vector<crop::Polygon> const& polygons, bool outside = false);
 
     virtual void initialize();
     virtual const Options getDefaultOptions() const;
@@ -80,9 +302,19 @@ public:
     boost::uint32_t processBuffer(PointBuffer& dstData, const PointBuffer& srcData) const;
 
     const Bounds<double>& getBounds() const;
+    boost::shared_ptr<crop::Router> getRegions() const
+    {
+        return m_regions;
+    }
+    bool isOutside() const
+    {
+        return m_outside;
+    }
 
 private:
     Bounds<double> m_bounds;
+    boost::shared_ptr<crop::Router> m_regions;
+    bool m_outside;
 
     Crop& operator=(const Crop&); // not implemented
     Crop(const Crop&); // not implemented
@@ -104,8 +336,10 @@ private:
     boost::uint64_t skipImpl(boost::uint64_t);
     boost::uint32_t readBufferImpl(PointBuffer&);
     bool atEndImpl() const;
+    void readBufferBeginImpl(PointBuffer&);
 
     const pdal::filters::Crop& m_cropFilter;
+    crop::Plan m_plan;
 };
 
 
@@ -38,6 +38,13 @@
 #include <pdal/Filter.hpp>
 #include <pdal/FilterIterator.hpp>
 
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include <vector>
+
 namespace pdal
 {
 class PointBuffer;
@@ -48,13 +55,146 @@ namespace pdal
 namespace filters
 {
 
+namespace decimation
+{
+
+// Keeps one point per occupied cube of a grid.  Points are binned on their
+// stored X, Y and Z values, so no scaling is applied per point.
+//
+// In "first" mode the first point seen in each voxel is kept, and the set
+// of occupied voxels is remembered across buffers, costing one key per
+// point kept.  In "centroid" mode the points of each voxel are averaged
+// into the first of them, one source buffer at a time, so a voxel that
+// straddles two buffers yields two points.
+class PDAL_DLL VoxelGrid
+{
+public:
+    VoxelGrid(double size, bool centroid);
+
+    // Resets the grid for the given schema.
+    void compile(Schema const& schema);
+    bool isCompiled() const
+    {
+        return m_compiled;
+    }
+
+    // Appends the kept points of src to dst, which must have the same
+    // schema and room for them.  Returns the number appended.
+    boost::uint32_t apply(PointBuffer& dst, PointBuffer const& src);
+
+    // the number of voxels remembered as occupied
+    std::size_t getNumVoxels() const
+    {
+        return m_seen.size();
+    }
+
+    struct Key
+    {
+        boost::int64_t x;
+        boost::int64_t y;
+        boost::int64_t z;
+
+        bool operator==(Key const& other) const
+        {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(Key const& key) const;
+    };
+
+    // Reads and writes one stored coordinate, and maps it to a voxel index
+    // as floor(raw * scale + shift).
+    struct Axis
+    {
+        typedef double (*Reader)(boost::uint8_t const* point);
+        typedef void (*Writer)(boost::uint8_t* point, double value);
+
+        Reader read;
+        Writer write;
+        std::size_t offset;
+        double scale;
+        double shift;
+    };
+
+private:
+    struct Sum
+    {
+        boost::uint32_t first;
+        boost::uint32_t count;
+        double x;
+        double y;
+        double z;
+    };
+
+    bool getKey(boost::uint8_t const* point, Key& key) const;
+    boost::uint32_t applyFirst(PointBuffer& dst, PointBuffer const& src);
+    boost::uint32_t applyCentroid(PointBuffer& dst, PointBuffer const& src);
+
+    double m_size;
+    bool m_centroid;
+    bool m_compiled;
+    bool m_hasZ;
+    Axis m_x;
+    Axis m_y;
+    Axis m_z;
+
+    boost::unordered_set<Key, KeyHash> m_seen;
+    boost::unordered_map<Key, boost::uint32_t, KeyHash> m_slots;
+    std::vector<Sum> m_sums;
+    std::vector<boost::uint8_t> m_mask;
+};
+
+
+// Keeps a uniform random sample of exactly count of the total points,
+// choosing each point as it streams past with the probability that
+// selection sampling gives it (Knuth's algorithm S), so no points are
+// held back.
+class PDAL_DLL RandomSample
+{
+public:
+    // A seed of 0 leaves the generator unseeded.
+    RandomSample(boost::uint64_t count, boost::uint64_t total, boost::uint32_t seed);
+
+    boost::uint32_t apply(PointBuffer& dst, PointBuffer const& src);
+
+    // have all count points been chosen?
+    bool done() const
+    {
+        return m_needed == 0;
+    }
+
+private:
+    boost::uint64_t m_needed;
+    boost::uint64_t m_remaining;
+    boost::random::mt19937 m_rng;
+};
+
+} // decimation
+
 
 // we keep only 1 out of every step points; if step=100, we get 1% of the file
+//
+// If the previous stage supports random iterators, the skipped points are
+// never read at all: we ask the previous stage for a strided read instead.
+//
+// With mode=voxel we instead keep one point per voxel_size cube, either the
+// first point in it or (voxel_method=centroid) the average of its points;
+// with mode=random we keep a uniform random sample of count points.
 class PDAL_DLL Decimation : public Filter
 {
 public:
     SET_STAGE_NAME("filters.decimation", "Decimation Filter")
 
+    enum Mode
+    {
+        Mode_Stride,
+        Mode_Voxel,
+        Mode_Random
+    };
+
     Decimation(Stage& prevStage, const Options&);
     Decimation(Stage& prevStage, boost::uint32_t step);
 
@@ -75,11 +215,36 @@ public:
     }
 
     boost::uint32_t getStep() const;
+    Mode getMode() const
+    {
+        return m_mode;
+    }
+    double getVoxelSize() const
+    {
+        return m_voxelSize;
+    }
+    bool isCentroid() const
+    {
+        return m_centroid;
+    }
+    boost::uint64_t getCount() const
+    {
+        return m_count;
+    }
+    boost::uint32_t getSeed() const
+    {
+        return m_seed;
+    }
 
     boost::uint32_t processBuffer(PointBuffer& dstData, const PointBuffer& srcData, boost::uint64_t srcStartIndex) const;
 
 private:
+    Mode m_mode;
     boost::uint32_t m_step;
+    double m_voxelSize;
+    bool m_centroid;
+    boost::uint64_t m_count;
+    boost::uint32_t m_seed;
 
     Decimation& operator=(const Decimation&); // not implemented
     Decimation(const Decimation&); // not implemented
@@ -99,10 +264,20 @@ public:
 
 private:
     boost::uint64_t skipImpl(boost::uint64_t);
+    void readBufferBeginImpl(PointBuffer&);
     boost::uint32_t readBufferImpl(PointBuffer&);
     bool atEndImpl() const;
 
+    boost::uint32_t processBuffer(PointBuffer& dstData, const PointBuffer& srcData, boost::uint64_t srcStartIndex);
+
     const pdal::filters::Decimation& m_filter;
+
+    // only set if the previous stage can do strided reads for us
+    boost::scoped_ptr<pdal::StageRandomIterator> m_stridedIterator;
+
+    // only one of these is set, for the voxel and random modes
+    boost::scoped_ptr<decimation::VoxelGrid> m_voxels;
+    boost::scoped_ptr<decimation::RandomSample> m_sample;
 };
 
 
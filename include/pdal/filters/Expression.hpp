@@ -0,0 +1,285 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_FILTERS_EXPRESSIONFILTER_HPP
+#define INCLUDED_FILTERS_EXPRESSIONFILTER_HPP
+
+#include <pdal/Filter.hpp>
+#include <pdal/FilterIterator.hpp>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace pdal
+{
+class PointBuffer;
+class Schema;
+}
+
+namespace pdal
+{
+namespace filters
+{
+
+namespace expression
+{
+
+// A parsed expression: statements separated by semicolons, each either an
+// assignment to a dimension or a condition points must meet to be kept.
+//
+//     Classification == 2 && Z > 100
+//     Intensity = Intensity * 0.5; Z > 100
+//
+// Dimensions are read and written as scaled values.  The operators are
+// those of C: || && ! == != < <= > >= + - * / and parentheses, with
+// abs(), sqrt(), floor(), ceil(), round(), min() and max().  Comparisons
+// and logical operators give 1 or 0, and any value other than 0 is true.
+class PDAL_DLL Program
+{
+public:
+    explicit Program(std::string const& source);
+
+    std::string const& getSource() const
+    {
+        return m_source;
+    }
+
+    // does any statement remove points?
+    bool hasCondition() const;
+
+    // does any statement assign to X, Y or Z?
+    bool movesPoints() const;
+
+    enum Operator
+    {
+        Op_Or,
+        Op_And,
+        Op_Equal,
+        Op_NotEqual,
+        Op_Less,
+        Op_LessEqual,
+        Op_Greater,
+        Op_GreaterEqual,
+        Op_Add,
+        Op_Subtract,
+        Op_Multiply,
+        Op_Divide,
+        Op_Min,
+        Op_Max,
+        Op_Negate,
+        Op_Not,
+        Op_Abs,
+        Op_Sqrt,
+        Op_Floor,
+        Op_Ceil,
+        Op_Round
+    };
+
+    struct Node
+    {
+        enum Kind
+        {
+            Kind_Number,
+            Kind_Dimension,
+            Kind_Unary,
+            Kind_Binary
+        };
+
+        Kind kind;
+        Operator op;
+        double value;
+        std::string name;
+        std::size_t lhs;
+        std::size_t rhs;
+    };
+
+    struct Statement
+    {
+        // the dimension assigned to, or empty for a condition
+        std::string target;
+        std::size_t root;
+    };
+
+    std::vector<Node> const& getNodes() const
+    {
+        return m_nodes;
+    }
+    std::vector<Statement> const& getStatements() const
+    {
+        return m_statements;
+    }
+
+private:
+    friend class Parser;
+
+    std::string m_source;
+    std::vector<Node> m_nodes;
+    std::vector<Statement> m_statements;
+};
+
+
+// A Program compiled against a schema into instructions that each work on
+// a block of points at a time.  Constant operands are folded into the
+// instructions rather than loaded.  A Kernel holds the scratch space it
+// runs in, so each thread needs its own; the Program may be shared.
+class PDAL_DLL Kernel
+{
+public:
+    Kernel(Program const& program, Schema const& schema);
+
+    // Runs the statements over every point of buffer, writing assignments
+    // in place, and returns the number of points meeting the conditions.
+    // A buffer whose points are moved loses its spatial bounds.
+    boost::uint32_t run(PointBuffer& buffer);
+
+    // Runs the statements over src and appends the points meeting the
+    // conditions to dst, which must have the same schema and room for them.
+    boost::uint32_t apply(PointBuffer& dst, PointBuffer& src);
+
+    static const boost::uint32_t s_blockSize = 256;
+
+    struct Context
+    {
+        boost::uint8_t* data;
+        std::size_t stride;
+        boost::uint32_t count;
+        double* registers;
+        boost::uint8_t* mask;
+    };
+
+    struct Instruction
+    {
+        typedef void (*Function)(Instruction const& instruction, Context& context);
+
+        Function function;
+        // registers, each s_blockSize values
+        std::size_t dst;
+        std::size_t lhs;
+        std::size_t rhs;
+        double constant;
+        // for loads and stores
+        std::size_t offset;
+        double scale;
+        double shift;
+    };
+
+private:
+    std::size_t compile(Program const& program, Schema const& schema, std::size_t node, std::size_t reg);
+    Instruction getAccess(Schema const& schema, std::string const& name, bool store) const;
+
+    std::vector<Instruction> m_instructions;
+    std::size_t m_numRegisters;
+    bool m_hasCondition;
+    bool m_movesPoints;
+    std::vector<double> m_registers;
+    std::vector<boost::uint8_t> m_mask;
+};
+
+} // expression
+
+
+// evaluates an expression over each point, keeping the points that meet
+// its conditions and writing its assignments into the points kept
+class PDAL_DLL Expression : public Filter
+{
+public:
+    SET_STAGE_NAME("filters.expression", "Expression Filter")
+
+    Expression(Stage& prevStage, const Options&);
+    Expression(Stage& prevStage, std::string const& expression);
+
+    virtual void initialize();
+    virtual const Options getDefaultOptions() const;
+
+    bool supportsIterator(StageIteratorType t) const
+    {
+        if (t == StageIterator_Sequential) return true;
+
+        return false;
+    }
+
+    pdal::StageSequentialIterator* createSequentialIterator(PointBuffer& buffer) const;
+    pdal::StageRandomIterator* createRandomIterator(PointBuffer&) const
+    {
+        return NULL;
+    }
+
+    // returns number of points appended to dstData; srcData gets the
+    // assignments
+    boost::uint32_t processBuffer(PointBuffer& dstData, PointBuffer& srcData) const;
+
+    const expression::Program& getProgram() const
+    {
+        return m_program;
+    }
+
+private:
+    expression::Program m_program;
+
+    Expression& operator=(const Expression&); // not implemented
+    Expression(const Expression&); // not implemented
+};
+
+
+namespace iterators
+{
+namespace sequential
+{
+
+
+class PDAL_DLL Expression : public pdal::FilterSequentialIterator
+{
+public:
+    Expression(const pdal::filters::Expression& filter, PointBuffer& buffer);
+
+private:
+    boost::uint64_t skipImpl(boost::uint64_t);
+    boost::uint32_t readBufferImpl(PointBuffer&);
+    bool atEndImpl() const;
+    void readBufferBeginImpl(PointBuffer&);
+
+    const pdal::filters::Expression& m_expressionFilter;
+    boost::scoped_ptr<expression::Kernel> m_kernel;
+};
+
+
+}
+} // namespaces
+
+}
+} // namespaces
+
+#endif
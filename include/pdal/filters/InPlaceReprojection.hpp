@@ -39,10 +39,14 @@
 #include <pdal/FilterIterator.hpp>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
 
 
 namespace pdal
 {
+class ApproximateTransform;
 class PointBuffer;
 namespace gdal
 {
@@ -96,6 +100,13 @@ public:
 
     void transform(double& x, double& y, double& z) const;
 
+    // Transforms count points, interpolating them if approximation_error
+    // is set.
+    void transform(double* x, double* y, double* z, boost::uint32_t count) const;
+
+    // Transforms count points in one call to the transformer.
+    void transformExact(double* x, double* y, double* z, boost::uint32_t count) const;
+
 private:
 
 
@@ -110,6 +121,11 @@ private:
     TransformPtr m_transform_ptr;
 
     boost::shared_ptr<pdal::gdal::Debug> m_gdal_debug;
+    boost::shared_ptr<ApproximateTransform> m_approximation;
+    // The approximation fills in its grid as points arrive and the GDAL
+    // transformer keeps state between calls, so although the processing
+    // is const, transform() holds this while it uses either of them.
+    mutable boost::mutex m_transformMutex;
 
     InPlaceReprojection& operator=(const InPlaceReprojection&); // not implemented
     InPlaceReprojection(const InPlaceReprojection&); // not implemented
@@ -147,6 +163,11 @@ private:
     
 
     const pdal::filters::InPlaceReprojection& m_reprojectionFilter;
+
+    // coordinates of the current buffer, transformed in one batch
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
 };
 
 
@@ -38,61 +38,195 @@
 #endif
 
 #include <pdal/PointBuffer.hpp>
+#include <pdal/filters/PointBufferSpill.hpp>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
 
 
 namespace pdal
 {
 
 
+// An LRU cache of PointBuffers, keyed by block number.  It is split into
+// shards, each with its own lock and its own share of the limits, so that
+// iterators on different threads mostly take different locks; key k lives
+// in shard k % numShards.  A cache is bounded by a number of buffers and,
+// optionally, by the bytes the buffers hold.  Given a PointBufferSpill,
+// buffers evicted from memory are written to it, and read back from it
+// (and cached again) when they are looked up.
 class PDAL_DLL PointBufferCache
 {
 public:
+    typedef boost::shared_ptr<PointBuffer> Block;
 
-    typedef int dummy_type;
-
-    // Bimap with key access on left view, key access
-    // history on right view, and associated value.
-    typedef boost::bimaps::bimap<
-    boost::bimaps::set_of<boost::uint64_t>,
-          boost::bimaps::list_of<dummy_type>,
-          boost::bimaps::with_info<PointBuffer*>
-          > cache_type;
-
-    // Constuctor specifies the cached function and
-    // the maximum number of records to be stored.
+    // A single shard holding at most c buffers.
     PointBufferCache(size_t c)
-        :_capacity(c)
-        , m_numCacheLookupMisses(0)
-        , m_numCacheLookupHits(0)
-        , m_numCacheInsertMisses(0)
-        , m_numCacheInsertHits(0)
+        : m_maxBytes(0)
     {
-        assert(_capacity!=0);
+        assert(c != 0);
+        m_shards.push_back(ShardPtr(new Shard(c, 0)));
     }
 
-    ~PointBufferCache()
+    // maxBytes of 0 means no byte limit.  Every shard gets at least one
+    // buffer, so there are never more shards than maxBlocks.
+    PointBufferCache(size_t maxBlocks, boost::uint64_t maxBytes, size_t numShards)
+        : m_maxBytes(maxBytes)
     {
-        for (cache_type::left_iterator it =_cache.left.begin(); it != _cache.left.end(); ++it)
+        assert(maxBlocks != 0);
+        numShards = std::max<size_t>(std::min(numShards, maxBlocks), 1);
+        for (size_t i = 0; i < numShards; ++i)
         {
-            PointBuffer* data = it->info;
-            delete data;
+            const size_t blocks = maxBlocks / numShards + (i < maxBlocks % numShards ? 1 : 0);
+            m_shards.push_back(ShardPtr(new Shard(blocks, maxBytes / numShards)));
         }
-        return;
     }
 
+    // The buffer stays valid until it is evicted, so this is only safe
+    // when no other thread inserts into the cache; use acquire() otherwise.
     PointBuffer* lookup(boost::uint64_t k)
     {
-        // Attempt to find existing record
-        const cache_type::left_iterator it =_cache.left.find(k);
+        return acquire(k).get();
+    }
 
-        if (it==_cache.left.end())
+    // A shared reference to the cached buffer, or an empty one.
+    Block acquire(boost::uint64_t k)
+    {
+        Block v = shard(k).lookup(k);
+        if (!v && m_spill)
         {
-            // We don't have it:
-            ++m_numCacheLookupMisses;
-            return NULL;
+            PointBuffer* spilled = m_spill->get(k);
+            if (spilled)
+            {
+                Evicted evicted;
+                v = shard(k).insert(k, Block(spilled), &evicted);
+                spill(evicted);
+            }
         }
-        else
+        return v;
+    }
+
+    // When something is inserted into the cache, the cache
+    // takes ownership (deletion responsibility) for it.  If k is already
+    // cached, v is deleted and the cached buffer is returned instead, so
+    // threads racing to fill the same block end up sharing one.
+    PointBuffer* insert(boost::uint64_t k, PointBuffer* v)
+    {
+        // reinserting the cached buffer itself must not give it a second owner
+        const Block cached = shard(k).peek(k);
+        if (cached.get() == v)
+            return v;
+        return share(k, v).get();
+    }
+
+    Block share(boost::uint64_t k, PointBuffer* v)
+    {
+        Evicted evicted;
+        const Block cached = shard(k).insert(k, Block(v), m_spill ? &evicted : NULL);
+        spill(evicted);
+        return cached;
+    }
+
+    // Evicted buffers are written to spill from now on.
+    void setSpill(boost::shared_ptr<PointBufferSpill> spill)
+    {
+        m_spill = spill;
+    }
+
+    const PointBufferSpill* getSpill() const
+    {
+        return m_spill.get();
+    }
+
+    size_t getNumShards() const
+    {
+        return m_shards.size();
+    }
+
+    // The byte limit, or 0 if there is none.
+    boost::uint64_t getMaxBytes() const
+    {
+        return m_maxBytes;
+    }
+
+    // The bytes held by the cached buffers, counted at their capacity.
+    boost::uint64_t getNumBytes() const
+    {
+        boost::uint64_t bytes = 0;
+        for (size_t i = 0; i < m_shards.size(); ++i)
+            bytes += m_shards[i]->numBytes();
+        return bytes;
+    }
+
+    // Obtain the cached keys, most recently used element
+    // at head, least recently used at tail, one shard after another.
+    // This method is provided purely to support testing.
+    template <typename IT> void get_keys(IT dst) const
+    {
+        for (size_t i = 0; i < m_shards.size(); ++i)
+            m_shards[i]->get_keys(dst);
+    }
+
+    void getCacheStats(boost::uint64_t& numCacheLookupMisses,
+                       boost::uint64_t& numCacheLookupHits,
+                       boost::uint64_t& numCacheInsertMisses,
+                       boost::uint64_t& numCacheInsertHits) const
+    {
+        numCacheLookupMisses = 0;
+        numCacheLookupHits = 0;
+        numCacheInsertMisses = 0;
+        numCacheInsertHits = 0;
+        for (size_t i = 0; i < m_shards.size(); ++i)
+            m_shards[i]->addCacheStats(numCacheLookupMisses,
+                                       numCacheLookupHits,
+                                       numCacheInsertMisses,
+                                       numCacheInsertHits);
+    }
+
+private:
+    typedef int dummy_type;
+
+    // Bimap with key access on left view, key access
+    // history on right view, and associated value.
+    typedef boost::bimaps::bimap<
+    boost::bimaps::set_of<boost::uint64_t>,
+          boost::bimaps::list_of<dummy_type>,
+          boost::bimaps::with_info<Block>
+          > cache_type;
+
+    typedef std::vector<std::pair<boost::uint64_t, Block> > Evicted;
+
+    class Shard
+    {
+    public:
+        Shard(size_t capacity, boost::uint64_t maxBytes)
+            : _capacity(std::max<size_t>(capacity, 1))
+            , m_maxBytes(maxBytes)
+            , m_numBytes(0)
+            , m_numCacheLookupMisses(0)
+            , m_numCacheLookupHits(0)
+            , m_numCacheInsertMisses(0)
+            , m_numCacheInsertHits(0)
         {
+            return;
+        }
+
+        Block lookup(boost::uint64_t k)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            // Attempt to find existing record
+            const cache_type::left_iterator it =_cache.left.find(k);
+
+            if (it==_cache.left.end())
+            {
+                // We don't have it:
+                ++m_numCacheLookupMisses;
+                return Block();
+            }
+
             // We do have it: update the access record view and return it
             _cache.right.relocate(
                 _cache.right.end(),
@@ -101,95 +235,133 @@ public:
             ++m_numCacheLookupHits;
             return it->info;
         }
-    }
-
-    // When something is inserted into the cache, the cache
-    // takes ownership (deletion responsibility) for it.
-    PointBuffer* insert(boost::uint64_t k, PointBuffer* v)
-    {
-        // Attempt to find existing record
-        const cache_type::left_iterator it =_cache.left.find(k);
 
-        if (it==_cache.left.end())
+        // Like lookup(), but neither counted nor marked as used.
+        Block peek(boost::uint64_t k) const
         {
-            // We don't have it: insert it
-            insertx(k,v);
-            ++m_numCacheInsertMisses;
-            return v;
+            boost::mutex::scoped_lock lock(m_mutex);
+            const cache_type::left_const_iterator it =_cache.left.find(k);
+            return it ==_cache.left.end() ? Block() : it->info;
         }
-        else
+
+        // The buffers evicted to make room are added to evicted, if given.
+        Block insert(boost::uint64_t k, Block v, Evicted* evicted)
         {
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            // Attempt to find existing record
+            const cache_type::left_iterator it =_cache.left.find(k);
+
+            if (it==_cache.left.end())
+            {
+                // We don't have it: insert it
+                insertx(k,v,evicted);
+                ++m_numCacheInsertMisses;
+                return v;
+            }
+
             // We do have it: update the access record view and return it
-            // note we don't support "replacing" the value (i.e. if v != it->info)
             _cache.right.relocate(
                 _cache.right.end(),
                 _cache.project_right(it)
             );
-            assert(it->info == v);
             ++m_numCacheInsertHits;
             return it->info;
         }
-    }
 
-    // Obtain the cached keys, most recently used element
-    // at head, least recently used at tail.
-    // This method is provided purely to support testing.
-    template <typename IT> void get_keys(IT dst) const
-    {
-        typename cache_type::right_const_reverse_iterator src
-            =_cache.right.rbegin();
-        while (src!=_cache.right.rend())
+        boost::uint64_t numBytes() const
         {
-            dst=(*src).second;
-            ++src;
-            ++dst;
+            boost::mutex::scoped_lock lock(m_mutex);
+            return m_numBytes;
         }
-    }
 
-    void getCacheStats(boost::uint64_t& numCacheLookupMisses,
-                       boost::uint64_t& numCacheLookupHits,
-                       boost::uint64_t& numCacheInsertMisses,
-                       boost::uint64_t& numCacheInsertHits) const
-    {
-        numCacheLookupMisses = m_numCacheLookupMisses;
-        numCacheLookupHits = m_numCacheLookupHits;
-        numCacheInsertMisses = m_numCacheInsertMisses;
-        numCacheInsertHits = m_numCacheInsertHits;
-    }
-
-private:
+        template <typename IT> void get_keys(IT& dst) const
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            typename cache_type::right_const_reverse_iterator src
+                =_cache.right.rbegin();
+            while (src!=_cache.right.rend())
+            {
+                dst=(*src).second;
+                ++src;
+                ++dst;
+            }
+        }
 
-    void insertx(boost::uint64_t k, PointBuffer* v)
-    {
-        assert(_cache.size()<=_capacity);
+        void addCacheStats(boost::uint64_t& numCacheLookupMisses,
+                           boost::uint64_t& numCacheLookupHits,
+                           boost::uint64_t& numCacheInsertMisses,
+                           boost::uint64_t& numCacheInsertHits) const
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            numCacheLookupMisses += m_numCacheLookupMisses;
+            numCacheLookupHits += m_numCacheLookupHits;
+            numCacheInsertMisses += m_numCacheInsertMisses;
+            numCacheInsertHits += m_numCacheInsertHits;
+        }
 
-        // If necessary, make space
-        if (_cache.size()==_capacity)
+    private:
+        void insertx(boost::uint64_t k, Block v, Evicted* evicted)
         {
-            // by purging the least-recently-used element
+            assert(_cache.size()<=_capacity);
+
+            const boost::uint64_t bytes = v->getBufferByteCapacity();
+
+            // If necessary, make space by purging the least-recently-used
+            // elements.  A buffer bigger than the byte limit is still kept,
+            // on its own.
+            while (!_cache.empty() &&
+                    (_cache.size()==_capacity ||
+                     (m_maxBytes != 0 && m_numBytes + bytes > m_maxBytes)))
+            {
+                cache_type::right_iterator iter =_cache.right.begin();
+                m_numBytes -= iter->info->getBufferByteCapacity();
+                if (evicted)
+                    evicted->push_back(std::make_pair(iter->second, iter->info));
+                _cache.right.erase(iter);
+            }
+
+            // Create a new record from the key, a dummy and the value
+            _cache.insert(
+                cache_type::value_type(
+                    k,0,v
+                )
+            );
+            m_numBytes += bytes;
+        }
 
-            cache_type::right_iterator iter =_cache.right.begin();
-            PointBuffer *old = iter->info;
-            delete old;
+        const size_t _capacity;
+        const boost::uint64_t m_maxBytes;
+        boost::uint64_t m_numBytes;
+        cache_type _cache;
+        mutable boost::mutex m_mutex;
 
-            _cache.right.erase(_cache.right.begin());
-        }
+        boost::uint64_t m_numCacheLookupMisses;
+        boost::uint64_t m_numCacheLookupHits;
+        boost::uint64_t m_numCacheInsertMisses;
+        boost::uint64_t m_numCacheInsertHits;
+
+        Shard& operator=(const Shard&); // not implemented
+        Shard(const Shard&); // not implemented
+    };
+
+    typedef boost::shared_ptr<Shard> ShardPtr;
 
-        // Create a new record from the key, a dummy and the value
-        _cache.insert(
-            cache_type::value_type(
-                k,0,v
-            )
-        );
+    Shard& shard(boost::uint64_t k)
+    {
+        return *m_shards[static_cast<size_t>(k % m_shards.size())];
     }
 
-    const size_t _capacity;
-    cache_type _cache;
+    // done outside the shard locks, as it writes to disk
+    void spill(const Evicted& evicted)
+    {
+        for (Evicted::const_iterator i = evicted.begin(); i != evicted.end(); ++i)
+            m_spill->put(i->first, *i->second);
+    }
 
-    boost::uint64_t m_numCacheLookupMisses;
-    boost::uint64_t m_numCacheLookupHits;
-    boost::uint64_t m_numCacheInsertMisses;
-    boost::uint64_t m_numCacheInsertHits;
+    std::vector<ShardPtr> m_shards;
+    boost::shared_ptr<PointBufferSpill> m_spill;
+    const boost::uint64_t m_maxBytes;
 
     PointBufferCache& operator=(const PointBufferCache&); // not implemented
     PointBufferCache(const PointBufferCache&); // not implemented
@@ -0,0 +1,139 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_PDAL_POINTBUFFERSPILL_HPP
+#define INCLUDED_PDAL_POINTBUFFERSPILL_HPP
+
+#include <pdal/pdal_internal.hpp>
+#include <pdal/Schema.hpp>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace boost
+{
+namespace iostreams
+{
+class mapped_file;
+}
+}
+
+namespace pdal
+{
+
+class PointBuffer;
+
+// A second, on-disk tier for a PointBufferCache.  Blocks evicted from
+// memory are written, in their raw schema layout, to fixed-size slots of
+// a memory-mapped scratch file, and copied back out on a hit, which frees
+// the slot.  The file holds at most maxBytes; when it is full the least
+// recently written slot is reused.  The file is removed when the spill is
+// destroyed.
+//
+// All blocks must share the spill's schema and have no more points than
+// its block capacity.  The methods may be called from several threads.
+class PDAL_DLL PointBufferSpill
+{
+public:
+    // The file is created in directory, or in the system temporary
+    // directory if that is empty.
+    PointBufferSpill(const Schema& schema,
+                     boost::uint32_t blockCapacity,
+                     boost::uint64_t maxBytes,
+                     const std::string& directory = "");
+    ~PointBufferSpill();
+
+    // Writes the block out under key, unless it is already there.  Returns
+    // false if the block does not fit the spill's layout.
+    bool put(boost::uint64_t key, const PointBuffer& block);
+
+    // A new buffer holding the block spilled under key, or NULL.  The
+    // block is removed from the spill.
+    PointBuffer* get(boost::uint64_t key);
+
+    const std::string& getFilename() const
+    {
+        return m_filename;
+    }
+
+    boost::uint32_t getNumSlots() const
+    {
+        return m_numSlots;
+    }
+
+    // the number of blocks in the file
+    boost::uint32_t getNumBlocks() const;
+
+    void getSpillStats(boost::uint64_t& numSpillMisses,
+                       boost::uint64_t& numSpillHits,
+                       boost::uint64_t& numSpillWrites) const;
+
+private:
+    struct Slot
+    {
+        boost::uint32_t index;
+        boost::uint32_t numPoints;
+        std::list<boost::uint64_t>::iterator lru;
+    };
+
+    const Schema m_schema;
+    const boost::uint32_t m_blockCapacity;
+    const boost::uint64_t m_slotBytes;
+    boost::uint32_t m_numSlots;
+    std::string m_filename;
+
+    boost::scoped_ptr<boost::iostreams::mapped_file> m_file;
+
+    mutable boost::mutex m_mutex;
+    std::map<boost::uint64_t, Slot> m_slots;
+    std::list<boost::uint64_t> m_lru;
+    std::vector<boost::uint32_t> m_free;
+
+    boost::uint64_t m_numSpillMisses;
+    boost::uint64_t m_numSpillHits;
+    boost::uint64_t m_numSpillWrites;
+
+    PointBufferSpill& operator=(const PointBufferSpill&); // not implemented
+    PointBufferSpill(const PointBufferSpill&); // not implemented
+};
+
+
+} // namespace pdal
+
+#endif
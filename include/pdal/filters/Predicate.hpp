@@ -80,8 +80,16 @@ public:
         return *m_script;
     }
 
+    // whether to pass the script only the dimensions it names as string
+    // constants, rather than all of them
+    bool namedDimensionsOnly() const
+    {
+        return m_namedDimensionsOnly;
+    }
+
 private:
     pdal::plang::Script* m_script;
+    bool m_namedDimensionsOnly;
 
     Predicate& operator=(const Predicate&); // not implemented
     Predicate(const Predicate&); // not implemented
@@ -81,8 +81,16 @@ public:
         return *m_script;
     }
 
+    // whether to pass the script only the dimensions it names as string
+    // constants, rather than all of them
+    bool namedDimensionsOnly() const
+    {
+        return m_namedDimensionsOnly;
+    }
+
 private:
     pdal::plang::Script* m_script;
+    bool m_namedDimensionsOnly;
 
     Programmable& operator=(const Programmable&); // not implemented
     Programmable(const Programmable&); // not implemented
@@ -39,10 +39,12 @@
 #include <pdal/FilterIterator.hpp>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 
 namespace pdal
 {
+class ApproximateTransform;
 class PointBuffer;
 namespace gdal
 {
@@ -88,7 +90,11 @@ public:
 private:
     void updateBounds();
     void checkImpedance();
-    void transform(double& x, double& y, double& z) const;
+    // Transforms count points, interpolating them if approximation_error
+    // is set.
+    void transform(double* x, double* y, double* z, boost::uint32_t count) const;
+    // Transforms count points in one call to the transformer.
+    void transformExact(double* x, double* y, double* z, boost::uint32_t count) const;
 
     SpatialReference m_inSRS;
     SpatialReference m_outSRS;
@@ -100,6 +106,11 @@ private:
     ReferencePtr m_out_ref_ptr;
     TransformPtr m_transform_ptr;
     boost::shared_ptr<pdal::gdal::Debug> m_gdal_debug;
+    boost::shared_ptr<ApproximateTransform> m_approximation;
+    // The approximation fills in its grid as points arrive and the GDAL
+    // transformer keeps state between calls, so although the processing
+    // is const, transform() holds this while it uses either of them.
+    mutable boost::mutex m_transformMutex;
 
     Reprojection& operator=(const Reprojection&); // not implemented
     Reprojection(const Reprojection&); // not implemented
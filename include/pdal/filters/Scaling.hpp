@@ -66,6 +66,25 @@ struct PDAL_DLL Scaler
     boost::uint32_t size;
 };
 
+// One step of a compiled scaling plan: rescales the column of values at
+// srcOffset in every point of a buffer into the column at dstOffset.
+struct PDAL_DLL Operation
+{
+    typedef void (*Function)(boost::uint8_t const* src,
+                             boost::uint8_t* dst,
+                             std::size_t stride,
+                             boost::uint32_t count,
+                             Operation const& op);
+
+    Function function;
+    std::size_t srcOffset;
+    std::size_t dstOffset;
+    double fromScale;
+    double fromOffset;
+    double toScale;
+    double toOffset;
+};
+
 }
 
 class PDAL_DLL Scaling: public Filter
@@ -124,65 +143,16 @@ private:
     boost::uint64_t skipImpl(boost::uint64_t);
     boost::uint32_t readBufferImpl(PointBuffer&);
     bool atEndImpl() const;
+    void readBufferBeginImpl(PointBuffer&);
     void alterSchema(pdal::PointBuffer&);
     dimension::Interpretation getInterpretation(std::string const& t) const;
+    void compile(Schema const& schema);
     const pdal::filters::Scaling& m_scalingFilter;
 
-    void writeScaledData(PointBuffer& buffer,
-                         Dimension const& from_dimension,
-                         Dimension const& to_dimension,
-                         boost::uint32_t pointIndex);
-    template<class T> void scale(Dimension const& from_dimension,
-                                 Dimension const& to_dimension,
-                                 T& value) const;
     std::map<dimension::id, dimension::id> m_scale_map;
+    std::vector<scaling::Operation> m_plan;
 };
 
-#ifdef PDAL_COMPILER_MSVC
-// when template T is know, std::numeric_limits<T>::is_exact is a constant...
-#  pragma warning(push)
-#  pragma warning(disable: 4127)  // conditional expression is constant
-#endif
-
-template <class T>
-inline void Scaling::scale(Dimension const& from_dimension,
-                           Dimension const& to_dimension,
-                           T& value) const
-{
-
-    double v = static_cast<double>(value);
-    double out = (v*from_dimension.getNumericScale() + from_dimension.getNumericOffset() - to_dimension.getNumericOffset())/to_dimension.getNumericScale();
-
-    T output = static_cast<T>(out);
-
-    if (std::numeric_limits<T>::is_exact) //
-    {
-        if (output > (std::numeric_limits<T>::max)())
-        {
-            std::ostringstream oss;
-            oss << "filter.Scaling: scale and/or offset combination causes "
-                "re-scaled value to be greater than std::numeric_limits::max for dimension '" << to_dimension.getName() << "'. " <<
-                "value is: " << output << " and max() is: " << (std::numeric_limits<T>::max)();
-        }
-        else if (output < (std::numeric_limits<T>::min)())
-        {
-            std::ostringstream oss;
-            oss << "filter.Scaling: scale and/or offset combination causes "
-                "re-scaled value to be less than std::numeric_limits::min for dimension '" << to_dimension.getName() << "'. " <<
-                "value is: " << output << " and min() is: " << (std::numeric_limits<T>::min)();
-            throw std::out_of_range(oss.str());
-
-        }
-    }
-    value = output;
-
-    return;
-}
-
-#ifdef PDAL_COMPILER_MSVC
-#  pragma warning(pop)
-#endif
-
 }
 } // namespaces
 
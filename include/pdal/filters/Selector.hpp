@@ -81,6 +81,8 @@ public:
     inline std::map<std::string, bool> const& getIgnoredMap() const { return m_ignoredMap; }
     
     inline bool doIgnoreUnspecifiedDimensions() const { return m_ignoreDefault; }
+
+    inline bool doPackIgnoredDimensions() const { return m_packIgnored; }
     
 private:
     void checkImpedance();
@@ -91,6 +93,7 @@ private:
     
     std::map<std::string, bool> m_ignoredMap;
     bool m_ignoreDefault;
+    bool m_packIgnored;
 };
 
 
@@ -43,17 +43,11 @@
 #include <pdal/Schema.hpp>
 
 #include <iostream>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics/stats.hpp>
-#include <boost/accumulators/statistics/mean.hpp>
-#include <boost/accumulators/statistics/moment.hpp>
-#include <boost/accumulators/statistics/max.hpp>
-#include <boost/accumulators/statistics/min.hpp>
-#include <boost/accumulators/statistics/count.hpp>
-#include <boost/accumulators/statistics/density.hpp>
+#include <limits>
+#include <vector>
 
+#include <boost/math/special_functions/fpclassify.hpp>
 #include <boost/random/mersenne_twister.hpp>
-#include <boost/random/uniform_int_distribution.hpp>
 
 namespace pdal
 {
@@ -63,93 +57,348 @@ namespace filters
 namespace stats
 {
 
+// All of the accumulators below are mergeable: two instances that saw
+// disjoint parts of a stream can be combined with merge() into the
+// same state (or, for the histogram with mismatched edges, the closest
+// approximation of it) that a single instance would have reached after
+// seeing the whole stream.  This lets partial results from threads,
+// chunks of a file or separate files be combined after the fact.
 
 
-typedef boost::iterator_range<std::vector<std::pair<double, double> >::iterator > histogram_type;
-#ifndef PDAL_COMPILER_MSVC  // See boost ticket 6535:  https://svn.boost.org/trac/boost/ticket/6535
-typedef boost::accumulators::accumulator_set<double, boost::accumulators::features< boost::accumulators::droppable<boost::accumulators::tag::density> > > density_accumulator ;
-#else
-typedef boost::accumulators::accumulator_set<double, boost::accumulators::features< boost::accumulators::tag::density > > density_accumulator ;
-#endif
-typedef boost::accumulators::accumulator_set<double, boost::accumulators::features<     boost::accumulators::droppable<boost::accumulators::tag::mean>,
-        boost::accumulators::droppable<boost::accumulators::tag::max>,
-        boost::accumulators::droppable<boost::accumulators::tag::min>,
-        boost::accumulators::droppable<boost::accumulators::tag::count> > > summary_accumulator;
-class PDAL_DLL Summary
+// Count, mean, variance and extrema, updated with Welford's algorithm
+// and merged with Chan et al.'s pairwise update.
+class PDAL_DLL Moments
 {
 public:
+    Moments();
+
+    inline void insert(double value)
+    {
+        ++m_count;
+        const double delta = value - m_mean;
+        m_mean += delta / static_cast<double>(m_count);
+        m_m2 += delta * (value - m_mean);
+        if (value < m_minimum) m_minimum = value;
+        if (value > m_maximum) m_maximum = value;
+        return;
+    }
+
+    // Adds a block of values at once: a two-pass mean and sum of squares
+    // over the block, folded in with merge().
+    void insert(double const* first, double const* last);
 
+    void merge(Moments const& other);
+    void reset();
+
+    boost::uint64_t count() const
+    {
+        return m_count;
+    }
     double minimum() const
     {
-        return boost::accumulators::min(m_summary);
+        return m_minimum;
     }
     double maximum() const
     {
-        return boost::accumulators::max(m_summary);
+        return m_maximum;
     }
-    double average() const
+    double mean() const
     {
-        return boost::accumulators::mean(m_summary);
+        return m_mean;
     }
+    // population variance
+    double variance() const;
+    double stddev() const;
+
+private:
+    boost::uint64_t m_count;
+    double m_mean;
+    double m_m2;
+    double m_minimum;
+    double m_maximum;
+};
+
+
+// Histogram with numBins regular bins plus an underflow (bin 0) and an
+// overflow (bin numBins+1) bin.  Bins are either linearly or
+// logarithmically spaced between lower and upper.  The range is either
+// given up front (fixed) or derived from the first cacheSize values
+// (auto-ranged); until the range is known, values are kept in a cache.
+//
+// Merging is exact when both sides share the same edges or when either
+// side is still caching; otherwise the other side's bin counts are
+// redistributed over our bins in proportion to their overlap.
+//
+// NaN values belong in no bin, and are dropped.
+class PDAL_DLL Histogram
+{
+public:
+    Histogram(boost::uint32_t numBins=20,
+              boost::uint32_t cacheSize=1000,
+              bool logSpaced=false);
+
+    static Histogram fixed(double lower,
+                           double upper,
+                           boost::uint32_t numBins=20,
+                           bool logSpaced=false);
+
+    inline void insert(double value)
+    {
+        if (boost::math::isnan(value))
+            return;
+        if (!m_isFixed)
+        {
+            m_cache.push_back(value);
+            if (m_cache.size() >= m_cacheSize)
+                fixRange();
+            return;
+        }
+        m_counts[getBin(value)]++;
+        return;
+    }
+
+    void insert(double const* first, double const* last);
+
+    void merge(Histogram const& other);
+    void reset();
+
+    // Fixes the range from the cached values, if not fixed already.
+    void fixRange();
+
+    bool isFixed() const
+    {
+        return m_isFixed;
+    }
+    bool isLogSpaced() const
+    {
+        return m_logSpaced;
+    }
+    // false once counts were redistributed by a merge of mismatched edges
+    bool isExact() const
+    {
+        return m_isExact;
+    }
+    boost::uint32_t getNumBins() const
+    {
+        return m_numBins;
+    }
+    double getLower() const
+    {
+        return m_lower;
+    }
+    double getUpper() const
+    {
+        return m_upper;
+    }
+
+    // The (lower bound, count) pairs of all numBins+2 bins.  An
+    // auto-ranged histogram that is still caching reports the bins it
+    // would have if its range were fixed now.
+    std::vector<std::pair<double, boost::uint64_t> > getBins() const;
+
+    boost::uint32_t getBin(double value) const;
+    double getEdge(boost::uint32_t edge) const;
+
+private:
+    bool hasSameEdges(Histogram const& other) const;
+    void redistribute(Histogram const& other);
+    void setRange(double lower, double upper);
+
+    boost::uint32_t m_numBins;
+    boost::uint32_t m_cacheSize;
+    bool m_logSpaced;
+    bool m_isFixed;
+    bool m_isExact;
+    double m_lower;
+    double m_upper;
+    double m_binScale; // bins per unit (or per unit of log) of the range
+    std::vector<boost::uint64_t> m_counts;
+    std::vector<double> m_cache;
+};
+
+
+// Quantile sketch after Karnin, Lang and Liberty (KLL) with a fixed
+// capacity k per level.  Level h holds items of weight 2^h; a full level
+// is sorted and every other item is promoted.  Promotion alternates
+// between even and odd offsets so results are deterministic.  The rank
+// error is on the order of log2(n/k)/k.
+class PDAL_DLL QuantileSketch
+{
+public:
+    QuantileSketch(boost::uint32_t k=200);
+
+    inline void insert(double value)
+    {
+        m_levels[0].push_back(value);
+        ++m_count;
+        if (m_levels[0].size() >= m_k)
+            compress();
+        return;
+    }
+
+    void insert(double const* first, double const* last);
+
+    void merge(QuantileSketch const& other);
+    void reset();
+
     boost::uint64_t count() const
     {
-        return boost::accumulators::count(m_summary);
+        return m_count;
     }
-    histogram_type histogram() const
+
+    // q in [0, 1].  Returns NaN when nothing has been inserted.
+    double quantile(double q) const;
+
+private:
+    void compress();
+
+    boost::uint32_t m_k;
+    boost::uint64_t m_count;
+    boost::uint32_t m_compactions;
+    std::vector<std::vector<double> > m_levels;
+};
+
+
+// Uniform random sample of at most size values.  Once the reservoir is
+// full, the number of values to pass over before the next replacement
+// is drawn directly (Vitter's algorithm X), so most values cost only a
+// decrement.  Merging draws from each side in proportion to the
+// population it saw.
+class PDAL_DLL Reservoir
+{
+public:
+    Reservoir(boost::uint32_t size=1000, boost::uint32_t seed=0);
+
+    inline void insert(double value)
     {
-        return boost::accumulators::density(m_histogram);
+        ++m_seen;
+        if (m_sample.size() < m_size)
+        {
+            m_sample.push_back(value);
+            if (m_sample.size() == m_size)
+                m_skip = nextSkip();
+            return;
+        }
+        if (m_skip)
+        {
+            --m_skip;
+            return;
+        }
+        if (m_size == 0)
+            return;
+        m_sample[static_cast<std::vector<double>::size_type>(draw(m_size))] = value;
+        m_skip = nextSkip();
+        return;
     }
 
-    boost::property_tree::ptree toPTree() const;
+    void merge(Reservoir const& other);
+    void reset();
+
+    boost::uint64_t seen() const
+    {
+        return m_seen;
+    }
+    std::vector<double> const& sample() const
+    {
+        return m_sample;
+    }
 
 private:
-    summary_accumulator m_summary;
-    density_accumulator m_histogram;
+    // uniform in [0, n)
+    boost::uint64_t draw(boost::uint64_t n);
+    boost::uint64_t nextSkip();
+
+    boost::uint32_t m_size;
+    boost::uint64_t m_seen;
+    boost::uint64_t m_skip;
     std::vector<double> m_sample;
-    boost::uint32_t m_sample_size;
     boost::random::mt19937 m_rng;
-    boost::random::uniform_int_distribution<> m_distribution;
+};
+
+
+class PDAL_DLL Summary
+{
 public:
 
     Summary(boost::uint32_t num_bins=20,
             boost::uint32_t sample_size=1000,
             boost::uint32_t cache_size=1000,
-            boost::uint32_t seed=0)
-        : m_histogram(boost::accumulators::tag::density::num_bins = num_bins,
-                      boost::accumulators::tag::density::cache_size = cache_size)
-        , m_sample_size(sample_size)
-        , m_distribution(0, cache_size)
-    {
-        if (seed != 0)
-        {
-            m_rng.seed(seed);
-            m_distribution.reset();
-        }
+            boost::uint32_t seed=0,
+            bool log_bins=false,
+            boost::uint32_t sketch_size=200);
 
-        return;
-    }
+    Summary(Histogram const& histogram,
+            boost::uint32_t sample_size=1000,
+            boost::uint32_t seed=0,
+            boost::uint32_t sketch_size=200);
 
-    void reset()
+    double minimum() const
     {
-        m_summary.drop<boost::accumulators::tag::mean>();
-        m_summary.drop<boost::accumulators::tag::count>();
-        m_summary.drop<boost::accumulators::tag::max>();
-        m_summary.drop<boost::accumulators::tag::min>();
-        m_histogram.drop<boost::accumulators::tag::density>();
-        return;
+        return m_moments.minimum();
+    }
+    double maximum() const
+    {
+        return m_moments.maximum();
+    }
+    double average() const
+    {
+        return m_moments.mean();
+    }
+    double variance() const
+    {
+        return m_moments.variance();
+    }
+    double stddev() const
+    {
+        return m_moments.stddev();
+    }
+    boost::uint64_t count() const
+    {
+        return m_moments.count();
+    }
+    double quantile(double q) const
+    {
+        return m_quantiles.quantile(q);
+    }
+    Moments const& moments() const
+    {
+        return m_moments;
+    }
+    Histogram const& histogram() const
+    {
+        return m_histogram;
+    }
+    QuantileSketch const& quantiles() const
+    {
+        return m_quantiles;
+    }
+    std::vector<double> const& sample() const
+    {
+        return m_sample.sample();
     }
 
+    void merge(Summary const& other);
+    void reset();
+
+    boost::property_tree::ptree toPTree() const;
+
+    void insert(double const* first, double const* last);
+
     template<class T> inline void insert(T value)
     {
-        m_summary(static_cast<double>(value));
-        m_histogram(static_cast<double>(value));
-
-        int sample = m_distribution(m_rng);
-        if (static_cast<boost::uint32_t>(sample) < m_sample_size)
-            m_sample.push_back(static_cast<double>(value));
+        const double v = static_cast<double>(value);
+        m_moments.insert(v);
+        m_histogram.insert(v);
+        m_quantiles.insert(v);
+        m_sample.insert(v);
         return;
     }
 
+private:
+    Moments m_moments;
+    Histogram m_histogram;
+    QuantileSketch m_quantiles;
+    Reservoir m_sample;
 };
 
 typedef boost::shared_ptr<Summary> SummaryPtr;
@@ -179,10 +428,7 @@ public:
     }
 
     pdal::StageSequentialIterator* createSequentialIterator(PointBuffer& buffer) const;
-    pdal::StageRandomIterator* createRandomIterator(PointBuffer&) const
-    {
-        return 0;    // BUG: add this
-    }
+    pdal::StageRandomIterator* createRandomIterator(PointBuffer& buffer) const;
 
     void processBuffer(PointBuffer& data) const;
 
@@ -208,20 +454,106 @@ private:
 
 
 
+namespace stats
+{
+
+typedef boost::shared_ptr<Dimension> DimensionPtr;
+
+// The per-dimension summaries gathered by the Stats filter's iterators.
+class PDAL_DLL Collector
+{
+public:
+    Collector(const pdal::filters::Stats& filter);
+
+    // Sets up a summary for each dimension of the schema the first time
+    // it is called.
+    void bind(Schema const& schema);
+    void accumulate(PointBuffer const& data);
+
+    boost::property_tree::ptree toPTree() const;
+    Summary const& getStats(Dimension const& dim) const;
+    void reset();
+
+    // Folds in the summaries of another collector (e.g. one that saw a
+    // different part of the stream, or a different file).  Dimensions
+    // are matched by name; ones we have not seen yet are added.
+    void merge(Collector const& other);
+
+private:
+    // Converts count values of one dimension, stride bytes apart, to
+    // (scaled) doubles.  One is chosen per dimension when the schema is
+    // first seen, so the inner loops don't switch on the type.
+    typedef void (*ConvertFunction)(boost::uint8_t const* data,
+                                    std::size_t stride,
+                                    boost::uint32_t count,
+                                    double scale,
+                                    double offset,
+                                    double* values);
+
+    struct Kernel
+    {
+        std::size_t byteOffset;
+        double scale;
+        double offset;
+        ConvertFunction convert;
+        SummaryPtr summary;
+    };
+
+    static ConvertFunction getConvertFunction(Dimension const& dim);
+
+    SummaryPtr findStats(Dimension const& dim) const;
+    SummaryPtr createSummary(Dimension const& dim, boost::uint32_t stats_cache_size) const;
+
+    const pdal::filters::Stats& m_filter;
+    std::vector<DimensionPtr> m_dimensions;
+    std::multimap<DimensionPtr, SummaryPtr> m_stats; // one Stats item per field in the schema
+    std::vector<Kernel> m_kernels;
+    std::vector<double> m_values;
+};
+
+} // namespace stats
+
+
 namespace iterators
 {
 namespace sequential
 {
 
-typedef boost::shared_ptr<Dimension> DimensionPtr;
+typedef stats::DimensionPtr DimensionPtr;
 
 class PDAL_DLL Stats : public pdal::FilterSequentialIterator
 {
 public:
     Stats(const pdal::filters::Stats& filter, PointBuffer& buffer);
-    boost::property_tree::ptree toPTree() const;
-    stats::Summary const& getStats(Dimension const& dim) const;
-    void reset();
+
+    boost::property_tree::ptree toPTree() const
+    {
+        return m_collector.toPTree();
+    }
+    stats::Summary const& getStats(Dimension const& dim) const
+    {
+        return m_collector.getStats(dim);
+    }
+    void reset()
+    {
+        m_collector.reset();
+    }
+    stats::Collector const& getCollector() const
+    {
+        return m_collector;
+    }
+
+    // Folds the summaries collected by another iterator (e.g. one that
+    // read a different part of the stream, or a different file) into
+    // ours.
+    void merge(Stats const& other)
+    {
+        m_collector.merge(other.m_collector);
+    }
+    void merge(stats::Collector const& other)
+    {
+        m_collector.merge(other);
+    }
 
 protected:
     virtual void readBufferBeginImpl(PointBuffer&);
@@ -231,18 +563,57 @@ private:
     boost::uint32_t readBufferImpl(PointBuffer&);
     bool atEndImpl() const;
 
-    const pdal::filters::Stats& m_statsFilter;
+    stats::Collector m_collector;
+};
 
-    std::vector<DimensionPtr> m_dimensions;
 
-    double getValue(PointBuffer& data, Dimension& dim, boost::uint32_t pointIndex);
+}
+} // iterators::sequential
+
 
-    std::multimap<DimensionPtr,stats::SummaryPtr> m_stats; // one Stats item per field in the schema
+namespace iterators
+{
+namespace random
+{
+
+// Summarizes whatever points are read through it, wherever they are
+// seeked to.  Reading runs of points at random positions gives an
+// estimate of the statistics without reading the whole stream.
+class PDAL_DLL Stats : public pdal::FilterRandomIterator
+{
+public:
+    Stats(const pdal::filters::Stats& filter, PointBuffer& buffer);
+
+    boost::property_tree::ptree toPTree() const
+    {
+        return m_collector.toPTree();
+    }
+    stats::Summary const& getStats(Dimension const& dim) const
+    {
+        return m_collector.getStats(dim);
+    }
+    void reset()
+    {
+        m_collector.reset();
+    }
+    stats::Collector const& getCollector() const
+    {
+        return m_collector;
+    }
+
+protected:
+    virtual void readBufferBeginImpl(PointBuffer&);
+
+private:
+    boost::uint64_t seekImpl(boost::uint64_t);
+    boost::uint32_t readBufferImpl(PointBuffer&);
+
+    stats::Collector m_collector;
 };
 
 
 }
-} // iterators::sequential
+} // iterators::random
 
 }
 } // namespaces
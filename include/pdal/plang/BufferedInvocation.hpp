@@ -39,6 +39,11 @@
 #ifdef PDAL_HAVE_PYTHON
 
 #include <pdal/plang/Invocation.hpp>
+#include <pdal/Schema.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
 
 namespace pdal
 {
@@ -47,15 +52,34 @@ namespace plang
 
 
 
+// Passes the dimensions of a PointBuffer to a script as numpy arrays viewing
+// the buffer, and copies back the arrays it returns.  The arrays are made
+// once per schema and re-pointed at each chunk.
+//
+// Every dimension is passed unless namedDimensionsOnly is set, in which case
+// only the dimensions the script spells out as string constants are: a script
+// that builds its names (ins['X'+s], ins.get(name), for k in ins) must not
+// ask for that.
 class PDAL_DLL BufferedInvocation : public Invocation
 {
 public:
-    BufferedInvocation(const Script& script);
+    BufferedInvocation(const Script& script, bool namedDimensionsOnly = false);
 
     void beginChunk(PointBuffer&);
     void endChunk(PointBuffer&);
 
 private:
+    void compileSchema(Schema const& schema);
+
+    // the schema the lists below were made for
+    Schema m_schema;
+    bool m_schemaCompiled;
+    bool m_namedDimensionsOnly;
+    // the dimensions passed to the script
+    std::vector<Dimension> m_inputs;
+    // every dimension by name, for looking up outputs
+    std::map<std::string, Dimension> m_dimensions;
+
     BufferedInvocation& operator=(BufferedInvocation const& rhs); // nope
 };
 
@@ -44,6 +44,10 @@
 #include <pdal/plang/Environment.hpp>
 #include <pdal/plang/Script.hpp>
 
+#include <map>
+#include <set>
+#include <string>
+
 namespace pdal
 {
 namespace plang
@@ -58,17 +62,28 @@ public:
 
     void compile();
 
+    // clears the ins and outs dictionaries for the next call; the arrays
+    // made by insertArgument() are kept, and re-pointed at the next chunk
+    // rather than made again
     void resetArguments();
 
+    // after compile(), says whether the script may read or write the given
+    // name: true if the name appears as a string constant anywhere in the
+    // script's module, or for every name if the script enumerates a dict
+    // (keys(), items() and the like)
+    bool usesName(const std::string& name) const;
 
     // creates a Python variable pointing to a (one dimensional) C array
-    // adds the new variable to the arguments dictionary
+    // adds the new variable to the arguments dictionary; the array is a
+    // writable strided view, so the script may also write through it
     void insertArgument(const std::string& name,
                         boost::uint8_t* data,
                         boost::uint32_t data_len,
                         boost::uint32_t data_stride,
                         dimension::Interpretation dataType,
                         boost::uint32_t numBytes);
+    // copies the named output array into the C array, converting its type;
+    // nothing is copied if the output is a view of that C array already
     void extractResult(const std::string& name,
                        boost::uint8_t* data,
                        boost::uint32_t data_len,
@@ -95,7 +110,20 @@ public:
     static void numpy_init();
 
 private:
+    struct View
+    {
+        PyObject* array;
+        int dataType;
+    };
+
     void cleanup();
+    void findScriptNames(PyObject* code);
+    PyObject* getView(const std::string& name,
+                      boost::uint8_t* data,
+                      boost::uint32_t data_len,
+                      boost::uint32_t data_stride,
+                      dimension::Interpretation dataType,
+                      boost::uint32_t numBytes);
 
     Script m_script;
     ::pdal::plang::Environment& m_environment;
@@ -109,7 +137,12 @@ private:
     PyObject* m_varsOut;
     PyObject* m_scriptArgs;
     PyObject* m_scriptResult;
-    std::vector<PyObject*> m_pyInputArrays;
+
+    // one array per name, kept across chunks
+    std::map<std::string, View> m_views;
+
+    std::set<std::string> m_scriptNames;
+    bool m_usesAllNames;
 
     Invocation& operator=(Invocation const& rhs); // nope
 };
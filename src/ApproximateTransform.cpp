@@ -0,0 +1,431 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/ApproximateTransform.hpp>
+
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pdal
+{
+
+namespace
+{
+
+// smallest batch worth building cells for, when the extent is per call
+const boost::uint32_t s_minApproximateCount = 64;
+
+inline bool isFinite(double v)
+{
+    return (boost::math::isfinite)(v);
+}
+
+inline double fraction(double v, double lower, double upper)
+{
+    if (upper <= lower)
+        return 0.0;
+    return (v - lower) / (upper - lower);
+}
+
+} // anonymous namespace
+
+
+ApproximateTransform::ApproximateTransform(Function exact,
+                                           double maxError,
+                                           const Bounds<double>& extent,
+                                           boost::uint32_t maxDepth)
+    : m_exact(exact)
+    , m_maxError(maxError)
+    , m_maxDepth(maxDepth)
+    , m_fixedExtent(false)
+    , m_minz(0.0)
+    , m_maxz(0.0)
+    , m_numExactPoints(0)
+    , m_numExactCalls(0)
+    , m_numInterpolatedPoints(0)
+{
+    if (maxError < 0.0)
+        throw pdal_error("ApproximateTransform: maximum error must not be negative");
+
+    if (extent.size() >= 2)
+    {
+        const double minz = extent.size() > 2 ? extent.getMinimum(2) : 0.0;
+        const double maxz = extent.size() > 2 ? extent.getMaximum(2) : 0.0;
+
+        if (isFinite(extent.getMinimum(0)) && isFinite(extent.getMaximum(0)) &&
+                isFinite(extent.getMinimum(1)) && isFinite(extent.getMaximum(1)) &&
+                isFinite(minz) && isFinite(maxz) &&
+                extent.getMinimum(0) <= extent.getMaximum(0) &&
+                extent.getMinimum(1) <= extent.getMaximum(1) &&
+                minz <= maxz)
+        {
+            setExtent(extent.getMinimum(0), extent.getMinimum(1), minz,
+                      extent.getMaximum(0), extent.getMaximum(1), maxz);
+            m_fixedExtent = true;
+        }
+    }
+
+    return;
+}
+
+
+void ApproximateTransform::setExtent(double minx, double miny, double minz,
+                                     double maxx, double maxy, double maxz)
+{
+    m_cells.clear();
+    m_minz = minz;
+    m_maxz = maxz;
+
+    Cell root;
+    root.minx = minx;
+    root.miny = miny;
+    root.maxx = maxx;
+    root.maxy = maxy;
+    root.depth = 0;
+    root.state = Cell_Unevaluated;
+    root.firstChild = 0;
+    m_cells.push_back(root);
+
+    return;
+}
+
+
+void ApproximateTransform::exact(double* x, double* y, double* z, boost::uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    m_exact(x, y, z, count);
+    m_numExactPoints += count;
+    ++m_numExactCalls;
+
+    return;
+}
+
+
+void ApproximateTransform::evaluate(const std::vector<std::size_t>& cells)
+{
+    // for each cell, its four corners at each Z level, then its centre at
+    // each Z level
+    const std::size_t numCells = cells.size();
+    m_exactX.resize(numCells * 10);
+    m_exactY.resize(numCells * 10);
+    m_exactZ.resize(numCells * 10);
+    for (std::size_t c = 0; c < numCells; ++c)
+    {
+        const Cell& cell = m_cells[cells[c]];
+        double* x = &m_exactX[c * 10];
+        double* y = &m_exactY[c * 10];
+        double* z = &m_exactZ[c * 10];
+        for (int level = 0; level < 2; ++level)
+        {
+            const double zz = level ? m_maxz : m_minz;
+            for (int corner = 0; corner < 4; ++corner)
+            {
+                x[level * 4 + corner] = (corner & 1) ? cell.maxx : cell.minx;
+                y[level * 4 + corner] = (corner & 2) ? cell.maxy : cell.miny;
+                z[level * 4 + corner] = zz;
+            }
+            x[8 + level] = (cell.minx + cell.maxx) / 2.0;
+            y[8 + level] = (cell.miny + cell.maxy) / 2.0;
+            z[8 + level] = zz;
+        }
+    }
+
+    try
+    {
+        exact(&m_exactX.front(), &m_exactY.front(), &m_exactZ.front(),
+              static_cast<boost::uint32_t>(numCells * 10));
+    }
+    catch (pdal_error&)
+    {
+        if (numCells == 1)
+        {
+            // part of the cell is outside the transform's domain; leave
+            // the points that are inside it to the exact transform
+            m_cells[cells[0]].state = Cell_Exact;
+            return;
+        }
+
+        // find the cells at fault one at a time
+        for (std::size_t c = 0; c < numCells; ++c)
+            evaluate(std::vector<std::size_t>(1, cells[c]));
+        return;
+    }
+
+    for (std::size_t c = 0; c < numCells; ++c)
+        classify(cells[c], &m_exactX[c * 10], &m_exactY[c * 10], &m_exactZ[c * 10]);
+
+    return;
+}
+
+
+void ApproximateTransform::classify(std::size_t index, const double* x, const double* y, const double* z)
+{
+    Cell& cell = m_cells[index];
+
+    bool accept = true;
+    for (int level = 0; level < 2; ++level)
+    {
+        double mean[3] = { 0.0, 0.0, 0.0 };
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            const int i = level * 4 + corner;
+            cell.corners[level][corner][0] = x[i];
+            cell.corners[level][corner][1] = y[i];
+            cell.corners[level][corner][2] = z[i];
+            mean[0] += x[i] / 4.0;
+            mean[1] += y[i] / 4.0;
+            mean[2] += z[i] / 4.0;
+        }
+
+        const double error = std::max(std::fabs(mean[0] - x[8 + level]),
+                                      std::max(std::fabs(mean[1] - y[8 + level]),
+                                               std::fabs(mean[2] - z[8 + level])));
+        if (!(error <= m_maxError))
+            accept = false;
+    }
+
+    if (accept)
+    {
+        cell.state = Cell_Interpolate;
+        return;
+    }
+
+    if (cell.depth >= m_maxDepth)
+    {
+        cell.state = Cell_Exact;
+        return;
+    }
+
+    cell.state = Cell_Split;
+    cell.firstChild = m_cells.size();
+
+    // copy what we need: pushing children may reallocate m_cells
+    const double minx = cell.minx;
+    const double miny = cell.miny;
+    const double maxx = cell.maxx;
+    const double maxy = cell.maxy;
+    const double cx = (minx + maxx) / 2.0;
+    const double cy = (miny + maxy) / 2.0;
+    const boost::uint32_t depth = cell.depth + 1;
+
+    for (int child = 0; child < 4; ++child)
+    {
+        Cell c;
+        c.minx = (child & 1) ? cx : minx;
+        c.maxx = (child & 1) ? maxx : cx;
+        c.miny = (child & 2) ? cy : miny;
+        c.maxy = (child & 2) ? maxy : cy;
+        c.depth = depth;
+        c.state = Cell_Unevaluated;
+        c.firstChild = 0;
+        m_cells.push_back(c);
+    }
+
+    return;
+}
+
+
+std::size_t ApproximateTransform::findCell(double x, double y) const
+{
+    std::size_t index = 0;
+    while (m_cells[index].state == Cell_Split)
+    {
+        const Cell& cell = m_cells[index];
+        const double cx = (cell.minx + cell.maxx) / 2.0;
+        const double cy = (cell.miny + cell.maxy) / 2.0;
+        index = cell.firstChild + (x >= cx ? 1 : 0) + (y >= cy ? 2 : 0);
+    }
+    return index;
+}
+
+
+void ApproximateTransform::interpolate(const Cell& cell, double& x, double& y, double& z) const
+{
+    const double u = fraction(x, cell.minx, cell.maxx);
+    const double v = fraction(y, cell.miny, cell.maxy);
+    const double t = fraction(z, m_minz, m_maxz);
+
+    const double w[4] = { (1.0 - u) * (1.0 - v), u * (1.0 - v),
+                          (1.0 - u) * v, u * v
+                        };
+
+    double out[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        double low = 0.0;
+        double high = 0.0;
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            low += w[corner] * cell.corners[0][corner][k];
+            high += w[corner] * cell.corners[1][corner][k];
+        }
+        out[k] = low + t * (high - low);
+    }
+
+    x = out[0];
+    y = out[1];
+    z = out[2];
+
+    return;
+}
+
+
+void ApproximateTransform::transform(double* x, double* y, double* z, boost::uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    if (!m_fixedExtent)
+    {
+        if (count < s_minApproximateCount)
+        {
+            exact(x, y, z, count);
+            return;
+        }
+
+        double minx = std::numeric_limits<double>::max();
+        double miny = std::numeric_limits<double>::max();
+        double minz = std::numeric_limits<double>::max();
+        double maxx = -std::numeric_limits<double>::max();
+        double maxy = -std::numeric_limits<double>::max();
+        double maxz = -std::numeric_limits<double>::max();
+        for (boost::uint32_t i = 0; i < count; ++i)
+        {
+            if (!isFinite(x[i]) || !isFinite(y[i]) || !isFinite(z[i]))
+                continue;
+            minx = std::min(minx, x[i]);
+            miny = std::min(miny, y[i]);
+            minz = std::min(minz, z[i]);
+            maxx = std::max(maxx, x[i]);
+            maxy = std::max(maxy, y[i]);
+            maxz = std::max(maxz, z[i]);
+        }
+        if (minx > maxx)
+        {
+            exact(x, y, z, count);
+            return;
+        }
+        setExtent(minx, miny, minz, maxx, maxy, maxz);
+    }
+
+    const Cell& root = m_cells[0];
+    const double minx = root.minx;
+    const double miny = root.miny;
+    const double maxx = root.maxx;
+    const double maxy = root.maxy;
+
+    m_pendingIndex.clear();
+    m_exactIndex.clear();
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        // the comparisons are false for NaNs, which go to the exact path
+        const bool inside = x[i] >= minx && x[i] <= maxx &&
+                            y[i] >= miny && y[i] <= maxy &&
+                            z[i] >= m_minz && z[i] <= m_maxz;
+        if (inside)
+            m_pendingIndex.push_back(i);
+        else
+            m_exactIndex.push_back(i);
+    }
+
+    // Walk the points down the tree a level at a time, evaluating the
+    // cells they reach in one batch, until every point has a cell.
+    while (!m_pendingIndex.empty())
+    {
+        m_evaluate.clear();
+        std::size_t numPending = 0;
+        for (std::size_t p = 0; p < m_pendingIndex.size(); ++p)
+        {
+            const boost::uint32_t i = m_pendingIndex[p];
+            const std::size_t index = findCell(x[i], y[i]);
+            Cell& cell = m_cells[index];
+
+            switch (cell.state)
+            {
+                case Cell_Interpolate:
+                    interpolate(cell, x[i], y[i], z[i]);
+                    ++m_numInterpolatedPoints;
+                    break;
+                case Cell_Exact:
+                    m_exactIndex.push_back(i);
+                    break;
+                case Cell_Unevaluated:
+                    cell.state = Cell_Pending;
+                    m_evaluate.push_back(index);
+                    m_pendingIndex[numPending++] = i;
+                    break;
+                default:
+                    m_pendingIndex[numPending++] = i;
+                    break;
+            }
+        }
+        m_pendingIndex.resize(numPending);
+
+        if (!m_evaluate.empty())
+            evaluate(m_evaluate);
+    }
+
+    const boost::uint32_t numExact = static_cast<boost::uint32_t>(m_exactIndex.size());
+    if (numExact == 0)
+        return;
+
+    m_exactX.resize(numExact);
+    m_exactY.resize(numExact);
+    m_exactZ.resize(numExact);
+    for (boost::uint32_t i = 0; i < numExact; ++i)
+    {
+        m_exactX[i] = x[m_exactIndex[i]];
+        m_exactY[i] = y[m_exactIndex[i]];
+        m_exactZ[i] = z[m_exactIndex[i]];
+    }
+
+    exact(&m_exactX.front(), &m_exactY.front(), &m_exactZ.front(), numExact);
+
+    for (boost::uint32_t i = 0; i < numExact; ++i)
+    {
+        x[m_exactIndex[i]] = m_exactX[i];
+        y[m_exactIndex[i]] = m_exactY[i];
+        z[m_exactIndex[i]] = m_exactZ[i];
+    }
+
+    return;
+}
+
+
+} // namespace pdal
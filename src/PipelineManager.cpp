@@ -41,6 +41,9 @@
 
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/optional.hpp>
+#include <boost/foreach.hpp>
+
+#include <set>
 
 namespace pdal
 {
@@ -144,10 +147,56 @@ boost::uint64_t PipelineManager::execute()
     if (!isWriterPipeline())
         throw pdal_error("This pipeline does not have a writer, unable to execute");
     getWriter()->initialize();
+
+    StageProfile::Timer timer(m_profile);
     return getWriter()->write(0);
 }
 
 
+static void profileStage(const StageBase& stage,
+                         std::set<const StageBase*>& seen,
+                         boost::property_tree::ptree& stages)
+{
+    if (!seen.insert(&stage).second) return;
+
+    // list the inputs first, so the stages come out in the order the
+    // points flow through them
+    BOOST_FOREACH(StageBase* prev, stage.getInputs())
+    {
+        profileStage(*prev, seen, stages);
+    }
+
+    stages.add_child("stage", stage.getProfilePTree());
+
+    return;
+}
+
+
+boost::property_tree::ptree PipelineManager::getProfile() const
+{
+    boost::property_tree::ptree tree;
+
+    tree.put("wall_time", m_profile.getWallTime());
+    tree.put("cpu_time", m_profile.getCpuTime());
+
+    boost::property_tree::ptree stages;
+    std::set<const StageBase*> seen;
+
+    if (m_lastWriter)
+    {
+        profileStage(*m_lastWriter, seen, stages);
+    }
+    else if (m_lastStage)
+    {
+        profileStage(*m_lastStage, seen, stages);
+    }
+
+    tree.add_child("stages", stages);
+
+    return tree;
+}
+
+
 bool PipelineManager::isWriterPipeline() const
 {
     return (m_lastWriter != NULL);
@@ -209,15 +209,17 @@ const Dimension& Schema::getDimension(std::string const& t, std::string const& n
 
         if (ns.size())
         {
-            while (it != name_index.end())
+            // Only walk the dimensions that share our name. Walking to the
+            // end of the hashed index would hand back whatever unrelated
+            // dimension happens to share the namespace.
+            std::pair<schema::index_by_name::const_iterator, schema::index_by_name::const_iterator> named = name_index.equal_range(t);
+            for (schema::index_by_name::const_iterator n = named.first; n != named.second; ++n)
             {
-                if (boost::equals(ns, it->getNamespace()))
+                if (boost::equals(ns, n->getNamespace()))
                 {
-                    if (!it->isIgnored())
-                        return *it;
+                    if (!n->isIgnored())
+                        return *n;
                 }
-                
-                ++it;
             }
 
         }
@@ -421,6 +423,21 @@ boost::optional<Dimension const&> Schema::getDimensionOptional(dimension::id con
 
 
 
+Schema Schema::pack() const
+{
+    Schema output;
+
+    schema::index_by_index const& idx = m_index.get<schema::index>();
+    for (schema::index_by_index::const_iterator iter = idx.begin(); iter != idx.end(); ++iter)
+    {
+        if (!iter->isIgnored())
+            output.appendDimension(*iter);
+    }
+
+    return output;
+}
+
+
 Schema Schema::from_xml(std::string const& xml, std::string const& xsd)
 {
 #ifdef PDAL_HAVE_LIBXML2
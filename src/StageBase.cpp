@@ -35,6 +35,7 @@
 #include <pdal/StageBase.hpp>
 
 #include <iostream>
+#include <algorithm>
 
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/foreach.hpp>
@@ -156,6 +157,42 @@ Metadata StageBase::getMetadata() const
 }
 
 
+boost::property_tree::ptree StageBase::getProfilePTree() const
+{
+    double inputsWallTime = 0.0;
+    double inputsCpuTime = 0.0;
+    boost::uint64_t numPointsIn = 0;
+
+    BOOST_FOREACH(StageBase* prev, getInputs())
+    {
+        const StageProfile& prevProfile = prev->getProfile();
+        inputsWallTime += prevProfile.getWallTime();
+        inputsCpuTime += prevProfile.getCpuTime();
+        numPointsIn += prevProfile.getNumPoints();
+    }
+
+    const StageProfile& profile = getProfile();
+    const double wallTime = (std::max)(0.0, profile.getWallTime() - inputsWallTime);
+    const double cpuTime = (std::max)(0.0, profile.getCpuTime() - inputsCpuTime);
+
+    boost::property_tree::ptree tree;
+
+    tree.put("name", getName());
+    tree.put("id", getId());
+    tree.put("wall_time", wallTime);
+    tree.put("cpu_time", cpuTime);
+    tree.put("blocked_time", (std::max)(0.0, wallTime - cpuTime));
+    tree.put("points_in", numPointsIn);
+    tree.put("points_out", profile.getNumPoints());
+    tree.put("bytes", profile.getNumBytes());
+    tree.put("buffers", profile.getNumBuffers());
+    tree.put("buffers_allocated", profile.getNumBuffersAllocated());
+    tree.add_child("inclusive", profile.toPTree());
+
+    return tree;
+}
+
+
 Options& StageBase::getOptions()
 {
     return m_options;
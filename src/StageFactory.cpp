@@ -39,6 +39,7 @@
 #include <pdal/Reader.hpp>
 #include <pdal/Writer.hpp>
 
+#include <pdal/drivers/columnar/Reader.hpp>
 #include <pdal/drivers/faux/Reader.hpp>
 #include <pdal/drivers/las/Reader.hpp>
 #ifdef PDAL_HAVE_ORACLE
@@ -51,10 +52,14 @@
 
 #include <pdal/drivers/pipeline/Reader.hpp>
 #include <pdal/drivers/qfit/Reader.hpp>
+#include <pdal/drivers/stream/Reader.hpp>
 #include <pdal/drivers/terrasolid/Reader.hpp>
+#include <pdal/drivers/text/Reader.hpp>
 
+#include <pdal/drivers/columnar/Writer.hpp>
 #include <pdal/drivers/faux/Writer.hpp>
 #include <pdal/drivers/las/Writer.hpp>
+#include <pdal/drivers/stream/Writer.hpp>
 #include <pdal/drivers/text/Writer.hpp>
 
 #ifdef PDAL_HAVE_ORACLE
@@ -72,6 +77,7 @@
 #include <pdal/filters/Colorization.hpp>
 #include <pdal/filters/Crop.hpp>
 #include <pdal/filters/Decimation.hpp>
+#include <pdal/filters/Expression.hpp>
 #include <pdal/filters/InPlaceReprojection.hpp>
 #include <pdal/filters/Reprojection.hpp>
 
@@ -130,6 +136,7 @@ namespace pdal
 //
 // define the functions to create the readers
 //
+MAKE_READER_CREATOR(ColumnarReader, pdal::drivers::columnar::Reader)
 MAKE_READER_CREATOR(FauxReader, pdal::drivers::faux::Reader)
 MAKE_READER_CREATOR(LasReader, pdal::drivers::las::Reader)
 #ifdef PDAL_HAVE_ORACLE
@@ -141,7 +148,9 @@ MAKE_READER_CREATOR(NITFReader, pdal::drivers::nitf::Reader)
 
 MAKE_READER_CREATOR(PipelineReader, pdal::drivers::pipeline::Reader)
 MAKE_READER_CREATOR(QfitReader, pdal::drivers::qfit::Reader)
+MAKE_READER_CREATOR(StreamReader, pdal::drivers::stream::Reader)
 MAKE_READER_CREATOR(TerrasolidReader, pdal::drivers::terrasolid::Reader)
+MAKE_READER_CREATOR(TextReader, pdal::drivers::text::Reader)
 
 //
 // define the functions to create the filters
@@ -153,6 +162,7 @@ MAKE_FILTER_CREATOR(Color, pdal::filters::Color)
 MAKE_FILTER_CREATOR(Colorization, pdal::filters::Colorization)
 MAKE_FILTER_CREATOR(Crop, pdal::filters::Crop)
 MAKE_FILTER_CREATOR(Decimation, pdal::filters::Decimation)
+MAKE_FILTER_CREATOR(Expression, pdal::filters::Expression)
 MAKE_FILTER_CREATOR(InPlaceReprojection, pdal::filters::InPlaceReprojection)
 
 #ifdef PDAL_HAVE_PYTHON
@@ -173,8 +183,10 @@ MAKE_MULTIFILTER_CREATOR(Mosaic, pdal::filters::Mosaic)
 //
 // define the functions to create the writers
 //
+MAKE_WRITER_CREATOR(ColumnarWriter, pdal::drivers::columnar::Writer)
 MAKE_WRITER_CREATOR(FauxWriter, pdal::drivers::faux::Writer)
 MAKE_WRITER_CREATOR(LasWriter, pdal::drivers::las::Writer)
+MAKE_WRITER_CREATOR(StreamWriter, pdal::drivers::stream::Writer)
 MAKE_WRITER_CREATOR(TextWriter, pdal::drivers::text::Writer)
 #ifdef PDAL_HAVE_ORACLE
 MAKE_WRITER_CREATOR(OciWriter, pdal::drivers::oci::Writer)
@@ -320,6 +332,7 @@ void StageFactory::registerWriter(const std::string& type, WriterCreator* f)
 
 void StageFactory::registerKnownReaders()
 {
+    REGISTER_READER(ColumnarReader, pdal::drivers::columnar::Reader);
     REGISTER_READER(FauxReader, pdal::drivers::faux::Reader);
     REGISTER_READER(LasReader, pdal::drivers::las::Reader);
 #ifdef PDAL_HAVE_ORACLE
@@ -331,7 +344,9 @@ void StageFactory::registerKnownReaders()
 
     REGISTER_READER(PipelineReader, pdal::drivers::pipeline::Reader);
     REGISTER_READER(QfitReader, pdal::drivers::qfit::Reader);
+    REGISTER_READER(StreamReader, pdal::drivers::stream::Reader);
     REGISTER_READER(TerrasolidReader, pdal::drivers::terrasolid::Reader);
+    REGISTER_READER(TextReader, pdal::drivers::text::Reader);
 }
 
 
@@ -344,6 +359,7 @@ void StageFactory::registerKnownFilters()
     REGISTER_FILTER(Colorization, pdal::filters::Colorization);
     REGISTER_FILTER(Crop, pdal::filters::Crop);
     REGISTER_FILTER(Decimation, pdal::filters::Decimation);
+    REGISTER_FILTER(Expression, pdal::filters::Expression);
     REGISTER_FILTER(Reprojection, pdal::filters::Reprojection);
     REGISTER_FILTER(InPlaceReprojection, pdal::filters::InPlaceReprojection);
 
@@ -367,8 +383,10 @@ void StageFactory::registerKnownMultiFilters()
 
 void StageFactory::registerKnownWriters()
 {
+    REGISTER_WRITER(ColumnarWriter, pdal::drivers::columnar::Writer);
     REGISTER_WRITER(FauxWriter, pdal::drivers::faux::Writer);
     REGISTER_WRITER(LasWriter, pdal::drivers::las::Writer);
+    REGISTER_WRITER(StreamWriter, pdal::drivers::stream::Writer);
     REGISTER_WRITER(TextWriter, pdal::drivers::text::Writer);
 #ifdef PDAL_HAVE_ORACLE
     REGISTER_WRITER(OciWriter, pdal::drivers::oci::Writer);
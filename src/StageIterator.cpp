@@ -38,6 +38,7 @@
 
 #include <pdal/Stage.hpp>
 #include <pdal/PointBuffer.hpp>
+#include <pdal/Tracer.hpp>
 
 namespace pdal
 {
@@ -122,7 +123,10 @@ void StageIterator::readBegin()
     }
     m_readBeginPerformed = false;
 
-    readBeginImpl();
+    {
+        Tracer::Scope trace("readBegin", &m_stage);
+        readBeginImpl();
+    }
 
     m_readBeginPerformed = true;
 
@@ -157,13 +161,21 @@ boost::uint32_t StageIterator::readBuffer(PointBuffer& buffer)
         throw pdal_error("readBuffer called without corresponding readBufferBegin");
     }
 
+    StageProfile& profile = m_stage.getProfile();
+    StageProfile::Timer timer(profile);
+
     boost::uint32_t numRead = 0;
 
 
-    numRead = readBufferImpl(buffer);
+    {
+        Tracer::Scope trace("readBuffer", &m_stage, &buffer);
+        numRead = readBufferImpl(buffer);
+    }
 
     m_index += numRead;
 
+    profile.addBuffer(numRead, static_cast<boost::uint32_t>(buffer.getSchema().getByteSize()));
+
     return numRead;
 }
 
@@ -216,6 +228,7 @@ boost::uint64_t StageIterator::naiveSkipImpl(boost::uint64_t count)
         const boost::uint32_t thisCount = static_cast<boost::uint32_t>(thisCount64);
 
         PointBuffer junk(getStage().getSchema(), thisCount);
+        getStage().getProfile().addBufferAllocation();
 
         const boost::uint32_t numRead = read(junk);
         if (numRead == 0) break; // end of file or something
@@ -292,6 +305,74 @@ boost::uint64_t StageRandomIterator::seek(boost::uint64_t position)
 }
 
 
+boost::uint32_t StageRandomIterator::readStrided(PointBuffer& buffer, boost::uint32_t step)
+{
+    if (step == 0)
+    {
+        throw pdal_error("readStrided requires a step of at least 1");
+    }
+
+    const boost::uint64_t start = m_index;
+
+    StageProfile& profile = getStage().getProfile();
+
+    readBegin();
+    readBufferBegin(buffer);
+    boost::uint32_t numRead = 0;
+    {
+        StageProfile::Timer timer(profile);
+        Tracer::Scope trace("readStrided", &getStage(), &buffer);
+        numRead = readStridedImpl(buffer, step);
+    }
+    readBufferEnd(buffer);
+    readEnd();
+
+    profile.addBuffer(numRead, static_cast<boost::uint32_t>(buffer.getSchema().getByteSize()));
+
+    m_index = start + static_cast<boost::uint64_t>(numRead) * step;
+
+    return numRead;
+}
+
+
+boost::uint32_t StageRandomIterator::readStridedImpl(PointBuffer& buffer, boost::uint32_t step)
+{
+    return naiveReadStridedImpl(buffer, step);
+}
+
+
+boost::uint32_t StageRandomIterator::naiveReadStridedImpl(PointBuffer& buffer, boost::uint32_t step)
+{
+    const bool knowsCount = (getStage().getPointCountType() == PointCount_Fixed);
+    const boost::uint64_t numPoints = getStage().getNumPoints();
+
+    PointBuffer one(buffer.getSchema(), 1);
+    getStage().getProfile().addBufferAllocation();
+
+    boost::uint64_t position = m_index;
+    boost::uint32_t numRead = 0;
+
+    while (numRead < buffer.getCapacity())
+    {
+        if (knowsCount && position >= numPoints) break;
+
+        // the readers compute how many points are left from our index
+        m_index = seekImpl(position);
+
+        one.setNumPoints(0);
+        if (readBufferImpl(one) == 0) break;
+
+        buffer.copyPointFast(numRead, 0, one);
+        ++numRead;
+        buffer.setNumPoints(numRead);
+
+        position += step;
+    }
+
+    return numRead;
+}
+
+
 
 
 } // namespace pdal
@@ -0,0 +1,145 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/StageProfile.hpp>
+
+#include <ctime>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace pdal
+{
+
+
+StageProfile::StageProfile()
+    : m_wallTime(0.0)
+    , m_cpuTime(0.0)
+    , m_numPoints(0)
+    , m_numBytes(0)
+    , m_numBuffers(0)
+    , m_buffersAllocated(0)
+    , m_depth(0)
+{
+    return;
+}
+
+
+void StageProfile::reset()
+{
+    m_wallTime = 0.0;
+    m_cpuTime = 0.0;
+    m_numPoints = 0;
+    m_numBytes = 0;
+    m_numBuffers = 0;
+    m_buffersAllocated = 0;
+
+    return;
+}
+
+
+void StageProfile::addBuffer(boost::uint32_t numPoints, boost::uint32_t pointSize)
+{
+    ++m_numBuffers;
+    m_numPoints += numPoints;
+    m_numBytes += static_cast<boost::uint64_t>(numPoints) * pointSize;
+
+    return;
+}
+
+
+boost::property_tree::ptree StageProfile::toPTree() const
+{
+    boost::property_tree::ptree tree;
+
+    tree.put("wall_time", m_wallTime);
+    tree.put("cpu_time", m_cpuTime);
+    tree.put("points", m_numPoints);
+    tree.put("bytes", m_numBytes);
+    tree.put("buffers", m_numBuffers);
+    tree.put("buffers_allocated", m_buffersAllocated);
+
+    return tree;
+}
+
+
+double StageProfile::getWallClock()
+{
+    static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+
+    const boost::posix_time::time_duration since =
+        boost::posix_time::microsec_clock::universal_time() - epoch;
+
+    return static_cast<double>(since.total_microseconds()) / 1.0e6;
+}
+
+
+double StageProfile::getCpuClock()
+{
+    return static_cast<double>(std::clock()) / static_cast<double>(CLOCKS_PER_SEC);
+}
+
+
+StageProfile::Timer::Timer(StageProfile& profile)
+    : m_profile(profile)
+    , m_wallStart(0.0)
+    , m_cpuStart(0.0)
+    , m_outermost(profile.m_depth == 0)
+{
+    ++m_profile.m_depth;
+
+    if (m_outermost)
+    {
+        m_wallStart = getWallClock();
+        m_cpuStart = getCpuClock();
+    }
+
+    return;
+}
+
+
+StageProfile::Timer::~Timer()
+{
+    --m_profile.m_depth;
+
+    if (m_outermost)
+    {
+        m_profile.m_wallTime += getWallClock() - m_wallStart;
+        m_profile.m_cpuTime += getCpuClock() - m_cpuStart;
+    }
+
+    return;
+}
+
+
+} // namespace pdal
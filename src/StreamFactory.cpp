@@ -35,6 +35,17 @@
 #include <pdal/StreamFactory.hpp>
 #include <pdal/FileUtils.hpp>
 
+#ifdef PDAL_PLATFORM_WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
 namespace pdal
 {
 
@@ -207,6 +218,258 @@ void FilenameSubsetStreamFactory::deallocate(std::istream& stream)
 }
 
 
+// --------------------------------------------------------------------
+
+// A read-only file, read at explicit positions.
+class PositionalStreamFactory::File
+{
+public:
+    File(const std::string& filename)
+    {
+#ifdef PDAL_PLATFORM_WIN32
+        m_handle = CreateFileA(filename.c_str(), GENERIC_READ,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_handle == INVALID_HANDLE_VALUE)
+            throw pdal_error("File not found: " + filename);
+#else
+        m_fd = ::open(filename.c_str(), O_RDONLY);
+        if (m_fd < 0)
+            throw pdal_error("File not found: " + filename);
+#endif
+        return;
+    }
+
+    ~File()
+    {
+#ifdef PDAL_PLATFORM_WIN32
+        CloseHandle(m_handle);
+#else
+        ::close(m_fd);
+#endif
+        return;
+    }
+
+    boost::uint64_t size() const
+    {
+#ifdef PDAL_PLATFORM_WIN32
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_handle, &size))
+            throw pdal_error("unable to get file size");
+        return static_cast<boost::uint64_t>(size.QuadPart);
+#else
+        struct stat st;
+        if (::fstat(m_fd, &st) != 0)
+            throw pdal_error("unable to get file size");
+        return static_cast<boost::uint64_t>(st.st_size);
+#endif
+    }
+
+    // Reads up to n bytes at position, returning how many were read,
+    // which is less than n only at the end of the file.
+    std::streamsize read(char* s, std::streamsize n, boost::uint64_t position) const
+    {
+        std::streamsize total = 0;
+        while (total < n)
+        {
+#ifdef PDAL_PLATFORM_WIN32
+            const boost::uint64_t at = position + total;
+            OVERLAPPED overlapped;
+            memset(&overlapped, 0, sizeof(overlapped));
+            overlapped.Offset = static_cast<DWORD>(at);
+            overlapped.OffsetHigh = static_cast<DWORD>(at >> 32);
+            DWORD count = 0;
+            const DWORD want = static_cast<DWORD>(std::min<std::streamsize>(n - total, 1 << 30));
+            if (!ReadFile(m_handle, s + total, want, &count, &overlapped) &&
+                    GetLastError() != ERROR_HANDLE_EOF)
+                throw pdal_error("error reading file");
+#else
+            const ssize_t count = ::pread(m_fd, s + total, static_cast<size_t>(n - total),
+                                          static_cast<off_t>(position + total));
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw pdal_error("error reading file");
+            }
+#endif
+            if (count == 0)
+                break;
+            total += count;
+        }
+        return total;
+    }
+
+private:
+#ifdef PDAL_PLATFORM_WIN32
+    HANDLE m_handle;
+#else
+    int m_fd;
+#endif
+
+    File& operator=(const File&); // not implemented
+    File(const File&); // not implemented
+};
+
+
+namespace
+{
+
+// A seekable source over [offset, offset + length) of a shared file,
+// with its own position.
+class PositionalSource
+{
+public:
+    typedef char char_type;
+    struct category
+        : public boost::iostreams::input_seekable
+        , public boost::iostreams::device_tag
+    {};
+
+    PositionalSource(boost::shared_ptr<PositionalStreamFactory::File> file,
+                     boost::uint64_t offset,
+                     boost::uint64_t length)
+        : m_file(file)
+        , m_offset(offset)
+        , m_length(length)
+        , m_position(0)
+    {
+        return;
+    }
+
+    std::streamsize read(char* s, std::streamsize n)
+    {
+        if (m_position >= m_length)
+            return -1;
+
+        n = static_cast<std::streamsize>(std::min<boost::uint64_t>(n, m_length - m_position));
+        const std::streamsize count = m_file->read(s, n, m_offset + m_position);
+        if (count == 0)
+            return -1;
+
+        m_position += count;
+        return count;
+    }
+
+    std::streampos seek(boost::iostreams::stream_offset off, std::ios_base::seekdir way)
+    {
+        boost::iostreams::stream_offset position = off;
+        if (way == std::ios_base::cur)
+            position += m_position;
+        else if (way == std::ios_base::end)
+            position += m_length;
+
+        if (position < 0)
+            throw std::ios_base::failure("bad seek offset");
+
+        m_position = static_cast<boost::uint64_t>(position);
+        return boost::iostreams::offset_to_position(position);
+    }
+
+private:
+    boost::shared_ptr<PositionalStreamFactory::File> m_file;
+    boost::uint64_t m_offset;
+    boost::uint64_t m_length;
+    boost::uint64_t m_position;
+};
+
+typedef boost::iostreams::stream<PositionalSource> PositionalStream;
+
+} // anonymous
+
+
+const std::streamsize PositionalStreamFactory::s_defaultBufferSize;
+
+
+PositionalStreamFactory::PositionalStreamFactory(const std::string& name, std::streamsize bufferSize)
+    : StreamFactory()
+    , m_filename(name)
+    , m_offset(0)
+    , m_length(0)
+    , m_wholeFile(true)
+    , m_bufferSize(bufferSize)
+{
+    return;
+}
+
+
+PositionalStreamFactory::PositionalStreamFactory(const std::string& name,
+        boost::uint64_t offset,
+        boost::uint64_t length,
+        std::streamsize bufferSize)
+    : StreamFactory()
+    , m_filename(name)
+    , m_offset(offset)
+    , m_length(length)
+    , m_wholeFile(false)
+    , m_bufferSize(bufferSize)
+{
+    return;
+}
+
+
+PositionalStreamFactory::~PositionalStreamFactory()
+{
+    for (std::set<std::istream*>::iterator i = m_allocated.begin(); i != m_allocated.end(); ++i)
+        delete *i;
+    for (std::vector<std::istream*>::iterator i = m_free.begin(); i != m_free.end(); ++i)
+        delete *i;
+
+    return;
+}
+
+
+std::istream& PositionalStreamFactory::allocate()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    std::istream* stream = NULL;
+    if (m_free.empty())
+    {
+        if (!m_file)
+        {
+            m_file.reset(new File(m_filename));
+            if (m_wholeFile)
+                m_length = m_file->size();
+        }
+        stream = new PositionalStream(PositionalSource(m_file, m_offset, m_length),
+                                      static_cast<int>(m_bufferSize));
+    }
+    else
+    {
+        stream = m_free.back();
+        m_free.pop_back();
+        stream->clear();
+        stream->seekg(0);
+    }
+
+    m_allocated.insert(stream);
+    return *stream;
+}
+
+
+void PositionalStreamFactory::deallocate(std::istream& stream)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    std::set<std::istream*>::iterator iter = m_allocated.find(&stream);
+    if (iter == m_allocated.end())
+        throw pdal_error("incorrect stream deallocation");
+
+    m_allocated.erase(iter);
+    m_free.push_back(&stream);
+
+    return;
+}
+
+
+std::size_t PositionalStreamFactory::getNumStreams() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_allocated.size() + m_free.size();
+}
+
+
 // --------------------------------------------------------------------
 
 
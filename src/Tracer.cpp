@@ -0,0 +1,280 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/Tracer.hpp>
+
+#include <pdal/StageBase.hpp>
+#include <pdal/StageProfile.hpp>
+#include <pdal/FileUtils.hpp>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+namespace pdal
+{
+
+namespace
+{
+
+// Scopes on any thread read the flag while enable() and disable() may be
+// setting it on another, so it is guarded like the rest of the state.  It
+// has its own lock, so that a disabled tracer never builds the log.
+boost::mutex s_enabledMutex;
+bool s_enabled = false;
+
+struct TraceEvent
+{
+    std::string name;
+    const char* category;
+    double start;
+    double duration;
+    boost::uint32_t thread;
+    const void* buffer;
+};
+
+// All of the tracer state lives here, so that it is only constructed
+// if somebody actually turns tracing on.
+struct TraceLog
+{
+    boost::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::map<boost::thread::id, boost::uint32_t> threads;
+    double origin;
+};
+
+TraceLog& getLog()
+{
+    static TraceLog log;
+    return log;
+}
+
+void writeEscaped(std::ostream& ostr, const std::string& s)
+{
+    for (std::string::const_iterator iter = s.begin(); iter != s.end(); ++iter)
+    {
+        const char c = *iter;
+        if (c == '"' || c == '\\')
+        {
+            ostr << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            ostr << ' ';
+        }
+        else
+        {
+            ostr << c;
+        }
+    }
+}
+
+} // anonymous namespace
+
+
+void Tracer::enable()
+{
+    TraceLog& log = getLog();
+
+    {
+        boost::mutex::scoped_lock lock(log.mutex);
+        log.events.clear();
+        log.origin = StageProfile::getWallClock();
+    }
+
+    boost::mutex::scoped_lock lock(s_enabledMutex);
+    s_enabled = true;
+
+    return;
+}
+
+
+void Tracer::disable()
+{
+    boost::mutex::scoped_lock lock(s_enabledMutex);
+    s_enabled = false;
+
+    return;
+}
+
+
+bool Tracer::isEnabled()
+{
+    boost::mutex::scoped_lock lock(s_enabledMutex);
+    return s_enabled;
+}
+
+
+void Tracer::clear()
+{
+    TraceLog& log = getLog();
+    boost::mutex::scoped_lock lock(log.mutex);
+
+    log.events.clear();
+
+    return;
+}
+
+
+boost::uint64_t Tracer::getNumEvents()
+{
+    TraceLog& log = getLog();
+    boost::mutex::scoped_lock lock(log.mutex);
+
+    return log.events.size();
+}
+
+
+void Tracer::record(const std::string& name,
+                    const char* category,
+                    double start,
+                    double duration,
+                    const void* buffer)
+{
+    TraceLog& log = getLog();
+    boost::mutex::scoped_lock lock(log.mutex);
+
+    // Chrome wants small thread ids, and boost::thread::id is opaque
+    const boost::thread::id tid = boost::this_thread::get_id();
+    std::map<boost::thread::id, boost::uint32_t>::const_iterator iter = log.threads.find(tid);
+    boost::uint32_t thread = 0;
+    if (iter == log.threads.end())
+    {
+        thread = static_cast<boost::uint32_t>(log.threads.size()) + 1;
+        log.threads.insert(std::make_pair(tid, thread));
+    }
+    else
+    {
+        thread = iter->second;
+    }
+
+    TraceEvent event;
+    event.name = name;
+    event.category = category;
+    event.start = start - log.origin;
+    event.duration = duration;
+    event.thread = thread;
+    event.buffer = buffer;
+
+    log.events.push_back(event);
+
+    return;
+}
+
+
+void Tracer::write(std::ostream& ostr)
+{
+    TraceLog& log = getLog();
+    boost::mutex::scoped_lock lock(log.mutex);
+
+    const std::ios::fmtflags flags = ostr.flags();
+    const std::streamsize prec = ostr.precision();
+
+    ostr << "{\"traceEvents\":[" << std::endl;
+
+    for (std::vector<TraceEvent>::size_type i = 0; i < log.events.size(); ++i)
+    {
+        const TraceEvent& event = log.events[i];
+
+        // trace-event times are in microseconds
+        ostr << std::fixed << std::setprecision(3);
+        ostr << "{\"name\":\"";
+        writeEscaped(ostr, event.name);
+        ostr << "\",\"cat\":\"" << event.category << "\""
+             << ",\"ph\":\"X\""
+             << ",\"ts\":" << event.start * 1.0e6
+             << ",\"dur\":" << event.duration * 1.0e6
+             << ",\"pid\":1"
+             << ",\"tid\":" << event.thread;
+
+        if (event.buffer)
+        {
+            ostr << ",\"args\":{\"buffer\":\"" << event.buffer << "\"}";
+        }
+
+        ostr << "}";
+        if (i + 1 < log.events.size()) ostr << ",";
+        ostr << std::endl;
+    }
+
+    ostr << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+    ostr.flags(flags);
+    ostr.precision(prec);
+
+    return;
+}
+
+
+void Tracer::write(const std::string& filename)
+{
+    std::ostream* ostr = FileUtils::createFile(filename, false);
+
+    write(*ostr);
+
+    FileUtils::closeFile(ostr);
+
+    return;
+}
+
+
+void Tracer::Scope::begin()
+{
+    m_start = StageProfile::getWallClock();
+
+    return;
+}
+
+
+void Tracer::Scope::end()
+{
+    const double duration = StageProfile::getWallClock() - m_start;
+
+    std::string name(m_event);
+    if (m_stage)
+    {
+        name = m_stage->getName() + " " + name;
+    }
+
+    Tracer::record(name, m_event, m_start, duration, m_buffer);
+
+    return;
+}
+
+
+} // namespace pdal
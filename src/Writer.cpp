@@ -40,6 +40,7 @@
 #include <pdal/Stage.hpp>
 #include <pdal/PointBuffer.hpp>
 #include <pdal/UserCallback.hpp>
+#include <pdal/Tracer.hpp>
 
 #include <pdal/PipelineWriter.hpp>
 
@@ -149,6 +150,9 @@ boost::uint64_t Writer::write(boost::uint64_t targetNumPointsToWrite)
         throw pdal_error("stage not initialized");
     }
 
+    StageProfile& profile = getProfile();
+    StageProfile::Timer timer(profile);
+
     boost::uint64_t actualNumPointsWritten = 0;
 
     UserCallback* callback = getUserCallback();
@@ -156,6 +160,7 @@ boost::uint64_t Writer::write(boost::uint64_t targetNumPointsToWrite)
 
     const Schema& schema = getPrevStage().getSchema();
     PointBuffer buffer(schema, m_chunkSize);
+    profile.addBufferAllocation();
 
     boost::scoped_ptr<StageSequentialIterator> iter(getPrevStage().createSequentialIterator(buffer));
 
@@ -164,7 +169,10 @@ boost::uint64_t Writer::write(boost::uint64_t targetNumPointsToWrite)
     // if we don't have an SRS, try to forward the one from the prev stage
     if (m_spatialReference.empty()) m_spatialReference = getPrevStage().getSpatialReference();
 
-    writeBegin(targetNumPointsToWrite);
+    {
+        Tracer::Scope trace("writeBegin", this);
+        writeBegin(targetNumPointsToWrite);
+    }
 
     iter->readBegin();
 
@@ -196,6 +204,7 @@ boost::uint64_t Writer::write(boost::uint64_t targetNumPointsToWrite)
             {
                 // Use the PointBuffer's schema in case the schema changed
                 buffer = PointBuffer(buffer.getSchema(), numPointsToReadThisChunk);
+                profile.addBufferAllocation();
             }
         }
 
@@ -211,10 +220,16 @@ boost::uint64_t Writer::write(boost::uint64_t targetNumPointsToWrite)
         if (numPointsReadThisChunk == 0) break;
 
         // write...
-        writeBufferBegin(buffer);
-        const boost::uint32_t numPointsWrittenThisChunk = writeBuffer(buffer);
-        assert(numPointsWrittenThisChunk == numPointsReadThisChunk);
-        writeBufferEnd(buffer);
+        boost::uint32_t numPointsWrittenThisChunk = 0;
+        {
+            Tracer::Scope trace("writeBuffer", this, &buffer);
+            writeBufferBegin(buffer);
+            numPointsWrittenThisChunk = writeBuffer(buffer);
+            assert(numPointsWrittenThisChunk == numPointsReadThisChunk);
+            writeBufferEnd(buffer);
+        }
+
+        profile.addBuffer(numPointsWrittenThisChunk, static_cast<boost::uint32_t>(buffer.getSchema().getByteSize()));
 
         // update count
         actualNumPointsWritten += numPointsWrittenThisChunk;
@@ -233,7 +248,10 @@ boost::uint64_t Writer::write(boost::uint64_t targetNumPointsToWrite)
 
     iter->readEnd();
 
-    writeEnd(actualNumPointsWritten);
+    {
+        Tracer::Scope trace("writeEnd", this);
+        writeEnd(actualNumPointsWritten);
+    }
 
     assert((targetNumPointsToWrite == 0) || (actualNumPointsWritten <= targetNumPointsToWrite));
 
@@ -0,0 +1,555 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/columnar/Codec.hpp>
+
+#ifdef PDAL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace columnar
+{
+
+namespace
+{
+
+const std::size_t s_blockSize = 128;
+
+
+template <typename T>
+inline T load(const char* p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+
+template <typename T>
+inline char* store(char* p, T const& v)
+{
+    std::memcpy(p, &v, sizeof(T));
+    return p + sizeof(T);
+}
+
+
+template <typename U>
+inline U zigzag(U v)
+{
+    return static_cast<U>(static_cast<U>(v << 1) ^ static_cast<U>(0 - (v >> (sizeof(U) * 8 - 1))));
+}
+
+
+template <typename U>
+inline U unzigzag(U v)
+{
+    return static_cast<U>((v >> 1) ^ static_cast<U>(0 - (v & 1)));
+}
+
+
+inline std::size_t getBitWidth(boost::uint64_t v)
+{
+    std::size_t width = 0;
+    while (v)
+    {
+        ++width;
+        v >>= 1;
+    }
+    return width;
+}
+
+
+// the 64 bit words taken by n values of width bits
+inline std::size_t getNumWords(std::size_t n, std::size_t width)
+{
+    return (n * width + 63) / 64;
+}
+
+
+// Unpacks n values of width bits. words must hold one word more than the
+// values need, so that each value can be read from two words without a
+// branch; this keeps the loop simple enough for the compiler to vectorize.
+inline void unpack(const boost::uint64_t* words, std::size_t width, std::size_t n, boost::uint64_t* values)
+{
+    if (width == 0)
+    {
+        std::fill(values, values + n, 0);
+        return;
+    }
+    if (width == 64)
+    {
+        std::copy(words, words + n, values);
+        return;
+    }
+
+    const boost::uint64_t mask = (static_cast<boost::uint64_t>(1) << width) - 1;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::size_t bit = i * width;
+        const std::size_t shift = bit & 63;
+        const boost::uint64_t* word = words + (bit >> 6);
+        values[i] = ((word[0] >> shift) | ((word[1] << 1) << (63 - shift))) & mask;
+    }
+    return;
+}
+
+
+void throwTruncated()
+{
+    throw columnar_error("columnar file column is truncated or corrupt");
+}
+
+
+// The first value as a uint64, a byte per block of 128 values giving the
+// width of its steps, padded to 8 bytes, then each block's steps packed
+// into 64 bit words.
+template <typename U>
+void encodeDelta(const char* values, boost::uint32_t count, std::vector<char>& encoded)
+{
+    const std::size_t numBlocks = (count + s_blockSize - 1) / s_blockSize;
+    const std::size_t headerSize = 8 + static_cast<std::size_t>(Footer::getPaddedSize(numBlocks));
+
+    encoded.assign(headerSize + numBlocks * getNumWords(s_blockSize, sizeof(U) * 8) * 8, 0);
+
+    const U first = load<U>(values);
+    store(&encoded[0], static_cast<boost::uint64_t>(first));
+
+    char* widths = &encoded[8];
+    char* out = &encoded[headerSize];
+
+    boost::uint64_t steps[s_blockSize];
+    U previous = first;
+    for (std::size_t block = 0; block < numBlocks; ++block)
+    {
+        const std::size_t begin = block * s_blockSize;
+        const std::size_t n = std::min<std::size_t>(s_blockSize, count - begin);
+        const char* p = values + begin * sizeof(U);
+
+        boost::uint64_t all = 0;
+        for (std::size_t i = 0; i < n; ++i, p += sizeof(U))
+        {
+            const U value = load<U>(p);
+            const U step = zigzag<U>(static_cast<U>(value - previous));
+            previous = value;
+            steps[i] = step;
+            all |= step;
+        }
+
+        const std::size_t width = getBitWidth(all);
+        widths[block] = static_cast<char>(width);
+        if (width == 0)
+            continue;
+
+        boost::uint64_t word = 0;
+        std::size_t used = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            word |= steps[i] << used;
+            used += width;
+            if (used >= 64)
+            {
+                out = store(out, word);
+                used -= 64;
+                word = used ? steps[i] >> (width - used) : 0;
+            }
+        }
+        if (used)
+            out = store(out, word);
+    }
+
+    encoded.resize(out - &encoded[0]);
+
+    return;
+}
+
+
+template <typename U>
+void decodeDelta(const char* encoded, std::size_t encodedSize, boost::uint32_t count, char* values)
+{
+    const std::size_t numBlocks = (count + s_blockSize - 1) / s_blockSize;
+    const std::size_t headerSize = 8 + static_cast<std::size_t>(Footer::getPaddedSize(numBlocks));
+    if (encodedSize < headerSize)
+        throwTruncated();
+
+    const char* widths = encoded + 8;
+    const char* position = encoded + headerSize;
+    const char* last = encoded + encodedSize;
+
+    boost::uint64_t words[s_blockSize + 1];
+    boost::uint64_t steps[s_blockSize];
+    U previous = static_cast<U>(load<boost::uint64_t>(encoded));
+    for (std::size_t block = 0; block < numBlocks; ++block)
+    {
+        const std::size_t begin = block * s_blockSize;
+        const std::size_t n = std::min<std::size_t>(s_blockSize, count - begin);
+
+        const std::size_t width = static_cast<unsigned char>(widths[block]);
+        if (width > sizeof(U) * 8)
+            throwTruncated();
+
+        const std::size_t numWords = getNumWords(n, width);
+        if (static_cast<std::size_t>(last - position) < numWords * 8)
+            throwTruncated();
+        std::memcpy(words, position, numWords * 8);
+        words[numWords] = 0;
+        position += numWords * 8;
+
+        unpack(words, width, n, steps);
+
+        char* p = values + begin * sizeof(U);
+        for (std::size_t i = 0; i < n; ++i, p += sizeof(U))
+        {
+            previous = static_cast<U>(previous + unzigzag<U>(static_cast<U>(steps[i])));
+            store(p, previous);
+        }
+    }
+
+    return;
+}
+
+
+// Each run as a uint32 length followed by the value.
+template <typename U>
+void encodeRunLength(const char* values, boost::uint32_t count, std::vector<char>& encoded)
+{
+    encoded.clear();
+
+    char record[sizeof(boost::uint32_t) + sizeof(U)];
+    boost::uint32_t i = 0;
+    while (i < count)
+    {
+        const U value = load<U>(values + i * sizeof(U));
+        boost::uint32_t run = 1;
+        while (i + run < count && load<U>(values + (i + run) * sizeof(U)) == value)
+            ++run;
+
+        store(store(record, run), value);
+        encoded.insert(encoded.end(), record, record + sizeof(record));
+        i += run;
+    }
+
+    return;
+}
+
+
+template <typename U>
+void decodeRunLength(const char* encoded, std::size_t encodedSize, boost::uint32_t count, char* values)
+{
+    const std::size_t recordSize = sizeof(boost::uint32_t) + sizeof(U);
+    if (encodedSize % recordSize)
+        throwTruncated();
+
+    boost::uint32_t i = 0;
+    for (const char* record = encoded; record != encoded + encodedSize; record += recordSize)
+    {
+        const boost::uint32_t run = load<boost::uint32_t>(record);
+        if (run > count - i)
+            throwTruncated();
+
+        const U value = load<U>(record + sizeof(boost::uint32_t));
+        char* p = values + i * sizeof(U);
+        for (boost::uint32_t j = 0; j < run; ++j, p += sizeof(U))
+            store(p, value);
+        i += run;
+    }
+    if (i != count)
+        throwTruncated();
+
+    return;
+}
+
+
+#ifdef PDAL_HAVE_ZLIB
+
+void shuffle(const char* values, boost::uint32_t count, std::size_t size, char* bytes)
+{
+    for (std::size_t b = 0; b < size; ++b)
+    {
+        const char* in = values + b;
+        char* out = bytes + b * count;
+        for (boost::uint32_t i = 0; i < count; ++i, in += size)
+            out[i] = *in;
+    }
+    return;
+}
+
+
+void unshuffle(const char* bytes, boost::uint32_t count, std::size_t size, char* values)
+{
+    for (std::size_t b = 0; b < size; ++b)
+    {
+        const char* in = bytes + b * count;
+        char* out = values + b;
+        for (boost::uint32_t i = 0; i < count; ++i, out += size)
+            *out = in[i];
+    }
+    return;
+}
+
+
+void deflateBytes(const char* bytes, std::size_t size, std::vector<char>& encoded)
+{
+    uLongf encodedSize = compressBound(static_cast<uLong>(size));
+    encoded.resize(encodedSize);
+
+    const int status = compress2(static_cast<Bytef*>(static_cast<void*>(&encoded[0])), &encodedSize,
+                                 static_cast<const Bytef*>(static_cast<const void*>(bytes)),
+                                 static_cast<uLong>(size), Z_BEST_SPEED);
+    if (status != Z_OK)
+        throw columnar_error("unable to deflate a column");
+    encoded.resize(encodedSize);
+
+    return;
+}
+
+
+void inflateBytes(const char* encoded, std::size_t encodedSize, char* bytes, std::size_t size)
+{
+    uLongf inflatedSize = static_cast<uLongf>(size);
+    const int status = uncompress(static_cast<Bytef*>(static_cast<void*>(bytes)), &inflatedSize,
+                                  static_cast<const Bytef*>(static_cast<const void*>(encoded)),
+                                  static_cast<uLong>(encodedSize));
+    if (status != Z_OK || inflatedSize != size)
+        throwTruncated();
+
+    return;
+}
+
+#endif
+
+
+void throwBadSize(codec::Type type, std::size_t size)
+{
+    std::ostringstream oss;
+    oss << "codec '" << getCodecName(type) << "' does not support values of " << size << " bytes";
+    throw columnar_error(oss.str());
+}
+
+} // anonymous namespace
+
+
+codec::Type getCodec(std::string const& name)
+{
+    if (boost::iequals(name, "none")) return codec::None;
+    if (boost::iequals(name, "delta")) return codec::Delta;
+    if (boost::iequals(name, "rle")) return codec::RunLength;
+    if (boost::iequals(name, "deflate")) return codec::Deflate;
+    if (boost::iequals(name, "shuffle")) return codec::Shuffle;
+    if (boost::iequals(name, "auto")) return codec::Auto;
+
+    throw columnar_error("unknown columnar codec '" + name + "'");
+}
+
+
+std::string getCodecName(codec::Type type)
+{
+    switch (type)
+    {
+        case codec::None: return "none";
+        case codec::Delta: return "delta";
+        case codec::RunLength: return "rle";
+        case codec::Deflate: return "deflate";
+        case codec::Shuffle: return "shuffle";
+        case codec::Auto: return "auto";
+    }
+    return "unknown";
+}
+
+
+bool isCodecAvailable(codec::Type type)
+{
+    if (type == codec::Deflate || type == codec::Shuffle)
+    {
+#ifdef PDAL_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    }
+    return true;
+}
+
+
+codec::Type chooseCodec(Dimension const& dim)
+{
+    const std::size_t size = dim.getByteSize();
+    if (size != 1 && size != 2 && size != 4 && size != 8)
+        return codec::None;
+    if (size == 1)
+        return codec::RunLength;
+    if (dim.getInterpretation() == dimension::Float && isCodecAvailable(codec::Shuffle))
+        return codec::Shuffle;
+    return codec::Delta;
+}
+
+
+void encodeColumn(codec::Type type, const char* values, boost::uint32_t count,
+                  std::size_t size, std::vector<char>& encoded)
+{
+    if (!isCodecAvailable(type))
+        throw columnar_error("codec '" + getCodecName(type) + "' needs PDAL built with zlib");
+
+    encoded.clear();
+    if (count == 0)
+        return;
+
+    switch (type)
+    {
+        case codec::None:
+            encoded.assign(values, values + count * size);
+            break;
+
+        case codec::Delta:
+            switch (size)
+            {
+                case 1: encodeDelta<boost::uint8_t>(values, count, encoded); break;
+                case 2: encodeDelta<boost::uint16_t>(values, count, encoded); break;
+                case 4: encodeDelta<boost::uint32_t>(values, count, encoded); break;
+                case 8: encodeDelta<boost::uint64_t>(values, count, encoded); break;
+                default: throwBadSize(type, size);
+            }
+            break;
+
+        case codec::RunLength:
+            switch (size)
+            {
+                case 1: encodeRunLength<boost::uint8_t>(values, count, encoded); break;
+                case 2: encodeRunLength<boost::uint16_t>(values, count, encoded); break;
+                case 4: encodeRunLength<boost::uint32_t>(values, count, encoded); break;
+                case 8: encodeRunLength<boost::uint64_t>(values, count, encoded); break;
+                default: throwBadSize(type, size);
+            }
+            break;
+
+        case codec::Deflate:
+#ifdef PDAL_HAVE_ZLIB
+            deflateBytes(values, count * size, encoded);
+#endif
+            break;
+
+        case codec::Shuffle:
+#ifdef PDAL_HAVE_ZLIB
+            {
+                std::vector<char> bytes(count * size);
+                shuffle(values, count, size, &bytes[0]);
+                deflateBytes(&bytes[0], bytes.size(), encoded);
+            }
+#endif
+            break;
+
+        default:
+            throw columnar_error("codec '" + getCodecName(type) + "' can't encode a column");
+    }
+
+    return;
+}
+
+
+void decodeColumn(codec::Type type, const char* encoded, std::size_t encodedSize,
+                  boost::uint32_t count, std::size_t size, char* values)
+{
+    if (!isCodecAvailable(type))
+        throw columnar_error("codec '" + getCodecName(type) + "' needs PDAL built with zlib");
+
+    if (count == 0)
+        return;
+
+    switch (type)
+    {
+        case codec::None:
+            if (encodedSize != count * size)
+                throwTruncated();
+            std::memcpy(values, encoded, encodedSize);
+            break;
+
+        case codec::Delta:
+            switch (size)
+            {
+                case 1: decodeDelta<boost::uint8_t>(encoded, encodedSize, count, values); break;
+                case 2: decodeDelta<boost::uint16_t>(encoded, encodedSize, count, values); break;
+                case 4: decodeDelta<boost::uint32_t>(encoded, encodedSize, count, values); break;
+                case 8: decodeDelta<boost::uint64_t>(encoded, encodedSize, count, values); break;
+                default: throwBadSize(type, size);
+            }
+            break;
+
+        case codec::RunLength:
+            switch (size)
+            {
+                case 1: decodeRunLength<boost::uint8_t>(encoded, encodedSize, count, values); break;
+                case 2: decodeRunLength<boost::uint16_t>(encoded, encodedSize, count, values); break;
+                case 4: decodeRunLength<boost::uint32_t>(encoded, encodedSize, count, values); break;
+                case 8: decodeRunLength<boost::uint64_t>(encoded, encodedSize, count, values); break;
+                default: throwBadSize(type, size);
+            }
+            break;
+
+        case codec::Deflate:
+#ifdef PDAL_HAVE_ZLIB
+            inflateBytes(encoded, encodedSize, values, count * size);
+#endif
+            break;
+
+        case codec::Shuffle:
+#ifdef PDAL_HAVE_ZLIB
+            {
+                std::vector<char> bytes(count * size);
+                inflateBytes(encoded, encodedSize, &bytes[0], bytes.size());
+                unshuffle(&bytes[0], count, size, values);
+            }
+#endif
+            break;
+
+        default:
+            throw columnar_error("codec '" + getCodecName(type) + "' can't decode a column");
+    }
+
+    return;
+}
+
+
+}
+}
+} // namespaces
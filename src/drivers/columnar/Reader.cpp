@@ -0,0 +1,439 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/columnar/Reader.hpp>
+#include <pdal/drivers/columnar/Codec.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/PointBuffer.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace columnar
+{
+
+namespace
+{
+
+struct ColumnCopy
+{
+    std::size_t column;
+    std::size_t byteOffset;
+    std::size_t size;
+};
+
+
+template <std::size_t N>
+inline void scatter(const char* src, boost::uint8_t* dest, std::size_t stride, boost::uint32_t count)
+{
+    for (boost::uint32_t i = 0; i < count; ++i, src += N, dest += stride)
+        std::memcpy(dest, src, N);
+    return;
+}
+
+
+// Copies count values of a column into consecutive rows of a buffer.
+inline void scatter(const char* src, boost::uint8_t* dest, std::size_t stride,
+                    boost::uint32_t count, std::size_t size)
+{
+    switch (size)
+    {
+        case 1: scatter<1>(src, dest, stride, count); break;
+        case 2: scatter<2>(src, dest, stride, count); break;
+        case 4: scatter<4>(src, dest, stride, count); break;
+        case 8: scatter<8>(src, dest, stride, count); break;
+        default:
+            for (boost::uint32_t i = 0; i < count; ++i, src += size, dest += stride)
+                std::memcpy(dest, src, size);
+            break;
+    }
+    return;
+}
+
+} // anonymous namespace
+
+
+Reader::Reader(const Options& options)
+    : pdal::Reader(options)
+{
+    return;
+}
+
+
+Reader::~Reader()
+{
+    return;
+}
+
+
+std::string Reader::getFileName() const
+{
+    return getOptions().getValueOrThrow<std::string>("filename");
+}
+
+
+const Options Reader::getDefaultOptions() const
+{
+    Options options;
+
+    Option filename("filename", "", "Columnar file to read");
+    Option dimensions("dimensions", "", "Comma separated names of the dimensions to read, all when empty");
+
+    options.add(filename);
+    options.add(dimensions);
+
+    return options;
+}
+
+
+void Reader::initialize()
+{
+    pdal::Reader::initialize();
+
+    const std::string filename = getFileName();
+    if (!FileUtils::fileExists(filename) || FileUtils::fileSize(filename) == 0)
+        throw columnar_error("unable to open columnar file '" + filename + "'");
+
+    m_file.open(filename);
+    m_footer.read(m_file.data(), m_file.size());
+
+    m_chunkStarts.clear();
+    boost::uint64_t numPoints = 0;
+    Bounds<double> bounds;
+    for (std::vector<ChunkInfo>::const_iterator chunk = m_footer.chunks.begin(); chunk != m_footer.chunks.end(); ++chunk)
+    {
+        m_chunkStarts.push_back(numPoints);
+        numPoints += chunk->numPoints;
+
+        for (std::size_t i = 0; i < chunk->columns.size(); ++i)
+        {
+            const boost::uint64_t size = static_cast<boost::uint64_t>(m_footer.dimensions[i].getByteSize()) * chunk->numPoints;
+            if (chunk->columns[i].codec == codec::None && chunk->columns[i].size != size)
+                throw columnar_error("columnar file column is truncated or corrupt");
+        }
+
+        if (chunk->bounds.size())
+        {
+            if (bounds.size())
+                bounds.grow(chunk->bounds);
+            else
+                bounds = chunk->bounds;
+        }
+    }
+
+    std::vector<Dimension> dimensions;
+    const std::string names = getOptions().getValueOrDefault<std::string>("dimensions", "");
+    if (names.empty())
+    {
+        dimensions = m_footer.dimensions;
+    }
+    else
+    {
+        std::vector<std::string> wanted;
+        boost::split(wanted, names, boost::is_any_of(","));
+        for (std::vector<std::string>::const_iterator name = wanted.begin(); name != wanted.end(); ++name)
+        {
+            const std::string trimmed = boost::trim_copy(*name);
+            std::size_t found = 0;
+            for (std::vector<Dimension>::const_iterator dim = m_footer.dimensions.begin(); dim != m_footer.dimensions.end(); ++dim)
+            {
+                if (dim->getName() == trimmed)
+                {
+                    dimensions.push_back(*dim);
+                    ++found;
+                }
+            }
+            if (!found)
+                throw columnar_error("columnar file '" + filename + "' has no dimension '" + trimmed + "'");
+        }
+    }
+    getSchemaRef() = Schema(dimensions);
+
+    setPointCountType(PointCount_Fixed);
+    setNumPoints(numPoints);
+    if (bounds.size())
+        setBounds(bounds);
+
+    if (!m_footer.spatialReference.empty())
+    {
+        SpatialReference srs;
+        srs.setWKT(m_footer.spatialReference);
+        setSpatialReference(srs);
+    }
+
+    return;
+}
+
+
+int Reader::findColumn(Dimension const& dim) const
+{
+    int byName = -1;
+    for (std::size_t i = 0; i < m_footer.dimensions.size(); ++i)
+    {
+        Dimension const& column = m_footer.dimensions[i];
+        if (column.getName() != dim.getName())
+            continue;
+        if (column.getNamespace() == dim.getNamespace())
+            return static_cast<int>(i);
+        if (byName < 0)
+            byName = static_cast<int>(i);
+    }
+    return byName;
+}
+
+
+std::size_t Reader::getColumnIndex(Dimension const& dim) const
+{
+    const int column = findColumn(dim);
+    if (column < 0)
+        throw columnar_error("columnar file has no dimension '" + dim.getName() + "'");
+    return static_cast<std::size_t>(column);
+}
+
+
+const char* Reader::getColumnData(std::size_t chunk, std::size_t column) const
+{
+    ChunkInfo const& info = m_footer.chunks[chunk];
+    return m_file.data() + info.offset + info.columns[column].offset;
+}
+
+
+codec::Type Reader::getColumnCodec(std::size_t chunk, Dimension const& dim) const
+{
+    return m_footer.chunks[chunk].columns[getColumnIndex(dim)].codec;
+}
+
+
+const boost::uint8_t* Reader::getColumn(std::size_t chunk, Dimension const& dim) const
+{
+    const std::size_t column = getColumnIndex(dim);
+    if (m_footer.chunks[chunk].columns[column].codec != codec::None)
+        throw columnar_error("column '" + dim.getName() + "' is encoded, it has to be decoded");
+
+    const char* p = getColumnData(chunk, column);
+    return static_cast<const boost::uint8_t*>(static_cast<const void*>(p));
+}
+
+
+void Reader::decodeColumn(std::size_t chunk, Dimension const& dim, std::vector<boost::uint8_t>& values) const
+{
+    const std::size_t column = getColumnIndex(dim);
+    ChunkInfo const& info = m_footer.chunks[chunk];
+    const std::size_t size = m_footer.dimensions[column].getByteSize();
+
+    values.resize(info.numPoints * size);
+    if (values.empty())
+        return;
+
+    pdal::drivers::columnar::decodeColumn(info.columns[column].codec, getColumnData(chunk, column),
+                                          static_cast<std::size_t>(info.columns[column].size),
+                                          info.numPoints, size,
+                                          static_cast<char*>(static_cast<void*>(&values[0])));
+
+    return;
+}
+
+
+boost::uint32_t Reader::processBuffer(PointBuffer& data, boost::uint64_t pointIndex, DecodedChunk& decoded) const
+{
+    const Schema& schema = data.getSchema();
+    const std::size_t stride = schema.getByteSize();
+
+    std::vector<ColumnCopy> copies;
+    schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
+    for (schema::index_by_index::const_iterator i = dims.begin(); i != dims.end(); ++i)
+    {
+        const int column = findColumn(*i);
+        if (column < 0)
+            continue;
+
+        Dimension const& stored = m_footer.dimensions[column];
+        if (stored.getByteSize() != i->getByteSize() || stored.getInterpretation() != i->getInterpretation())
+            throw columnar_error("dimension '" + i->getName() + "' has a different type in the buffer than in the file");
+
+        ColumnCopy copy;
+        copy.column = static_cast<std::size_t>(column);
+        copy.byteOffset = i->getByteOffset();
+        copy.size = i->getByteSize();
+        copies.push_back(copy);
+    }
+
+    const boost::uint64_t numPoints = getNumPoints();
+    const boost::uint32_t capacity = data.getCapacity();
+
+    boost::uint32_t count = 0;
+    while (count < capacity && pointIndex < numPoints)
+    {
+        const std::size_t chunk = std::upper_bound(m_chunkStarts.begin(), m_chunkStarts.end(), pointIndex) - m_chunkStarts.begin() - 1;
+        const boost::uint64_t first = pointIndex - m_chunkStarts[chunk];
+        const boost::uint32_t n = static_cast<boost::uint32_t>(
+            std::min<boost::uint64_t>(capacity - count, m_footer.chunks[chunk].numPoints - first));
+
+        ChunkInfo const& info = m_footer.chunks[chunk];
+        if (decoded.chunk != chunk)
+        {
+            decoded.chunk = chunk;
+            decoded.columns.resize(m_footer.dimensions.size());
+            for (std::size_t i = 0; i < decoded.columns.size(); ++i)
+                decoded.columns[i].clear();
+        }
+
+        for (std::vector<ColumnCopy>::const_iterator copy = copies.begin(); copy != copies.end(); ++copy)
+        {
+            ColumnInfo const& column = info.columns[copy->column];
+
+            const char* values = getColumnData(chunk, copy->column);
+            if (column.codec != codec::None)
+            {
+                std::vector<char>& buffer = decoded.columns[copy->column];
+                if (buffer.empty())
+                {
+                    buffer.resize(info.numPoints * copy->size);
+                    pdal::drivers::columnar::decodeColumn(column.codec, values, static_cast<std::size_t>(column.size),
+                                                          info.numPoints, copy->size, &buffer[0]);
+                }
+                values = &buffer[0];
+            }
+
+            scatter(values + first * copy->size, data.getData(count) + copy->byteOffset, stride, n, copy->size);
+        }
+
+        count += n;
+        pointIndex += n;
+    }
+
+    data.setNumPoints(count);
+
+    return count;
+}
+
+
+boost::property_tree::ptree Reader::toPTree() const
+{
+    boost::property_tree::ptree tree = pdal::Reader::toPTree();
+
+    // add stuff here specific to this stage type
+
+    return tree;
+}
+
+
+pdal::StageSequentialIterator* Reader::createSequentialIterator(PointBuffer& buffer) const
+{
+    return new pdal::drivers::columnar::iterators::sequential::Reader(*this, buffer);
+}
+
+
+pdal::StageRandomIterator* Reader::createRandomIterator(PointBuffer& buffer) const
+{
+    return new pdal::drivers::columnar::iterators::random::Reader(*this, buffer);
+}
+
+
+namespace iterators
+{
+
+namespace sequential
+{
+
+
+Reader::Reader(const pdal::drivers::columnar::Reader& reader, PointBuffer& buffer)
+    : pdal::ReaderSequentialIterator(reader, buffer)
+    , m_reader(reader)
+{
+    return;
+}
+
+
+boost::uint64_t Reader::skipImpl(boost::uint64_t count)
+{
+    const boost::uint64_t numPoints = getStage().getNumPoints();
+    const boost::uint64_t index = getIndex();
+
+    if (index >= numPoints)
+        return 0;
+    return std::min(count, numPoints - index);
+}
+
+
+bool Reader::atEndImpl() const
+{
+    return getIndex() >= getStage().getNumPoints();
+}
+
+
+boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
+{
+    return m_reader.processBuffer(data, getIndex(), m_decoded);
+}
+
+} // sequential
+
+namespace random
+{
+
+
+Reader::Reader(const pdal::drivers::columnar::Reader& reader, PointBuffer& buffer)
+    : pdal::ReaderRandomIterator(reader, buffer)
+    , m_reader(reader)
+{
+    return;
+}
+
+
+boost::uint64_t Reader::seekImpl(boost::uint64_t count)
+{
+    return std::min(count, getStage().getNumPoints());
+}
+
+
+boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
+{
+    return m_reader.processBuffer(data, getIndex(), m_decoded);
+}
+
+
+} // random
+} // iterators
+
+}
+}
+} // namespaces
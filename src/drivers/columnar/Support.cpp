@@ -0,0 +1,337 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/columnar/Support.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace columnar
+{
+
+namespace
+{
+
+// Appends the footer's fields to a byte buffer.
+class Encoder
+{
+public:
+    Encoder(std::vector<char>& bytes)
+        : m_bytes(bytes)
+    {}
+
+    template <typename T>
+    void put(T const& v)
+    {
+        const char* p = static_cast<const char*>(static_cast<const void*>(&v));
+        m_bytes.insert(m_bytes.end(), p, p + sizeof(T));
+    }
+
+    void put(std::string const& s)
+    {
+        put(static_cast<boost::uint32_t>(s.size()));
+        m_bytes.insert(m_bytes.end(), s.begin(), s.end());
+    }
+
+    void put(dimension::id const& id)
+    {
+        m_bytes.insert(m_bytes.end(), id.begin(), id.end());
+    }
+
+private:
+    Encoder& operator=(const Encoder&); // not implemented
+
+    std::vector<char>& m_bytes;
+};
+
+
+// Reads the footer's fields, throwing rather than running off the end.
+class Decoder
+{
+public:
+    Decoder(const char* first, const char* last)
+        : m_position(first)
+        , m_last(last)
+    {}
+
+    template <typename T>
+    T get()
+    {
+        T v;
+        std::memcpy(&v, take(sizeof(T)), sizeof(T));
+        return v;
+    }
+
+    std::string getString()
+    {
+        const boost::uint32_t size = get<boost::uint32_t>();
+        const char* p = take(size);
+        return std::string(p, p + size);
+    }
+
+    const char* getPosition() const
+    {
+        return m_position;
+    }
+
+    dimension::id getId()
+    {
+        dimension::id id;
+        const char* p = take(dimension::id::static_size());
+        std::copy(p, p + dimension::id::static_size(), id.begin());
+        return id;
+    }
+
+private:
+    const char* take(std::size_t size)
+    {
+        if (static_cast<std::size_t>(m_last - m_position) < size)
+            throw columnar_error("columnar file footer is truncated");
+        const char* p = m_position;
+        m_position += size;
+        return p;
+    }
+
+    const char* m_position;
+    const char* m_last;
+};
+
+} // anonymous namespace
+
+
+const char Footer::s_magic[8] = { 'P', 'D', 'A', 'L', 'C', 'O', 'L', 'S' };
+const boost::uint32_t Footer::s_version = 2;
+const boost::uint32_t Footer::s_byteOrderMark = 0x01020304;
+const std::size_t Footer::s_headerSize = 16;
+const std::size_t Footer::s_trailerSize = 16;
+
+
+boost::uint64_t Footer::getPaddedSize(boost::uint64_t size)
+{
+    return (size + 7) & ~static_cast<boost::uint64_t>(7);
+}
+
+
+void Footer::writeHeader(std::ostream& stream)
+{
+    stream.write(s_magic, sizeof(s_magic));
+    stream.write(static_cast<const char*>(static_cast<const void*>(&s_version)), sizeof(s_version));
+    stream.write(static_cast<const char*>(static_cast<const void*>(&s_byteOrderMark)), sizeof(s_byteOrderMark));
+
+    return;
+}
+
+
+void Footer::write(std::ostream& stream, boost::uint64_t position) const
+{
+    std::vector<char> bytes;
+    encode(bytes);
+
+    if (!bytes.empty())
+        stream.write(&bytes[0], bytes.size());
+    stream.write(static_cast<const char*>(static_cast<const void*>(&position)), sizeof(position));
+    stream.write(s_magic, sizeof(s_magic));
+
+    return;
+}
+
+
+void Footer::read(const char* data, std::size_t size)
+{
+    if (size < s_headerSize + s_trailerSize ||
+            std::memcmp(data, s_magic, sizeof(s_magic)) != 0 ||
+            std::memcmp(data + size - sizeof(s_magic), s_magic, sizeof(s_magic)) != 0)
+        throw columnar_error("not a columnar point file, or an incomplete one");
+
+    Decoder header(data + sizeof(s_magic), data + s_headerSize);
+    const boost::uint32_t version = header.get<boost::uint32_t>();
+    if (version != s_version)
+    {
+        std::ostringstream oss;
+        oss << "columnar file version " << version << " is not supported";
+        throw columnar_error(oss.str());
+    }
+    if (header.get<boost::uint32_t>() != s_byteOrderMark)
+        throw columnar_error("columnar file was written on a machine of the other byte order");
+
+    Decoder trailer(data + size - s_trailerSize, data + size);
+    const boost::uint64_t position = trailer.get<boost::uint64_t>();
+    if (position < s_headerSize || position > size - s_trailerSize)
+        throw columnar_error("columnar file footer offset is out of range");
+
+    decode(data + position, data + size - s_trailerSize);
+
+    for (std::vector<ChunkInfo>::const_iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk)
+    {
+        if (chunk->offset < s_headerSize || chunk->offset > position)
+            throw columnar_error("columnar file chunk is out of range");
+
+        for (std::vector<ColumnInfo>::const_iterator column = chunk->columns.begin(); column != chunk->columns.end(); ++column)
+        {
+            if (column->offset > position - chunk->offset || column->size > position - chunk->offset - column->offset)
+                throw columnar_error("columnar file column is out of range");
+        }
+    }
+
+    return;
+}
+
+
+void Footer::encode(std::vector<char>& bytes) const
+{
+    bytes.clear();
+    Encoder encoder(bytes);
+    encoder.put(static_cast<boost::uint32_t>(dimensions.size()));
+    for (std::vector<Dimension>::const_iterator i = dimensions.begin(); i != dimensions.end(); ++i)
+    {
+        encoder.put(i->getName());
+        encoder.put(i->getNamespace());
+        encoder.put(i->getDescription());
+        encoder.put(static_cast<boost::uint32_t>(i->getInterpretation()));
+        encoder.put(static_cast<boost::uint32_t>(i->getByteSize()));
+        encoder.put(i->getNumericScale());
+        encoder.put(i->getNumericOffset());
+        encoder.put(i->getMinimum());
+        encoder.put(i->getMaximum());
+        encoder.put(static_cast<boost::uint32_t>(i->getEndianness()));
+        encoder.put(i->getFlags());
+        encoder.put(i->getUUID());
+        encoder.put(i->getParent());
+    }
+
+    encoder.put(xmlSchema);
+    encoder.put(spatialReference);
+
+    encoder.put(static_cast<boost::uint64_t>(chunks.size()));
+    for (std::vector<ChunkInfo>::const_iterator i = chunks.begin(); i != chunks.end(); ++i)
+    {
+        encoder.put(i->offset);
+        encoder.put(i->numPoints);
+        encoder.put(static_cast<boost::uint32_t>(i->bounds.size()));
+        for (std::size_t d = 0; d < i->bounds.size(); ++d)
+        {
+            encoder.put(i->bounds.getMinimum(d));
+            encoder.put(i->bounds.getMaximum(d));
+        }
+        for (std::vector<ColumnInfo>::const_iterator c = i->columns.begin(); c != i->columns.end(); ++c)
+        {
+            encoder.put(c->offset);
+            encoder.put(c->size);
+            encoder.put(static_cast<boost::uint32_t>(c->codec));
+        }
+    }
+
+    return;
+}
+
+
+const char* Footer::decode(const char* first, const char* last)
+{
+    Decoder decoder(first, last);
+
+    dimensions.clear();
+    const boost::uint32_t numDimensions = decoder.get<boost::uint32_t>();
+    for (boost::uint32_t i = 0; i < numDimensions; ++i)
+    {
+        const std::string name = decoder.getString();
+        const std::string ns = decoder.getString();
+        const std::string description = decoder.getString();
+        const boost::uint32_t interpretation = decoder.get<boost::uint32_t>();
+        const boost::uint32_t byteSize = decoder.get<boost::uint32_t>();
+
+        Dimension dim(name, static_cast<dimension::Interpretation>(interpretation),
+                      static_cast<dimension::size_type>(byteSize), description);
+        dim.setNamespace(ns);
+        dim.setNumericScale(decoder.get<double>());
+        dim.setNumericOffset(decoder.get<double>());
+        dim.setMinimum(decoder.get<double>());
+        dim.setMaximum(decoder.get<double>());
+        dim.setEndianness(static_cast<EndianType>(decoder.get<boost::uint32_t>()));
+        dim.setFlags(decoder.get<boost::uint32_t>());
+        dim.setUUID(decoder.getId());
+        dim.setParent(decoder.getId());
+
+        dimensions.push_back(dim);
+    }
+
+    xmlSchema = decoder.getString();
+    spatialReference = decoder.getString();
+
+    chunks.clear();
+    const boost::uint64_t numChunks = decoder.get<boost::uint64_t>();
+    for (boost::uint64_t i = 0; i < numChunks; ++i)
+    {
+        ChunkInfo chunk;
+        chunk.offset = decoder.get<boost::uint64_t>();
+        chunk.numPoints = decoder.get<boost::uint32_t>();
+
+        const boost::uint32_t numBounds = decoder.get<boost::uint32_t>();
+        if (numBounds > 3)
+            throw columnar_error("columnar file footer is corrupt");
+        Bounds<double>::RangeVector ranges(numBounds);
+        for (boost::uint32_t d = 0; d < numBounds; ++d)
+        {
+            ranges[d].setMinimum(decoder.get<double>());
+            ranges[d].setMaximum(decoder.get<double>());
+        }
+        chunk.bounds = Bounds<double>(ranges);
+
+        for (boost::uint32_t d = 0; d < numDimensions; ++d)
+        {
+            ColumnInfo column;
+            column.offset = decoder.get<boost::uint64_t>();
+            column.size = decoder.get<boost::uint64_t>();
+            const boost::uint32_t type = decoder.get<boost::uint32_t>();
+            if (type >= codec::Auto)
+                throw columnar_error("columnar file column has an unknown codec");
+            column.codec = static_cast<codec::Type>(type);
+            chunk.columns.push_back(column);
+        }
+
+        chunks.push_back(chunk);
+    }
+
+    return decoder.getPosition();
+}
+
+
+}
+}
+} // namespaces
@@ -0,0 +1,320 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/columnar/Writer.hpp>
+#include <pdal/drivers/columnar/Codec.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/PointBuffer.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace columnar
+{
+
+namespace
+{
+
+template <typename T>
+inline double readValue(const char* p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return static_cast<double>(v);
+}
+
+
+// The unscaled value of one entry of a column.
+double readValue(Dimension const& dim, const char* p)
+{
+    const dimension::size_type size = dim.getByteSize();
+    switch (dim.getInterpretation())
+    {
+        case dimension::SignedByte:
+        case dimension::SignedInteger:
+            if (size == 1) return readValue<boost::int8_t>(p);
+            if (size == 2) return readValue<boost::int16_t>(p);
+            if (size == 4) return readValue<boost::int32_t>(p);
+            if (size == 8) return readValue<boost::int64_t>(p);
+            break;
+        case dimension::UnsignedByte:
+        case dimension::UnsignedInteger:
+            if (size == 1) return readValue<boost::uint8_t>(p);
+            if (size == 2) return readValue<boost::uint16_t>(p);
+            if (size == 4) return readValue<boost::uint32_t>(p);
+            if (size == 8) return readValue<boost::uint64_t>(p);
+            break;
+        case dimension::Float:
+            if (size == 4) return readValue<float>(p);
+            if (size == 8) return readValue<double>(p);
+            break;
+        default:
+            break;
+    }
+    throw columnar_error("dimension '" + dim.getName() + "' has no numeric value for the chunk bounds");
+}
+
+} // anonymous namespace
+
+
+Writer::Writer(Stage& prevStage, const Options& options)
+    : pdal::Writer(prevStage, options)
+    , m_stream(0)
+    , m_position(0)
+    , m_compression(codec::None)
+{
+    return;
+}
+
+
+Writer::~Writer()
+{
+    if (m_stream)
+        FileUtils::closeFile(m_stream);
+    return;
+}
+
+
+void Writer::initialize()
+{
+    pdal::Writer::initialize();
+
+    m_filename = getOptions().getValueOrThrow<std::string>("filename");
+
+    m_compression = getCodec(getOptions().getValueOrDefault<std::string>("compression", "none"));
+    if (!isCodecAvailable(m_compression))
+        throw columnar_error("codec '" + getCodecName(m_compression) + "' needs PDAL built with zlib");
+
+    m_codecs.clear();
+    const std::string codecs = getOptions().getValueOrDefault<std::string>("codecs", "");
+    std::vector<std::string> entries;
+    boost::split(entries, codecs, boost::is_any_of(","));
+    for (std::vector<std::string>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+    {
+        const std::string entry = boost::trim_copy(*i);
+        if (entry.empty())
+            continue;
+
+        const std::string::size_type colon = entry.find(':');
+        if (colon == std::string::npos)
+            throw columnar_error("codecs entry '" + entry + "' is not of the form Name:codec");
+
+        const codec::Type type = getCodec(boost::trim_copy(entry.substr(colon + 1)));
+        if (!isCodecAvailable(type))
+            throw columnar_error("codec '" + getCodecName(type) + "' needs PDAL built with zlib");
+        m_codecs[boost::trim_copy(entry.substr(0, colon))] = type;
+    }
+
+    return;
+}
+
+
+const Options Writer::getDefaultOptions() const
+{
+    Options options;
+
+    Option filename("filename", "", "Filename to write the columnar file to");
+    Option compression("compression", "none", "Codec for every dimension: none, auto, delta, rle, deflate or shuffle");
+    Option codecs("codecs", "", "Codecs for single dimensions, as Name:codec,Name:codec");
+
+    options.add(filename);
+    options.add(compression);
+    options.add(codecs);
+
+    return options;
+}
+
+
+void Writer::writeBegin(boost::uint64_t /*targetNumPointsToWrite*/)
+{
+    if (m_stream)
+        FileUtils::closeFile(m_stream);
+    m_stream = FileUtils::createFile(m_filename, true);
+
+    Footer::writeHeader(*m_stream);
+    m_position = Footer::s_headerSize;
+
+    m_footer = Footer();
+    m_columnCodecs.clear();
+    m_footer.spatialReference = getPrevStage().getSpatialReference().getWKT(SpatialReference::eCompoundOK);
+
+    return;
+}
+
+
+boost::uint32_t Writer::writeBuffer(const PointBuffer& data)
+{
+    const Schema& schema = data.getSchema();
+
+    if (m_footer.dimensions.empty())
+    {
+        schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
+        for (schema::index_by_index::const_iterator i = dims.begin(); i != dims.end(); ++i)
+        {
+            if (!i->isIgnored())
+                m_footer.dimensions.push_back(*i);
+        }
+        m_footer.xmlSchema = Schema::to_xml(schema);
+
+        for (std::map<std::string, codec::Type>::const_iterator i = m_codecs.begin(); i != m_codecs.end(); ++i)
+        {
+            std::vector<Dimension>::const_iterator dim = m_footer.dimensions.begin();
+            while (dim != m_footer.dimensions.end() && dim->getName() != i->first)
+                ++dim;
+            if (dim == m_footer.dimensions.end())
+                throw columnar_error("codecs names dimension '" + i->first + "', which is not being written");
+        }
+
+        for (std::vector<Dimension>::const_iterator i = m_footer.dimensions.begin(); i != m_footer.dimensions.end(); ++i)
+        {
+            std::map<std::string, codec::Type>::const_iterator found = m_codecs.find(i->getName());
+            codec::Type type = (found == m_codecs.end()) ? m_compression : found->second;
+            if (type == codec::Auto)
+                type = chooseCodec(*i);
+            m_columnCodecs.push_back(type);
+        }
+    }
+
+    const boost::uint32_t numPoints = data.getNumPoints();
+    if (numPoints == 0)
+        return 0;
+
+    ChunkInfo chunk;
+    chunk.offset = m_position;
+    chunk.numPoints = numPoints;
+
+    Bounds<double>::RangeVector ranges(3);
+    bool haveAxis[3] = { false, false, false };
+
+    static const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    for (std::size_t c = 0; c < m_footer.dimensions.size(); ++c)
+    {
+        Dimension const& stored = m_footer.dimensions[c];
+
+        // Look the dimension up again, every buffer may lay it out differently.
+        Dimension const& dim = schema.getDimension(stored.getName(), stored.getNamespace());
+        if (dim.getByteSize() != stored.getByteSize() || dim.getInterpretation() != stored.getInterpretation())
+            throw columnar_error("dimension '" + dim.getName() + "' changed type between buffers");
+
+        const std::size_t size = dim.getByteSize();
+        const std::size_t offset = dim.getByteOffset();
+
+        m_column.resize(size * numPoints);
+        char* column = &m_column[0];
+        for (boost::uint32_t p = 0; p < numPoints; ++p)
+            std::memcpy(column + p * size, data.getData(p) + offset, size);
+
+        const std::string& name = dim.getName();
+        const std::size_t axis = (name == "X") ? 0 : (name == "Y") ? 1 : (name == "Z") ? 2 : 3;
+        if (axis < 3 && !haveAxis[axis])
+        {
+            const double first = dim.applyScaling(readValue(dim, column));
+            Range<double> range(first, first);
+            for (boost::uint32_t p = 1; p < numPoints; ++p)
+                range.grow(dim.applyScaling(readValue(dim, column + p * size)));
+            ranges[axis] = range;
+            haveAxis[axis] = true;
+        }
+
+        ColumnInfo info;
+        info.offset = m_position - chunk.offset;
+        info.size = m_column.size();
+
+        const char* bytes = column;
+        if (m_columnCodecs[c] != codec::None)
+        {
+            encodeColumn(m_columnCodecs[c], column, numPoints, size, m_encoded);
+            if (m_encoded.size() < m_column.size())
+            {
+                info.size = m_encoded.size();
+                info.codec = m_columnCodecs[c];
+                bytes = &m_encoded[0];
+            }
+        }
+        chunk.columns.push_back(info);
+
+        const boost::uint64_t paddedSize = Footer::getPaddedSize(info.size);
+        m_stream->write(bytes, static_cast<std::streamsize>(info.size));
+        m_stream->write(padding, static_cast<std::streamsize>(paddedSize - info.size));
+        m_position += paddedSize;
+    }
+
+    if (haveAxis[0] && haveAxis[1] && haveAxis[2])
+        chunk.bounds = Bounds<double>(ranges);
+    m_footer.chunks.push_back(chunk);
+
+    if (!*m_stream)
+        throw columnar_error("unable to write to '" + m_filename + "'");
+
+    return numPoints;
+}
+
+
+void Writer::writeEnd(boost::uint64_t /*actualNumPointsWritten*/)
+{
+    m_footer.write(*m_stream, m_position);
+
+    const bool good = !!*m_stream;
+    FileUtils::closeFile(m_stream);
+    m_stream = 0;
+
+    if (!good)
+        throw columnar_error("unable to write to '" + m_filename + "'");
+
+    return;
+}
+
+
+boost::property_tree::ptree Writer::toPTree() const
+{
+    boost::property_tree::ptree tree = pdal::Writer::toPTree();
+
+    // add stuff here specific to this stage type
+
+    return tree;
+}
+
+
+}
+}
+} // namespaces
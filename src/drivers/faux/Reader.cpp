@@ -152,7 +152,7 @@ pdal::StageRandomIterator* Reader::createRandomIterator(PointBuffer& buffer) con
 }
 
 
-boost::uint32_t Reader::processBuffer(PointBuffer& data, boost::uint64_t index) const
+boost::uint32_t Reader::processBuffer(PointBuffer& data, boost::uint64_t index, boost::uint32_t step) const
 {
     const Schema& schema = data.getSchema();
 
@@ -162,7 +162,7 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data, boost::uint64_t index)
     boost::uint64_t numPointsWanted = data.getCapacity();
 
     // we can only give them as many as we have left
-    boost::uint64_t numPointsAvailable = getNumPoints() - index;
+    boost::uint64_t numPointsAvailable = (getNumPoints() - index + step - 1) / step;
     if (numPointsAvailable < numPointsWanted)
         numPointsWanted = numPointsAvailable;
 
@@ -210,9 +210,9 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data, boost::uint64_t index)
                 z = minZ;
                 break;
             case Reader::Ramp:
-                x = minX + delX * pointIndex;
-                y = minY + delY * pointIndex;
-                z = minZ + delZ * pointIndex;
+                x = minX + delX * pointIndex * step;
+                y = minY + delY * pointIndex * step;
+                z = minZ + delZ * pointIndex * step;
                 break;
             default:
                 throw pdal_error("invalid mode in FauxReader");
@@ -224,7 +224,7 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data, boost::uint64_t index)
         data.setField<double>(dimZ, pointIndex, z);
         data.setField<boost::uint64_t>(dimTime, pointIndex, time);
 
-        ++time;
+        time += step;
 
         ++cnt;
         data.setNumPoints(cnt);
@@ -307,6 +307,15 @@ boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
     return m_reader.processBuffer(data, getIndex());
 }
 
+
+boost::uint32_t Reader::readStridedImpl(PointBuffer& data, boost::uint32_t step)
+{
+    if (getIndex() >= getStage().getNumPoints())
+        return 0;
+
+    return m_reader.processBuffer(data, getIndex(), step);
+}
+
 }
 } // iterators::random
 
@@ -47,6 +47,7 @@
 #include "LasHeaderReader.hpp"
 #include <pdal/PointBuffer.hpp>
 #include <pdal/Metadata.hpp>
+#include <pdal/Tracer.hpp>
 #include "ZipPoint.hpp"
 
 #ifdef PDAL_HAVE_GDAL
@@ -71,7 +72,7 @@ namespace las
 
 Reader::Reader(const Options& options)
     : ReaderBase(options)
-    , m_streamFactory(new FilenameStreamFactory(options.getValueOrThrow<std::string>("filename")))
+    , m_streamFactory(new PositionalStreamFactory(options.getValueOrThrow<std::string>("filename")))
     , m_ownsStreamFactory(true)
 {
     addDefaultDimensions();
@@ -81,7 +82,7 @@ Reader::Reader(const Options& options)
 
 Reader::Reader(const std::string& filename)
     : ReaderBase(Options::none())
-    , m_streamFactory(new FilenameStreamFactory(filename))
+    , m_streamFactory(new PositionalStreamFactory(filename))
     , m_ownsStreamFactory(true)
 {
     addDefaultDimensions();
@@ -206,10 +207,12 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data,
                                       boost::uint64_t numPointsLeft,
                                       LASunzipper* unzipper,
                                       ZipPoint* zipPoint,
-                                      PointDimensions* dimensions) const
+                                      PointDimensions* dimensions,
+                                      boost::uint32_t step) const
 {
     // we must not read more points than are left in the file
-    const boost::uint64_t numPoints64 = std::min<boost::uint64_t>(data.getCapacity(), numPointsLeft);
+    const boost::uint64_t numPointsWanted = (step > 1) ? (numPointsLeft + step - 1) / step : numPointsLeft;
+    const boost::uint64_t numPoints64 = std::min<boost::uint64_t>(data.getCapacity(), numPointsWanted);
     const boost::uint32_t numPoints = (boost::uint32_t)std::min<boost::uint64_t>(numPoints64, std::numeric_limits<boost::uint32_t>::max());
 
     const LasHeader& lasHeader = getLasHeader();
@@ -228,9 +231,14 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data,
     }
     if (zipPoint)
     {
+        if (step > 1)
+        {
+            throw pdal_error("Strided reads of compressed point data must seek per point");
+        }
 #ifdef PDAL_HAVE_LASZIP
         boost::uint8_t* p = buf;
 
+        Tracer::Scope trace("io.read", this, &data);
         bool ok = false;
         for (boost::uint32_t i=0; i<numPoints; i++)
         {
@@ -254,94 +262,120 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data,
     }
     else
     {
-        Utils::read_n(buf, stream, pointByteCount * numPoints);
+        Tracer::Scope trace("io.read", this, &data);
+        Utils::read_n_strided(buf, stream, pointByteCount, numPoints, step);
     }
 
+    // Only the dimensions that are present (and not ignored) in the
+    // destination buffer's schema are decoded. Everything else is stepped
+    // over using the fixed field offsets of the LAS point record, so a
+    // downstream filters.selector that only keeps X/Y/Z does not pay for
+    // unpacking the remaining fields.
+    const bool wantFlags = dimensions->ReturnNumber || dimensions->NumberOfReturns ||
+                           dimensions->ScanDirectionFlag || dimensions->EdgeOfFlightLine;
+    const bool wantTime = hasTime && dimensions->Time;
+    const bool wantColor = hasColor && (dimensions->Red || dimensions->Green || dimensions->Blue);
+
+    const std::size_t timeOffset = 20;
+    const std::size_t colorOffset = hasTime ? 28 : 20;
+
     for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
     {
         boost::uint8_t* p = buf + pointByteCount * pointIndex;
+        boost::uint8_t* q = 0;
+
+        if (dimensions->X)
+        {
+            q = p;
+            data.setField<boost::int32_t>(*dimensions->X, pointIndex, Utils::read_field<boost::int32_t>(q));
+        }
+
+        if (dimensions->Y)
+        {
+            q = p + 4;
+            data.setField<boost::int32_t>(*dimensions->Y, pointIndex, Utils::read_field<boost::int32_t>(q));
+        }
+
+        if (dimensions->Z)
+        {
+            q = p + 8;
+            data.setField<boost::int32_t>(*dimensions->Z, pointIndex, Utils::read_field<boost::int32_t>(q));
+        }
 
-        // always read the base fields
+        if (dimensions->Intensity)
         {
-            const boost::int32_t x = Utils::read_field<boost::int32_t>(p);
-            const boost::int32_t y = Utils::read_field<boost::int32_t>(p);
-            const boost::int32_t z = Utils::read_field<boost::int32_t>(p);
-            const boost::uint16_t intensity = Utils::read_field<boost::uint16_t>(p);
-            const boost::uint8_t flags = Utils::read_field<boost::uint8_t>(p);
-            const boost::uint8_t classification = Utils::read_field<boost::uint8_t>(p);
-            const boost::int8_t scanAngleRank = Utils::read_field<boost::int8_t>(p);
-            const boost::uint8_t user = Utils::read_field<boost::uint8_t>(p);
-            const boost::uint16_t pointSourceId = Utils::read_field<boost::uint16_t>(p);
-
-            const boost::uint8_t returnNum = flags & 0x07;
-            const boost::uint8_t numReturns = (flags >> 3) & 0x07;
-            const boost::uint8_t scanDirFlag = (flags >> 6) & 0x01;
-            const boost::uint8_t flight = (flags >> 7) & 0x01;
-            
-            if (dimensions->X)
-                data.setField<boost::uint32_t>(*dimensions->X, pointIndex, x);
-
-            if (dimensions->Y)
-                data.setField<boost::uint32_t>(*dimensions->Y, pointIndex, y);
-
-            if (dimensions->Z)
-                data.setField<boost::uint32_t>(*dimensions->Z, pointIndex, z);
-
-            if (dimensions->Intensity)
-                data.setField<boost::uint16_t>(*dimensions->Intensity, pointIndex, intensity);
-            
+            q = p + 12;
+            data.setField<boost::uint16_t>(*dimensions->Intensity, pointIndex, Utils::read_field<boost::uint16_t>(q));
+        }
+
+        if (wantFlags)
+        {
+            q = p + 14;
+            const boost::uint8_t flags = Utils::read_field<boost::uint8_t>(q);
+
             if (dimensions->ReturnNumber)
-                data.setField<boost::uint8_t>(*dimensions->ReturnNumber, pointIndex, returnNum);
-            
+                data.setField<boost::uint8_t>(*dimensions->ReturnNumber, pointIndex, flags & 0x07);
+
             if (dimensions->NumberOfReturns)
-                data.setField<boost::uint8_t>(*dimensions->NumberOfReturns, pointIndex, numReturns);
-            
+                data.setField<boost::uint8_t>(*dimensions->NumberOfReturns, pointIndex, (flags >> 3) & 0x07);
+
             if (dimensions->ScanDirectionFlag)
-                data.setField<boost::uint8_t>(*dimensions->ScanDirectionFlag, pointIndex, scanDirFlag);
-            
+                data.setField<boost::uint8_t>(*dimensions->ScanDirectionFlag, pointIndex, (flags >> 6) & 0x01);
+
             if (dimensions->EdgeOfFlightLine)
-                data.setField<boost::uint8_t>(*dimensions->EdgeOfFlightLine, pointIndex, flight);
-            
-            if (dimensions->Classification)
-                data.setField<boost::uint8_t>(*dimensions->Classification, pointIndex, classification);
-            
-            if (dimensions->ScanAngleRank)
-                data.setField<boost::int8_t>(*dimensions->ScanAngleRank, pointIndex, scanAngleRank);
-            
-            if (dimensions->UserData)
-                data.setField<boost::uint8_t>(*dimensions->UserData, pointIndex, user);
-            
-            if (dimensions->PointSourceId)
-                data.setField<boost::uint16_t>(*dimensions->PointSourceId, pointIndex, pointSourceId);
+                data.setField<boost::uint8_t>(*dimensions->EdgeOfFlightLine, pointIndex, (flags >> 7) & 0x01);
+        }
+
+        if (dimensions->Classification)
+        {
+            q = p + 15;
+            data.setField<boost::uint8_t>(*dimensions->Classification, pointIndex, Utils::read_field<boost::uint8_t>(q));
+        }
+
+        if (dimensions->ScanAngleRank)
+        {
+            q = p + 16;
+            data.setField<boost::int8_t>(*dimensions->ScanAngleRank, pointIndex, Utils::read_field<boost::int8_t>(q));
         }
 
-        if (hasTime)
+        if (dimensions->UserData)
         {
-            const double time = Utils::read_field<double>(p);
-            
-            if (dimensions->Time)
-                data.setField<double>(*dimensions->Time, pointIndex, time);
+            q = p + 17;
+            data.setField<boost::uint8_t>(*dimensions->UserData, pointIndex, Utils::read_field<boost::uint8_t>(q));
         }
 
-        if (hasColor)
+        if (dimensions->PointSourceId)
         {
-            const boost::uint16_t red = Utils::read_field<boost::uint16_t>(p);
-            const boost::uint16_t green = Utils::read_field<boost::uint16_t>(p);
-            const boost::uint16_t blue = Utils::read_field<boost::uint16_t>(p);
-            
+            q = p + 18;
+            data.setField<boost::uint16_t>(*dimensions->PointSourceId, pointIndex, Utils::read_field<boost::uint16_t>(q));
+        }
+
+        if (wantTime)
+        {
+            q = p + timeOffset;
+            data.setField<double>(*dimensions->Time, pointIndex, Utils::read_field<double>(q));
+        }
+
+        if (wantColor)
+        {
+            q = p + colorOffset;
+            const boost::uint16_t red = Utils::read_field<boost::uint16_t>(q);
+            const boost::uint16_t green = Utils::read_field<boost::uint16_t>(q);
+            const boost::uint16_t blue = Utils::read_field<boost::uint16_t>(q);
+
             if (dimensions->Red)
                 data.setField<boost::uint16_t>(*dimensions->Red, pointIndex, red);
-            
+
             if (dimensions->Green)
                 data.setField<boost::uint16_t>(*dimensions->Green, pointIndex, green);
-            
+
             if (dimensions->Blue)
                 data.setField<boost::uint16_t>(*dimensions->Blue, pointIndex, blue);
         }
-
-        data.setNumPoints(pointIndex+1);
     }
 
+    data.setNumPoints(numPoints);
+
     delete[] buf;
 
     data.setSpatialBounds(lasHeader.getBounds());
@@ -833,6 +867,31 @@ boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
 }
 
 
+boost::uint32_t Reader::readStridedImpl(PointBuffer& data, boost::uint32_t step)
+{
+    const boost::uint64_t numPoints = getStage().getNumPoints();
+    if (getIndex() >= numPoints)
+        return 0;
+
+#ifdef PDAL_HAVE_LASZIP
+    // LASzip can only get to a point by seeking its own decoder, so the
+    // generic seek-and-read-one version is as good as it gets
+    if (m_unzipper)
+        return naiveReadStridedImpl(data, step);
+#endif
+
+    seekImpl(getIndex());
+
+    return m_reader.processBuffer(data,
+                                  m_istream,
+                                  numPoints - getIndex(),
+                                  NULL,
+                                  NULL,
+                                  m_pointDimensions,
+                                  step);
+}
+
+
 } // random
 } // iterators
 }
@@ -161,9 +161,34 @@ boost::uint16_t Support::getPointDataSize(PointFormat pointFormat)
 PointDimensions::PointDimensions(const Schema& schema, std::string const& ns)
 {
 
-    X = &schema.getDimension("X", ns);
-    Y = &schema.getDimension("Y", ns);
-    Z = &schema.getDimension("Z", ns);
+    // X, Y and Z may have been ignored (or packed away) by a downstream
+    // stage like filters.selector, so they are optional like everything else
+    try
+    {
+        X = &schema.getDimension("X", ns);
+    }
+    catch (pdal::dimension_not_found&)
+    {
+        X = 0;
+    }
+
+    try
+    {
+        Y = &schema.getDimension("Y", ns);
+    }
+    catch (pdal::dimension_not_found&)
+    {
+        Y = 0;
+    }
+
+    try
+    {
+        Z = &schema.getDimension("Z", ns);
+    }
+    catch (pdal::dimension_not_found&)
+    {
+        Z = 0;
+    }
 
     try
     {
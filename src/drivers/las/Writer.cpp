@@ -292,6 +292,11 @@ boost::uint32_t Writer::writeBuffer(const PointBuffer& pointBuffer)
 
     const PointDimensions dimensions(schema,"");
 
+    if (!dimensions.X || !dimensions.Y || !dimensions.Z)
+    {
+        throw dimension_not_found("X, Y and Z dimensions are required to write LAS data");
+    }
+
     boost::uint32_t numValidPoints = 0;
 
     boost::uint8_t buf[1024]; // BUG: fixed size
@@ -155,7 +155,7 @@ void Reader::initialize()
         nitf.close();
     }
 
-    m_streamFactory = new FilenameSubsetStreamFactory(m_filename, offset, length);
+    m_streamFactory = new PositionalStreamFactory(m_filename, offset, length);
 
     m_lasReader = new pdal::drivers::las::Reader(m_streamFactory);
     m_lasReader->initialize();
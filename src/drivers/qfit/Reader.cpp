@@ -171,6 +171,7 @@ Word #       Content
 #include <pdal/PointBuffer.hpp>
 #include <pdal/FileUtils.hpp>
 #include <pdal/Utils.hpp>
+#include <pdal/Tracer.hpp>
 
 
 #include <map>
@@ -485,10 +486,11 @@ Reader::~Reader()
     return;
 }
 
-boost::uint32_t Reader::processBuffer(PointBuffer& data, std::istream& stream, boost::uint64_t numPointsLeft) const
+boost::uint32_t Reader::processBuffer(PointBuffer& data, std::istream& stream, boost::uint64_t numPointsLeft, boost::uint32_t step) const
 {
     // we must not read more points than are left in the file
-    const boost::uint64_t numPoints64 = std::min<boost::uint64_t>(data.getCapacity(), numPointsLeft);
+    const boost::uint64_t numPointsWanted = (step > 1) ? (numPointsLeft + step - 1) / step : numPointsLeft;
+    const boost::uint64_t numPoints64 = std::min<boost::uint64_t>(data.getCapacity(), numPointsWanted);
     const boost::uint32_t numPoints = (boost::uint32_t)std::min<boost::uint64_t>(numPoints64, std::numeric_limits<boost::uint32_t>::max());
 
     const Schema& schema = data.getSchema();
@@ -518,7 +520,10 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data, std::istream& stream, b
         throw pdal_error("QFIT Reader::processBuffer stream is eof!");
     }
 
-    Utils::read_n(buf, stream, pointByteCount * numPoints);
+    {
+        Tracer::Scope trace("io.read", this, &data);
+        Utils::read_n_strided(buf, stream, pointByteCount, numPoints, step);
+    }
 
     for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
     {
@@ -888,6 +893,20 @@ boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
 }
 
 
+boost::uint32_t Reader::readStridedImpl(PointBuffer& data, boost::uint32_t step)
+{
+    boost::uint64_t numpoints = getStage().getNumPoints();
+    boost::uint64_t index = this->getIndex();
+
+    if (index >= numpoints)
+        return 0;
+
+    seekImpl(index);
+
+    return m_reader.processBuffer(data, *m_istream, numpoints-index, step);
+}
+
+
 } // random
 } // iterators
 
@@ -0,0 +1,315 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/stream/Reader.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/PointBuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace stream
+{
+
+
+Reader::Reader(const Options& options)
+    : pdal::Reader(options)
+    , m_stream(0)
+{
+    return;
+}
+
+
+Reader::~Reader()
+{
+    if (m_stream)
+        closeFrames(m_stream);
+    return;
+}
+
+
+std::string Reader::getFileName() const
+{
+    return getOptions().getValueOrThrow<std::string>("filename");
+}
+
+
+const Options Reader::getDefaultOptions() const
+{
+    Options options;
+
+    Option filename("filename", "", "File to read the point stream from, or - for standard input");
+
+    options.add(filename);
+
+    return options;
+}
+
+
+void Reader::initialize()
+{
+    pdal::Reader::initialize();
+
+    const std::string filename = getFileName();
+    if (m_stream)
+        closeFrames(m_stream);
+    m_stream = 0;
+
+    if (filename == "-")
+    {
+        setBinaryMode(stdin);
+        m_stream = &std::cin;
+    }
+    else
+    {
+        if (!FileUtils::fileExists(filename))
+            throw stream_error("unable to open point stream '" + filename + "'");
+        m_stream = FileUtils::openFile(filename);
+    }
+    m_header.read(*m_stream);
+
+    getSchemaRef() = Schema(m_header.schema.dimensions);
+
+    setPointCountType(m_header.pointCountType);
+    setNumPoints(m_header.numPoints);
+    if (m_header.bounds.size())
+        setBounds(m_header.bounds);
+
+    if (!m_header.schema.spatialReference.empty())
+    {
+        SpatialReference srs;
+        srs.setWKT(m_header.schema.spatialReference);
+        setSpatialReference(srs);
+    }
+
+    return;
+}
+
+
+std::istream* Reader::openFrames() const
+{
+    if (m_stream)
+    {
+        std::istream* stream = m_stream;
+        m_stream = 0;
+        return stream;
+    }
+
+    const std::string filename = getFileName();
+    if (filename == "-")
+        throw stream_error("standard input can only be read once");
+
+    std::istream* stream = FileUtils::openFile(filename);
+    try
+    {
+        Header header;
+        header.read(*stream);
+    }
+    catch (...)
+    {
+        FileUtils::closeFile(stream);
+        throw;
+    }
+    return stream;
+}
+
+
+void Reader::closeFrames(std::istream* stream) const
+{
+    if (stream != &std::cin)
+        FileUtils::closeFile(stream);
+    return;
+}
+
+
+boost::property_tree::ptree Reader::toPTree() const
+{
+    boost::property_tree::ptree tree = pdal::Reader::toPTree();
+
+    // add stuff here specific to this stage type
+
+    return tree;
+}
+
+
+pdal::StageSequentialIterator* Reader::createSequentialIterator(PointBuffer& buffer) const
+{
+    return new pdal::drivers::stream::iterators::sequential::Reader(*this, buffer);
+}
+
+
+namespace iterators
+{
+
+namespace sequential
+{
+
+
+Reader::Reader(const pdal::drivers::stream::Reader& reader, PointBuffer& buffer)
+    : pdal::ReaderSequentialIterator(reader, buffer)
+    , m_reader(reader)
+    , m_stream(reader.openFrames())
+    , m_pointSize(reader.getSchema().getByteSize())
+    , m_remaining(0)
+    , m_atEnd(false)
+{
+    return;
+}
+
+
+Reader::~Reader()
+{
+    m_reader.closeFrames(m_stream);
+    return;
+}
+
+
+boost::uint32_t Reader::readPoints(char* dest, boost::uint32_t count)
+{
+    boost::uint32_t numRead = 0;
+    while (numRead < count && !m_atEnd)
+    {
+        if (m_remaining == 0)
+        {
+            boost::uint32_t numPoints = 0;
+            m_stream->read(static_cast<char*>(static_cast<void*>(&numPoints)), sizeof(numPoints));
+            if (m_stream->gcount() != static_cast<std::streamsize>(sizeof(numPoints)))
+                throw stream_error("point stream ended before its last frame");
+            if (numPoints == 0)
+                m_atEnd = true;
+            m_remaining = numPoints;
+            continue;
+        }
+
+        const boost::uint32_t n = std::min(m_remaining, count - numRead);
+        const std::streamsize size = static_cast<std::streamsize>(n * m_pointSize);
+        m_stream->read(dest + numRead * m_pointSize, size);
+        if (m_stream->gcount() != size)
+            throw stream_error("point stream ended in the middle of a frame");
+
+        numRead += n;
+        m_remaining -= n;
+    }
+
+    return numRead;
+}
+
+
+boost::uint64_t Reader::skipImpl(boost::uint64_t count)
+{
+    m_scratch.resize(std::max<std::size_t>(m_pointSize, 1 << 16));
+    const boost::uint32_t pointsPerRead = static_cast<boost::uint32_t>(m_scratch.size() / std::max<std::size_t>(m_pointSize, 1));
+
+    boost::uint64_t numSkipped = 0;
+    while (numSkipped < count && !m_atEnd)
+    {
+        const boost::uint32_t n = static_cast<boost::uint32_t>(std::min<boost::uint64_t>(count - numSkipped, pointsPerRead));
+        numSkipped += readPoints(&m_scratch[0], n);
+    }
+
+    return numSkipped;
+}
+
+
+bool Reader::atEndImpl() const
+{
+    return m_atEnd;
+}
+
+
+boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
+{
+    const Schema& schema = data.getSchema();
+    const Schema& stored = m_reader.getSchema();
+    const std::size_t stride = schema.getByteSize();
+    const boost::uint32_t capacity = data.getCapacity();
+
+    // the bytes of each of the buffer's dimensions within a streamed point
+    std::vector<std::pair<std::size_t, std::size_t> > offsets;
+    std::vector<std::size_t> sizes;
+    bool sameLayout = (stride == m_pointSize);
+
+    schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
+    for (schema::index_by_index::const_iterator i = dims.begin(); i != dims.end(); ++i)
+    {
+        boost::optional<Dimension const&> dim = stored.getDimensionOptional(i->getName(), i->getNamespace());
+        if (!dim)
+            dim = stored.getDimensionOptional(i->getName());
+        if (!dim || dim->getByteSize() != i->getByteSize() || dim->getInterpretation() != i->getInterpretation())
+        {
+            sameLayout = false;
+            continue;
+        }
+
+        offsets.push_back(std::make_pair(dim->getByteOffset(), i->getByteOffset()));
+        sizes.push_back(i->getByteSize());
+        if (dim->getByteOffset() != i->getByteOffset())
+            sameLayout = false;
+    }
+
+    boost::uint32_t numRead = 0;
+    if (sameLayout)
+    {
+        numRead = readPoints(static_cast<char*>(static_cast<void*>(data.getData(0))), capacity);
+    }
+    else
+    {
+        m_scratch.resize(capacity * m_pointSize);
+        numRead = readPoints(m_scratch.empty() ? 0 : &m_scratch[0], capacity);
+
+        for (std::size_t d = 0; d < offsets.size(); ++d)
+        {
+            const char* src = m_scratch.empty() ? 0 : &m_scratch[0] + offsets[d].first;
+            for (boost::uint32_t p = 0; p < numRead; ++p, src += m_pointSize)
+                std::memcpy(data.getData(p) + offsets[d].second, src, sizes[d]);
+        }
+    }
+
+    data.setNumPoints(numRead);
+
+    return numRead;
+}
+
+} // sequential
+} // iterators
+
+}
+}
+} // namespaces
@@ -0,0 +1,196 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/stream/Support.hpp>
+
+#include <boost/concept_check.hpp> // ignore_unused_variable_warning
+
+#ifdef PDAL_PLATFORM_WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace stream
+{
+
+namespace
+{
+
+template <typename T>
+void put(std::ostream& stream, T const& v)
+{
+    stream.write(static_cast<const char*>(static_cast<const void*>(&v)), sizeof(T));
+    return;
+}
+
+
+void take(std::istream& stream, char* p, std::size_t size)
+{
+    stream.read(p, static_cast<std::streamsize>(size));
+    if (static_cast<std::size_t>(stream.gcount()) != size)
+        throw stream_error("point stream header is truncated");
+    return;
+}
+
+
+template <typename T>
+T take(std::istream& stream)
+{
+    T v;
+    take(stream, static_cast<char*>(static_cast<void*>(&v)), sizeof(T));
+    return v;
+}
+
+} // anonymous namespace
+
+
+const char Header::s_magic[8] = { 'P', 'D', 'A', 'L', 'S', 'T', 'R', 'M' };
+const boost::uint32_t Header::s_version = 1;
+const boost::uint32_t Header::s_byteOrderMark = 0x01020304;
+
+
+void Header::write(std::ostream& stream) const
+{
+    std::vector<char> bytes;
+    schema.encode(bytes);
+
+    stream.write(s_magic, sizeof(s_magic));
+    put(stream, s_version);
+    put(stream, s_byteOrderMark);
+    put(stream, numPoints);
+    put(stream, static_cast<boost::uint32_t>(pointCountType));
+
+    put(stream, static_cast<boost::uint32_t>(bounds.size()));
+    for (std::size_t d = 0; d < bounds.size(); ++d)
+    {
+        put(stream, bounds.getMinimum(d));
+        put(stream, bounds.getMaximum(d));
+    }
+
+    put(stream, static_cast<boost::uint64_t>(bytes.size()));
+    if (!bytes.empty())
+        stream.write(&bytes[0], static_cast<std::streamsize>(bytes.size()));
+
+    return;
+}
+
+
+void Header::read(std::istream& stream)
+{
+    char magic[sizeof(s_magic)];
+    stream.read(magic, sizeof(magic));
+    if (stream.gcount() != static_cast<std::streamsize>(sizeof(magic)) ||
+            std::memcmp(magic, s_magic, sizeof(s_magic)) != 0)
+        throw stream_error("not a point stream");
+
+    const boost::uint32_t version = take<boost::uint32_t>(stream);
+    if (version != s_version)
+    {
+        std::ostringstream oss;
+        oss << "point stream version " << version << " is not supported";
+        throw stream_error(oss.str());
+    }
+    if (take<boost::uint32_t>(stream) != s_byteOrderMark)
+        throw stream_error("point stream was written on a machine of the other byte order");
+
+    numPoints = take<boost::uint64_t>(stream);
+    const boost::uint32_t countType = take<boost::uint32_t>(stream);
+    if (countType != PointCount_Fixed && countType != PointCount_Unknown)
+        throw stream_error("point stream has an unknown point count type");
+    pointCountType = static_cast<PointCountType>(countType);
+
+    const boost::uint32_t numBounds = take<boost::uint32_t>(stream);
+    if (numBounds > 3)
+        throw stream_error("point stream header is corrupt");
+    Bounds<double>::RangeVector ranges(numBounds);
+    for (boost::uint32_t d = 0; d < numBounds; ++d)
+    {
+        ranges[d].setMinimum(take<double>(stream));
+        ranges[d].setMaximum(take<double>(stream));
+    }
+    bounds = Bounds<double>(ranges);
+
+    // Read the schema in pieces, so that a corrupt size can't ask for
+    // more memory than the stream holds.
+    const boost::uint64_t size = take<boost::uint64_t>(stream);
+    std::vector<char> bytes;
+    while (bytes.size() < size)
+    {
+        const std::size_t piece = static_cast<std::size_t>(std::min<boost::uint64_t>(size - bytes.size(), 1 << 16));
+        const std::size_t used = bytes.size();
+        bytes.resize(used + piece);
+        take(stream, &bytes[used], piece);
+    }
+
+    try
+    {
+        schema.decode(bytes.empty() ? 0 : &bytes[0], bytes.empty() ? 0 : &bytes[0] + bytes.size());
+    }
+    catch (columnar::columnar_error const&)
+    {
+        throw stream_error("point stream schema is corrupt");
+    }
+    if (!schema.chunks.empty())
+        throw stream_error("point stream schema is corrupt");
+
+    return;
+}
+
+
+void setBinaryMode(std::FILE* file)
+{
+#ifdef PDAL_PLATFORM_WIN32
+    _setmode(_fileno(file), _O_BINARY);
+#else
+    boost::ignore_unused_variable_warning(file);
+#endif
+
+    return;
+}
+
+
+}
+}
+} // namespaces
@@ -0,0 +1,190 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/stream/Writer.hpp>
+#include <pdal/PointBuffer.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace stream
+{
+
+
+Writer::Writer(Stage& prevStage, const Options& options)
+    : pdal::Writer(prevStage, options)
+    , m_ostream(0)
+    , m_pointSize(0)
+{
+    return;
+}
+
+
+Writer::Writer(Stage& prevStage, std::ostream* ostream)
+    : pdal::Writer(prevStage, Options::none())
+    , m_ostream(ostream)
+    , m_pointSize(0)
+{
+    return;
+}
+
+
+Writer::~Writer()
+{
+    return;
+}
+
+
+void Writer::initialize()
+{
+    pdal::Writer::initialize();
+
+    if (!m_ostream)
+        m_filename = getOptions().getValueOrThrow<std::string>("filename");
+
+    return;
+}
+
+
+const Options Writer::getDefaultOptions() const
+{
+    Options options;
+
+    Option filename("filename", "", "File to write the point stream to, or - for standard output");
+
+    options.add(filename);
+
+    return options;
+}
+
+
+void Writer::writeBegin(boost::uint64_t targetNumPointsToWrite)
+{
+    if (m_ostream)
+    {
+        m_streamManager.reset(new OutputStreamManager(m_ostream));
+    }
+    else if (m_filename == "-")
+    {
+        setBinaryMode(stdout);
+        m_streamManager.reset(new OutputStreamManager(&std::cout));
+    }
+    else
+    {
+        m_streamManager.reset(new OutputStreamManager(m_filename));
+    }
+    m_streamManager->open();
+
+    const Stage& prevStage = getPrevStage();
+    const Schema& schema = prevStage.getSchema();
+
+    Header header;
+    if (prevStage.getPointCountType() == PointCount_Fixed)
+    {
+        header.pointCountType = PointCount_Fixed;
+        header.numPoints = prevStage.getNumPoints();
+        if (targetNumPointsToWrite)
+            header.numPoints = std::min(header.numPoints, targetNumPointsToWrite);
+    }
+    header.bounds = prevStage.getBounds();
+
+    schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
+    header.schema.dimensions.assign(dims.begin(), dims.end());
+    header.schema.xmlSchema = Schema::to_xml(schema);
+    header.schema.spatialReference = prevStage.getSpatialReference().getWKT(SpatialReference::eCompoundOK);
+
+    header.write(m_streamManager->ostream());
+    m_pointSize = schema.getByteSize();
+
+    return;
+}
+
+
+boost::uint32_t Writer::writeBuffer(const PointBuffer& data)
+{
+    if (data.getSchema().getByteSize() != m_pointSize)
+        throw stream_error("the schema of the points changed while they were being written");
+
+    const boost::uint32_t numPoints = data.getNumPoints();
+    if (numPoints == 0)
+        return 0;
+
+    std::ostream& stream = m_streamManager->ostream();
+    stream.write(static_cast<const char*>(static_cast<const void*>(&numPoints)), sizeof(numPoints));
+    stream.write(static_cast<const char*>(static_cast<const void*>(data.getData(0))),
+                 static_cast<std::streamsize>(numPoints * m_pointSize));
+
+    if (!stream)
+        throw stream_error("unable to write the point stream");
+
+    return numPoints;
+}
+
+
+void Writer::writeEnd(boost::uint64_t /*actualNumPointsWritten*/)
+{
+    std::ostream& stream = m_streamManager->ostream();
+
+    const boost::uint32_t end = 0;
+    stream.write(static_cast<const char*>(static_cast<const void*>(&end)), sizeof(end));
+    stream.flush();
+
+    const bool good = !!stream;
+    m_streamManager->close();
+
+    if (!good)
+        throw stream_error("unable to write the point stream");
+
+    return;
+}
+
+
+boost::property_tree::ptree Writer::toPTree() const
+{
+    boost::property_tree::ptree tree = pdal::Writer::toPTree();
+
+    // add stuff here specific to this stage type
+
+    return tree;
+}
+
+
+}
+}
+} // namespaces
@@ -37,6 +37,7 @@
 #include <pdal/drivers/terrasolid/Reader.hpp>
 #include <pdal/PointBuffer.hpp>
 #include <pdal/FileUtils.hpp>
+#include <pdal/Tracer.hpp>
 
 #include <map>
 
@@ -289,10 +290,11 @@ Reader::~Reader()
     return;
 }
 
-boost::uint32_t Reader::processBuffer(PointBuffer& data, std::istream& stream, boost::uint64_t numPointsLeft) const
+boost::uint32_t Reader::processBuffer(PointBuffer& data, std::istream& stream, boost::uint64_t numPointsLeft, boost::uint32_t step) const
 {
     // we must not read more points than are left in the file
-    const boost::uint64_t numPoints64 = std::min<boost::uint64_t>(data.getCapacity(), numPointsLeft);
+    const boost::uint64_t numPointsWanted = (step > 1) ? (numPointsLeft + step - 1) / step : numPointsLeft;
+    const boost::uint64_t numPoints64 = std::min<boost::uint64_t>(data.getCapacity(), numPointsWanted);
     const boost::uint32_t numPoints = (boost::uint32_t)std::min<boost::uint64_t>(numPoints64, std::numeric_limits<boost::uint32_t>::max());
 
     const Schema& schema = data.getSchema();
@@ -302,7 +304,10 @@ boost::uint32_t Reader::processBuffer(PointBuffer& data, std::istream& stream, b
     const PointDimensions dimensions(schema, getName());
 
     boost::uint8_t* buf = new boost::uint8_t[pointByteCount * numPoints];
-    Utils::read_n(buf, stream, pointByteCount * numPoints);
+    {
+        Tracer::Scope trace("io.read", this, &data);
+        Utils::read_n_strided(buf, stream, pointByteCount, numPoints, step);
+    }
 
     for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
     {
@@ -605,7 +610,7 @@ Reader::~Reader()
 boost::uint64_t Reader::seekImpl(boost::uint64_t count)
 {
 
-    m_istream->seekg(m_reader.getPointDataSize() * count + m_reader.getPointDataOffset(), std::ios::cur);
+    m_istream->seekg(m_reader.getPointDataSize() * count + m_reader.getPointDataOffset(), std::ios::beg);
 
     return count;
 }
@@ -616,6 +621,17 @@ boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
     return m_reader.processBuffer(data, *m_istream, getStage().getNumPoints()-this->getIndex());
 }
 
+
+boost::uint32_t Reader::readStridedImpl(PointBuffer& data, boost::uint32_t step)
+{
+    if (getIndex() >= getStage().getNumPoints())
+        return 0;
+
+    seekImpl(getIndex());
+
+    return m_reader.processBuffer(data, *m_istream, getStage().getNumPoints()-this->getIndex(), step);
+}
+
 } // random
 } // iterators
 
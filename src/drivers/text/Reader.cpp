@@ -0,0 +1,1042 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/drivers/text/Reader.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/Utils.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
+
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+
+namespace pdal
+{
+namespace drivers
+{
+namespace text
+{
+
+namespace
+{
+
+// Don't start a thread for fewer lines than this.
+const std::size_t s_minLinesPerRun = 4096;
+
+struct Token
+{
+    const char* first;
+    const char* last;
+};
+
+struct Line
+{
+    std::size_t first;
+    std::size_t last;
+};
+
+enum StoreType
+{
+    Store_None,
+    Store_Int8,
+    Store_Int16,
+    Store_Int32,
+    Store_Int64,
+    Store_UInt8,
+    Store_UInt16,
+    Store_UInt32,
+    Store_UInt64,
+    Store_Float,
+    Store_Double
+};
+
+// Where and how a column is written into a point buffer's rows.
+struct Target
+{
+    Target()
+        : type(Store_None)
+        , byteOffset(0)
+        , scale(1.0)
+        , offset(0.0)
+    {}
+
+    StoreType type;
+    std::size_t byteOffset;
+    double scale;
+    double offset;
+};
+
+struct KnownColumn
+{
+    const char* name;
+    const char* type;
+};
+
+// LAS dimension names get LAS types, anything else is a double.
+const KnownColumn s_knownColumns[] =
+{
+    { "X", "double" },
+    { "Y", "double" },
+    { "Z", "double" },
+    { "Intensity", "uint16" },
+    { "ReturnNumber", "uint8" },
+    { "NumberOfReturns", "uint8" },
+    { "ScanDirectionFlag", "uint8" },
+    { "EdgeOfFlightLine", "uint8" },
+    { "Classification", "uint8" },
+    { "ScanAngleRank", "int8" },
+    { "UserData", "uint8" },
+    { "PointSourceId", "uint16" },
+    { "Time", "double" },
+    { "Red", "uint16" },
+    { "Green", "uint16" },
+    { "Blue", "uint16" }
+};
+
+// Powers of ten that are exact as doubles.
+const double s_powersOfTen[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+
+// Returns the end of the line starting at begin, not counting the newline.
+inline std::size_t lineEnd(const char* data, std::size_t begin, std::size_t size)
+{
+    const void* newline = std::memchr(data + begin, '\n', size - begin);
+    if (!newline)
+        return size;
+    return static_cast<const char*>(newline) - data;
+}
+
+
+inline std::size_t nextLine(std::size_t end, std::size_t size)
+{
+    return end < size ? end + 1 : end;
+}
+
+
+bool isBlankLine(const char* first, const char* last)
+{
+    for (; first != last; ++first)
+    {
+        if (!isBlank(*first))
+            return false;
+    }
+    return true;
+}
+
+
+Token makeToken(const char* first, const char* last)
+{
+    while (first != last && isBlank(*first))
+        ++first;
+    while (last != first && isBlank(*(last - 1)))
+        --last;
+    if (last - first >= 2 && *first == '"' && *(last - 1) == '"')
+    {
+        ++first;
+        --last;
+    }
+
+    Token token;
+    token.first = first;
+    token.last = last;
+    return token;
+}
+
+
+// Splits a line into tokens. With a zero delimiter tokens are separated by
+// runs of blanks.
+void tokenize(const char* first, const char* last, char delimiter,
+              std::vector<Token>& tokens)
+{
+    tokens.clear();
+
+    if (delimiter)
+    {
+        while (true)
+        {
+            const char* end = first;
+            while (end != last && *end != delimiter)
+                ++end;
+            tokens.push_back(makeToken(first, end));
+            if (end == last)
+                break;
+            first = end + 1;
+        }
+        return;
+    }
+
+    while (true)
+    {
+        while (first != last && isBlank(*first))
+            ++first;
+        if (first == last)
+            break;
+        const char* end = first;
+        while (end != last && !isBlank(*end))
+            ++end;
+        tokens.push_back(makeToken(first, end));
+        first = end;
+    }
+
+    return;
+}
+
+
+// The slow path of parseNumber, for whatever the fast one doesn't handle
+// exactly. The stream is imbued with the classic locale so that the
+// global one can't change the decimal point.
+bool parseNumberSlow(const char* first, const char* last, double& value)
+{
+    std::istringstream iss(std::string(first, last));
+    iss.imbue(std::locale::classic());
+    iss >> value;
+    if (iss.fail())
+        return false;
+
+    char c;
+    return !(iss >> c);
+}
+
+
+// Parses a decimal number without iostreams. Numbers with at most 19
+// significant digits whose mantissa fits in a double's 53 bits and whose
+// exponent is small enough are exact with a single multiply or divide by
+// an exact power of ten, which covers the fixed point coordinates found
+// in point cloud text files.
+bool parseNumber(const char* first, const char* last, double& value)
+{
+    const char* p = first;
+
+    bool negative = false;
+    if (p != last && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    boost::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+
+    for (; p != last && isDigit(*p); ++p)
+    {
+        if (digits == 19)
+            return parseNumberSlow(first, last, value);
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa)
+            ++digits;
+        any = true;
+    }
+    if (p != last && *p == '.')
+    {
+        for (++p; p != last && isDigit(*p); ++p)
+        {
+            if (digits == 19)
+                return parseNumberSlow(first, last, value);
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa)
+                ++digits;
+            --exponent;
+            any = true;
+        }
+    }
+    if (!any)
+        return parseNumberSlow(first, last, value);
+
+    if (p != last && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool negativeExponent = false;
+        if (p != last && (*p == '-' || *p == '+'))
+        {
+            negativeExponent = (*p == '-');
+            ++p;
+        }
+        if (p == last || !isDigit(*p))
+            return false;
+
+        int e = 0;
+        for (; p != last && isDigit(*p); ++p)
+        {
+            if (e < 10000)
+                e = e * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+    if (p != last)
+        return false;
+
+    if (mantissa > (boost::uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+        return parseNumberSlow(first, last, value);
+
+    value = static_cast<double>(mantissa);
+    if (exponent < 0)
+        value /= s_powersOfTen[-exponent];
+    else
+        value *= s_powersOfTen[exponent];
+    if (negative)
+        value = -value;
+
+    return true;
+}
+
+
+template <typename T>
+inline void storeInteger(boost::uint8_t* p, double v)
+{
+    const T lowest = (std::numeric_limits<T>::min)();
+    const T highest = (std::numeric_limits<T>::max)();
+
+    // Saturate, and send NaN to the lowest value.
+    T t;
+    if (!(v > static_cast<double>(lowest)))
+        t = lowest;
+    else if (v >= static_cast<double>(highest))
+        t = highest;
+    else
+        t = static_cast<T>(Utils::sround(v));
+
+    std::memcpy(p, &t, sizeof(T));
+    return;
+}
+
+
+template <typename T>
+inline void storeFloat(boost::uint8_t* p, double v)
+{
+    const T t = static_cast<T>(v);
+    std::memcpy(p, &t, sizeof(T));
+    return;
+}
+
+
+inline void store(Target const& target, boost::uint8_t* row, double v)
+{
+    boost::uint8_t* p = row + target.byteOffset;
+    v = (v - target.offset) / target.scale;
+
+    switch (target.type)
+    {
+        case Store_Int8: storeInteger<boost::int8_t>(p, v); break;
+        case Store_Int16: storeInteger<boost::int16_t>(p, v); break;
+        case Store_Int32: storeInteger<boost::int32_t>(p, v); break;
+        case Store_Int64: storeInteger<boost::int64_t>(p, v); break;
+        case Store_UInt8: storeInteger<boost::uint8_t>(p, v); break;
+        case Store_UInt16: storeInteger<boost::uint16_t>(p, v); break;
+        case Store_UInt32: storeInteger<boost::uint32_t>(p, v); break;
+        case Store_UInt64: storeInteger<boost::uint64_t>(p, v); break;
+        case Store_Float: storeFloat<float>(p, v); break;
+        case Store_Double: storeFloat<double>(p, v); break;
+        case Store_None: break;
+    }
+
+    return;
+}
+
+
+Target makeTarget(Dimension const& dim)
+{
+    Target target;
+    target.byteOffset = dim.getByteOffset();
+    target.scale = dim.getNumericScale();
+    target.offset = dim.getNumericOffset();
+
+    const dimension::size_type size = dim.getByteSize();
+    switch (dim.getInterpretation())
+    {
+        case dimension::SignedByte:
+        case dimension::SignedInteger:
+            if (size == 1) target.type = Store_Int8;
+            else if (size == 2) target.type = Store_Int16;
+            else if (size == 4) target.type = Store_Int32;
+            else if (size == 8) target.type = Store_Int64;
+            break;
+        case dimension::UnsignedByte:
+        case dimension::UnsignedInteger:
+            if (size == 1) target.type = Store_UInt8;
+            else if (size == 2) target.type = Store_UInt16;
+            else if (size == 4) target.type = Store_UInt32;
+            else if (size == 8) target.type = Store_UInt64;
+            break;
+        case dimension::Float:
+            if (size == 4) target.type = Store_Float;
+            else if (size == 8) target.type = Store_Double;
+            break;
+        default:
+            break;
+    }
+
+    if (target.type == Store_None)
+    {
+        std::ostringstream oss;
+        oss << "Text reader cannot store numbers in dimension '"
+            << dim.getName() << "' of type " << dim.getInterpretationName()
+            << " and size " << size;
+        throw text_driver_error(oss.str());
+    }
+
+    return target;
+}
+
+
+// Parses a run of lines into the matching rows of a point buffer. Runs
+// are disjoint, so several can fill the same buffer at once.
+class Parser
+{
+public:
+    Parser(const char* data,
+           std::vector<Line> const& lines,
+           std::vector<Target> const& targets,
+           std::vector<std::string> const& columns,
+           char delimiter,
+           PointBuffer& buffer,
+           boost::uint64_t pointIndex)
+        : m_data(data)
+        , m_lines(lines)
+        , m_targets(targets)
+        , m_columns(columns)
+        , m_delimiter(delimiter)
+        , m_buffer(buffer)
+        , m_pointIndex(pointIndex)
+    {}
+
+    void parse(std::size_t first, std::size_t last) const
+    {
+        std::vector<Token> tokens;
+        tokens.reserve(m_targets.size());
+
+        for (std::size_t i = first; i != last; ++i)
+        {
+            Line const& line = m_lines[i];
+            tokenize(m_data + line.first, m_data + line.last, m_delimiter, tokens);
+
+            if (tokens.size() != m_targets.size())
+            {
+                std::ostringstream oss;
+                oss << "Text reader found " << tokens.size()
+                    << " columns where it expected " << m_targets.size()
+                    << " at point " << m_pointIndex + i << ": '"
+                    << std::string(m_data + line.first, m_data + line.last)
+                    << "'";
+                throw text_driver_error(oss.str());
+            }
+
+            boost::uint8_t* row = m_buffer.getData(i);
+            for (std::size_t c = 0; c < tokens.size(); ++c)
+            {
+                Target const& target = m_targets[c];
+                if (target.type == Store_None)
+                    continue;
+
+                double value(0.0);
+                if (!parseNumber(tokens[c].first, tokens[c].last, value))
+                {
+                    std::ostringstream oss;
+                    oss << "Text reader could not parse '"
+                        << std::string(tokens[c].first, tokens[c].last)
+                        << "' in column '" << m_columns[c]
+                        << "' of point " << m_pointIndex + i;
+                    throw text_driver_error(oss.str());
+                }
+                store(target, row, value);
+            }
+        }
+
+        return;
+    }
+
+private:
+    Parser& operator=(const Parser&); // not implemented
+
+    const char* m_data;
+    std::vector<Line> const& m_lines;
+    std::vector<Target> const& m_targets;
+    std::vector<std::string> const& m_columns;
+    char m_delimiter;
+    PointBuffer& m_buffer;
+    boost::uint64_t m_pointIndex;
+};
+
+
+// Runs a Parser on a thread, keeping any error for the caller.
+class ParseRun
+{
+public:
+    ParseRun(Parser const& parser, std::size_t first, std::size_t last,
+             std::string& error)
+        : m_parser(parser)
+        , m_first(first)
+        , m_last(last)
+        , m_error(error)
+    {}
+
+    void operator()()
+    {
+        try
+        {
+            m_parser.parse(m_first, m_last);
+        }
+        catch (std::exception const& e)
+        {
+            m_error = e.what();
+        }
+        return;
+    }
+
+private:
+    Parser const& m_parser;
+    std::size_t m_first;
+    std::size_t m_last;
+    std::string& m_error;
+};
+
+} // anonymous namespace
+
+
+const boost::uint64_t Reader::s_indexStride = 65536;
+
+
+Reader::Reader(const Options& options)
+    : pdal::Reader(options)
+    , m_data(0)
+    , m_size(0)
+    , m_delimiter(0)
+    , m_numThreads(1)
+{
+    return;
+}
+
+
+Reader::~Reader()
+{
+    return;
+}
+
+
+std::string Reader::getFileName() const
+{
+    return getOptions().getValueOrThrow<std::string>("filename");
+}
+
+
+const Options Reader::getDefaultOptions() const
+{
+    Options options;
+
+    Option filename("filename", "", "Text file to read");
+    Option delimiter("delimiter", "", "Column delimiter, or ' ' for whitespace (detected when not given)");
+    Option skip("skip", 0, "Number of lines to skip before the header or data");
+    Option header("header", "auto", "Whether the first line holds column names");
+    Option columns("columns", "", "Column names with optional types, as in 'X,Y,Z,Intensity:uint16'");
+    Option threads("threads", 0, "Number of parsing threads, 0 for one per core");
+
+    options.add(filename);
+    options.add(delimiter);
+    options.add(skip);
+    options.add(header);
+    options.add(columns);
+    options.add(threads);
+
+    return options;
+}
+
+
+Dimension Reader::makeDimension(std::string const& name, std::string type) const
+{
+    std::string canonical(name);
+    for (std::size_t i = 0; i < sizeof(s_knownColumns) / sizeof(s_knownColumns[0]); ++i)
+    {
+        if (boost::iequals(name, s_knownColumns[i].name))
+        {
+            canonical = s_knownColumns[i].name;
+            if (type.empty())
+                type = s_knownColumns[i].type;
+            break;
+        }
+    }
+
+    // A scale stores X, Y or Z as a scaled integer, as LAS does.
+    bool scaled(false);
+    double scale(1.0);
+    double offset(0.0);
+    if (canonical == "X" || canonical == "Y" || canonical == "Z")
+    {
+        const std::string axis = boost::to_lower_copy(canonical);
+        if (getOptions().hasOption("scale_" + axis))
+        {
+            scaled = true;
+            scale = getOptions().getValueOrThrow<double>("scale_" + axis);
+            offset = getOptions().getValueOrDefault<double>("offset_" + axis, 0.0);
+            if (!(scale > 0.0))
+                throw text_driver_error("Text reader scale_" + axis + " must be positive");
+            if (type == "double")
+                type = "int32";
+        }
+    }
+
+    dimension::Interpretation interpretation(dimension::Float);
+    dimension::size_type size(8);
+    if (type.empty() || type == "double") { interpretation = dimension::Float; size = 8; }
+    else if (type == "float") { interpretation = dimension::Float; size = 4; }
+    else if (type == "int8") { interpretation = dimension::SignedInteger; size = 1; }
+    else if (type == "int16") { interpretation = dimension::SignedInteger; size = 2; }
+    else if (type == "int32") { interpretation = dimension::SignedInteger; size = 4; }
+    else if (type == "int64") { interpretation = dimension::SignedInteger; size = 8; }
+    else if (type == "uint8") { interpretation = dimension::UnsignedInteger; size = 1; }
+    else if (type == "uint16") { interpretation = dimension::UnsignedInteger; size = 2; }
+    else if (type == "uint32") { interpretation = dimension::UnsignedInteger; size = 4; }
+    else if (type == "uint64") { interpretation = dimension::UnsignedInteger; size = 8; }
+    else
+        throw text_driver_error("Text reader does not know the type '" + type +
+                                "' of column '" + name + "'");
+
+    Dimension dim(canonical, interpretation, size);
+    if (scaled)
+    {
+        dim.setNumericScale(scale);
+        dim.setNumericOffset(offset);
+    }
+    dim.createUUID();
+    dim.setNamespace(getName());
+
+    return dim;
+}
+
+
+std::vector<std::string> Reader::splitLine(std::size_t begin, std::size_t end) const
+{
+    std::vector<Token> tokens;
+    tokenize(m_data + begin, m_data + end, m_delimiter, tokens);
+
+    std::vector<std::string> output;
+    for (std::vector<Token>::const_iterator i = tokens.begin(); i != tokens.end(); ++i)
+        output.push_back(std::string(i->first, i->last));
+
+    return output;
+}
+
+
+void Reader::readLayout(std::size_t& position)
+{
+    const boost::uint32_t skip = getOptions().getValueOrDefault<boost::uint32_t>("skip", 0);
+    for (boost::uint32_t i = 0; i < skip && position < m_size; ++i)
+        position = nextLine(lineEnd(m_data, position, m_size), m_size);
+
+    std::size_t end = lineEnd(m_data, position, m_size);
+    while (position < m_size && isBlankLine(m_data + position, m_data + end))
+    {
+        position = nextLine(end, m_size);
+        end = lineEnd(m_data, position, m_size);
+    }
+
+    if (getOptions().hasOption("delimiter") &&
+            !getOptions().getValueOrThrow<std::string>("delimiter").empty())
+    {
+        const char c = getOptions().getValueOrThrow<std::string>("delimiter")[0];
+        m_delimiter = isBlank(c) ? 0 : c;
+    }
+    else
+    {
+        const std::string first(m_data + position, m_data + end);
+        const char candidates[] = { ',', ';', '|' };
+        m_delimiter = 0;
+        for (std::size_t i = 0; i < sizeof(candidates); ++i)
+        {
+            if (first.find(candidates[i]) != std::string::npos)
+            {
+                m_delimiter = candidates[i];
+                break;
+            }
+        }
+    }
+
+    std::vector<std::string> tokens = splitLine(position, end);
+
+    bool header(false);
+    const std::string headerOption = getOptions().getValueOrDefault<std::string>("header", "auto");
+    if (headerOption == "auto")
+    {
+        for (std::size_t i = 0; i < tokens.size(); ++i)
+        {
+            double value;
+            if (!parseNumber(tokens[i].data(), tokens[i].data() + tokens[i].size(), value))
+                header = true;
+        }
+    }
+    else
+        header = getOptions().getValueOrThrow<bool>("header");
+
+    std::vector<std::string> names;
+    std::vector<std::string> types;
+    if (header)
+    {
+        for (std::size_t i = 0; i < tokens.size(); ++i)
+        {
+            std::ostringstream oss;
+            oss << "Column" << i + 1;
+            names.push_back(tokens[i].empty() ? oss.str() : tokens[i]);
+        }
+        position = nextLine(end, m_size);
+    }
+    else if (tokens.size() == 1 &&
+             tokens[0].find_first_not_of("0123456789") == std::string::npos)
+    {
+        // A PTS point count line.
+        const std::size_t next = nextLine(end, m_size);
+        const std::vector<std::string> following = splitLine(next, lineEnd(m_data, next, m_size));
+        if (following.size() > 1)
+        {
+            position = next;
+            tokens = following;
+        }
+    }
+
+    const std::string columns = getOptions().getValueOrDefault<std::string>("columns", "");
+    if (!columns.empty())
+    {
+        std::vector<std::string> fields;
+        boost::split(fields, columns, boost::is_any_of(","));
+        names.clear();
+        for (std::size_t i = 0; i < fields.size(); ++i)
+        {
+            std::vector<std::string> parts;
+            boost::split(parts, fields[i], boost::is_any_of(":"));
+            names.push_back(boost::trim_copy(parts[0]));
+            types.push_back(parts.size() > 1 ? boost::to_lower_copy(boost::trim_copy(parts[1])) : "");
+        }
+    }
+    else if (!header)
+    {
+        const char* xyz[] = { "X", "Y", "Z" };
+        const char* rgb[] = { "Red", "Green", "Blue" };
+        const std::size_t count = tokens.size();
+        for (std::size_t i = 0; i < count && i < 3; ++i)
+            names.push_back(xyz[i]);
+        if (count == 4 || count == 7)
+            names.push_back("Intensity");
+        if (count == 6 || count == 7)
+            names.insert(names.end(), rgb, rgb + 3);
+        for (std::size_t i = names.size(); i < count; ++i)
+        {
+            std::ostringstream oss;
+            oss << "Column" << i + 1;
+            names.push_back(oss.str());
+        }
+    }
+    types.resize(names.size());
+
+    std::vector<Dimension> dimensions;
+    m_columns.clear();
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        Dimension dim = makeDimension(names[i], types[i]);
+        for (std::size_t j = 0; j < m_columns.size(); ++j)
+        {
+            if (m_columns[j] == dim.getName())
+                throw text_driver_error("Text reader found the column '" +
+                                        dim.getName() + "' twice");
+        }
+        m_columns.push_back(dim.getName());
+        dimensions.push_back(dim);
+    }
+
+    getSchemaRef() = Schema(dimensions);
+
+    return;
+}
+
+
+void Reader::initialize()
+{
+    pdal::Reader::initialize();
+
+    const std::string filename = getFileName();
+    if (!FileUtils::fileExists(filename))
+        throw text_driver_error("Text reader unable to open file '" + filename + "'");
+
+    // An empty file can't be mapped.
+    if (FileUtils::fileSize(filename) > 0)
+    {
+        m_file.open(filename);
+        m_data = m_file.data();
+        m_size = m_file.size();
+    }
+
+    m_numThreads = getOptions().getValueOrDefault<boost::uint32_t>("threads", 0);
+    if (m_numThreads == 0)
+        m_numThreads = std::max(1u, boost::thread::hardware_concurrency());
+
+    std::size_t position = 0;
+    readLayout(position);
+
+    // Count the points, noting where every s_indexStride'th one starts.
+    m_index.clear();
+    boost::uint64_t count = 0;
+    while (position < m_size)
+    {
+        const std::size_t end = lineEnd(m_data, position, m_size);
+        if (!isBlankLine(m_data + position, m_data + end))
+        {
+            if (count % s_indexStride == 0)
+                m_index.push_back(position);
+            ++count;
+        }
+        position = nextLine(end, m_size);
+    }
+
+    setPointCountType(PointCount_Fixed);
+    setNumPoints(count);
+
+    std::ostringstream oss;
+    oss << "text reader: " << count << " points in " << m_columns.size()
+        << " columns, delimiter '" << (m_delimiter ? m_delimiter : ' ') << "'";
+    log()->get(logDEBUG) << oss.str() << std::endl;
+
+    return;
+}
+
+
+std::size_t Reader::findPoint(boost::uint64_t pointIndex) const
+{
+    if (pointIndex >= getNumPoints())
+        return m_size;
+
+    std::size_t position = m_index[pointIndex / s_indexStride];
+    boost::uint64_t count = pointIndex % s_indexStride;
+    while (true)
+    {
+        const std::size_t end = lineEnd(m_data, position, m_size);
+        if (!isBlankLine(m_data + position, m_data + end))
+        {
+            if (count == 0)
+                return position;
+            --count;
+        }
+        position = nextLine(end, m_size);
+    }
+}
+
+
+boost::uint32_t Reader::processBuffer(PointBuffer& data,
+                                      std::size_t& position,
+                                      boost::uint64_t pointIndex) const
+{
+    const boost::uint64_t numPoints = getNumPoints();
+
+    boost::uint32_t count = data.getCapacity();
+    if (pointIndex >= numPoints)
+        count = 0;
+    else if (numPoints - pointIndex < count)
+        count = static_cast<boost::uint32_t>(numPoints - pointIndex);
+
+    std::vector<Line> lines;
+    lines.reserve(count);
+    while (lines.size() < count && position < m_size)
+    {
+        Line line;
+        line.first = position;
+        line.last = lineEnd(m_data, position, m_size);
+        if (!isBlankLine(m_data + line.first, m_data + line.last))
+            lines.push_back(line);
+        position = nextLine(line.last, m_size);
+    }
+    if (lines.size() != count)
+        throw text_driver_error("Text reader ran out of lines, has '" +
+                                getFileName() + "' changed?");
+
+    Schema const& schema = data.getSchema();
+    std::vector<Target> targets(m_columns.size());
+    for (std::size_t c = 0; c < m_columns.size(); ++c)
+    {
+        boost::optional<Dimension const&> dim = schema.getDimensionOptional(m_columns[c], getName());
+        if (!dim)
+            dim = schema.getDimensionOptional(m_columns[c]);
+        if (dim)
+            targets[c] = makeTarget(*dim);
+    }
+
+    const Parser parser(m_data, lines, targets, m_columns, m_delimiter, data, pointIndex);
+
+    const std::size_t numRuns = std::max<std::size_t>(1,
+        std::min<std::size_t>(m_numThreads, count / s_minLinesPerRun));
+    if (numRuns == 1)
+    {
+        parser.parse(0, count);
+    }
+    else
+    {
+        std::vector<std::string> errors(numRuns);
+        boost::thread_group threads;
+        for (std::size_t i = 0; i < numRuns; ++i)
+        {
+            const std::size_t first = count * i / numRuns;
+            const std::size_t last = count * (i + 1) / numRuns;
+            threads.create_thread(ParseRun(parser, first, last, errors[i]));
+        }
+        threads.join_all();
+
+        for (std::size_t i = 0; i < numRuns; ++i)
+        {
+            if (!errors[i].empty())
+                throw text_driver_error(errors[i]);
+        }
+    }
+
+    data.setNumPoints(count);
+
+    return count;
+}
+
+
+boost::property_tree::ptree Reader::toPTree() const
+{
+    boost::property_tree::ptree tree = pdal::Reader::toPTree();
+
+    // add stuff here specific to this stage type
+
+    return tree;
+}
+
+
+pdal::StageSequentialIterator* Reader::createSequentialIterator(PointBuffer& buffer) const
+{
+    return new pdal::drivers::text::iterators::sequential::Reader(*this, buffer);
+}
+
+
+pdal::StageRandomIterator* Reader::createRandomIterator(PointBuffer& buffer) const
+{
+    return new pdal::drivers::text::iterators::random::Reader(*this, buffer);
+}
+
+
+namespace iterators
+{
+
+namespace sequential
+{
+
+
+Reader::Reader(const pdal::drivers::text::Reader& reader, PointBuffer& buffer)
+    : pdal::ReaderSequentialIterator(reader, buffer)
+    , m_reader(reader)
+    , m_position(reader.findPoint(0))
+{
+    return;
+}
+
+
+boost::uint64_t Reader::skipImpl(boost::uint64_t count)
+{
+    const boost::uint64_t numPoints = getStage().getNumPoints();
+    const boost::uint64_t index = getIndex();
+
+    if (index >= numPoints)
+        return 0;
+    count = std::min(count, numPoints - index);
+    m_position = m_reader.findPoint(index + count);
+
+    return count;
+}
+
+
+bool Reader::atEndImpl() const
+{
+    return getIndex() >= getStage().getNumPoints();
+}
+
+
+boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
+{
+    return m_reader.processBuffer(data, m_position, getIndex());
+}
+
+} // sequential
+
+namespace random
+{
+
+
+Reader::Reader(const pdal::drivers::text::Reader& reader, PointBuffer& buffer)
+    : pdal::ReaderRandomIterator(reader, buffer)
+    , m_reader(reader)
+    , m_position(reader.findPoint(0))
+{
+    return;
+}
+
+
+boost::uint64_t Reader::seekImpl(boost::uint64_t count)
+{
+    count = std::min(count, getStage().getNumPoints());
+    m_position = m_reader.findPoint(count);
+
+    return count;
+}
+
+
+boost::uint32_t Reader::readBufferImpl(PointBuffer& data)
+{
+    return m_reader.processBuffer(data, m_position, getIndex());
+}
+
+
+} // random
+} // iterators
+
+}
+}
+} // namespaces
@@ -39,6 +39,12 @@
 #include <algorithm>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/math/special_functions/sign.hpp>
+#include <boost/thread.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <locale>
 
 
 #ifdef USE_PDAL_PLUGIN_TEXT
@@ -78,101 +84,64 @@ struct FileStreamDeleter
     }
 };
 
-Writer::Writer(Stage& prevStage, const Options& options)
-    : pdal::Writer(prevStage, options)
-    , m_wrote_header(false)
-
-{
-
-    return;
-}
-
 
-Writer::~Writer()
+namespace
 {
-    return;
-}
 
+// Don't start a thread for fewer points than this.
+const boost::uint32_t s_minPointsPerRun = 4096;
 
-void Writer::initialize()
+// Powers of ten that are exact as doubles.
+const double s_powersOfTen[] =
 {
-    pdal::Writer::initialize();
-
-    std::string filename = getOptions().getValueOrThrow<std::string>("filename");
-
-    // This is so the stream gets closed down if we throw any sort of
-    // exception
-    m_stream = FileStreamPtr(FileUtils::createFile(filename, true), FileStreamDeleter());
-
-    return;
-}
-
-
-
-const Options Writer::getDefaultOptions() const
-{
-    Options options;
-
-    Option delimiter("delimiter", ",", "Delimiter to use for writing text");
-    Option newline("newline", "\n", "Newline character to use for additional lines");
-    Option quote_header("quote_header", true, "Write dimension names in quotes");
-    Option filename("filename", "", "Filename to write CSV file to");
-
-
-    options.add(filename);
-    options.add(delimiter);
-    options.add(newline);
-    options.add(quote_header);
-
-    return options;
-}
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
+// 2^53, past which doubles no longer hold every integer
+const double s_maxExactInteger = 9007199254740992.0;
 
-void Writer::writeBegin(boost::uint64_t /*targetNumPointsToWrite*/)
+enum FieldType
 {
-    return;
-}
-
+    Field_Int8,
+    Field_Int16,
+    Field_Int32,
+    Field_Int64,
+    Field_UInt8,
+    Field_UInt16,
+    Field_UInt32,
+    Field_UInt64,
+    Field_Float,
+    Field_Double,
+    Field_Other
+};
 
-void Writer::writeEnd(boost::uint64_t /*actualNumPointsWritten*/)
+enum FieldMode
 {
-    m_stream.reset();
-    m_stream = FileStreamPtr();
-    m_wrote_header = false;
-    return;
-}
+    Mode_Fixed,
+    Mode_Shortest,
+    Mode_Stream
+};
 
-void Writer::WriteHeader(pdal::Schema const& schema)
+// How one dimension is formatted, worked out once per buffer rather than
+// once per field.
+struct FieldFormat
 {
+    Dimension const* dim;
+    FieldType type;
+    FieldMode mode;
+    std::size_t byteOffset;
+    double scale;
+    double offset;
+    boost::uint32_t precision;
+};
 
-    schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
-
-    bool isQuoted = getOptions().getValueOrDefault<bool>("quote_header", true);
-    std::string newline = getOptions().getValueOrDefault<std::string>("newline", "\n");
-    std::string delimiter = getOptions().getValueOrDefault<std::string>("delimiter",",");
-
-    schema::index_by_index::const_iterator iter = dims.begin();
-    while (iter != dims.end())
-    {
-        if (iter->isIgnored())
-            continue;
-        if (isQuoted)
-            *m_stream << "\"";
-        *m_stream << iter->getName();
-        if (isQuoted)
-            *m_stream<< "\"";
-        iter++;
-        if (iter != dims.end())
-            *m_stream << delimiter;
-    }
-    *m_stream << newline;
-
-    return;
-}
 
-std::string Writer::getStringRepresentation(PointBuffer const& data,
-        Dimension const& d,
-        std::size_t pointIndex) const
+// The original, iostream based formatting of a field. Anything the fast
+// paths below can't reproduce exactly is handed to this.
+std::string getStringRepresentation(PointBuffer const& data,
+                                    Dimension const& d,
+                                    std::size_t pointIndex)
 {
     std::ostringstream output;
 
@@ -266,48 +235,459 @@ std::string Writer::getStringRepresentation(PointBuffer const& data,
 }
 
 
+std::vector<FieldFormat> makeFormats(Schema const& schema, bool shortestFloats)
+{
+    std::vector<FieldFormat> formats;
 
-boost::uint32_t Writer::writeBuffer(const PointBuffer& data)
+    schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
+    for (schema::index_by_index::const_iterator iter = dims.begin(); iter != dims.end(); ++iter)
+    {
+        if (iter->isIgnored())
+            continue;
+
+        FieldFormat format;
+        format.dim = &*iter;
+        format.type = Field_Other;
+        format.byteOffset = iter->getByteOffset();
+        format.scale = iter->getNumericScale();
+        format.offset = iter->getNumericOffset();
+        format.precision = 0;
+
+        const boost::uint32_t size = iter->getByteSize();
+        switch (iter->getInterpretation())
+        {
+            case dimension::SignedInteger:
+            case dimension::SignedByte:
+                if (size == 1) format.type = Field_Int8;
+                else if (size == 2) format.type = Field_Int16;
+                else if (size == 4) format.type = Field_Int32;
+                else if (size == 8) format.type = Field_Int64;
+                break;
+            case dimension::UnsignedInteger:
+            case dimension::UnsignedByte:
+                if (size == 1) format.type = Field_UInt8;
+                else if (size == 2) format.type = Field_UInt16;
+                else if (size == 4) format.type = Field_UInt32;
+                else if (size == 8) format.type = Field_UInt64;
+                break;
+            case dimension::Float:
+                if (size == 4) format.type = Field_Float;
+                else if (size == 8) format.type = Field_Double;
+                break;
+            default:
+                break;
+        }
+
+        // Without a scale the stream's default formatting is used, which
+        // only the stream itself reproduces.
+        if (format.type == Field_Other || Utils::compare_distance(format.scale, 0.0))
+        {
+            format.mode = Mode_Stream;
+        }
+        else if (shortestFloats && (format.type == Field_Float || format.type == Field_Double))
+        {
+            format.mode = Mode_Shortest;
+        }
+        else
+        {
+            format.mode = Mode_Fixed;
+            format.precision = Utils::getStreamPrecision(format.scale);
+        }
+
+        formats.push_back(format);
+    }
+
+    return formats;
+}
+
+
+template <typename T>
+inline double scaledValue(FieldFormat const& format, const boost::uint8_t* row)
 {
+    T v;
+    std::memcpy(&v, row + format.byteOffset, sizeof(T));
+    return static_cast<double>(v) * format.scale + format.offset;
+}
 
-    if (!m_wrote_header)
+
+template <typename T>
+inline double floatValue(FieldFormat const& format, const boost::uint8_t* row)
+{
+    T v;
+    std::memcpy(&v, row + format.byteOffset, sizeof(T));
+    return static_cast<double>(v);
+}
+
+
+// The value as getStringRepresentation() would print it: integers scaled,
+// floats as they are.
+inline double getValue(FieldFormat const& format, const boost::uint8_t* row)
+{
+    switch (format.type)
     {
-        WriteHeader(data.getSchema());
-        m_wrote_header = true;
+        case Field_Int8: return scaledValue<boost::int8_t>(format, row);
+        case Field_Int16: return scaledValue<boost::int16_t>(format, row);
+        case Field_Int32: return scaledValue<boost::int32_t>(format, row);
+        case Field_Int64: return scaledValue<boost::int64_t>(format, row);
+        case Field_UInt8: return scaledValue<boost::uint8_t>(format, row);
+        case Field_UInt16: return scaledValue<boost::uint16_t>(format, row);
+        case Field_UInt32: return scaledValue<boost::uint32_t>(format, row);
+        case Field_UInt64: return scaledValue<boost::uint64_t>(format, row);
+        case Field_Float: return floatValue<float>(format, row);
+        case Field_Double: return floatValue<double>(format, row);
+        case Field_Other: break;
     }
+    return 0.0;
+}
 
-    std::string newline = getOptions().getValueOrDefault<std::string>("newline", "\n");
-    std::string delimiter = getOptions().getValueOrDefault<std::string>("delimiter",",");
 
-    boost::uint32_t pointIndex(0);
+inline bool isSame(double a, double b)
+{
+    return !(a < b) && !(a > b);
+}
 
-    pdal::Schema const& schema = data.getSchema();
-    schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
 
-    while (pointIndex != data.getNumPoints())
+// Appends n with precision digits after the decimal point.
+inline void appendDecimal(std::string& out, bool negative, boost::uint64_t n,
+                          boost::uint32_t precision)
+{
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+
+    for (boost::uint32_t i = 0; i < precision; ++i)
+    {
+        *--p = static_cast<char>('0' + n % 10);
+        n /= 10;
+    }
+    if (precision)
+        *--p = '.';
+    do
     {
+        *--p = static_cast<char>('0' + n % 10);
+        n /= 10;
+    }
+    while (n);
+    if (negative)
+        *--p = '-';
+
+    out.append(p, end);
+    return;
+}
+
+
+// Appends v as printf("%.*f") would, or returns false when the value is
+// too large, too precise or too close to halfway between two outputs to
+// be sure of rounding it the same way.
+inline bool appendFixed(std::string& out, double v, boost::uint32_t precision)
+{
+    if (precision > 15)
+        return false;
+
+    const double scaled = std::fabs(v) * s_powersOfTen[precision];
+    if (!(scaled < s_maxExactInteger))
+        return false;
+
+    // scaled is within half an ulp of the exact product, so outside of
+    // twice that around the halfway point it rounds the same way.
+    const double whole = std::floor(scaled);
+    const double fraction = scaled - whole;
+    if (std::fabs(fraction - 0.5) <= scaled * 2.3e-16)
+        return false;
+
+    boost::uint64_t n = static_cast<boost::uint64_t>(whole);
+    if (fraction > 0.5)
+        ++n;
+
+    appendDecimal(out, boost::math::signbit(v) != 0, n, precision);
+    return true;
+}
+
 
-        schema::index_by_index::const_iterator iter = dims.begin();
-        while (iter != dims.end())
+// Appends v with the fewest decimals that read back as v, or returns false
+// when that would take an exponent.
+inline bool appendShortest(std::string& out, double v)
+{
+    const double magnitude = std::fabs(v);
+    if (!(magnitude < s_maxExactInteger))
+        return false;
+
+    for (boost::uint32_t precision = 0; precision <= 17; ++precision)
+    {
+        const double scaled = magnitude * s_powersOfTen[precision];
+        if (!(scaled < s_maxExactInteger))
+            break;
+
+        const double n = std::floor(scaled + 0.5);
+        if (isSame(n / s_powersOfTen[precision], magnitude))
         {
-            if (iter->isIgnored())
+            appendDecimal(out, boost::math::signbit(v) != 0,
+                          static_cast<boost::uint64_t>(n), precision);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void formatPoints(PointBuffer const& data,
+                  std::vector<FieldFormat> const& formats,
+                  std::string const& delimiter,
+                  std::string const& newline,
+                  boost::uint32_t first,
+                  boost::uint32_t last,
+                  std::string& out)
+{
+    for (boost::uint32_t pointIndex = first; pointIndex != last; ++pointIndex)
+    {
+        const boost::uint8_t* row = data.getData(pointIndex);
+
+        for (std::size_t i = 0; i < formats.size(); ++i)
+        {
+            FieldFormat const& format = formats[i];
+            if (i)
+                out += delimiter;
+
+            if (format.mode == Mode_Fixed)
+            {
+                if (appendFixed(out, getValue(format, row), format.precision))
+                    continue;
+            }
+            else if (format.mode == Mode_Shortest)
+            {
+                const double v = getValue(format, row);
+                if (!appendShortest(out, v))
+                {
+                    std::ostringstream oss;
+                    oss.imbue(std::locale::classic());
+                    oss.precision(17);
+                    oss << v;
+                    out += oss.str();
+                }
                 continue;
+            }
+
+            out += getStringRepresentation(data, *format.dim, pointIndex);
+        }
+        out += newline;
+    }
+
+    return;
+}
 
-            *m_stream << getStringRepresentation(data, *iter, pointIndex);
 
-            iter++;
-            if (iter != dims.end())
-                *m_stream << delimiter;
+// Formats a run of points on a thread, keeping any error for the caller.
+class FormatRun
+{
+public:
+    FormatRun(PointBuffer const& data,
+              std::vector<FieldFormat> const& formats,
+              std::string const& delimiter,
+              std::string const& newline,
+              boost::uint32_t first,
+              boost::uint32_t last,
+              std::string& out,
+              std::string& error)
+        : m_data(data)
+        , m_formats(formats)
+        , m_delimiter(delimiter)
+        , m_newline(newline)
+        , m_first(first)
+        , m_last(last)
+        , m_out(out)
+        , m_error(error)
+    {}
+
+    void operator()()
+    {
+        try
+        {
+            formatPoints(m_data, m_formats, m_delimiter, m_newline, m_first, m_last, m_out);
+        }
+        catch (std::exception const& e)
+        {
+            m_error = e.what();
         }
-        *m_stream << newline;
+        return;
+    }
+
+private:
+    PointBuffer const& m_data;
+    std::vector<FieldFormat> const& m_formats;
+    std::string const& m_delimiter;
+    std::string const& m_newline;
+    boost::uint32_t m_first;
+    boost::uint32_t m_last;
+    std::string& m_out;
+    std::string& m_error;
+};
+
+} // anonymous namespace
+
+
+Writer::Writer(Stage& prevStage, const Options& options)
+    : pdal::Writer(prevStage, options)
+    , m_wrote_header(false)
+    , m_numThreads(1)
+    , m_shortestFloats(false)
+{
+
+    return;
+}
+
+
+Writer::~Writer()
+{
+    return;
+}
+
+
+void Writer::initialize()
+{
+    pdal::Writer::initialize();
+
+    std::string filename = getOptions().getValueOrThrow<std::string>("filename");
+
+    // This is so the stream gets closed down if we throw any sort of
+    // exception
+    m_stream = FileStreamPtr(FileUtils::createFile(filename, true), FileStreamDeleter());
 
-        pointIndex++;
+    m_numThreads = getOptions().getValueOrDefault<boost::uint32_t>("threads", 0);
+    if (m_numThreads == 0)
+        m_numThreads = std::max(1u, boost::thread::hardware_concurrency());
 
+    const std::string floatFormat = getOptions().getValueOrDefault<std::string>("float_format", "fixed");
+    if (floatFormat == "shortest")
+        m_shortestFloats = true;
+    else if (floatFormat == "fixed")
+        m_shortestFloats = false;
+    else
+        throw text_driver_error("float_format must be 'fixed' or 'shortest', not '" + floatFormat + "'");
+
+    return;
+}
+
+
+
+const Options Writer::getDefaultOptions() const
+{
+    Options options;
+
+    Option delimiter("delimiter", ",", "Delimiter to use for writing text");
+    Option newline("newline", "\n", "Newline character to use for additional lines");
+    Option quote_header("quote_header", true, "Write dimension names in quotes");
+    Option filename("filename", "", "Filename to write CSV file to");
+    Option float_format("float_format", "fixed", "'fixed' to use the precision of each dimension's scale, 'shortest' for the fewest digits that round trip");
+    Option threads("threads", 0, "Number of formatting threads, 0 for one per core");
+
+
+    options.add(filename);
+    options.add(delimiter);
+    options.add(newline);
+    options.add(quote_header);
+    options.add(float_format);
+    options.add(threads);
+
+    return options;
+}
+
+
+void Writer::writeBegin(boost::uint64_t /*targetNumPointsToWrite*/)
+{
+    return;
+}
+
+
+void Writer::writeEnd(boost::uint64_t /*actualNumPointsWritten*/)
+{
+    m_stream.reset();
+    m_stream = FileStreamPtr();
+    m_wrote_header = false;
+    return;
+}
+
+void Writer::WriteHeader(pdal::Schema const& schema)
+{
+
+    schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
+
+    bool isQuoted = getOptions().getValueOrDefault<bool>("quote_header", true);
+    std::string newline = getOptions().getValueOrDefault<std::string>("newline", "\n");
+    std::string delimiter = getOptions().getValueOrDefault<std::string>("delimiter",",");
+
+    bool first = true;
+    schema::index_by_index::const_iterator iter = dims.begin();
+    for (; iter != dims.end(); ++iter)
+    {
+        if (iter->isIgnored())
+            continue;
+        if (!first)
+            *m_stream << delimiter;
+        first = false;
+        if (isQuoted)
+            *m_stream << "\"";
+        *m_stream << iter->getName();
+        if (isQuoted)
+            *m_stream<< "\"";
+    }
+    *m_stream << newline;
+
+    return;
+}
+
+
+boost::uint32_t Writer::writeBuffer(const PointBuffer& data)
+{
+
+    if (!m_wrote_header)
+    {
+        WriteHeader(data.getSchema());
+        m_wrote_header = true;
     }
 
+    std::string newline = getOptions().getValueOrDefault<std::string>("newline", "\n");
+    std::string delimiter = getOptions().getValueOrDefault<std::string>("delimiter",",");
+
+    const std::vector<FieldFormat> formats = makeFormats(data.getSchema(), m_shortestFloats);
+    const boost::uint32_t numPoints = data.getNumPoints();
+
+    // Each run formats into its own buffer, and the buffers are written
+    // out in order.
+    const boost::uint32_t numRuns = std::max<boost::uint32_t>(1,
+        std::min<boost::uint32_t>(m_numThreads, numPoints / s_minPointsPerRun));
+    std::vector<std::string> buffers(numRuns);
+    for (boost::uint32_t i = 0; i < numRuns; ++i)
+        buffers[i].reserve((numPoints / numRuns + 1) * formats.size() * 12);
+
+    if (numRuns == 1)
+    {
+        formatPoints(data, formats, delimiter, newline, 0, numPoints, buffers[0]);
+    }
+    else
+    {
+        std::vector<std::string> errors(numRuns);
+        boost::thread_group threads;
+        for (boost::uint32_t i = 0; i < numRuns; ++i)
+        {
+            const boost::uint32_t first = static_cast<boost::uint32_t>(boost::uint64_t(numPoints) * i / numRuns);
+            const boost::uint32_t last = static_cast<boost::uint32_t>(boost::uint64_t(numPoints) * (i + 1) / numRuns);
+            threads.create_thread(FormatRun(data, formats, delimiter, newline,
+                                            first, last, buffers[i], errors[i]));
+        }
+        threads.join_all();
+
+        for (boost::uint32_t i = 0; i < numRuns; ++i)
+        {
+            if (!errors[i].empty())
+                throw text_driver_error(errors[i]);
+        }
+    }
 
+    for (boost::uint32_t i = 0; i < numRuns; ++i)
+        m_stream->write(buffers[i].data(), buffers[i].size());
 
-    return data.getNumPoints();
+    return numPoints;
 }
 
 
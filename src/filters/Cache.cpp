@@ -36,6 +36,8 @@
 
 #include <pdal/filters/PointBufferCache.hpp>
 
+#include <algorithm>
+
 namespace pdal
 {
 namespace filters
@@ -49,6 +51,11 @@ Cache::Cache(Stage& prevStage, const Options& options)
     , m_cache(NULL)
     , m_maxCacheBlocks(options.getValueOrThrow<boost::uint32_t>("max_cache_blocks"))
     , m_cacheBlockSize(options.getValueOrThrow<boost::uint32_t>("cache_block_size"))
+    , m_maxCacheBytes(options.getValueOrDefault<boost::uint64_t>("max_cache_bytes", 0))
+    , m_numCacheShards(options.getValueOrDefault<boost::uint32_t>("cache_shards", 8))
+    , m_prefetchBlocks(options.getValueOrDefault<boost::uint32_t>("prefetch_blocks", 0))
+    , m_maxSpillBytes(options.getValueOrDefault<boost::uint64_t>("spill_bytes", 0))
+    , m_spillDirectory(options.getValueOrDefault<std::string>("spill_directory", ""))
 {
     return;
 }
@@ -62,6 +69,10 @@ Cache::Cache(Stage& prevStage, boost::uint32_t maxCacheBlocks, boost::uint32_t c
     , m_cache(NULL)
     , m_maxCacheBlocks(maxCacheBlocks)
     , m_cacheBlockSize(cacheBlockSize)
+    , m_maxCacheBytes(0)
+    , m_numCacheShards(8)
+    , m_prefetchBlocks(0)
+    , m_maxSpillBytes(0)
 {
     return;
 }
@@ -77,6 +88,11 @@ void Cache::initialize()
 {
     Filter::initialize();
 
+    if (m_maxCacheBlocks == 0)
+        throw pdal_error("filters.cache: max_cache_blocks must be positive");
+    if (m_cacheBlockSize == 0)
+        throw pdal_error("filters.cache: cache_block_size must be positive");
+
     resetCache();
     return;
 }
@@ -87,8 +103,18 @@ const Options Cache::getDefaultOptions() const
     Options options;
     Option max_cache_blocks("max_cache_blocks", 1);
     Option cache_block_size("cache_block_size", 32768);
+    Option max_cache_bytes("max_cache_bytes", 0, "limit on the bytes cached, or 0 for none");
+    Option cache_shards("cache_shards", 8, "number of separately locked parts of the cache");
+    Option prefetch_blocks("prefetch_blocks", 0, "blocks to read ahead after a cache miss");
     options.add(max_cache_blocks);
     options.add(cache_block_size);
+    options.add(max_cache_bytes);
+    options.add(cache_shards);
+    Option spill_bytes("spill_bytes", 0, "size of the scratch file for evicted blocks, or 0 for none");
+    Option spill_directory("spill_directory", "", "where to put the scratch file, if not the temporary directory");
+    options.add(prefetch_blocks);
+    options.add(spill_bytes);
+    options.add(spill_directory);
     return options;
 }
 
@@ -99,12 +125,45 @@ boost::uint32_t Cache::getCacheBlockSize() const
 }
 
 
+boost::uint64_t Cache::getMaxCacheBytes() const
+{
+    return m_maxCacheBytes;
+}
+
+
+boost::uint32_t Cache::getPrefetchBlocks() const
+{
+    return m_prefetchBlocks;
+}
+
+
+boost::uint32_t Cache::getNumCacheShards() const
+{
+    return static_cast<boost::uint32_t>(m_cache->getNumShards());
+}
+
+
+boost::uint64_t Cache::getCacheBytes() const
+{
+    return m_cache->getNumBytes();
+}
+
+
+const PointBufferSpill* Cache::getSpill() const
+{
+    return m_cache->getSpill();
+}
+
+
 void Cache::addToCache(boost::uint64_t pointIndex, const PointBuffer& data) const
 {
+    const boost::uint32_t numPoints = std::min(data.getNumPoints(), m_cacheBlockSize);
+
     PointBuffer* block = new PointBuffer(data.getSchema(), m_cacheBlockSize);
-    block->copyPointsFast(0, 0, data, m_cacheBlockSize);
+    block->copyPointsFast(0, 0, data, numPoints);
+    block->setNumPoints(numPoints);
 
-    m_cache->insert(pointIndex, block);
+    insertBlock(pointIndex / m_cacheBlockSize, block);
 
     return;
 }
@@ -114,9 +173,19 @@ const PointBuffer* Cache::lookupInCache(boost::uint64_t pointIndex) const
 {
     const boost::uint64_t blockNum = pointIndex / m_cacheBlockSize;
 
-    const PointBuffer* block = m_cache->lookup(blockNum);
+    return m_cache->lookup(blockNum);
+}
 
-    return block;
+
+Cache::Block Cache::lookupBlock(boost::uint64_t blockNum) const
+{
+    return m_cache->acquire(blockNum);
+}
+
+
+Cache::Block Cache::insertBlock(boost::uint64_t blockNum, PointBuffer* block) const
+{
+    return m_cache->share(blockNum, block);
 }
 
 
@@ -142,25 +211,49 @@ void Cache::resetCache(boost::uint32_t maxCacheBlocks, boost::uint32_t cacheBloc
 
 void Cache::resetCache()
 {
+    // Each shard is a separate LRU with an equal part of the limits, so
+    // don't split the cache into parts too small to be worth it: a few
+    // blocks each, and at least one block's worth of any byte limit.
+    boost::uint64_t numShards = std::min(m_numCacheShards, m_maxCacheBlocks / 4);
+    const boost::uint64_t blockBytes =
+        static_cast<boost::uint64_t>(getSchema().getByteSize()) * m_cacheBlockSize;
+    if (m_maxCacheBytes != 0 && blockBytes != 0)
+        numShards = std::min(numShards, m_maxCacheBytes / blockBytes);
+    numShards = std::max<boost::uint64_t>(numShards, 1);
+
     delete m_cache;
-    m_cache = new PointBufferCache(m_maxCacheBlocks);
+    m_cache = new PointBufferCache(m_maxCacheBlocks, m_maxCacheBytes,
+                                   static_cast<size_t>(numShards));
+
+    if (m_maxSpillBytes != 0)
+    {
+        if (m_maxSpillBytes < blockBytes)
+            throw pdal_error("filters.cache: spill_bytes is smaller than one block");
+        boost::shared_ptr<PointBufferSpill> spill(
+            new PointBufferSpill(getSchema(), m_cacheBlockSize, m_maxSpillBytes, m_spillDirectory));
+        m_cache->setSpill(spill);
+        log()->get(logDEBUG) << "filters.cache spilling to " << spill->getFilename() << std::endl;
+    }
 }
 
 
 boost::uint64_t Cache::getNumPointsRequested() const
 {
+    boost::mutex::scoped_lock lock(m_statsMutex);
     return m_numPointsRequested;
 }
 
 
 boost::uint64_t Cache::getNumPointsRead() const
 {
+    boost::mutex::scoped_lock lock(m_statsMutex);
     return m_numPointsRead;
 }
 
 
 void Cache::updateStats(boost::uint64_t numRead, boost::uint64_t numRequested) const
 {
+    boost::mutex::scoped_lock lock(m_statsMutex);
     m_numPointsRead += numRead;
     m_numPointsRequested += numRequested;
 }
@@ -180,6 +273,82 @@ pdal::StageRandomIterator* Cache::createRandomIterator(PointBuffer& buffer) cons
 
 namespace iterators
 {
+
+namespace
+{
+
+// Whether points of one schema may be copied bytewise into the other: the
+// same dimensions, in the same places.
+bool sameLayout(const Schema& lhs, const Schema& rhs)
+{
+    if (lhs.getByteSize() != rhs.getByteSize())
+        return false;
+
+    schema::index_by_index const& left = lhs.getDimensions().get<schema::index>();
+    schema::index_by_index const& right = rhs.getDimensions().get<schema::index>();
+    if (left.size() != right.size())
+        return false;
+
+    for (schema::index_by_index::size_type i = 0; i < left.size(); ++i)
+    {
+        const Dimension& l = left[i];
+        const Dimension& r = right[i];
+        if (l.getName() != r.getName() ||
+                l.getNamespace() != r.getNamespace() ||
+                l.getInterpretation() != r.getInterpretation() ||
+                l.getByteSize() != r.getByteSize() ||
+                l.getByteOffset() != r.getByteOffset())
+            return false;
+    }
+
+    return true;
+}
+
+
+// Fills data with the points from index on, copied out of the blocks
+// covering them, which the iterator gets from the cache or reads.
+template <class Iterator>
+boost::uint32_t readBlocks(Iterator& iter,
+                           const pdal::filters::Cache& filter,
+                           PointBuffer& data,
+                           boost::uint64_t index)
+{
+    const boost::uint32_t blockSize = filter.getCacheBlockSize();
+    const boost::uint32_t capacity = data.getCapacity();
+
+    assert(sameLayout(data.getSchema(), filter.getSchema()));
+
+    boost::uint32_t numRead = 0;
+    while (numRead < capacity)
+    {
+        const boost::uint64_t pointIndex = index + numRead;
+        const pdal::filters::Cache::Block block = iter.getBlock(pointIndex / blockSize);
+        if (!block)
+            break;
+
+        const boost::uint32_t offset = static_cast<boost::uint32_t>(pointIndex % blockSize);
+        const boost::uint32_t blockPoints = block->getNumPoints();
+        if (offset >= blockPoints)
+            break;
+
+        const boost::uint32_t count = std::min(capacity - numRead, blockPoints - offset);
+        data.copyPointsFast(numRead, offset, *block, count);
+        numRead += count;
+
+        // a short block is the last one
+        if (blockPoints < blockSize)
+            break;
+    }
+
+    data.setNumPoints(numRead);
+    filter.updateStats(0, capacity);
+
+    return numRead;
+}
+
+} // anonymous
+
+
 namespace sequential
 {
 
@@ -194,64 +363,126 @@ Cache::Cache(const pdal::filters::Cache& filter, PointBuffer& buffer)
 
 boost::uint64_t Cache::skipImpl(boost::uint64_t count)
 {
-    getPrevIterator().skip(count);
+    // the previous stage is moved on when a block past it is needed
     return count;
 }
 
 
 bool Cache::atEndImpl() const
 {
-    return getPrevIterator().atEnd();
+    if (m_filter.getPointCountType() == PointCount_Fixed)
+        return getIndex() >= m_filter.getNumPoints();
+
+    const boost::uint32_t blockSize = m_filter.getCacheBlockSize();
+    std::map<boost::uint64_t, pdal::filters::Cache::Block>::const_iterator i =
+        m_held.find(getIndex() / blockSize);
+    if (i != m_held.end())
+        return getIndex() % blockSize >= i->second->getNumPoints();
+
+    return getIndex() >= getPrevIterator().getIndex() && getPrevIterator().atEnd();
 }
 
 
 boost::uint32_t Cache::readBufferImpl(PointBuffer& data)
 {
-    const boost::uint32_t cacheBlockSize = m_filter.getCacheBlockSize();
+    const boost::uint64_t index = getIndex();
+    if (!sameLayout(data.getSchema(), m_filter.getSchema()))
+        return readUncached(data, index);
+
+    const boost::uint32_t numRead = readBlocks(*this, m_filter, data, index);
+
+    // let go of the blocks we are past
+    const boost::uint64_t current = (index + numRead) / m_filter.getCacheBlockSize();
+    m_held.erase(m_held.begin(), m_held.lower_bound(current));
 
-    const boost::uint64_t currentPointIndex = getIndex();
+    return numRead;
+}
 
-    // for now, we only read from the cache if they are asking for one point
-    // (this avoids the problem of an N-point request needing more than one
-    // cached block to satisfy it)
-    if (data.getCapacity() != 1)
+
+pdal::filters::Cache::Block Cache::getBlock(boost::uint64_t blockNum)
+{
+    std::map<boost::uint64_t, pdal::filters::Cache::Block>::const_iterator i = m_held.find(blockNum);
+    if (i != m_held.end())
+        return i->second;
+
+    pdal::filters::Cache::Block block = m_filter.lookupBlock(blockNum);
+    if (!block)
     {
-        const boost::uint32_t numRead = getPrevIterator().read(data);
-
-        // if they asked for a full block and we got a full block,
-        // and the block we got is properly aligned and not already cached,
-        // then let's cache it!
-        const bool isCacheable = (data.getCapacity() == cacheBlockSize) &&
-                                 (numRead == cacheBlockSize) &&
-                                 (currentPointIndex % cacheBlockSize == 0);
-        if (isCacheable && (m_filter.lookupInCache(currentPointIndex) == NULL))
+        block = fetchBlock(blockNum);
+        for (boost::uint32_t n = 1; block && n <= m_filter.getPrefetchBlocks(); ++n)
         {
-            m_filter.addToCache(currentPointIndex, data);
+            if (m_held.count(blockNum + n))
+                continue;
+
+            // a cached block is held too, since the fetches after it move
+            // the previous stage past it
+            pdal::filters::Cache::Block cached = m_filter.lookupBlock(blockNum + n);
+            if (cached)
+            {
+                m_held[blockNum + n] = cached;
+                continue;
+            }
+            if (!fetchBlock(blockNum + n))
+                break;
         }
+    }
 
-        m_filter.updateStats(numRead, data.getCapacity());
+    if (block)
+        m_held[blockNum] = block;
 
-        return numRead;
-    }
+    return block;
+}
 
-    // they asked for just one point -- first, check Mister Cache
-    const PointBuffer* block = m_filter.lookupInCache(currentPointIndex);
-    if (block != NULL)
-    {
-        // A hit! A palpable hit!
-        data.copyPointFast(0,  currentPointIndex % cacheBlockSize, *block);
 
-        m_filter.updateStats(0, 1);
+// The blocks are laid out in the stage schema, so a buffer of another
+// layout is read straight from the previous stage.
+boost::uint32_t Cache::readUncached(PointBuffer& data, boost::uint64_t index)
+{
+    StageSequentialIterator& prev = getPrevIterator();
+    if (prev.getIndex() > index)
+        throw pdal_error("filters.cache: cannot read a buffer of another schema from points already cached");
+    if (prev.getIndex() < index)
+        prev.skip(index - prev.getIndex());
 
-        return 1;
-    }
+    const boost::uint32_t numRead = prev.read(data);
+    m_filter.updateStats(numRead, data.getCapacity());
 
-    // Not in the cache, so do a normal read :-(
-    const boost::uint32_t numRead = getPrevIterator().read(data);
-    m_filter.updateStats(numRead, numRead);
+    const boost::uint64_t current = (index + numRead) / m_filter.getCacheBlockSize();
+    m_held.erase(m_held.begin(), m_held.lower_bound(current));
 
     return numRead;
 }
+
+
+pdal::filters::Cache::Block Cache::fetchBlock(boost::uint64_t blockNum)
+{
+    const boost::uint32_t blockSize = m_filter.getCacheBlockSize();
+    const boost::uint64_t start = blockNum * blockSize;
+
+    StageSequentialIterator& prev = getPrevIterator();
+    if (prev.getIndex() > start)
+        throw pdal_error("filters.cache: block is behind the previous stage");
+    if (prev.getIndex() < start)
+        prev.skip(start - prev.getIndex());
+    if (prev.atEnd())
+        return pdal::filters::Cache::Block();
+
+    PointBuffer* buffer = new PointBuffer(m_filter.getSchema(), blockSize);
+    const boost::uint32_t numRead = prev.read(*buffer);
+    m_filter.updateStats(numRead, 0);
+    if (numRead == 0)
+    {
+        delete buffer;
+        return pdal::filters::Cache::Block();
+    }
+
+    pdal::filters::Cache::Block block = m_filter.insertBlock(blockNum, buffer);
+    m_held[blockNum] = block;
+
+    return block;
+}
+
+
 }
 } // iterators::sequential
 
@@ -262,68 +493,100 @@ namespace random
 {
 
 
-
 Cache::Cache(const pdal::filters::Cache& filter, PointBuffer& buffer)
     : pdal::FilterRandomIterator(filter, buffer)
     , m_filter(filter)
+    , m_lastBlockNum(0)
 {
     return;
 }
 
 
-boost::uint64_t Cache::seekImpl(boost::uint64_t count)
+boost::uint64_t Cache::seekImpl(boost::uint64_t position)
 {
-    return getPrevIterator().seek(count);
+    // the previous stage is moved when a block is read from it
+    if (m_filter.getPointCountType() == PointCount_Fixed)
+        return std::min(position, m_filter.getNumPoints());
+
+    return position;
 }
 
 
-// BUG: this duplicates the code above
 boost::uint32_t Cache::readBufferImpl(PointBuffer& data)
 {
-    const boost::uint32_t cacheBlockSize = m_filter.getCacheBlockSize();
+    if (!sameLayout(data.getSchema(), m_filter.getSchema()))
+        return readUncached(data, getIndex());
+
+    return readBlocks(*this, m_filter, data, getIndex());
+}
+
+
+// The blocks are laid out in the stage schema, so a buffer of another
+// layout is read straight from the previous stage.
+boost::uint32_t Cache::readUncached(PointBuffer& data, boost::uint64_t index)
+{
+    StageRandomIterator& prev = getPrevIterator();
+    if (prev.seek(index) != index)
+    {
+        data.setNumPoints(0);
+        return 0;
+    }
+
+    const boost::uint32_t numRead = prev.read(data);
+    m_filter.updateStats(numRead, data.getCapacity());
+
+    return numRead;
+}
+
 
-    const boost::uint64_t currentPointIndex = getIndex();
+pdal::filters::Cache::Block Cache::getBlock(boost::uint64_t blockNum)
+{
+    if (m_lastBlock && m_lastBlockNum == blockNum)
+        return m_lastBlock;
 
-    // for now, we only read from the cache if they are asking for one point
-    // (this avoids the problem of an N-point request needing more than one
-    // cached block to satisfy it)
-    if (data.getCapacity() != 1)
+    pdal::filters::Cache::Block block = m_filter.lookupBlock(blockNum);
+    if (!block)
     {
-        const boost::uint32_t numRead = getPrevIterator().read(data);
-
-        // if they asked for a full block and we got a full block,
-        // and the block we got is properly aligned and not already cached,
-        // then let's cache it!
-        const bool isCacheable = (data.getCapacity() == cacheBlockSize) &&
-                                 (numRead == cacheBlockSize) &&
-                                 (currentPointIndex % cacheBlockSize == 0);
-        if (isCacheable && (m_filter.lookupInCache(currentPointIndex) == NULL))
+        block = fetchBlock(blockNum);
+        for (boost::uint32_t n = 1; block && n <= m_filter.getPrefetchBlocks(); ++n)
         {
-            m_filter.addToCache(currentPointIndex, data);
+            if (m_filter.lookupBlock(blockNum + n))
+                continue;
+            if (!fetchBlock(blockNum + n))
+                break;
         }
+    }
 
-        m_filter.updateStats(numRead, data.getCapacity());
+    m_lastBlockNum = blockNum;
+    m_lastBlock = block;
 
-        return numRead;
-    }
+    return block;
+}
 
-    // they asked for just one point -- first, check Mister Cache
-    const PointBuffer* block = m_filter.lookupInCache(currentPointIndex);
-    if (block != NULL)
-    {
-        // A hit! A palpable hit!
-        data.copyPointFast(0,  currentPointIndex % cacheBlockSize, *block);
 
-        m_filter.updateStats(0, 1);
+pdal::filters::Cache::Block Cache::fetchBlock(boost::uint64_t blockNum)
+{
+    const boost::uint32_t blockSize = m_filter.getCacheBlockSize();
+    const boost::uint64_t start = blockNum * blockSize;
 
-        return 1;
-    }
+    if (m_filter.getPointCountType() == PointCount_Fixed &&
+            start >= m_filter.getNumPoints())
+        return pdal::filters::Cache::Block();
 
-    // Not in the cache, so do a normal read :-(
-    const boost::uint32_t numRead = getPrevIterator().read(data);
-    m_filter.updateStats(numRead, numRead);
+    StageRandomIterator& prev = getPrevIterator();
+    if (prev.seek(start) != start)
+        return pdal::filters::Cache::Block();
 
-    return numRead;
+    PointBuffer* buffer = new PointBuffer(m_filter.getSchema(), blockSize);
+    const boost::uint32_t numRead = prev.read(*buffer);
+    m_filter.updateStats(numRead, 0);
+    if (numRead == 0)
+    {
+        delete buffer;
+        return pdal::filters::Cache::Block();
+    }
+
+    return m_filter.insertBlock(blockNum, buffer);
 }
 
 
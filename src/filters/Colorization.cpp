@@ -36,7 +36,10 @@
 
 #include <boost/concept_check.hpp> // ignore_unused_variable_warning
 
+#include <boost/bind.hpp>
+
 #include <algorithm>
+#include <cmath>
 
 #include <pdal/PointBuffer.hpp>
 
@@ -63,8 +66,146 @@ struct GDALSourceDeleter
 };
 #endif
 
+
+namespace colorization
+{
+
+
+TileCache::TileCache(Loader loader,
+                     boost::int32_t rasterXSize,
+                     boost::int32_t rasterYSize,
+                     boost::int32_t blockXSize,
+                     boost::int32_t blockYSize,
+                     boost::uint32_t numBands,
+                     boost::uint32_t maxTiles)
+    : m_loader(loader)
+    , m_rasterXSize(rasterXSize)
+    , m_rasterYSize(rasterYSize)
+    , m_blockXSize(std::max<boost::int32_t>(blockXSize, 1))
+    , m_blockYSize(std::max<boost::int32_t>(blockYSize, 1))
+    , m_numBands(numBands)
+    , m_maxTiles(std::max<boost::uint32_t>(maxTiles, 1))
+    , m_lastKey(-1, -1)
+    , m_lastTile(0)
+    , m_numHits(0)
+    , m_numMisses(0)
+{
+    return;
+}
+
+
+const double* TileCache::getTile(boost::int32_t blockX, boost::int32_t blockY)
+{
+    const Key key(blockX, blockY);
+    if (m_lastTile && key == m_lastKey)
+    {
+        ++m_numHits;
+        return m_lastTile;
+    }
+
+    std::map<Key, Tile>::iterator i = m_tiles.find(key);
+    if (i != m_tiles.end())
+    {
+        ++m_numHits;
+        m_lru.splice(m_lru.begin(), m_lru, i->second.lru);
+    }
+    else
+    {
+        ++m_numMisses;
+
+        // reuse the storage of the least recently used tile, if full
+        std::vector<double> data;
+        if (m_tiles.size() >= m_maxTiles)
+        {
+            std::map<Key, Tile>::iterator victim = m_tiles.find(m_lru.back());
+            data.swap(victim->second.data);
+            m_tiles.erase(victim);
+            m_lru.pop_back();
+        }
+        data.resize(static_cast<std::size_t>(m_blockXSize) * m_blockYSize * m_numBands);
+        m_loader(blockX, blockY, &data.front());
+
+        m_lru.push_front(key);
+        i = m_tiles.insert(std::make_pair(key, Tile())).first;
+        i->second.data.swap(data);
+        i->second.lru = m_lru.begin();
+    }
+
+    m_lastKey = key;
+    m_lastTile = &i->second.data.front();
+    return m_lastTile;
+}
+
+
+boost::uint64_t TileCache::getTileIndex(double pixel, double line) const
+{
+    const boost::uint64_t blockX = static_cast<boost::uint64_t>(std::floor(pixel)) / m_blockXSize;
+    const boost::uint64_t blockY = static_cast<boost::uint64_t>(std::floor(line)) / m_blockYSize;
+    return (blockY << 32) | blockX;
+}
+
+
+double TileCache::getPixel(boost::int32_t pixel, boost::int32_t line, boost::uint32_t band)
+{
+    const double* tile = getTile(pixel / m_blockXSize, line / m_blockYSize);
+    const std::size_t offset = static_cast<std::size_t>(band) * m_blockXSize * m_blockYSize +
+                               static_cast<std::size_t>(line % m_blockYSize) * m_blockXSize +
+                               pixel % m_blockXSize;
+    return tile[offset];
+}
+
+
+bool TileCache::getNearest(double pixel, double line, double* values)
+{
+    if (!contains(pixel, line))
+        return false;
+
+    const boost::int32_t x = static_cast<boost::int32_t>(pixel);
+    const boost::int32_t y = static_cast<boost::int32_t>(line);
+    for (boost::uint32_t band = 0; band < m_numBands; ++band)
+        values[band] = getPixel(x, y, band);
+
+    return true;
+}
+
+
+bool TileCache::getBilinear(double pixel, double line, double* values)
+{
+    if (!contains(pixel, line))
+        return false;
+
+    // pixel centres are at half-integer positions
+    const double px = pixel - 0.5;
+    const double py = line - 0.5;
+    const double fx = std::floor(px);
+    const double fy = std::floor(py);
+    const double u = px - fx;
+    const double v = py - fy;
+
+    const boost::int32_t x0 = std::max<boost::int32_t>(static_cast<boost::int32_t>(fx), 0);
+    const boost::int32_t y0 = std::max<boost::int32_t>(static_cast<boost::int32_t>(fy), 0);
+    const boost::int32_t x1 = std::min<boost::int32_t>(static_cast<boost::int32_t>(fx) + 1, m_rasterXSize - 1);
+    const boost::int32_t y1 = std::min<boost::int32_t>(static_cast<boost::int32_t>(fy) + 1, m_rasterYSize - 1);
+
+    for (boost::uint32_t band = 0; band < m_numBands; ++band)
+    {
+        const double top = (1.0 - u) * getPixel(x0, y0, band) + u * getPixel(x1, y0, band);
+        const double bottom = (1.0 - u) * getPixel(x0, y1, band) + u * getPixel(x1, y1, band);
+        values[band] = (1.0 - v) * top + v * bottom;
+    }
+
+    return true;
+}
+
+
+} // colorization
+
+
 Colorization::Colorization(Stage& prevStage, const Options& options)
     : pdal::Filter(prevStage, options)
+    , m_scale(0)
+    , m_tileCacheSize(16)
+    , m_bilinear(false)
 {
     return;
 }
@@ -131,6 +272,8 @@ const Options Colorization::getDefaultOptions() const
     blue.setOptions(blueO);
 
     pdal::Option reproject("reproject", false, "Reproject the input data into the same coordinate system as the raster?");
+    pdal::Option interpolation("interpolation", std::string("nearest"), "Raster sampling: 'nearest' pixel or 'bilinear' interpolation of the four nearest pixel centres");
+    pdal::Option tile_cache_size("tile_cache_size", 16, "Number of raster blocks, with all bands, to keep in memory");
 
     options.add(x);
     options.add(y);
@@ -138,6 +281,8 @@ const Options Colorization::getDefaultOptions() const
     options.add(green);
     options.add(blue);
     options.add(reproject);
+    options.add(interpolation);
+    options.add(tile_cache_size);
 
 
     return options;
@@ -148,6 +293,23 @@ void Colorization::collectOptions()
 
     Options options = getOptions();
 
+    m_tileCacheSize = options.getValueOrDefault<boost::uint32_t>("tile_cache_size", 16);
+    std::string interpolation = options.getValueOrDefault<std::string>("interpolation", "nearest");
+    if (interpolation == "bilinear")
+    {
+        m_bilinear = true;
+    }
+    else if (interpolation == "nearest")
+    {
+        m_bilinear = false;
+    }
+    else
+    {
+        std::ostringstream oss;
+        oss << "Unknown interpolation '" << interpolation << "' for filters.colorization";
+        throw pdal_error(oss.str());
+    }
+
     std::vector<Option> dimensions = options.getOptions("dimension");
     std::vector<Option>::const_iterator i;
 
@@ -215,19 +377,10 @@ namespace sequential
 
 Colorization::Colorization(const pdal::filters::Colorization& filter, PointBuffer& buffer)
     : pdal::FilterSequentialIterator(filter, buffer)
+    , m_dimX(0)
+    , m_dimY(0)
     , m_stage(filter)
 {
-    return;
-}
-
-void Colorization::readBufferBeginImpl(PointBuffer& buffer)
-{
-    // Cache dimension positions
-
-    pdal::Schema const& schema = buffer.getSchema();
-    m_dimX = &(schema.getDimension(m_stage.getOptions().getValueOrDefault<std::string>("x_dim", "X")));
-    m_dimY = &(schema.getDimension(m_stage.getOptions().getValueOrDefault<std::string>("y_dim", "Y")));
-
     std::map<std::string, boost::uint32_t> band_map = m_stage.getBandMap();
     std::map<std::string, double> scale_map = m_stage.getScaleMap();
 
@@ -235,49 +388,105 @@ void Colorization::readBufferBeginImpl(PointBuffer& buffer)
             i != band_map.end();
             ++i)
     {
-        pdal::Dimension const* dim = &(schema.getDimension(i->first));
-        m_dimensions.push_back(dim);
-        m_bands.push_back(static_cast<boost::uint32_t>(i->second));
+        m_names.push_back(i->first);
+        m_bands.push_back(static_cast<int>(i->second));
         std::map<std::string, double>::const_iterator t = scale_map.find(i->first);
         double scale(1.0);
         if (t != scale_map.end())
             scale = t->second;
         m_scales.push_back(scale);
     }
+    m_values.resize(m_bands.size());
 
+#ifdef PDAL_HAVE_GDAL
+    GDALDatasetH ds = m_stage.getDataSource().get();
+    if (m_bands.empty() || ds == NULL)
+        return;
 
+    const int numBands = GDALGetRasterCount(ds);
+    for (std::vector<int>::size_type i = 0; i < m_bands.size(); i++)
+    {
+        if (m_bands[i] < 1 || m_bands[i] > numBands)
+        {
+            std::ostringstream oss;
+            oss << "Unable to get band " << m_bands[i] << " from data source!";
+            throw pdal_error(oss.str());
+        }
+    }
+
+    const int xSize = GDALGetRasterXSize(ds);
+    const int ySize = GDALGetRasterYSize(ds);
+    int blockXSize(0);
+    int blockYSize(0);
+    GDALGetBlockSize(GDALGetRasterBand(ds, m_bands[0]), &blockXSize, &blockYSize);
+    blockXSize = std::min(std::max(blockXSize, 1), xSize);
+    blockYSize = std::min(std::max(blockYSize, 1), ySize);
+
+    // Stripped rasters have blocks of a few lines; read several at once.
+    while (blockYSize < ySize && blockXSize * blockYSize < 256 * 256)
+        blockYSize = std::min(blockYSize * 2, ySize);
+
+    m_cache = boost::shared_ptr<colorization::TileCache>(
+        new colorization::TileCache(boost::bind(&Colorization::loadTile, this, _1, _2, _3),
+                                    xSize, ySize, blockXSize, blockYSize,
+                                    static_cast<boost::uint32_t>(m_bands.size()),
+                                    m_stage.getTileCacheSize()));
+#endif
+
+    return;
 }
 
-// Determines the pixel/line position given an x/y.
-// No reprojection is done at this time.
-bool Colorization::getPixelAndLinePosition(double x,
-        double y,
-        boost::array<double, 6> const& inverse,
-        boost::int32_t& pixel,
-        boost::int32_t& line,
-        colorization::DataSourcePtr ds)
+void Colorization::readBufferBeginImpl(PointBuffer& buffer)
+{
+    // Cache dimension positions
+
+    pdal::Schema const& schema = buffer.getSchema();
+    m_dimX = &(schema.getDimension(m_stage.getOptions().getValueOrDefault<std::string>("x_dim", "X")));
+    m_dimY = &(schema.getDimension(m_stage.getOptions().getValueOrDefault<std::string>("y_dim", "Y")));
+
+    m_dimensions.clear();
+    for (std::vector<std::string>::const_iterator i = m_names.begin(); i != m_names.end(); ++i)
+    {
+        m_dimensions.push_back(&(schema.getDimension(*i)));
+    }
+
+    return;
+}
+
+
+// Reads a whole block, all bands at once, into the tile cache.
+void Colorization::loadTile(boost::int32_t blockX, boost::int32_t blockY, double* data)
 {
 #ifdef PDAL_HAVE_GDAL
-    pixel = (boost::int32_t) std::floor(
-                inverse[0]
-                + inverse[1] * x
-                + inverse[2] * y);
-    line = (boost::int32_t) std::floor(
-               inverse[3]
-               + inverse[4] * x
-               + inverse[5] * y);
-
-    if (pixel < 0 || line < 0
-            || pixel >= GDALGetRasterXSize(ds.get())
-            || line  >= GDALGetRasterYSize(ds.get())
-       )
+    GDALDatasetH ds = m_stage.getDataSource().get();
+
+    const int blockXSize = m_cache->getBlockXSize();
+    const int blockYSize = m_cache->getBlockYSize();
+    const int xOff = blockX * blockXSize;
+    const int yOff = blockY * blockYSize;
+    const int width = std::min(blockXSize, GDALGetRasterXSize(ds) - xOff);
+    const int height = std::min(blockYSize, GDALGetRasterYSize(ds) - yOff);
+
+    CPLErr err = GDALDatasetRasterIO(ds, GF_Read, xOff, yOff, width, height,
+                                     data, width, height, GDT_Float64,
+                                     static_cast<int>(m_bands.size()), &m_bands.front(),
+                                     static_cast<int>(sizeof(double)),
+                                     static_cast<int>(sizeof(double)) * blockXSize,
+                                     static_cast<int>(sizeof(double)) * blockXSize * blockYSize);
+    if (err != CE_None)
     {
-        // The x, y is not coincident with this raster
-        return false;
+        std::ostringstream oss;
+        oss << "Unable to read raster block at pixel " << xOff << ", line " << yOff
+            << ": " << CPLGetLastErrorMsg();
+        throw pdal_error(oss.str());
     }
+#else
+    boost::ignore_unused_variable_warning(blockX);
+    boost::ignore_unused_variable_warning(blockY);
+    boost::ignore_unused_variable_warning(data);
 #endif
 
-    return true;
+    return;
 }
 
 
@@ -285,53 +494,50 @@ boost::uint32_t Colorization::readBufferImpl(PointBuffer& data)
 {
     const boost::uint32_t numRead = getPrevIterator().read(data);
 
-#ifdef PDAL_HAVE_GDAL
+    if (!m_cache)
+        return numRead;
 
     boost::array<double, 6> inverse = m_stage.getInverseTransform();
 
-    colorization::DataSourcePtr ds = m_stage.getDataSource();
-
-    boost::int32_t pixel(0);
-    boost::int32_t line(0);
-    double x(0.0);
-    double y(0.0);
-    bool fetched(false);
-
-    boost::array<double, 2> pix;
-    pix.assign(0.0);
-
+    // Find each point's pixel, then visit the points block by block so
+    // each block is read at most once per buffer.
+    m_pixels.resize(numRead);
+    m_lines.resize(numRead);
+    m_order.clear();
     for (boost::uint32_t pointIndex=0; pointIndex<numRead; pointIndex++)
     {
-        x = getScaledValue(data, *m_dimX, pointIndex);
-        y = getScaledValue(data, *m_dimY, pointIndex);
+        const double x = getScaledValue(data, *m_dimX, pointIndex);
+        const double y = getScaledValue(data, *m_dimY, pointIndex);
+
+        const double pixel = inverse[0] + inverse[1] * x + inverse[2] * y;
+        const double line = inverse[3] + inverse[4] * x + inverse[5] * y;
 
-        fetched = getPixelAndLinePosition(x, y, inverse, pixel, line, ds);
-        if (!fetched)
+        // points that are not coincident with this raster are left alone
+        if (!m_cache->contains(pixel, line))
             continue;
 
-        for (std::vector<boost::int32_t>::size_type i = 0;
-                i < m_bands.size(); i++)
-        {
-            GDALRasterBandH hBand = GDALGetRasterBand(ds.get(), m_bands[i]);
-            if (hBand == NULL)
-            {
-                std::ostringstream oss;
-                oss << "Unable to get band " << m_bands[i] << " from data source!";
-                throw pdal_error(oss.str());
-            }
-            if (GDALRasterIO(hBand, GF_Read, pixel, line, 1, 1,
-                             &pix[0], 1, 1, GDT_CFloat64, 0, 0) == CE_None)
-            {
+        m_pixels[pointIndex] = pixel;
+        m_lines[pointIndex] = line;
+        m_order.push_back(std::make_pair(m_cache->getTileIndex(pixel, line), pointIndex));
+    }
 
-                double output = pix[0];
-                output = output * m_scales[i];
-                setScaledValue(data, output, *m_dimensions[i], pointIndex);
-            }
-        }
+    std::sort(m_order.begin(), m_order.end());
+
+    const bool bilinear = m_stage.isBilinear();
+    for (std::size_t o = 0; o < m_order.size(); o++)
+    {
+        const boost::uint32_t pointIndex = m_order[o].second;
+        if (bilinear)
+            m_cache->getBilinear(m_pixels[pointIndex], m_lines[pointIndex], &m_values.front());
+        else
+            m_cache->getNearest(m_pixels[pointIndex], m_lines[pointIndex], &m_values.front());
 
+        for (std::vector<double>::size_type i = 0; i < m_values.size(); i++)
+        {
+            setScaledValue(data, m_values[i] * m_scales[i], *m_dimensions[i], pointIndex);
+        }
     }
 
-#endif
     return numRead;
 }
 
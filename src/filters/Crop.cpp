@@ -35,6 +35,14 @@
 #include <pdal/filters/Crop.hpp>
 
 #include <pdal/PointBuffer.hpp>
+#include <pdal/Schema.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <sstream>
 
 namespace pdal
@@ -42,121 +50,1051 @@ namespace pdal
 namespace filters
 {
 
+namespace crop
+{
 
-Crop::Crop(Stage& prevStage, const Options& options)
-    : pdal::Filter(prevStage, options)
-    , m_bounds(options.getValueOrThrow<Bounds<double> >("bounds"))
+namespace
+{
+
+template <typename T>
+void testSigned(boost::uint8_t const* data, std::size_t stride, boost::uint32_t count,
+                Plan::Test const& test, boost::uint8_t* mask)
 {
+    const T lower = static_cast<T>(test.lowerSigned);
+    const T upper = static_cast<T>(test.upperSigned);
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        T v;
+        std::memcpy(&v, data + i * stride, sizeof(T));
+        mask[i] &= static_cast<boost::uint8_t>((v >= lower) & (v <= upper));
+    }
     return;
 }
 
+template <typename T>
+void testUnsigned(boost::uint8_t const* data, std::size_t stride, boost::uint32_t count,
+                  Plan::Test const& test, boost::uint8_t* mask)
+{
+    const T lower = static_cast<T>(test.lowerUnsigned);
+    const T upper = static_cast<T>(test.upperUnsigned);
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        T v;
+        std::memcpy(&v, data + i * stride, sizeof(T));
+        mask[i] &= static_cast<boost::uint8_t>((v >= lower) & (v <= upper));
+    }
+    return;
+}
 
-Crop::Crop(Stage& prevStage, Bounds<double> const& bounds)
-    : Filter(prevStage, Options::none())
-    , m_bounds(bounds)
+// floating point dimensions are not scaled
+template <typename T>
+void testFloat(boost::uint8_t const* data, std::size_t stride, boost::uint32_t count,
+               Plan::Test const& test, boost::uint8_t* mask)
 {
+    const double lower = test.lower;
+    const double upper = test.upper;
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        T v;
+        std::memcpy(&v, data + i * stride, sizeof(T));
+        const double d = static_cast<double>(v);
+        mask[i] &= static_cast<boost::uint8_t>((lower <= d) & (d <= upper));
+    }
     return;
 }
 
 
-void Crop::initialize()
+template <typename T>
+T clampTo(double v)
 {
-    Filter::initialize();
+    if (v <= static_cast<double>((std::numeric_limits<T>::min)()))
+        return (std::numeric_limits<T>::min)();
+    if (v >= static_cast<double>((std::numeric_limits<T>::max)()))
+        return (std::numeric_limits<T>::max)();
+    return static_cast<T>(v);
+}
+
+template <typename T>
+bool isInside(Dimension const& d, T raw, double lower, double upper)
+{
+    const double v = d.applyScaling<T>(raw);
+    return lower <= v && v <= upper;
+}
 
-    this->setBounds(m_bounds);
+// Finds the raw values of d whose scaled values are within
+// [lower, upper], as Dimension::applyScaling computes them.  Returns false
+// if there are none.
+template <typename T, typename Limit>
+bool getRawRange(Dimension const& d, double lower, double upper, Limit& rawLower, Limit& rawUpper)
+{
+    const T tmin = (std::numeric_limits<T>::min)();
+    const T tmax = (std::numeric_limits<T>::max)();
+    const double scale = d.getNumericScale();
+    const double offset = d.getNumericOffset();
 
-    this->setNumPoints(0);
-    this->setPointCountType(PointCount_Unknown);
+    if (!(lower <= upper))
+        return false;
 
-    return;
+    if (!(scale > 0.0) && !(scale < 0.0))
+    {
+        if (!(lower <= offset && offset <= upper))
+            return false;
+        rawLower = tmin;
+        rawUpper = tmax;
+        return true;
+    }
+
+    double a = (lower - offset) / scale;
+    double b = (upper - offset) / scale;
+    if (scale < 0.0)
+        std::swap(a, b);
+
+    T lo = clampTo<T>(std::ceil(a));
+    T hi = clampTo<T>(std::floor(b));
+
+    // the division and applyScaling round differently; nudge the ends by
+    // the odd raw value
+    for (int i = 0; i < 4 && lo > tmin && isInside<T>(d, static_cast<T>(lo - 1), lower, upper); ++i)
+        --lo;
+    for (int i = 0; i < 4 && lo < hi && !isInside<T>(d, lo, lower, upper); ++i)
+        ++lo;
+    for (int i = 0; i < 4 && hi < tmax && isInside<T>(d, static_cast<T>(hi + 1), lower, upper); ++i)
+        ++hi;
+    for (int i = 0; i < 4 && hi > lo && !isInside<T>(d, hi, lower, upper); ++i)
+        --hi;
+
+    if (lo > hi || !isInside<T>(d, lo, lower, upper) || !isInside<T>(d, hi, lower, upper))
+        return false;
+
+    rawLower = static_cast<Limit>(lo);
+    rawUpper = static_cast<Limit>(hi);
+    return true;
 }
 
+template <typename T>
+double readCoordinate(boost::uint8_t const* point, Coordinate const& coordinate)
+{
+    T v;
+    std::memcpy(&v, point + coordinate.offset, sizeof(T));
+    return static_cast<double>(v) * coordinate.scale + coordinate.shift;
+}
 
-const Options Crop::getDefaultOptions() const
+double readNothing(boost::uint8_t const*, Coordinate const&)
 {
-    Options options;
-    Option bounds("bounds",Bounds<double>(),"bounds to crop to");
-    options.add(bounds);
-    return options;
+    return 0.0;
 }
 
 
-const Bounds<double>& Crop::getBounds() const
+// A grid with about cellsPerItem cells for each of numItems items, at most
+// maxCells on a side.
+boost::uint32_t getGridSize(std::size_t numItems, boost::uint32_t maxCells)
 {
-    return m_bounds;
+    const double side = std::ceil(std::sqrt(static_cast<double>(numItems)) * 2.0);
+    return static_cast<boost::uint32_t>((std::max)(1.0, (std::min)(side, static_cast<double>(maxCells))));
 }
 
 
-// append all points from src buffer to end of dst buffer, based on the our bounds
-boost::uint32_t Crop::processBuffer(PointBuffer& dstData, const PointBuffer& srcData) const
+// Just enough of a WKT reader for POLYGON and MULTIPOLYGON.
+class WKTReader
 {
-    const Schema& schema = dstData.getSchema();
+public:
+    WKTReader(std::string const& wkt)
+        : m_wkt(wkt)
+        , m_pos(0)
+    {}
 
-    const Bounds<double>& bounds = this->getBounds();
+    std::string readWord()
+    {
+        skipSpace();
+        std::string word;
+        while (m_pos < m_wkt.size() && std::isalpha(static_cast<unsigned char>(m_wkt[m_pos])))
+            word += static_cast<char>(std::toupper(static_cast<unsigned char>(m_wkt[m_pos++])));
+        return word;
+    }
 
-    boost::uint32_t numSrcPoints = srcData.getNumPoints();
-    boost::uint32_t dstIndex = dstData.getNumPoints();
+    bool consume(char c)
+    {
+        skipSpace();
+        if (m_pos < m_wkt.size() && m_wkt[m_pos] == c)
+        {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
 
-    boost::uint32_t numPointsAdded = 0;
+    void expect(char c)
+    {
+        if (!consume(c))
+        {
+            std::ostringstream oss;
+            oss << "expected '" << c << "'";
+            error(oss.str());
+        }
+    }
+
+    bool atEnd()
+    {
+        skipSpace();
+        return m_pos == m_wkt.size();
+    }
+
+    // ( x y [z [m]], ... ), keeping x and y
+    void readRing(std::vector<double>& ring)
+    {
+        ring.clear();
+        expect('(');
+        do
+        {
+            const double x = readNumber();
+            const double y = readNumber();
+            // skip any Z and M
+            while (!peek(',') && !peek(')'))
+                readNumber();
+            ring.push_back(x);
+            ring.push_back(y);
+        }
+        while (consume(','));
+        expect(')');
+    }
+
+    void error(std::string const& what) const
+    {
+        std::ostringstream oss;
+        oss << "Unable to read WKT polygon: " << what << " at position " << m_pos;
+        throw pdal_error(oss.str());
+    }
 
-    boost::optional<Dimension const&> dimX = schema.getDimension("X");
-    boost::optional<Dimension const&> dimY = schema.getDimension("Y");
-    boost::optional<Dimension const&> dimZ = schema.getDimension("Z");
+private:
+    void skipSpace()
+    {
+        while (m_pos < m_wkt.size() && std::isspace(static_cast<unsigned char>(m_wkt[m_pos])))
+            ++m_pos;
+    }
 
-    for (boost::uint32_t srcIndex=0; srcIndex<numSrcPoints; srcIndex++)
+    bool peek(char c)
     {
-        // need to scale the values
-        double x(0.0);
-        double y(0.0);
-        double z(0.0);
+        skipSpace();
+        return m_pos < m_wkt.size() && m_wkt[m_pos] == c;
+    }
+
+    double readNumber()
+    {
+        skipSpace();
+        const char* start = m_wkt.c_str() + m_pos;
+        char* end = 0;
+        const double value = std::strtod(start, &end);
+        if (end == start)
+            error("expected a number");
+        m_pos += static_cast<std::size_t>(end - start);
+        return value;
+    }
+
+    std::string const& m_wkt;
+    std::size_t m_pos;
+};
+
+} // anonymous namespace
+
 
-        if (dimX->getInterpretation() == dimension::SignedInteger)
+// ------------------------------------------------------------------------
+
+Polygon::Polygon()
+    : m_minX(0.0)
+    , m_minY(0.0)
+    , m_cellWidth(1.0)
+    , m_cellHeight(1.0)
+    , m_numColumns(0)
+    , m_numRows(0)
+{
+    return;
+}
+
+
+Polygon::Polygon(std::string const& wkt)
+    : m_minX(0.0)
+    , m_minY(0.0)
+    , m_cellWidth(1.0)
+    , m_cellHeight(1.0)
+    , m_numColumns(0)
+    , m_numRows(0)
+{
+    WKTReader reader(wkt);
+
+    const std::string type = reader.readWord();
+    if (type != "POLYGON" && type != "MULTIPOLYGON")
+        reader.error("expected POLYGON or MULTIPOLYGON");
+    const bool multi = (type == "MULTIPOLYGON");
+
+    std::string word = reader.readWord();
+    if (word == "Z" || word == "M" || word == "ZM")
+        word = reader.readWord();
+
+    if (word == "EMPTY")
+    {
+        if (!reader.atEnd())
+            reader.error("unexpected text after EMPTY");
+        return;
+    }
+    if (!word.empty())
+        reader.error("unexpected '" + word + "'");
+
+    std::vector<double> ring;
+    reader.expect('(');
+    do
+    {
+        if (multi)
+            reader.expect('(');
+        do
         {
-            boost::int32_t xi = srcData.getField<boost::int32_t>(*dimX, srcIndex);
-            boost::int32_t yi = srcData.getField<boost::int32_t>(*dimY, srcIndex);
-            boost::int32_t zi = srcData.getField<boost::int32_t>(*dimZ, srcIndex);
+            reader.readRing(ring);
+            addRing(ring);
+        }
+        while (reader.consume(','));
+        if (multi)
+            reader.expect(')');
+    }
+    while (multi && reader.consume(','));
+    reader.expect(')');
+
+    if (!reader.atEnd())
+        reader.error("unexpected text after the polygon");
+
+    buildIndex();
+
+    return;
+}
+
+
+void Polygon::addRing(std::vector<double> const& ring)
+{
+    const std::size_t numPoints = ring.size() / 2;
+    if (numPoints < 3)
+        throw pdal_error("Unable to read WKT polygon: a ring needs at least three points");
+
+    for (std::size_t i = 0; i < numPoints; ++i)
+    {
+        // rings are closed in WKT, but close them anyway
+        const std::size_t j = (i + 1) % numPoints;
+
+        Edge edge;
+        edge.x0 = ring[2 * i];
+        edge.y0 = ring[2 * i + 1];
+        edge.x1 = ring[2 * j];
+        edge.y1 = ring[2 * j + 1];
+        // skip repeated points
+        if (!(edge.x0 < edge.x1) && !(edge.x0 > edge.x1) &&
+                !(edge.y0 < edge.y1) && !(edge.y0 > edge.y1))
+            continue;
+        m_edges.push_back(edge);
+    }
+
+    return;
+}
+
+
+boost::uint32_t Polygon::getColumn(double x) const
+{
+    const double column = std::floor((x - m_minX) / m_cellWidth);
+    if (!(column > 0.0))
+        return 0;
+    return (std::min)(static_cast<boost::uint32_t>((std::min)(column, 4294967295.0)), m_numColumns - 1);
+}
+
+
+boost::uint32_t Polygon::getRow(double y) const
+{
+    const double row = std::floor((y - m_minY) / m_cellHeight);
+    if (!(row > 0.0))
+        return 0;
+    return (std::min)(static_cast<boost::uint32_t>((std::min)(row, 4294967295.0)), m_numRows - 1);
+}
+
+
+void Polygon::buildIndex()
+{
+    if (m_edges.empty())
+        return;
+
+    double minX = m_edges[0].x0;
+    double minY = m_edges[0].y0;
+    double maxX = minX;
+    double maxY = minY;
+    for (std::vector<Edge>::const_iterator e = m_edges.begin(); e != m_edges.end(); ++e)
+    {
+        minX = (std::min)(minX, (std::min)(e->x0, e->x1));
+        maxX = (std::max)(maxX, (std::max)(e->x0, e->x1));
+        minY = (std::min)(minY, (std::min)(e->y0, e->y1));
+        maxY = (std::max)(maxY, (std::max)(e->y0, e->y1));
+    }
+    m_bounds = Bounds<double>(minX, minY, maxX, maxY);
+
+    const boost::uint32_t size = getGridSize(m_edges.size(), 1024);
+    m_minX = minX;
+    m_minY = minY;
+    m_numColumns = maxX > minX ? size : 1;
+    m_numRows = maxY > minY ? size : 1;
+    m_cellWidth = maxX > minX ? (maxX - minX) / m_numColumns : 1.0;
+    m_cellHeight = maxY > minY ? (maxY - minY) / m_numRows : 1.0;
+
+    // Rows list every edge whose Y range overlaps them; bands are widened
+    // a little so rounding in getRow() can't lose an edge.
+    const double slackX = m_cellWidth * 1e-6;
+    const double slackY = m_cellHeight * 1e-6;
+    std::vector<std::vector<boost::uint32_t> > rows(m_numRows);
+    m_cells.assign(static_cast<std::size_t>(m_numRows) * m_numColumns, Cell_Outside);
+    std::vector<bool> boundary(m_cells.size(), false);
 
-            x = dimX->applyScaling(xi);
-            y = dimY->applyScaling(yi);
-            z = dimZ->applyScaling(zi);
+    for (std::size_t i = 0; i < m_edges.size(); ++i)
+    {
+        const Edge& e = m_edges[i];
+        const double lowY = (std::min)(e.y0, e.y1);
+        const double highY = (std::max)(e.y0, e.y1);
+        const boost::uint32_t firstRow = getRow(lowY - slackY);
+        const boost::uint32_t lastRow = getRow(highY + slackY);
+
+        for (boost::uint32_t row = firstRow; row <= lastRow; ++row)
+        {
+            rows[row].push_back(static_cast<boost::uint32_t>(i));
 
+            // the part of the edge within this row, and the cells it
+            // passes through
+            const double bandLow = (std::max)(lowY, m_minY + row * m_cellHeight - slackY);
+            const double bandHigh = (std::min)(highY, m_minY + (row + 1) * m_cellHeight + slackY);
+            double xa = e.x0;
+            double xb = e.x1;
+            if (e.y1 < e.y0 || e.y1 > e.y0)
+            {
+                xa = e.x0 + (bandLow - e.y0) * (e.x1 - e.x0) / (e.y1 - e.y0);
+                xb = e.x0 + (bandHigh - e.y0) * (e.x1 - e.x0) / (e.y1 - e.y0);
+            }
+            const boost::uint32_t firstColumn = getColumn((std::min)(xa, xb) - slackX);
+            const boost::uint32_t lastColumn = getColumn((std::max)(xa, xb) + slackX);
+            for (boost::uint32_t column = firstColumn; column <= lastColumn; ++column)
+                boundary[static_cast<std::size_t>(row) * m_numColumns + column] = true;
         }
-        else if (dimX->getInterpretation() == dimension::UnsignedInteger)
+    }
+
+    m_rowStart.assign(m_numRows + 1, 0);
+    m_rowEdges.clear();
+    for (boost::uint32_t row = 0; row < m_numRows; ++row)
+    {
+        m_rowStart[row] = static_cast<boost::uint32_t>(m_rowEdges.size());
+        m_rowEdges.insert(m_rowEdges.end(), rows[row].begin(), rows[row].end());
+    }
+    m_rowStart[m_numRows] = static_cast<boost::uint32_t>(m_rowEdges.size());
+
+    // No edge passes through the other cells, so their centres say
+    // whether all of them is inside.
+    for (boost::uint32_t row = 0; row < m_numRows; ++row)
+    {
+        for (boost::uint32_t column = 0; column < m_numColumns; ++column)
         {
-            boost::uint32_t xi = srcData.getField<boost::uint32_t>(*dimX, srcIndex);
-            boost::uint32_t yi = srcData.getField<boost::uint32_t>(*dimY, srcIndex);
-            boost::uint32_t zi = srcData.getField<boost::uint32_t>(*dimZ, srcIndex);
+            const std::size_t cell = static_cast<std::size_t>(row) * m_numColumns + column;
+            if (boundary[cell])
+            {
+                m_cells[cell] = Cell_Boundary;
+                continue;
+            }
+            const double x = m_minX + (column + 0.5) * m_cellWidth;
+            const double y = m_minY + (row + 0.5) * m_cellHeight;
+            m_cells[cell] = crossings(x, y, row) ? Cell_Inside : Cell_Outside;
+        }
+    }
+
+    return;
+}
 
-            x = dimX->applyScaling(xi);
-            y = dimY->applyScaling(yi);
-            z = dimZ->applyScaling(zi);
 
+// Casts a ray from (x, y) towards +X across the edges of the row,
+// returning true if it crosses an odd number of them.
+bool Polygon::crossings(double x, double y, boost::uint32_t row) const
+{
+    bool odd(false);
+    const boost::uint32_t end = m_rowStart[row + 1];
+    for (boost::uint32_t i = m_rowStart[row]; i < end; ++i)
+    {
+        const Edge& e = m_edges[m_rowEdges[i]];
+        if ((e.y0 > y) != (e.y1 > y))
+        {
+            const double crossing = e.x0 + (y - e.y0) * (e.x1 - e.x0) / (e.y1 - e.y0);
+            if (x < crossing)
+                odd = !odd;
         }
+    }
+    return odd;
+}
+
+
+bool Polygon::contains(double x, double y) const
+{
+    if (m_edges.empty())
+        return false;
+    if (!(x >= m_bounds.getMinimum(0) && x <= m_bounds.getMaximum(0) &&
+            y >= m_bounds.getMinimum(1) && y <= m_bounds.getMaximum(1)))
+        return false;
+
+    const boost::uint32_t row = getRow(y);
+    switch (m_cells[static_cast<std::size_t>(row) * m_numColumns + getColumn(x)])
+    {
+        case Cell_Inside:
+            return true;
+        case Cell_Outside:
+            return false;
+        default:
+            return crossings(x, y, row);
+    }
+}
+
+
+// ------------------------------------------------------------------------
+
+Router::Router(std::vector<Polygon> const& regions)
+    : m_regions(regions)
+    , m_minX(0.0)
+    , m_minY(0.0)
+    , m_cellWidth(1.0)
+    , m_cellHeight(1.0)
+    , m_numColumns(1)
+    , m_numRows(1)
+{
+    bool first(true);
+    for (std::vector<Polygon>::const_iterator r = m_regions.begin(); r != m_regions.end(); ++r)
+    {
+        if (r->empty())
+            continue;
+        if (first)
+            m_bounds = r->getBounds();
         else
+            m_bounds.grow(r->getBounds());
+        first = false;
+    }
+
+    m_cellStart.assign(2, 0);
+    if (first)
+        return;
+
+    const double minX = m_bounds.getMinimum(0);
+    const double minY = m_bounds.getMinimum(1);
+    const double maxX = m_bounds.getMaximum(0);
+    const double maxY = m_bounds.getMaximum(1);
+    const boost::uint32_t size = getGridSize(m_regions.size(), 256);
+    m_minX = minX;
+    m_minY = minY;
+    m_numColumns = maxX > minX ? size : 1;
+    m_numRows = maxY > minY ? size : 1;
+    m_cellWidth = maxX > minX ? (maxX - minX) / m_numColumns : 1.0;
+    m_cellHeight = maxY > minY ? (maxY - minY) / m_numRows : 1.0;
+
+    const std::size_t numCells = static_cast<std::size_t>(m_numColumns) * m_numRows;
+    std::vector<std::vector<boost::uint32_t> > cells(numCells);
+    for (std::size_t i = 0; i < m_regions.size(); ++i)
+    {
+        const Polygon& region = m_regions[i];
+        if (region.empty())
+            continue;
+
+        const Bounds<double>& b = region.getBounds();
+        const boost::uint32_t first = getCell(b.getMinimum(0), b.getMinimum(1));
+        const boost::uint32_t last = getCell(b.getMaximum(0), b.getMaximum(1));
+        for (boost::uint32_t row = first / m_numColumns; row <= last / m_numColumns; ++row)
         {
-            x = srcData.getField<double>(*dimX, srcIndex);
-            y = srcData.getField<double>(*dimY, srcIndex);
-            z = srcData.getField<double>(*dimZ, srcIndex);
+            for (boost::uint32_t column = first % m_numColumns; column <= last % m_numColumns; ++column)
+                cells[static_cast<std::size_t>(row) * m_numColumns + column].push_back(static_cast<boost::uint32_t>(i));
+        }
+    }
 
+    m_cellStart.assign(numCells + 1, 0);
+    m_cellRegions.clear();
+    for (std::size_t cell = 0; cell < numCells; ++cell)
+    {
+        m_cellStart[cell] = static_cast<boost::uint32_t>(m_cellRegions.size());
+        m_cellRegions.insert(m_cellRegions.end(), cells[cell].begin(), cells[cell].end());
+    }
+    m_cellStart[numCells] = static_cast<boost::uint32_t>(m_cellRegions.size());
+
+    return;
+}
+
+
+boost::uint32_t Router::getCell(double x, double y) const
+{
+    const double column = std::floor((x - m_minX) / m_cellWidth);
+    const double row = std::floor((y - m_minY) / m_cellHeight);
+    const boost::uint32_t c = column > 0.0 ? (std::min)(static_cast<boost::uint32_t>((std::min)(column, 4294967295.0)), m_numColumns - 1) : 0;
+    const boost::uint32_t r = row > 0.0 ? (std::min)(static_cast<boost::uint32_t>((std::min)(row, 4294967295.0)), m_numRows - 1) : 0;
+    return r * m_numColumns + c;
+}
+
+
+bool Router::contains(double x, double y) const
+{
+    if (m_cellRegions.empty())
+        return false;
+    if (!(x >= m_bounds.getMinimum(0) && x <= m_bounds.getMaximum(0) &&
+            y >= m_bounds.getMinimum(1) && y <= m_bounds.getMaximum(1)))
+        return false;
+
+    const boost::uint32_t cell = getCell(x, y);
+    for (boost::uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i)
+    {
+        if (m_regions[m_cellRegions[i]].contains(x, y))
+            return true;
+    }
+    return false;
+}
+
+
+void Router::find(double x, double y, std::vector<std::size_t>& regions) const
+{
+    regions.clear();
+    if (m_cellRegions.empty())
+        return;
+    if (!(x >= m_bounds.getMinimum(0) && x <= m_bounds.getMaximum(0) &&
+            y >= m_bounds.getMinimum(1) && y <= m_bounds.getMaximum(1)))
+        return;
+
+    const boost::uint32_t cell = getCell(x, y);
+    for (boost::uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i)
+    {
+        if (m_regions[m_cellRegions[i]].contains(x, y))
+            regions.push_back(m_cellRegions[i]);
+    }
+    return;
+}
+
+
+boost::uint32_t Router::route(PointBuffer const& src, std::vector<PointBuffer*> const& outputs) const
+{
+    if (outputs.size() != m_regions.size())
+        throw pdal_error("crop::Router: need one output buffer per region");
+
+    Schema const& schema = src.getSchema();
+    const Coordinate x(schema.getDimension("X"));
+    const Coordinate y(schema.getDimension("Y"));
+
+    const boost::uint32_t numPoints = src.getNumPoints();
+    boost::uint32_t numRouted = 0;
+    std::vector<std::size_t> regions;
+    for (boost::uint32_t i = 0; i < numPoints; ++i)
+    {
+        boost::uint8_t const* point = src.getData(i);
+        find(x.read(point), y.read(point), regions);
+        if (regions.empty())
+            continue;
+
+        ++numRouted;
+        for (std::vector<std::size_t>::const_iterator r = regions.begin(); r != regions.end(); ++r)
+        {
+            PointBuffer& output = *outputs[*r];
+            const boost::uint32_t index = output.getNumPoints();
+            if (index >= output.getCapacity())
+            {
+                std::ostringstream oss;
+                oss << "crop::Router: the output buffer for region " << *r << " is full";
+                throw pdal_error(oss.str());
+            }
+            output.copyPointFast(index, i, src);
+            output.setNumPoints(index + 1);
         }
+    }
+
+    return numRouted;
+}
+
+
+// ------------------------------------------------------------------------
+
+Coordinate::Coordinate()
+    : function(&readNothing)
+    , offset(0)
+    , scale(1.0)
+    , shift(0.0)
+{
+    return;
+}
+
+
+Coordinate::Coordinate(Dimension const& dimension)
+    : function(0)
+    , offset(dimension.getByteOffset())
+    , scale(dimension.getNumericScale())
+    , shift(dimension.getNumericOffset())
+{
+    const boost::uint32_t size = dimension.getByteSize();
+    switch (dimension.getInterpretation())
+    {
+        case dimension::Float:
+            // floating point dimensions are not scaled
+            scale = 1.0;
+            shift = 0.0;
+            if (size == 4)
+                function = &readCoordinate<float>;
+            else if (size == 8)
+                function = &readCoordinate<double>;
+            break;
+        case dimension::SignedInteger:
+        case dimension::SignedByte:
+            if (size == 1)
+                function = &readCoordinate<boost::int8_t>;
+            else if (size == 2)
+                function = &readCoordinate<boost::int16_t>;
+            else if (size == 4)
+                function = &readCoordinate<boost::int32_t>;
+            else if (size == 8)
+                function = &readCoordinate<boost::int64_t>;
+            break;
+        case dimension::UnsignedInteger:
+        case dimension::UnsignedByte:
+            if (size == 1)
+                function = &readCoordinate<boost::uint8_t>;
+            else if (size == 2)
+                function = &readCoordinate<boost::uint16_t>;
+            else if (size == 4)
+                function = &readCoordinate<boost::uint32_t>;
+            else if (size == 8)
+                function = &readCoordinate<boost::uint64_t>;
+            break;
+        case dimension::Pointer:
+        case dimension::Undefined:
+            break;
+    }
+
+    if (function == 0)
+    {
+        std::ostringstream oss;
+        oss << "Unable to crop on dimension '" << dimension.getName() << "' of interpretation "
+            << dimension.getInterpretation() << " and size " << size;
+        throw pdal_error(oss.str());
+    }
 
-        Vector<double> point(x,y,z);
+    return;
+}
 
-        if (bounds.contains(point))
+
+// ------------------------------------------------------------------------
+
+
+Plan::Plan()
+    : m_outside(false)
+    , m_compiled(false)
+    , m_empty(false)
+{
+    return;
+}
+
+
+void Plan::compile(Bounds<double> const& bounds,
+                   Schema const& schema,
+                   boost::shared_ptr<Router> regions,
+                   bool outside)
+{
+    m_bounds = bounds;
+    m_regions = regions;
+    m_outside = outside;
+    m_tests.clear();
+    m_empty = false;
+    m_compiled = true;
+
+    if (m_regions)
+    {
+        m_x = Coordinate(schema.getDimension("X"));
+        m_y = Coordinate(schema.getDimension("Y"));
+    }
+
+    // nothing is inside bounds of any other dimensionality
+    const std::size_t numDimensions = bounds.size();
+    if (numDimensions != 2 && numDimensions != 3)
+    {
+        m_empty = true;
+        return;
+    }
+
+    const char* names[] = { "X", "Y", "Z" };
+    for (std::size_t i = 0; i < numDimensions; ++i)
+    {
+        Dimension const& d = schema.getDimension(names[i]);
+        const boost::uint32_t size = d.getByteSize();
+
+        Test test;
+        test.function = 0;
+        test.offset = d.getByteOffset();
+        test.lower = bounds.getMinimum(i);
+        test.upper = bounds.getMaximum(i);
+        test.lowerSigned = 0;
+        test.upperSigned = 0;
+        test.lowerUnsigned = 0;
+        test.upperUnsigned = 0;
+
+        bool ok(true);
+        switch (d.getInterpretation())
         {
-            dstData.copyPointFast(dstIndex, srcIndex, srcData);
-            dstData.setNumPoints(dstIndex+1);
-            ++dstIndex;
-            ++numPointsAdded;
+            case dimension::Float:
+                if (size == 4)
+                    test.function = &testFloat<float>;
+                else if (size == 8)
+                    test.function = &testFloat<double>;
+                ok = test.lower <= test.upper;
+                break;
+
+            case dimension::SignedInteger:
+            case dimension::SignedByte:
+                if (size == 1)
+                {
+                    test.function = &testSigned<boost::int8_t>;
+                    ok = getRawRange<boost::int8_t>(d, test.lower, test.upper, test.lowerSigned, test.upperSigned);
+                }
+                else if (size == 2)
+                {
+                    test.function = &testSigned<boost::int16_t>;
+                    ok = getRawRange<boost::int16_t>(d, test.lower, test.upper, test.lowerSigned, test.upperSigned);
+                }
+                else if (size == 4)
+                {
+                    test.function = &testSigned<boost::int32_t>;
+                    ok = getRawRange<boost::int32_t>(d, test.lower, test.upper, test.lowerSigned, test.upperSigned);
+                }
+                else if (size == 8)
+                {
+                    test.function = &testSigned<boost::int64_t>;
+                    ok = getRawRange<boost::int64_t>(d, test.lower, test.upper, test.lowerSigned, test.upperSigned);
+                }
+                break;
+
+            case dimension::UnsignedInteger:
+            case dimension::UnsignedByte:
+                if (size == 1)
+                {
+                    test.function = &testUnsigned<boost::uint8_t>;
+                    ok = getRawRange<boost::uint8_t>(d, test.lower, test.upper, test.lowerUnsigned, test.upperUnsigned);
+                }
+                else if (size == 2)
+                {
+                    test.function = &testUnsigned<boost::uint16_t>;
+                    ok = getRawRange<boost::uint16_t>(d, test.lower, test.upper, test.lowerUnsigned, test.upperUnsigned);
+                }
+                else if (size == 4)
+                {
+                    test.function = &testUnsigned<boost::uint32_t>;
+                    ok = getRawRange<boost::uint32_t>(d, test.lower, test.upper, test.lowerUnsigned, test.upperUnsigned);
+                }
+                else if (size == 8)
+                {
+                    test.function = &testUnsigned<boost::uint64_t>;
+                    ok = getRawRange<boost::uint64_t>(d, test.lower, test.upper, test.lowerUnsigned, test.upperUnsigned);
+                }
+                break;
+
+            case dimension::Pointer:
+            case dimension::Undefined:
+                break;
         }
+
+        if (test.function == 0)
+        {
+            std::ostringstream oss;
+            oss << "Unable to crop on dimension '" << d.getName() << "' of interpretation "
+                << d.getInterpretation() << " and size " << size;
+            throw pdal_error(oss.str());
+        }
+
+        if (!ok)
+            m_empty = true;
+        m_tests.push_back(test);
+    }
+
+    return;
+}
+
+
+Plan::Coverage Plan::getCoverage(Bounds<double> const& extent) const
+{
+    // A buffer starts out with the default extent, which is not an extent
+    // at all (its minimum is the smallest positive double); only bounds a
+    // stage actually set may decide a buffer.
+    if (extent.size() < m_bounds.size() || extent == Bounds<double>::getDefaultSpatialExtent())
+        return Coverage_Partial;
+
+    bool all(true);
+    for (std::size_t i = 0; i < m_bounds.size(); ++i)
+    {
+        const double lower = extent.getMinimum(i);
+        const double upper = extent.getMaximum(i);
+        if (!(lower <= upper))
+            return Coverage_Partial;
+
+        if (upper < m_bounds.getMinimum(i) || lower > m_bounds.getMaximum(i))
+            return Coverage_None;
+        if (!(m_bounds.getMinimum(i) <= lower && upper <= m_bounds.getMaximum(i)))
+            all = false;
+    }
+
+    return all ? Coverage_All : Coverage_Partial;
+}
+
+
+// Copies the points whose mask is keep a run at a time.
+boost::uint32_t Plan::copy(PointBuffer& dst, PointBuffer const& src, boost::uint8_t keep)
+{
+    const boost::uint32_t numSrcPoints = src.getNumPoints();
+    const boost::uint32_t dstIndex = dst.getNumPoints();
+
+    boost::uint32_t numPointsAdded = 0;
+    boost::uint32_t i = 0;
+    while (i < numSrcPoints)
+    {
+        if (m_mask[i] != keep)
+        {
+            ++i;
+            continue;
+        }
+
+        boost::uint32_t end = i;
+        while (end < numSrcPoints && m_mask[end] == keep)
+            ++end;
+
+        dst.copyPointsFast(dstIndex + numPointsAdded, i, src, end - i);
+        numPointsAdded += end - i;
+        i = end;
     }
 
-    assert(dstIndex <= dstData.getCapacity());
+    dst.setNumPoints(dstIndex + numPointsAdded);
+    assert(dst.getNumPoints() <= dst.getCapacity());
 
     return numPointsAdded;
 }
 
 
+boost::uint32_t Plan::apply(PointBuffer& dst, PointBuffer const& src)
+{
+    const boost::uint32_t numSrcPoints = src.getNumPoints();
+
+    if (numSrcPoints == 0)
+        return 0;
+
+    // Buffers that carry their extent may be decided wholesale.
+    const Coverage coverage = m_empty ? Coverage_None : getCoverage(src.getSpatialBounds());
+    const bool all = (coverage == Coverage_All && !m_regions);
+    if ((coverage == Coverage_None && !m_outside) || (all && m_outside))
+        return 0;
+
+    if ((coverage == Coverage_None && m_outside) || all)
+    {
+        m_mask.assign(numSrcPoints, 1);
+        return copy(dst, src, 1);
+    }
+
+    m_mask.assign(numSrcPoints, 1);
+    const std::size_t stride = src.getSchema().getByteSize();
+    boost::uint8_t const* data = src.getData(0);
+    for (std::vector<Test>::const_iterator t = m_tests.begin(); t != m_tests.end(); ++t)
+    {
+        t->function(data + t->offset, stride, numSrcPoints, *t, &m_mask.front());
+    }
+
+    // points inside the box are then tested against the regions
+    if (m_regions)
+    {
+        for (boost::uint32_t i = 0; i < numSrcPoints; ++i)
+        {
+            if (!m_mask[i])
+                continue;
+            boost::uint8_t const* point = data + i * stride;
+            m_mask[i] = m_regions->contains(m_x.read(point), m_y.read(point)) ? 1 : 0;
+        }
+    }
+
+    return copy(dst, src, m_outside ? 0 : 1);
+}
+
+} // crop
+
+
+Crop::Crop(Stage& prevStage, const Options& options)
+    : pdal::Filter(prevStage, options)
+    , m_outside(options.getValueOrDefault<bool>("outside", false))
+{
+    std::vector<Option> polygons = options.getOptions("polygon");
+    if (polygons.size())
+    {
+        std::vector<crop::Polygon> regions;
+        for (std::vector<Option>::const_iterator i = polygons.begin(); i != polygons.end(); ++i)
+        {
+            regions.push_back(crop::Polygon(i->getValue<std::string>()));
+        }
+        m_regions = boost::shared_ptr<crop::Router>(new crop::Router(regions));
+    }
+
+    // polygons alone crop to their extent first
+    if (m_regions && !options.hasOption("bounds"))
+        m_bounds = m_regions->getBounds();
+    else
+        m_bounds = options.getValueOrThrow<Bounds<double> >("bounds");
+
+    return;
+}
+
+
+Crop::Crop(Stage& prevStage, Bounds<double> const& bounds)
+    : Filter(prevStage, Options::none())
+    , m_bounds(bounds)
+    , m_outside(false)
+{
+    return;
+}
+
+
+Crop::Crop(Stage& prevStage, std::vector<crop::Polygon> const& polygons, bool outside)
+    : Filter(prevStage, Options::none())
+    , m_regions(new crop::Router(polygons))
+    , m_outside(outside)
+{
+    m_bounds = m_regions->getBounds();
+    return;
+}
+
+
+void Crop::initialize()
+{
+    Filter::initialize();
+
+    if (m_outside)
+        this->setBounds(getPrevStage().getBounds());
+    else
+        this->setBounds(m_bounds);
+
+    this->setNumPoints(0);
+    this->setPointCountType(PointCount_Unknown);
+
+    return;
+}
+
+
+const Options Crop::getDefaultOptions() const
+{
+    Options options;
+    Option bounds("bounds",Bounds<double>(),"bounds to crop to");
+    options.add(bounds);
+    return options;
+}
+
+
+const Bounds<double>& Crop::getBounds() const
+{
+    return m_bounds;
+}
+
+
+// append all points from src buffer to end of dst buffer, based on the our bounds
+boost::uint32_t Crop::processBuffer(PointBuffer& dstData, const PointBuffer& srcData) const
+{
+    crop::Plan plan;
+    plan.compile(getBounds(), dstData.getSchema(), m_regions, m_outside);
+
+    return plan.apply(dstData, srcData);
+}
+
+
 pdal::StageSequentialIterator* Crop::createSequentialIterator(PointBuffer& buffer) const
 {
     return new pdal::filters::iterators::sequential::Crop(*this, buffer);
@@ -183,6 +1121,17 @@ boost::uint64_t Crop::skipImpl(boost::uint64_t count)
 }
 
 
+void Crop::readBufferBeginImpl(PointBuffer& buffer)
+{
+    // We'll assume you're not changing the schema per-read call
+    if (!m_plan.isCompiled())
+        m_plan.compile(m_cropFilter.getBounds(), buffer.getSchema(),
+                       m_cropFilter.getRegions(), m_cropFilter.isOutside());
+
+    return;
+}
+
+
 boost::uint32_t Crop::readBufferImpl(PointBuffer& dstData)
 {
     // The client has asked us for dstData.getCapacity() points.
@@ -209,7 +1158,7 @@ boost::uint32_t Crop::readBufferImpl(PointBuffer& dstData)
 
         // copy points from src (prev stage) into dst (our stage),
         // based on the CropFilter's rules (i.e. its bounds)
-        const boost::uint32_t numPointsProcessed = m_cropFilter.processBuffer(dstData, srcData);
+        const boost::uint32_t numPointsProcessed = m_plan.apply(dstData, srcData);
 
         numPointsNeeded -= numPointsProcessed;
     }
@@ -35,24 +35,384 @@
 #include <pdal/filters/Decimation.hpp>
 
 #include <pdal/PointBuffer.hpp>
+#include <pdal/StageIterator.hpp>
+
+#include <boost/functional/hash.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/random/uniform_01.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
 
 namespace pdal
 {
 namespace filters
 {
 
+namespace decimation
+{
+
+namespace
+{
+
+template <typename T>
+double readRaw(boost::uint8_t const* point)
+{
+    T v;
+    std::memcpy(&v, point, sizeof(T));
+    return static_cast<double>(v);
+}
+
+template <typename T>
+void writeRaw(boost::uint8_t* point, double value)
+{
+    // the mean of stored integers is rounded back to the nearest one
+    if (std::numeric_limits<T>::is_integer)
+        value = std::floor(value + 0.5);
+    const T v = static_cast<T>(value);
+    std::memcpy(point, &v, sizeof(T));
+}
+
+template <typename T>
+void setAxis(VoxelGrid::Axis& axis)
+{
+    axis.read = &readRaw<T>;
+    axis.write = &writeRaw<T>;
+}
+
+VoxelGrid::Axis getAxis(Dimension const& dimension, double size)
+{
+    VoxelGrid::Axis axis;
+    axis.read = 0;
+    axis.write = 0;
+    axis.offset = dimension.getByteOffset();
+
+    const boost::uint32_t byteSize = dimension.getByteSize();
+    double scale = dimension.getNumericScale();
+    double shift = dimension.getNumericOffset();
+    switch (dimension.getInterpretation())
+    {
+        case dimension::Float:
+            // floating point dimensions are not scaled
+            scale = 1.0;
+            shift = 0.0;
+            if (byteSize == 4)
+                setAxis<float>(axis);
+            else if (byteSize == 8)
+                setAxis<double>(axis);
+            break;
+        case dimension::SignedInteger:
+        case dimension::SignedByte:
+            if (byteSize == 1)
+                setAxis<boost::int8_t>(axis);
+            else if (byteSize == 2)
+                setAxis<boost::int16_t>(axis);
+            else if (byteSize == 4)
+                setAxis<boost::int32_t>(axis);
+            else if (byteSize == 8)
+                setAxis<boost::int64_t>(axis);
+            break;
+        case dimension::UnsignedInteger:
+        case dimension::UnsignedByte:
+            if (byteSize == 1)
+                setAxis<boost::uint8_t>(axis);
+            else if (byteSize == 2)
+                setAxis<boost::uint16_t>(axis);
+            else if (byteSize == 4)
+                setAxis<boost::uint32_t>(axis);
+            else if (byteSize == 8)
+                setAxis<boost::uint64_t>(axis);
+            break;
+        case dimension::Pointer:
+        case dimension::Undefined:
+            break;
+    }
+
+    if (axis.read == 0)
+    {
+        std::ostringstream oss;
+        oss << "Unable to decimate on dimension '" << dimension.getName() << "' of interpretation "
+            << dimension.getInterpretation() << " and size " << byteSize;
+        throw pdal_error(oss.str());
+    }
+
+    // voxels are aligned to multiples of size in scaled units:
+    // floor((raw * scale + shift) / size)
+    axis.scale = scale / size;
+    axis.shift = shift / size;
+
+    return axis;
+}
+
+} // anonymous namespace
+
+
+std::size_t VoxelGrid::KeyHash::operator()(Key const& key) const
+{
+    std::size_t seed = 0;
+    boost::hash_combine(seed, key.x);
+    boost::hash_combine(seed, key.y);
+    boost::hash_combine(seed, key.z);
+    return seed;
+}
+
+
+VoxelGrid::VoxelGrid(double size, bool centroid)
+    : m_size(size)
+    , m_centroid(centroid)
+    , m_compiled(false)
+    , m_hasZ(false)
+{
+    if (!(size > 0.0))
+        throw pdal_error("Decimation voxel size must be greater than zero");
+
+    return;
+}
+
+
+void VoxelGrid::compile(Schema const& schema)
+{
+    m_x = getAxis(schema.getDimension("X"), m_size);
+    m_y = getAxis(schema.getDimension("Y"), m_size);
+
+    boost::optional<Dimension const&> z = schema.getDimensionOptional("Z");
+    m_hasZ = z;
+    if (m_hasZ)
+        m_z = getAxis(*z, m_size);
+
+    m_seen.clear();
+    m_slots.clear();
+    m_sums.clear();
+    m_compiled = true;
+
+    return;
+}
+
+
+// Returns false if the point has no voxel, which happens only for
+// coordinates that aren't finite or are too far from the origin.
+bool VoxelGrid::getKey(boost::uint8_t const* point, Key& key) const
+{
+    const double limit = 9.0e18;
+
+    const double x = std::floor(m_x.read(point + m_x.offset) * m_x.scale + m_x.shift);
+    const double y = std::floor(m_y.read(point + m_y.offset) * m_y.scale + m_y.shift);
+    const double z = m_hasZ ? std::floor(m_z.read(point + m_z.offset) * m_z.scale + m_z.shift) : 0.0;
+    if (!(x > -limit && x < limit && y > -limit && y < limit && z > -limit && z < limit))
+        return false;
+
+    key.x = static_cast<boost::int64_t>(x);
+    key.y = static_cast<boost::int64_t>(y);
+    key.z = static_cast<boost::int64_t>(z);
+    return true;
+}
+
+
+boost::uint32_t VoxelGrid::apply(PointBuffer& dst, PointBuffer const& src)
+{
+    if (m_centroid)
+        return applyCentroid(dst, src);
+    return applyFirst(dst, src);
+}
+
+
+boost::uint32_t VoxelGrid::applyFirst(PointBuffer& dst, PointBuffer const& src)
+{
+    const boost::uint32_t numSrcPoints = src.getNumPoints();
+    const boost::uint32_t dstIndex = dst.getNumPoints();
+    const std::size_t stride = src.getSchema().getByteSize();
+    boost::uint8_t const* data = src.getData(0);
+
+    m_mask.assign(numSrcPoints, 0);
+    Key key;
+    for (boost::uint32_t i = 0; i < numSrcPoints; ++i)
+    {
+        // points without a voxel are all kept
+        if (!getKey(data + i * stride, key) || m_seen.insert(key).second)
+            m_mask[i] = 1;
+    }
+
+    // copy the kept points a run at a time
+    boost::uint32_t numPointsAdded = 0;
+    boost::uint32_t i = 0;
+    while (i < numSrcPoints)
+    {
+        if (!m_mask[i])
+        {
+            ++i;
+            continue;
+        }
+
+        boost::uint32_t end = i;
+        while (end < numSrcPoints && m_mask[end])
+            ++end;
+
+        dst.copyPointsFast(dstIndex + numPointsAdded, i, src, end - i);
+        numPointsAdded += end - i;
+        i = end;
+    }
+
+    dst.setNumPoints(dstIndex + numPointsAdded);
+    assert(dst.getNumPoints() <= dst.getCapacity());
+
+    return numPointsAdded;
+}
+
+
+boost::uint32_t VoxelGrid::applyCentroid(PointBuffer& dst, PointBuffer const& src)
+{
+    const boost::uint32_t numSrcPoints = src.getNumPoints();
+    const std::size_t stride = src.getSchema().getByteSize();
+    boost::uint8_t const* data = src.getData(0);
+
+    m_slots.clear();
+    m_sums.clear();
+
+    Key key;
+    for (boost::uint32_t i = 0; i < numSrcPoints; ++i)
+    {
+        boost::uint8_t const* point = data + i * stride;
+        const double x = m_x.read(point + m_x.offset);
+        const double y = m_y.read(point + m_y.offset);
+        const double z = m_hasZ ? m_z.read(point + m_z.offset) : 0.0;
+
+        if (getKey(point, key))
+        {
+            std::pair<boost::unordered_map<Key, boost::uint32_t, KeyHash>::iterator, bool> slot =
+                m_slots.insert(std::make_pair(key, static_cast<boost::uint32_t>(m_sums.size())));
+            if (!slot.second)
+            {
+                Sum& sum = m_sums[slot.first->second];
+                ++sum.count;
+                sum.x += x;
+                sum.y += y;
+                sum.z += z;
+                continue;
+            }
+        }
+
+        Sum sum;
+        sum.first = i;
+        sum.count = 1;
+        sum.x = x;
+        sum.y = y;
+        sum.z = z;
+        m_sums.push_back(sum);
+    }
+
+    // the output keeps the other fields of the first point of each voxel
+    boost::uint32_t dstIndex = dst.getNumPoints();
+    for (std::vector<Sum>::const_iterator sum = m_sums.begin(); sum != m_sums.end(); ++sum)
+    {
+        dst.copyPointFast(dstIndex, sum->first, src);
+        if (sum->count > 1)
+        {
+            boost::uint8_t* point = dst.getData(dstIndex);
+            m_x.write(point + m_x.offset, sum->x / sum->count);
+            m_y.write(point + m_y.offset, sum->y / sum->count);
+            if (m_hasZ)
+                m_z.write(point + m_z.offset, sum->z / sum->count);
+        }
+        ++dstIndex;
+    }
+
+    dst.setNumPoints(dstIndex);
+    assert(dst.getNumPoints() <= dst.getCapacity());
+
+    return static_cast<boost::uint32_t>(m_sums.size());
+}
+
+
+RandomSample::RandomSample(boost::uint64_t count, boost::uint64_t total, boost::uint32_t seed)
+    : m_needed((std::min)(count, total))
+    , m_remaining(total)
+{
+    if (seed != 0)
+        m_rng.seed(seed);
+
+    return;
+}
+
+
+boost::uint32_t RandomSample::apply(PointBuffer& dst, PointBuffer const& src)
+{
+    const boost::uint32_t numSrcPoints = src.getNumPoints();
+    boost::uint32_t dstIndex = dst.getNumPoints();
+    boost::random::uniform_01<double> uniform;
+
+    boost::uint32_t numPointsAdded = 0;
+    for (boost::uint32_t i = 0; i < numSrcPoints && m_needed > 0; ++i)
+    {
+        // the stage said how many points it had; if it has more, the
+        // sample simply ends early
+        if (m_remaining == 0)
+            break;
+
+        if (uniform(m_rng) * static_cast<double>(m_remaining) < static_cast<double>(m_needed))
+        {
+            dst.copyPointFast(dstIndex, i, src);
+            ++dstIndex;
+            ++numPointsAdded;
+            --m_needed;
+        }
+        --m_remaining;
+    }
+
+    dst.setNumPoints(dstIndex);
+    assert(dst.getNumPoints() <= dst.getCapacity());
+
+    return numPointsAdded;
+}
+
+} // decimation
+
 
 Decimation::Decimation(Stage& prevStage, const Options& options)
     : pdal::Filter(prevStage, options)
-    , m_step(options.getValueOrThrow<boost::uint32_t>("step"))
+    , m_mode(Mode_Stride)
+    , m_step(1)
+    , m_voxelSize(options.getValueOrDefault<double>("voxel_size", 1.0))
+    , m_centroid(false)
+    , m_count(options.getValueOrDefault<boost::uint64_t>("count", 0))
+    , m_seed(options.getValueOrDefault<boost::uint32_t>("seed", 0))
 {
+    const std::string mode = options.getValueOrDefault<std::string>("mode", "stride");
+    if (mode == "stride")
+        m_mode = Mode_Stride;
+    else if (mode == "voxel")
+        m_mode = Mode_Voxel;
+    else if (mode == "random")
+        m_mode = Mode_Random;
+    else
+        throw pdal_error("Decimation mode '" + mode + "' is not one of stride, voxel or random");
+
+    if (m_mode == Mode_Stride)
+        m_step = options.getValueOrThrow<boost::uint32_t>("step");
+
+    const std::string method = options.getValueOrDefault<std::string>("voxel_method", "first");
+    if (method == "centroid")
+        m_centroid = true;
+    else if (method != "first")
+        throw pdal_error("Decimation voxel_method '" + method + "' is not one of first or centroid");
+
+    if (m_mode == Mode_Voxel && !(m_voxelSize > 0.0))
+        throw pdal_error("Decimation voxel_size must be greater than zero");
+
     return;
 }
 
 
 Decimation::Decimation(Stage& prevStage, boost::uint32_t step)
     : Filter(prevStage, Options::none())
+    , m_mode(Mode_Stride)
     , m_step(step)
+    , m_voxelSize(1.0)
+    , m_centroid(false)
+    , m_count(0)
+    , m_seed(0)
 {
     return;
 }
@@ -62,7 +422,21 @@ void Decimation::initialize()
 {
     Filter::initialize();
 
-    this->setNumPoints(this->getNumPoints() / m_step);
+    switch (m_mode)
+    {
+        case Mode_Stride:
+            this->setNumPoints(this->getNumPoints() / m_step);
+            break;
+        case Mode_Voxel:
+            this->setNumPoints(0);
+            this->setPointCountType(PointCount_Unknown);
+            break;
+        case Mode_Random:
+            if (getPrevStage().getPointCountType() != PointCount_Fixed)
+                throw pdal_error("Random decimation needs a previous stage with a known number of points");
+            this->setNumPoints((std::min)(m_count, getPrevStage().getNumPoints()));
+            break;
+    }
 
     return;
 }
@@ -71,6 +445,19 @@ void Decimation::initialize()
 const Options Decimation::getDefaultOptions() const
 {
     Options options;
+
+    Option mode("mode", "stride", "stride (keep every step'th point), voxel (one point per voxel_size cube) or random (count points)");
+    Option voxel_method("voxel_method", "first", "keep the first point of each voxel, or the centroid of its points");
+    Option voxel_size("voxel_size", 1.0, "edge length of a voxel, in scaled units");
+    Option count("count", 0, "number of points to keep in random mode");
+    Option seed("seed", 0, "Seed to use for a repeatable random sample. A seed value of 0 means no seed is used");
+
+    options.add(mode);
+    options.add(voxel_method);
+    options.add(voxel_size);
+    options.add(count);
+    options.add(seed);
+
     return options;
 }
 
@@ -132,6 +519,35 @@ Decimation::Decimation(const pdal::filters::Decimation& filter, PointBuffer& buf
     : pdal::FilterSequentialIterator(filter, buffer)
     , m_filter(filter)
 {
+    const Stage& prev = filter.getPrevStage();
+
+    if (filter.getMode() == pdal::filters::Decimation::Mode_Voxel)
+    {
+        m_voxels.reset(new decimation::VoxelGrid(filter.getVoxelSize(), filter.isCentroid()));
+        return;
+    }
+    if (filter.getMode() == pdal::filters::Decimation::Mode_Random)
+    {
+        m_sample.reset(new decimation::RandomSample(filter.getCount(), prev.getNumPoints(), filter.getSeed()));
+        return;
+    }
+
+    if (filter.getStep() > 1 &&
+        prev.getPointCountType() == PointCount_Fixed &&
+        prev.supportsIterator(StageIterator_Random))
+    {
+        // Some readers can't hand out a second stream over the same data,
+        // in which case we just stay on the sequential path.
+        try
+        {
+            m_stridedIterator.reset(prev.createRandomIterator(buffer));
+        }
+        catch (pdal::pdal_error&)
+        {
+            m_stridedIterator.reset();
+        }
+    }
+
     return;
 }
 
@@ -140,6 +556,20 @@ boost::uint64_t Decimation::skipImpl(boost::uint64_t count)
 {
     //return naiveSkipImpl(count);
 
+    if (m_voxels || m_sample)
+    {
+        return naiveSkipImpl(count);
+    }
+
+    if (m_stridedIterator)
+    {
+        const boost::uint64_t numPoints = m_filter.getPrevStage().getNumPoints();
+        const boost::uint64_t current = m_stridedIterator->getIndex();
+        const boost::uint64_t target = std::min<boost::uint64_t>(current + count * m_filter.getStep(), numPoints);
+        m_stridedIterator->seek(target);
+        return (target - current + m_filter.getStep() - 1) / m_filter.getStep();
+    }
+
     // BUG: this is not exactly correct
     return getPrevIterator().skip(count * m_filter.getStep());
 }
@@ -147,11 +577,48 @@ boost::uint64_t Decimation::skipImpl(boost::uint64_t count)
 
 bool Decimation::atEndImpl() const
 {
+    if (m_sample && m_sample->done())
+    {
+        return true;
+    }
+
+    if (m_stridedIterator)
+    {
+        return m_stridedIterator->getIndex() >= m_filter.getPrevStage().getNumPoints();
+    }
+
     const StageSequentialIterator& iter = getPrevIterator();
     return iter.atEnd();
 }
 
 
+void Decimation::readBufferBeginImpl(PointBuffer& buffer)
+{
+    // We'll assume you're not changing the schema per-read call
+    if (m_voxels && !m_voxels->isCompiled())
+    {
+        m_voxels->compile(buffer.getSchema());
+    }
+
+    return;
+}
+
+
+boost::uint32_t Decimation::processBuffer(PointBuffer& dstData, const PointBuffer& srcData, boost::uint64_t srcStartIndex)
+{
+    if (m_voxels)
+    {
+        return m_voxels->apply(dstData, srcData);
+    }
+    if (m_sample)
+    {
+        return m_sample->apply(dstData, srcData);
+    }
+
+    return m_filter.processBuffer(dstData, srcData, srcStartIndex);
+}
+
+
 boost::uint32_t Decimation::readBufferImpl(PointBuffer& dstData)
 {
     // The client has asked us for dstData.getCapacity() points.
@@ -161,11 +628,27 @@ boost::uint32_t Decimation::readBufferImpl(PointBuffer& dstData)
     boost::uint32_t numPointsNeeded = dstData.getCapacity();
     assert(dstData.getNumPoints() == 0);
 
-    // set up buffer to be filled by prev stage
-    PointBuffer srcData(dstData.getSchema(), numPointsNeeded);
+    if (m_stridedIterator)
+    {
+        return m_stridedIterator->readStrided(dstData, m_filter.getStep());
+    }
 
-    while (numPointsNeeded > 0)
+    while (numPointsNeeded > 0 && !(m_sample && m_sample->done()))
     {
+        if (getPrevIterator().atEnd()) break;
+
+        // set up buffer to be filled by prev stage: in the voxel and random
+        // modes no bigger than the room left, as every point read may be
+        // kept, while a stride keeps one point in step, so reads enough to
+        // fill the room, up to a full buffer
+        boost::uint32_t numSrcPointsWanted = numPointsNeeded;
+        if (!m_voxels && !m_sample)
+        {
+            const boost::uint64_t strided = static_cast<boost::uint64_t>(numPointsNeeded) * m_filter.getStep();
+            numSrcPointsWanted = static_cast<boost::uint32_t>((std::min)(strided, static_cast<boost::uint64_t>(dstData.getCapacity())));
+        }
+        PointBuffer srcData(dstData.getSchema(), numSrcPointsWanted);
+
         // read from prev stage
         const boost::uint64_t srcStartIndex = getPrevIterator().getIndex();
         const boost::uint32_t numSrcPointsRead = getPrevIterator().read(srcData);
@@ -176,8 +659,8 @@ boost::uint32_t Decimation::readBufferImpl(PointBuffer& dstData)
         if (numSrcPointsRead == 0) break;
 
         // copy points from src (prev stage) into dst (our stage),
-        // based on the CropFilter's rules (i.e. its bounds)
-        const boost::uint32_t numPointsAdded = m_filter.processBuffer(dstData, srcData, srcStartIndex);
+        // based on the decimation mode
+        const boost::uint32_t numPointsAdded = processBuffer(dstData, srcData, srcStartIndex);
 
         numPointsNeeded -= numPointsAdded;
         //printf(".");fflush(stdout);
@@ -0,0 +1,1186 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/filters/Expression.hpp>
+
+#include <pdal/PointBuffer.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace pdal
+{
+namespace filters
+{
+
+namespace expression
+{
+
+namespace
+{
+
+typedef Kernel::Instruction Instruction;
+typedef Kernel::Context Context;
+
+// The operators.  Comparisons are written so that NaN compares false.
+inline bool isTrue(double v)
+{
+    return v < 0.0 || v > 0.0;
+}
+
+struct Or
+{
+    static double apply(double a, double b)
+    {
+        return (isTrue(a) || isTrue(b)) ? 1.0 : 0.0;
+    }
+};
+struct And
+{
+    static double apply(double a, double b)
+    {
+        return (isTrue(a) && isTrue(b)) ? 1.0 : 0.0;
+    }
+};
+struct Equal
+{
+    static double apply(double a, double b)
+    {
+        return (a <= b && a >= b) ? 1.0 : 0.0;
+    }
+};
+struct NotEqual
+{
+    static double apply(double a, double b)
+    {
+        return (a < b || a > b) ? 1.0 : 0.0;
+    }
+};
+struct Less
+{
+    static double apply(double a, double b)
+    {
+        return a < b ? 1.0 : 0.0;
+    }
+};
+struct LessEqual
+{
+    static double apply(double a, double b)
+    {
+        return a <= b ? 1.0 : 0.0;
+    }
+};
+struct Greater
+{
+    static double apply(double a, double b)
+    {
+        return a > b ? 1.0 : 0.0;
+    }
+};
+struct GreaterEqual
+{
+    static double apply(double a, double b)
+    {
+        return a >= b ? 1.0 : 0.0;
+    }
+};
+struct Add
+{
+    static double apply(double a, double b)
+    {
+        return a + b;
+    }
+};
+struct Subtract
+{
+    static double apply(double a, double b)
+    {
+        return a - b;
+    }
+};
+struct Multiply
+{
+    static double apply(double a, double b)
+    {
+        return a * b;
+    }
+};
+struct Divide
+{
+    static double apply(double a, double b)
+    {
+        return a / b;
+    }
+};
+struct Min
+{
+    static double apply(double a, double b)
+    {
+        return b < a ? b : a;
+    }
+};
+struct Max
+{
+    static double apply(double a, double b)
+    {
+        return b > a ? b : a;
+    }
+};
+struct Negate
+{
+    static double apply(double a)
+    {
+        return -a;
+    }
+};
+struct Not
+{
+    static double apply(double a)
+    {
+        return isTrue(a) ? 0.0 : 1.0;
+    }
+};
+struct Abs
+{
+    static double apply(double a)
+    {
+        return std::fabs(a);
+    }
+};
+struct Sqrt
+{
+    static double apply(double a)
+    {
+        return std::sqrt(a);
+    }
+};
+struct Floor
+{
+    static double apply(double a)
+    {
+        return std::floor(a);
+    }
+};
+struct Ceil
+{
+    static double apply(double a)
+    {
+        return std::ceil(a);
+    }
+};
+struct Round
+{
+    static double apply(double a)
+    {
+        return a < 0.0 ? std::ceil(a - 0.5) : std::floor(a + 0.5);
+    }
+};
+
+
+// The kernels, each over one block of points.
+
+template <typename Op>
+void binaryRegisters(Instruction const& in, Context& c)
+{
+    double* d = c.registers + in.dst * Kernel::s_blockSize;
+    double const* a = c.registers + in.lhs * Kernel::s_blockSize;
+    double const* b = c.registers + in.rhs * Kernel::s_blockSize;
+    for (boost::uint32_t i = 0; i < c.count; ++i)
+        d[i] = Op::apply(a[i], b[i]);
+    return;
+}
+
+template <typename Op>
+void binaryConstantRight(Instruction const& in, Context& c)
+{
+    double* d = c.registers + in.dst * Kernel::s_blockSize;
+    double const* a = c.registers + in.lhs * Kernel::s_blockSize;
+    const double b = in.constant;
+    for (boost::uint32_t i = 0; i < c.count; ++i)
+        d[i] = Op::apply(a[i], b);
+    return;
+}
+
+template <typename Op>
+void binaryConstantLeft(Instruction const& in, Context& c)
+{
+    double* d = c.registers + in.dst * Kernel::s_blockSize;
+    const double a = in.constant;
+    double const* b = c.registers + in.rhs * Kernel::s_blockSize;
+    for (boost::uint32_t i = 0; i < c.count; ++i)
+        d[i] = Op::apply(a, b[i]);
+    return;
+}
+
+template <typename Op>
+void unary(Instruction const& in, Context& c)
+{
+    double* d = c.registers + in.dst * Kernel::s_blockSize;
+    double const* a = c.registers + in.lhs * Kernel::s_blockSize;
+    for (boost::uint32_t i = 0; i < c.count; ++i)
+        d[i] = Op::apply(a[i]);
+    return;
+}
+
+void constant(Instruction const& in, Context& c)
+{
+    double* d = c.registers + in.dst * Kernel::s_blockSize;
+    std::fill(d, d + c.count, in.constant);
+    return;
+}
+
+template <typename T>
+void load(Instruction const& in, Context& c)
+{
+    double* d = c.registers + in.dst * Kernel::s_blockSize;
+    boost::uint8_t const* p = c.data + in.offset;
+    for (boost::uint32_t i = 0; i < c.count; ++i, p += c.stride)
+    {
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        d[i] = static_cast<double>(v) * in.scale + in.shift;
+    }
+    return;
+}
+
+// Integers are rounded and saturate at the limits of their type; NaN
+// stores the lowest value.
+template <typename T>
+T toStored(double v)
+{
+    if (!std::numeric_limits<T>::is_integer)
+        return static_cast<T>(v);
+
+    const double lowest = static_cast<double>((std::numeric_limits<T>::min)());
+    const double highest = static_cast<double>((std::numeric_limits<T>::max)());
+    v = std::floor(v + 0.5);
+    if (!(v > lowest))
+        return (std::numeric_limits<T>::min)();
+    if (v >= highest)
+        return (std::numeric_limits<T>::max)();
+    return static_cast<T>(v);
+}
+
+template <typename T>
+void store(Instruction const& in, Context& c)
+{
+    double const* s = c.registers + in.lhs * Kernel::s_blockSize;
+    boost::uint8_t* p = c.data + in.offset;
+    for (boost::uint32_t i = 0; i < c.count; ++i, p += c.stride)
+    {
+        const T v = toStored<T>((s[i] - in.shift) / in.scale);
+        std::memcpy(p, &v, sizeof(T));
+    }
+    return;
+}
+
+void condition(Instruction const& in, Context& c)
+{
+    double const* s = c.registers + in.lhs * Kernel::s_blockSize;
+    for (boost::uint32_t i = 0; i < c.count; ++i)
+        c.mask[i] &= isTrue(s[i]) ? 1 : 0;
+    return;
+}
+
+
+template <typename Op>
+Instruction::Function selectBinary(int operands)
+{
+    switch (operands)
+    {
+        case 1:
+            return &binaryConstantRight<Op>;
+        case 2:
+            return &binaryConstantLeft<Op>;
+        default:
+            return &binaryRegisters<Op>;
+    }
+}
+
+// operands: 0 both in registers, 1 constant right, 2 constant left
+Instruction::Function selectBinary(Program::Operator op, int operands)
+{
+    switch (op)
+    {
+        case Program::Op_Or:
+            return selectBinary<Or>(operands);
+        case Program::Op_And:
+            return selectBinary<And>(operands);
+        case Program::Op_Equal:
+            return selectBinary<Equal>(operands);
+        case Program::Op_NotEqual:
+            return selectBinary<NotEqual>(operands);
+        case Program::Op_Less:
+            return selectBinary<Less>(operands);
+        case Program::Op_LessEqual:
+            return selectBinary<LessEqual>(operands);
+        case Program::Op_Greater:
+            return selectBinary<Greater>(operands);
+        case Program::Op_GreaterEqual:
+            return selectBinary<GreaterEqual>(operands);
+        case Program::Op_Add:
+            return selectBinary<Add>(operands);
+        case Program::Op_Subtract:
+            return selectBinary<Subtract>(operands);
+        case Program::Op_Multiply:
+            return selectBinary<Multiply>(operands);
+        case Program::Op_Divide:
+            return selectBinary<Divide>(operands);
+        case Program::Op_Min:
+            return selectBinary<Min>(operands);
+        case Program::Op_Max:
+            return selectBinary<Max>(operands);
+        default:
+            throw pdal_error("Expression: not a binary operator");
+    }
+}
+
+Instruction::Function selectUnary(Program::Operator op)
+{
+    switch (op)
+    {
+        case Program::Op_Negate:
+            return &unary<Negate>;
+        case Program::Op_Not:
+            return &unary<Not>;
+        case Program::Op_Abs:
+            return &unary<Abs>;
+        case Program::Op_Sqrt:
+            return &unary<Sqrt>;
+        case Program::Op_Floor:
+            return &unary<Floor>;
+        case Program::Op_Ceil:
+            return &unary<Ceil>;
+        case Program::Op_Round:
+            return &unary<Round>;
+        default:
+            throw pdal_error("Expression: not a unary operator");
+    }
+}
+
+double evaluate(Program::Operator op, double a, double b)
+{
+    switch (op)
+    {
+        case Program::Op_Or:
+            return Or::apply(a, b);
+        case Program::Op_And:
+            return And::apply(a, b);
+        case Program::Op_Equal:
+            return Equal::apply(a, b);
+        case Program::Op_NotEqual:
+            return NotEqual::apply(a, b);
+        case Program::Op_Less:
+            return Less::apply(a, b);
+        case Program::Op_LessEqual:
+            return LessEqual::apply(a, b);
+        case Program::Op_Greater:
+            return Greater::apply(a, b);
+        case Program::Op_GreaterEqual:
+            return GreaterEqual::apply(a, b);
+        case Program::Op_Add:
+            return Add::apply(a, b);
+        case Program::Op_Subtract:
+            return Subtract::apply(a, b);
+        case Program::Op_Multiply:
+            return Multiply::apply(a, b);
+        case Program::Op_Divide:
+            return Divide::apply(a, b);
+        case Program::Op_Min:
+            return Min::apply(a, b);
+        case Program::Op_Max:
+            return Max::apply(a, b);
+        case Program::Op_Negate:
+            return Negate::apply(a);
+        case Program::Op_Not:
+            return Not::apply(a);
+        case Program::Op_Abs:
+            return Abs::apply(a);
+        case Program::Op_Sqrt:
+            return Sqrt::apply(a);
+        case Program::Op_Floor:
+            return Floor::apply(a);
+        case Program::Op_Ceil:
+            return Ceil::apply(a);
+        case Program::Op_Round:
+            return Round::apply(a);
+    }
+    return 0.0;
+}
+
+template <typename T>
+void setAccess(Instruction& in, bool store)
+{
+    in.function = store ? &expression::store<T> : &load<T>;
+}
+
+} // anonymous namespace
+
+
+// A recursive descent parser, from the loosest binding operator to the
+// tightest.
+class Parser
+{
+public:
+    Parser(Program& program)
+        : m_program(program)
+        , m_source(program.m_source)
+        , m_pos(0)
+    {}
+
+    void parse()
+    {
+        do
+        {
+            skipSpace();
+            if (m_pos == m_source.size() || peek(';'))
+                continue;
+
+            Program::Statement statement;
+            const std::size_t start = m_pos;
+            const std::string name = readName();
+            skipSpace();
+            if (!name.empty() && peek('=') && !peek("=="))
+            {
+                ++m_pos;
+                statement.target = name;
+            }
+            else
+            {
+                m_pos = start;
+            }
+            statement.root = parseOr();
+            m_program.m_statements.push_back(statement);
+            skipSpace();
+        }
+        while (consume(";"));
+
+        if (m_pos != m_source.size())
+            error("unexpected text");
+        if (m_program.m_statements.empty())
+            error("no statements");
+
+        return;
+    }
+
+private:
+    std::size_t parseOr()
+    {
+        std::size_t lhs = parseAnd();
+        while (consume("||"))
+            lhs = binary(Program::Op_Or, lhs, parseAnd());
+        return lhs;
+    }
+
+    std::size_t parseAnd()
+    {
+        std::size_t lhs = parseEquality();
+        while (consume("&&"))
+            lhs = binary(Program::Op_And, lhs, parseEquality());
+        return lhs;
+    }
+
+    std::size_t parseEquality()
+    {
+        std::size_t lhs = parseRelational();
+        while (true)
+        {
+            if (consume("=="))
+                lhs = binary(Program::Op_Equal, lhs, parseRelational());
+            else if (consume("!="))
+                lhs = binary(Program::Op_NotEqual, lhs, parseRelational());
+            else
+                return lhs;
+        }
+    }
+
+    std::size_t parseRelational()
+    {
+        std::size_t lhs = parseAdditive();
+        while (true)
+        {
+            if (consume("<="))
+                lhs = binary(Program::Op_LessEqual, lhs, parseAdditive());
+            else if (consume(">="))
+                lhs = binary(Program::Op_GreaterEqual, lhs, parseAdditive());
+            else if (consume("<"))
+                lhs = binary(Program::Op_Less, lhs, parseAdditive());
+            else if (consume(">"))
+                lhs = binary(Program::Op_Greater, lhs, parseAdditive());
+            else
+                return lhs;
+        }
+    }
+
+    std::size_t parseAdditive()
+    {
+        std::size_t lhs = parseMultiplicative();
+        while (true)
+        {
+            if (consume("+"))
+                lhs = binary(Program::Op_Add, lhs, parseMultiplicative());
+            else if (consume("-"))
+                lhs = binary(Program::Op_Subtract, lhs, parseMultiplicative());
+            else
+                return lhs;
+        }
+    }
+
+    std::size_t parseMultiplicative()
+    {
+        std::size_t lhs = parseUnary();
+        while (true)
+        {
+            if (consume("*"))
+                lhs = binary(Program::Op_Multiply, lhs, parseUnary());
+            else if (consume("/"))
+                lhs = binary(Program::Op_Divide, lhs, parseUnary());
+            else
+                return lhs;
+        }
+    }
+
+    std::size_t parseUnary()
+    {
+        if (consume("-"))
+            return unary(Program::Op_Negate, parseUnary());
+        if (consume("!"))
+            return unary(Program::Op_Not, parseUnary());
+        if (consume("+"))
+            return parseUnary();
+        return parsePrimary();
+    }
+
+    std::size_t parsePrimary()
+    {
+        skipSpace();
+        if (consume("("))
+        {
+            const std::size_t inner = parseOr();
+            expect(")");
+            return inner;
+        }
+
+        if (m_pos < m_source.size() &&
+                (std::isdigit(static_cast<unsigned char>(m_source[m_pos])) || m_source[m_pos] == '.'))
+        {
+            const char* start = m_source.c_str() + m_pos;
+            char* end = 0;
+            const double value = std::strtod(start, &end);
+            if (end == start)
+                error("expected a number");
+            m_pos += static_cast<std::size_t>(end - start);
+
+            Program::Node node = makeNode(Program::Node::Kind_Number);
+            node.value = value;
+            return add(node);
+        }
+
+        const std::string name = readName();
+        if (name.empty())
+            error("expected a number, a dimension or '('");
+
+        if (!consume("("))
+        {
+            Program::Node node = makeNode(Program::Node::Kind_Dimension);
+            node.name = name;
+            return add(node);
+        }
+
+        // a function call
+        if (name == "min" || name == "max")
+        {
+            const std::size_t a = parseOr();
+            expect(",");
+            const std::size_t b = parseOr();
+            expect(")");
+            return binary(name == "min" ? Program::Op_Min : Program::Op_Max, a, b);
+        }
+
+        Program::Operator op = Program::Op_Abs;
+        if (name == "abs")
+            op = Program::Op_Abs;
+        else if (name == "sqrt")
+            op = Program::Op_Sqrt;
+        else if (name == "floor")
+            op = Program::Op_Floor;
+        else if (name == "ceil")
+            op = Program::Op_Ceil;
+        else if (name == "round")
+            op = Program::Op_Round;
+        else
+            error("unknown function '" + name + "'");
+
+        const std::size_t a = parseOr();
+        expect(")");
+        return unary(op, a);
+    }
+
+    // Dimension names may contain dots, as in "prefix.X".
+    std::string readName()
+    {
+        skipSpace();
+        std::string name;
+        if (m_pos < m_source.size() &&
+                (std::isalpha(static_cast<unsigned char>(m_source[m_pos])) || m_source[m_pos] == '_'))
+        {
+            while (m_pos < m_source.size() &&
+                    (std::isalnum(static_cast<unsigned char>(m_source[m_pos])) ||
+                     m_source[m_pos] == '_' || m_source[m_pos] == '.'))
+            {
+                name += m_source[m_pos++];
+            }
+        }
+        return name;
+    }
+
+    Program::Node makeNode(Program::Node::Kind kind) const
+    {
+        Program::Node node;
+        node.kind = kind;
+        node.op = Program::Op_Add;
+        node.value = 0.0;
+        node.lhs = 0;
+        node.rhs = 0;
+        return node;
+    }
+
+    std::size_t add(Program::Node const& node)
+    {
+        m_program.m_nodes.push_back(node);
+        return m_program.m_nodes.size() - 1;
+    }
+
+    std::size_t binary(Program::Operator op, std::size_t lhs, std::size_t rhs)
+    {
+        Program::Node node = makeNode(Program::Node::Kind_Binary);
+        node.op = op;
+        node.lhs = lhs;
+        node.rhs = rhs;
+        return add(node);
+    }
+
+    std::size_t unary(Program::Operator op, std::size_t operand)
+    {
+        Program::Node node = makeNode(Program::Node::Kind_Unary);
+        node.op = op;
+        node.lhs = operand;
+        return add(node);
+    }
+
+    void skipSpace()
+    {
+        while (m_pos < m_source.size() && std::isspace(static_cast<unsigned char>(m_source[m_pos])))
+            ++m_pos;
+    }
+
+    bool peek(char c)
+    {
+        return m_pos < m_source.size() && m_source[m_pos] == c;
+    }
+
+    bool peek(const char* token)
+    {
+        return m_source.compare(m_pos, std::strlen(token), token) == 0;
+    }
+
+    bool consume(const char* token)
+    {
+        skipSpace();
+        if (!peek(token))
+            return false;
+        m_pos += std::strlen(token);
+        return true;
+    }
+
+    void expect(const char* token)
+    {
+        if (!consume(token))
+            error(std::string("expected '") + token + "'");
+    }
+
+    void error(std::string const& what) const
+    {
+        std::ostringstream oss;
+        oss << "Unable to parse expression '" << m_source << "': " << what << " at position " << m_pos;
+        throw pdal_error(oss.str());
+    }
+
+    Program& m_program;
+    std::string const& m_source;
+    std::size_t m_pos;
+};
+
+
+Program::Program(std::string const& source)
+    : m_source(source)
+{
+    Parser parser(*this);
+    parser.parse();
+
+    return;
+}
+
+
+bool Program::hasCondition() const
+{
+    for (std::vector<Statement>::const_iterator s = m_statements.begin(); s != m_statements.end(); ++s)
+    {
+        if (s->target.empty())
+            return true;
+    }
+    return false;
+}
+
+
+bool Program::movesPoints() const
+{
+    for (std::vector<Statement>::const_iterator s = m_statements.begin(); s != m_statements.end(); ++s)
+    {
+        const std::string::size_type dot = s->target.rfind('.');
+        const std::string name = (dot == std::string::npos) ? s->target : s->target.substr(dot + 1);
+        if (name == "X" || name == "Y" || name == "Z")
+            return true;
+    }
+    return false;
+}
+
+
+// ------------------------------------------------------------------------
+
+const boost::uint32_t Kernel::s_blockSize;
+
+
+Kernel::Kernel(Program const& program, Schema const& schema)
+    : m_numRegisters(1)
+    , m_hasCondition(program.hasCondition())
+    , m_movesPoints(program.movesPoints())
+{
+    std::vector<Program::Statement> const& statements = program.getStatements();
+    for (std::vector<Program::Statement>::const_iterator s = statements.begin(); s != statements.end(); ++s)
+    {
+        const std::size_t reg = compile(program, schema, s->root, 0);
+
+        Instruction in;
+        if (s->target.empty())
+        {
+            in.function = &condition;
+        }
+        else
+        {
+            in = getAccess(schema, s->target, true);
+        }
+        in.lhs = reg;
+        m_instructions.push_back(in);
+    }
+
+    m_registers.resize(m_numRegisters * s_blockSize);
+
+    return;
+}
+
+
+Instruction Kernel::getAccess(Schema const& schema, std::string const& name, bool store) const
+{
+    boost::optional<Dimension const&> found = schema.getDimensionOptional(name);
+    if (!found)
+    {
+        throw pdal_error("Expression: dimension '" + name + "' is not in the schema");
+    }
+    Dimension const& dimension = *found;
+
+    Instruction in;
+    in.function = 0;
+    in.dst = 0;
+    in.lhs = 0;
+    in.rhs = 0;
+    in.constant = 0.0;
+    in.offset = dimension.getByteOffset();
+    in.scale = dimension.getNumericScale();
+    in.shift = dimension.getNumericOffset();
+
+    const boost::uint32_t size = dimension.getByteSize();
+    switch (dimension.getInterpretation())
+    {
+        case dimension::Float:
+            // floating point dimensions are not scaled
+            in.scale = 1.0;
+            in.shift = 0.0;
+            if (size == 4)
+                setAccess<float>(in, store);
+            else if (size == 8)
+                setAccess<double>(in, store);
+            break;
+        case dimension::SignedInteger:
+        case dimension::SignedByte:
+            if (size == 1)
+                setAccess<boost::int8_t>(in, store);
+            else if (size == 2)
+                setAccess<boost::int16_t>(in, store);
+            else if (size == 4)
+                setAccess<boost::int32_t>(in, store);
+            else if (size == 8)
+                setAccess<boost::int64_t>(in, store);
+            break;
+        case dimension::UnsignedInteger:
+        case dimension::UnsignedByte:
+            if (size == 1)
+                setAccess<boost::uint8_t>(in, store);
+            else if (size == 2)
+                setAccess<boost::uint16_t>(in, store);
+            else if (size == 4)
+                setAccess<boost::uint32_t>(in, store);
+            else if (size == 8)
+                setAccess<boost::uint64_t>(in, store);
+            break;
+        case dimension::Pointer:
+        case dimension::Undefined:
+            break;
+    }
+
+    if (in.function == 0)
+    {
+        std::ostringstream oss;
+        oss << "Expression: unable to use dimension '" << name << "' of interpretation "
+            << dimension.getInterpretation() << " and size " << size;
+        throw pdal_error(oss.str());
+    }
+
+    return in;
+}
+
+
+// Emits the instructions leaving the value of node in register reg, using
+// the registers above it as scratch.  Returns reg.
+std::size_t Kernel::compile(Program const& program, Schema const& schema, std::size_t index, std::size_t reg)
+{
+    std::vector<Program::Node> const& nodes = program.getNodes();
+    Program::Node const& node = nodes[index];
+    m_numRegisters = (std::max)(m_numRegisters, reg + 1);
+
+    Instruction in;
+    in.dst = reg;
+    in.lhs = reg;
+    in.rhs = reg + 1;
+    in.constant = 0.0;
+    in.offset = 0;
+    in.scale = 1.0;
+    in.shift = 0.0;
+
+    switch (node.kind)
+    {
+        case Program::Node::Kind_Number:
+            in.function = &constant;
+            in.constant = node.value;
+            break;
+
+        case Program::Node::Kind_Dimension:
+            in = getAccess(schema, node.name, false);
+            in.dst = reg;
+            break;
+
+        case Program::Node::Kind_Unary:
+            if (nodes[node.lhs].kind == Program::Node::Kind_Number)
+            {
+                in.function = &constant;
+                in.constant = evaluate(node.op, nodes[node.lhs].value, 0.0);
+                break;
+            }
+            compile(program, schema, node.lhs, reg);
+            in.function = selectUnary(node.op);
+            break;
+
+        case Program::Node::Kind_Binary:
+        {
+            const bool constantLeft = (nodes[node.lhs].kind == Program::Node::Kind_Number);
+            const bool constantRight = (nodes[node.rhs].kind == Program::Node::Kind_Number);
+            if (constantLeft && constantRight)
+            {
+                in.function = &constant;
+                in.constant = evaluate(node.op, nodes[node.lhs].value, nodes[node.rhs].value);
+            }
+            else if (constantRight)
+            {
+                compile(program, schema, node.lhs, reg);
+                in.function = selectBinary(node.op, 1);
+                in.constant = nodes[node.rhs].value;
+            }
+            else if (constantLeft)
+            {
+                compile(program, schema, node.rhs, reg);
+                in.rhs = reg;
+                in.function = selectBinary(node.op, 2);
+                in.constant = nodes[node.lhs].value;
+            }
+            else
+            {
+                compile(program, schema, node.lhs, reg);
+                compile(program, schema, node.rhs, reg + 1);
+                in.function = selectBinary(node.op, 0);
+            }
+            break;
+        }
+    }
+
+    m_instructions.push_back(in);
+
+    return reg;
+}
+
+
+boost::uint32_t Kernel::run(PointBuffer& buffer)
+{
+    const boost::uint32_t numPoints = buffer.getNumPoints();
+    m_mask.assign(numPoints, 1);
+
+    // the extent a reader set no longer holds once points move, and
+    // filters.crop decides whole buffers from it
+    if (m_movesPoints)
+        buffer.setSpatialBounds(Bounds<double>());
+
+    if (numPoints == 0)
+        return 0;
+
+    Context context;
+    context.stride = buffer.getSchema().getByteSize();
+    context.registers = &m_registers.front();
+
+    for (boost::uint32_t begin = 0; begin < numPoints; begin += s_blockSize)
+    {
+        context.data = buffer.getData(0) + begin * context.stride;
+        context.count = (std::min)(s_blockSize, numPoints - begin);
+        context.mask = &m_mask.front() + begin;
+
+        for (std::vector<Instruction>::const_iterator in = m_instructions.begin(); in != m_instructions.end(); ++in)
+        {
+            in->function(*in, context);
+        }
+    }
+
+    if (!m_hasCondition)
+        return numPoints;
+    return static_cast<boost::uint32_t>(std::count(m_mask.begin(), m_mask.end(), 1));
+}
+
+
+boost::uint32_t Kernel::apply(PointBuffer& dst, PointBuffer& src)
+{
+    const boost::uint32_t numSrcPoints = src.getNumPoints();
+    const boost::uint32_t dstIndex = dst.getNumPoints();
+
+    run(src);
+    if (m_movesPoints)
+        dst.setSpatialBounds(Bounds<double>());
+
+    // copy the kept points a run at a time
+    boost::uint32_t numPointsAdded = 0;
+    boost::uint32_t i = 0;
+    while (i < numSrcPoints)
+    {
+        if (!m_mask[i])
+        {
+            ++i;
+            continue;
+        }
+
+        boost::uint32_t end = i;
+        while (end < numSrcPoints && m_mask[end])
+            ++end;
+
+        dst.copyPointsFast(dstIndex + numPointsAdded, i, src, end - i);
+        numPointsAdded += end - i;
+        i = end;
+    }
+
+    dst.setNumPoints(dstIndex + numPointsAdded);
+    assert(dst.getNumPoints() <= dst.getCapacity());
+
+    return numPointsAdded;
+}
+
+} // expression
+
+
+Expression::Expression(Stage& prevStage, const Options& options)
+    : pdal::Filter(prevStage, options)
+    , m_program(options.getValueOrThrow<std::string>("expression"))
+{
+    return;
+}
+
+
+Expression::Expression(Stage& prevStage, std::string const& expression)
+    : Filter(prevStage, Options::none())
+    , m_program(expression)
+{
+    return;
+}
+
+
+void Expression::initialize()
+{
+    Filter::initialize();
+
+    // check the names now rather than at the first read
+    expression::Kernel check(m_program, getSchema());
+
+    if (m_program.hasCondition())
+    {
+        this->setNumPoints(0);
+        this->setPointCountType(PointCount_Unknown);
+    }
+
+    return;
+}
+
+
+const Options Expression::getDefaultOptions() const
+{
+    Options options;
+    Option expression("expression", "", "statements to run on each point, separated by ';': conditions points must meet, or assignments like 'Intensity = Intensity * 0.5'");
+    options.add(expression);
+    return options;
+}
+
+
+boost::uint32_t Expression::processBuffer(PointBuffer& dstData, PointBuffer& srcData) const
+{
+    expression::Kernel kernel(m_program, srcData.getSchema());
+    return kernel.apply(dstData, srcData);
+}
+
+
+pdal::StageSequentialIterator* Expression::createSequentialIterator(PointBuffer& buffer) const
+{
+    return new pdal::filters::iterators::sequential::Expression(*this, buffer);
+}
+
+
+namespace iterators
+{
+namespace sequential
+{
+
+
+Expression::Expression(const pdal::filters::Expression& filter, PointBuffer& buffer)
+    : pdal::FilterSequentialIterator(filter, buffer)
+    , m_expressionFilter(filter)
+{
+    return;
+}
+
+
+void Expression::readBufferBeginImpl(PointBuffer& buffer)
+{
+    // We'll assume you're not changing the schema per-read call
+    if (!m_kernel)
+    {
+        m_kernel.reset(new expression::Kernel(m_expressionFilter.getProgram(), buffer.getSchema()));
+    }
+
+    return;
+}
+
+
+boost::uint32_t Expression::readBufferImpl(PointBuffer& dstData)
+{
+    // Without conditions every point is kept, so the points are read
+    // straight into dstData and changed there.
+    if (!m_expressionFilter.getProgram().hasCondition())
+    {
+        const boost::uint32_t numRead = getPrevIterator().read(dstData);
+        m_kernel->run(dstData);
+        return numRead;
+    }
+
+    // The client has asked us for dstData.getCapacity() points.
+    // We will read from our previous stage until we get that amount (or
+    // until the previous stage runs out of points).
+
+    boost::uint32_t numPointsNeeded = dstData.getCapacity();
+    assert(dstData.getNumPoints() == 0);
+
+    while (numPointsNeeded > 0)
+    {
+        if (getPrevIterator().atEnd()) break;
+
+        // set up buffer to be filled by prev stage
+        PointBuffer srcData(dstData.getSchema(), numPointsNeeded);
+
+        // read from prev stage
+        const boost::uint32_t numSrcPointsRead = getPrevIterator().read(srcData);
+        assert(numSrcPointsRead == srcData.getNumPoints());
+        assert(numSrcPointsRead <= numPointsNeeded);
+
+        // we got no data, and there is no more to get -- exit the loop
+        if (numSrcPointsRead == 0) break;
+
+        const boost::uint32_t numPointsProcessed = m_kernel->apply(dstData, srcData);
+
+        numPointsNeeded -= numPointsProcessed;
+    }
+
+    const boost::uint32_t numPointsAchieved = dstData.getNumPoints();
+
+    return numPointsAchieved;
+}
+
+
+boost::uint64_t Expression::skipImpl(boost::uint64_t count)
+{
+    if (!m_expressionFilter.getProgram().hasCondition())
+    {
+        return getPrevIterator().skip(count);
+    }
+
+    return naiveSkipImpl(count);
+}
+
+
+bool Expression::atEndImpl() const
+{
+    return getPrevIterator().atEnd();
+}
+
+
+}
+} // iterators::sequential
+
+}
+} // pdal::filters
@@ -34,10 +34,15 @@
 
 #include <pdal/filters/InPlaceReprojection.hpp>
 
+#include <boost/bind.hpp>
 #include <boost/concept_check.hpp> // ignore_unused_variable_warning
 
+#include <pdal/ApproximateTransform.hpp>
 #include <pdal/PointBuffer.hpp>
 
+#include <algorithm>
+#include <vector>
+
 #ifdef PDAL_HAVE_GDAL
 #include <gdal.h>
 #include <ogr_spatialref.h>
@@ -149,6 +154,14 @@ void InPlaceReprojection::initialize()
 
 #endif
 
+    const double maxError = getOptions().getValueOrDefault<double>("approximation_error", 0.0);
+    if (maxError > 0.0)
+    {
+        m_approximation = boost::shared_ptr<ApproximateTransform>(
+            new ApproximateTransform(boost::bind(&InPlaceReprojection::transformExact, this, _1, _2, _3, _4),
+                                     maxError, getPrevStage().getBounds()));
+    }
+
     setSpatialReference(m_outSRS);
 
 
@@ -170,6 +183,7 @@ const Options InPlaceReprojection::getDefaultOptions() const
     Option x_offset("offset_x", 0.0f, "Offset for output X data in the case when 'X' dimension data are to be scaled.  Defaults to '0.0'.  If not set, the Dimensions's scale will be used");
     Option y_offset("offset_y", 0.0f, "Offset for output Y data in the case when 'Y' dimension data are to be scaled.  Defaults to '0.0'.  If not set, the Dimensions's scale will be used");
     Option z_offset("offset_z", 0.0f, "Offset for output Z data in the case when 'Z' dimension data are to be scaled.  Defaults to '0.0'.  If not set, the Dimensions's scale will be used");
+    Option approximation_error("approximation_error", 0.0, "Interpolate the transform to within this error, in output units.  Defaults to '0.0', which transforms every point exactly");
     options.add(in_srs);
     options.add(out_srs);
     options.add(x);
@@ -181,6 +195,7 @@ const Options InPlaceReprojection::getDefaultOptions() const
     options.add(x_offset);
     options.add(y_offset);
     options.add(z_offset);
+    options.add(approximation_error);
 
     return options;
 }
@@ -188,22 +203,48 @@ const Options InPlaceReprojection::getDefaultOptions() const
 
 
 void InPlaceReprojection::transform(double& x, double& y, double& z) const
+{
+    transform(&x, &y, &z, 1);
+    return;
+}
+
+
+void InPlaceReprojection::transform(double* x, double* y, double* z, boost::uint32_t count) const
+{
+    boost::mutex::scoped_lock lock(m_transformMutex);
+
+    if (m_approximation)
+        m_approximation->transform(x, y, z, count);
+    else
+        transformExact(x, y, z, count);
+
+    return;
+}
+
+
+void InPlaceReprojection::transformExact(double* x, double* y, double* z, boost::uint32_t count) const
 {
 
 #ifdef PDAL_HAVE_GDAL
-    int ret = 0;
+    if (count == 0)
+        return;
 
-    ret = OCTTransform(m_transform_ptr.get(), 1, &x, &y, &z);
-    if (!ret)
+    std::vector<int> success(count, 0);
+    int ret = OCTTransformEx(m_transform_ptr.get(), static_cast<int>(count), x, y, z, &success.front());
+
+    std::vector<int>::const_iterator failed = std::find(success.begin(), success.end(), 0);
+    if (!ret || failed != success.end())
     {
         std::ostringstream msg;
-        msg << "Could not project point for InPlaceReprojection::" << CPLGetLastErrorMsg() << ret;
+        msg << "Could not project point " << (failed - success.begin()) << " of " << count
+            << " for InPlaceReprojection::" << CPLGetLastErrorMsg() << ret;
         throw pdal_error(msg.str());
     }
 #else
     boost::ignore_unused_variable_warning(x);
     boost::ignore_unused_variable_warning(y);
     boost::ignore_unused_variable_warning(z);
+    boost::ignore_unused_variable_warning(count);
 #endif
 
     return;
@@ -541,64 +582,80 @@ boost::uint32_t InPlaceReprojection::readBufferImpl(PointBuffer& buffer)
     Dimension const& new_z = schema.getDimension(m_new_z_id);
 
     bool logOutput = m_reprojectionFilter.log()->getLevel() > logDEBUG4;
-    
+
+    // Gather the whole buffer so the transformer is called once per
+    // buffer instead of once per point.
+    m_x.resize(numPoints);
+    m_y.resize(numPoints);
+    m_z.resize(numPoints);
+
     for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
     {
-        double x = m_reprojectionFilter.getScaledValue(buffer, old_x, pointIndex);
-        double y = m_reprojectionFilter.getScaledValue(buffer, old_y, pointIndex);
-        double z = m_reprojectionFilter.getScaledValue(buffer, old_z, pointIndex);
-        
+        m_x[pointIndex] = m_reprojectionFilter.getScaledValue(buffer, old_x, pointIndex);
+        m_y[pointIndex] = m_reprojectionFilter.getScaledValue(buffer, old_y, pointIndex);
+        m_z[pointIndex] = m_reprojectionFilter.getScaledValue(buffer, old_z, pointIndex);
+
         if (logOutput)
-            m_reprojectionFilter.log()->get(logDEBUG5) << "input: " << x << " y: " << y << " z: " << z << std::endl;
-        m_reprojectionFilter.transform(x,y,z);
+            m_reprojectionFilter.log()->get(logDEBUG5) << "input: " << m_x[pointIndex] << " y: " << m_y[pointIndex] << " z: " << m_z[pointIndex] << std::endl;
+    }
+
+    if (numPoints)
+        m_reprojectionFilter.transform(&m_x.front(), &m_y.front(), &m_z.front(), numPoints);
+
+    for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
+    {
         if (logOutput)
-            m_reprojectionFilter.log()->get(logDEBUG5) << "output: " << x << " y: " << y << " z: " << z << std::endl;
-    
-        m_reprojectionFilter.setScaledValue(buffer, x, new_x, pointIndex);
-        m_reprojectionFilter.setScaledValue(buffer, y, new_y, pointIndex);
-        m_reprojectionFilter.setScaledValue(buffer, z, new_z, pointIndex);
-        
+            m_reprojectionFilter.log()->get(logDEBUG5) << "output: " << m_x[pointIndex] << " y: " << m_y[pointIndex] << " z: " << m_z[pointIndex] << std::endl;
+
+        m_reprojectionFilter.setScaledValue(buffer, m_x[pointIndex], new_x, pointIndex);
+        m_reprojectionFilter.setScaledValue(buffer, m_y[pointIndex], new_y, pointIndex);
+        m_reprojectionFilter.setScaledValue(buffer, m_z[pointIndex], new_z, pointIndex);
+
         if (logOutput)
         {
             m_reprojectionFilter.log()->get(logDEBUG5) << "scaled: " << m_reprojectionFilter.getScaledValue(buffer, new_x, pointIndex)
                   << " y: " << m_reprojectionFilter.getScaledValue(buffer, new_y, pointIndex)
                   << " z: " << m_reprojectionFilter.getScaledValue(buffer, new_z, pointIndex) << std::endl;
         }
-    
-        buffer.setNumPoints(pointIndex+1);
     }
 
+    buffer.setNumPoints(numPoints);
+
     updateBounds(buffer);
 
 
     return numPoints;
 }
 
+// The extent is taken from the stored points themselves: transforming the
+// corners of the old extent can understate it, and filters.crop decides
+// whole buffers from it.
 void InPlaceReprojection::updateBounds(PointBuffer& buffer)
 {
-    const Bounds<double>& oldBounds = buffer.getSpatialBounds();
-
-    double minx = oldBounds.getMinimum(0);
-    double miny = oldBounds.getMinimum(1);
-    double minz = oldBounds.getMinimum(2);
-    double maxx = oldBounds.getMaximum(0);
-    double maxy = oldBounds.getMaximum(1);
-    double maxz = oldBounds.getMaximum(2);
-
-    try
+    const boost::uint32_t numPoints = buffer.getNumPoints();
+    if (numPoints == 0)
     {
+        buffer.setSpatialBounds(Bounds<double>());
+        return;
+    }
 
-        m_reprojectionFilter.transform(minx, miny, minz);
-        m_reprojectionFilter.transform(maxx, maxy, maxz);
+    const Schema& schema = buffer.getSchema();
+    Dimension const& new_x = schema.getDimension(m_new_x_id);
+    Dimension const& new_y = schema.getDimension(m_new_y_id);
+    Dimension const& new_z = schema.getDimension(m_new_z_id);
 
-    }
-    catch (pdal::pdal_error&)
+    Bounds<double> newBounds;
+    for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
     {
-        return;
+        const double x = m_reprojectionFilter.getScaledValue(buffer, new_x, pointIndex);
+        const double y = m_reprojectionFilter.getScaledValue(buffer, new_y, pointIndex);
+        const double z = m_reprojectionFilter.getScaledValue(buffer, new_z, pointIndex);
+        if (pointIndex == 0)
+            newBounds = Bounds<double>(x, y, z, x, y, z);
+        else
+            newBounds.grow(Vector<double>(x, y, z));
     }
 
-    Bounds<double> newBounds(minx, miny, minz, maxx, maxy, maxz);
-
     buffer.setSpatialBounds(newBounds);
 
     return;
@@ -0,0 +1,196 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <pdal/filters/PointBufferSpill.hpp>
+
+#include <pdal/FileUtils.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/Utils.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <cstring>
+
+namespace pdal
+{
+
+
+PointBufferSpill::PointBufferSpill(const Schema& schema,
+                                   boost::uint32_t blockCapacity,
+                                   boost::uint64_t maxBytes,
+                                   const std::string& directory)
+    : m_schema(schema)
+    , m_blockCapacity(blockCapacity)
+    , m_slotBytes(static_cast<boost::uint64_t>(schema.getByteSize()) * blockCapacity)
+    , m_numSlots(0)
+    , m_numSpillMisses(0)
+    , m_numSpillHits(0)
+    , m_numSpillWrites(0)
+{
+    if (m_slotBytes == 0)
+        throw pdal_error("spill blocks must not be empty");
+
+    const boost::uint64_t numSlots = maxBytes / m_slotBytes;
+    if (numSlots == 0)
+        throw pdal_error("spill file limit is smaller than one block");
+    m_numSlots = static_cast<boost::uint32_t>(std::min<boost::uint64_t>(numSlots, 0xffffffff));
+
+    m_filename = directory.empty() ?
+                 Utils::generate_tempfile() :
+                 (boost::filesystem::path(directory) / Utils::generate_filename()).string();
+
+    // The file is created at its full size, which costs no disk space
+    // until the slots are written on filesystems with sparse files.
+    boost::iostreams::mapped_file_params params(m_filename);
+    params.mode = std::ios_base::in | std::ios_base::out;
+    params.new_file_size = static_cast<boost::iostreams::stream_offset>(m_slotBytes * m_numSlots);
+    try
+    {
+        m_file.reset(new boost::iostreams::mapped_file(params));
+    }
+    catch (std::exception& e)
+    {
+        FileUtils::deleteFile(m_filename);
+        throw pdal_error("unable to create spill file " + m_filename + ": " + e.what());
+    }
+
+    m_free.reserve(m_numSlots);
+    for (boost::uint32_t i = m_numSlots; i > 0; --i)
+        m_free.push_back(i - 1);
+
+    return;
+}
+
+
+PointBufferSpill::~PointBufferSpill()
+{
+    m_file->close();
+    m_file.reset();
+    FileUtils::deleteFile(m_filename);
+}
+
+
+bool PointBufferSpill::put(boost::uint64_t key, const PointBuffer& block)
+{
+    if (block.getSchema().getByteSize() != m_schema.getByteSize() ||
+            block.getNumPoints() > m_blockCapacity)
+        return false;
+
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    // blocks never change, so one written already is still good; this
+    // happens when iterators race to fill a block
+    std::map<boost::uint64_t, Slot>::iterator i = m_slots.find(key);
+    if (i != m_slots.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, i->second.lru);
+        return true;
+    }
+
+    Slot slot;
+    if (m_free.empty())
+    {
+        std::map<boost::uint64_t, Slot>::iterator victim = m_slots.find(m_lru.back());
+        slot.index = victim->second.index;
+        m_slots.erase(victim);
+        m_lru.pop_back();
+    }
+    else
+    {
+        slot.index = m_free.back();
+        m_free.pop_back();
+    }
+
+    slot.numPoints = block.getNumPoints();
+    std::memcpy(m_file->data() + slot.index * m_slotBytes,
+                block.getData(0),
+                static_cast<std::size_t>(block.getBufferByteLength()));
+    m_lru.push_front(key);
+    slot.lru = m_lru.begin();
+    m_slots.insert(std::make_pair(key, slot));
+    ++m_numSpillWrites;
+
+    return true;
+}
+
+
+PointBuffer* PointBufferSpill::get(boost::uint64_t key)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    std::map<boost::uint64_t, Slot>::iterator i = m_slots.find(key);
+    if (i == m_slots.end())
+    {
+        ++m_numSpillMisses;
+        return NULL;
+    }
+    ++m_numSpillHits;
+
+    const Slot slot = i->second;
+    PointBuffer* block = new PointBuffer(m_schema, m_blockCapacity);
+    std::memcpy(block->getData(0),
+                m_file->const_data() + slot.index * m_slotBytes,
+                static_cast<std::size_t>(m_schema.getByteSize()) * slot.numPoints);
+    block->setNumPoints(slot.numPoints);
+
+    // The block goes back into memory, and is written again if it is
+    // evicted again; until then its slot is better used for another.
+    m_lru.erase(slot.lru);
+    m_slots.erase(i);
+    m_free.push_back(slot.index);
+
+    return block;
+}
+
+
+boost::uint32_t PointBufferSpill::getNumBlocks() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return static_cast<boost::uint32_t>(m_slots.size());
+}
+
+
+void PointBufferSpill::getSpillStats(boost::uint64_t& numSpillMisses,
+                                     boost::uint64_t& numSpillHits,
+                                     boost::uint64_t& numSpillWrites) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    numSpillMisses = m_numSpillMisses;
+    numSpillHits = m_numSpillHits;
+    numSpillWrites = m_numSpillWrites;
+}
+
+
+} // namespace pdal
@@ -48,6 +48,7 @@ namespace filters
 Predicate::Predicate(Stage& prevStage, const Options& options)
     : pdal::Filter(prevStage, options)
     , m_script(NULL)
+    , m_namedDimensionsOnly(false)
 {
     return;
 }
@@ -64,6 +65,7 @@ void Predicate::initialize()
     Filter::initialize();
 
     m_script = new pdal::plang::Script(getOptions());
+    m_namedDimensionsOnly = getOptions().getValueOrDefault<bool>("named_dimensions_only", false);
 
     log()->get(logDEBUG)  << "script " << *m_script << std::endl;
 
@@ -84,6 +86,9 @@ const Options Predicate::getDefaultOptions() const
     Option function("function", "");
     options.add(function);
 
+    Option namedOnly("named_dimensions_only", false, "pass the script only the dimensions it names as string constants");
+    options.add(namedOnly);
+
     return options;
 }
 
@@ -126,6 +131,10 @@ boost::uint32_t Predicate::processBuffer(PointBuffer& srcData, PointBuffer& dstD
 
     dstData.setNumPoints(count);
 
+    // the script is handed writable arrays, so the points it kept may have
+    // been moved; do not let an extent from an earlier read stand for them
+    dstData.setSpatialBounds(Bounds<double>());
+
     delete[] mask;
 
     return count;
@@ -167,7 +176,7 @@ void Predicate::createParser()
 {
     const pdal::plang::Script& script = m_predicateFilter.getScript();
 
-    m_pythonMethod = new pdal::plang::BufferedInvocation(script);
+    m_pythonMethod = new pdal::plang::BufferedInvocation(script, m_predicateFilter.namedDimensionsOnly());
 
     m_pythonMethod->compile();
 
@@ -48,6 +48,7 @@ namespace filters
 Programmable::Programmable(Stage& prevStage, const Options& options)
     : pdal::Filter(prevStage, options)
     , m_script(NULL)
+    , m_namedDimensionsOnly(false)
 {
     return;
 }
@@ -64,6 +65,7 @@ void Programmable::initialize()
     Filter::initialize();
 
     m_script = new pdal::plang::Script(getOptions());
+    m_namedDimensionsOnly = getOptions().getValueOrDefault<bool>("named_dimensions_only", false);
 
     log()->get(logDEBUG)  << "script " << *m_script << std::endl;
 
@@ -84,6 +86,9 @@ const Options Programmable::getDefaultOptions() const
     Option function("function", "");
     options.add(function);
 
+    Option namedOnly("named_dimensions_only", false, "pass the script only the dimensions it names as string constants");
+    options.add(namedOnly);
+
     return options;
 
 }
@@ -99,6 +104,10 @@ void Programmable::processBuffer(PointBuffer& data, pdal::plang::BufferedInvocat
 
     python.endChunk(data);
 
+    // the script may have moved the points, through its outputs or through
+    // the arrays it was handed, so whatever extent the buffer carried is gone
+    data.setSpatialBounds(Bounds<double>());
+
     return;
 }
 
@@ -137,7 +146,7 @@ void Programmable::createParser()
 {
     const pdal::plang::Script& script = m_programmableFilter.getScript();
 
-    m_pythonMethod = new pdal::plang::BufferedInvocation(script);
+    m_pythonMethod = new pdal::plang::BufferedInvocation(script, m_programmableFilter.namedDimensionsOnly());
 
     m_pythonMethod->compile();
 
@@ -34,10 +34,14 @@
 
 #include <pdal/filters/Reprojection.hpp>
 
+#include <boost/bind.hpp>
 #include <boost/concept_check.hpp> // ignore_unused_variable_warning
 
+#include <pdal/ApproximateTransform.hpp>
 #include <pdal/PointBuffer.hpp>
 
+#include <algorithm>
+#include <vector>
 
 #ifdef PDAL_HAVE_GDAL
 #include <gdal.h>
@@ -174,6 +178,14 @@ void Reprojection::initialize()
 
 #endif
 
+    const double maxError = getOptions().getValueOrDefault<double>("approximation_error", 0.0);
+    if (maxError > 0.0)
+    {
+        m_approximation = boost::shared_ptr<ApproximateTransform>(
+            new ApproximateTransform(boost::bind(&Reprojection::transformExact, this, _1, _2, _3, _4),
+                                     maxError, getPrevStage().getBounds()));
+    }
+
     setSpatialReference(m_outSRS);
 
     updateBounds();
@@ -185,6 +197,10 @@ void Reprojection::initialize()
 const Options Reprojection::getDefaultOptions() const
 {
     Options options;
+
+    Option approximation_error("approximation_error", 0.0, "Interpolate the transform to within this error, in output units (0 transforms every point exactly)");
+    options.add(approximation_error);
+
     return options;
 }
 
@@ -193,26 +209,20 @@ void Reprojection::updateBounds()
 {
     const Bounds<double>& oldBounds = getBounds();
 
-    double minx = oldBounds.getMinimum(0);
-    double miny = oldBounds.getMinimum(1);
-    double minz = oldBounds.getMinimum(2);
-    double maxx = oldBounds.getMaximum(0);
-    double maxy = oldBounds.getMaximum(1);
-    double maxz = oldBounds.getMaximum(2);
+    double x[2] = { oldBounds.getMinimum(0), oldBounds.getMaximum(0) };
+    double y[2] = { oldBounds.getMinimum(1), oldBounds.getMaximum(1) };
+    double z[2] = { oldBounds.getMinimum(2), oldBounds.getMaximum(2) };
 
     try
     {
-
-        transform(minx, miny, minz);
-        transform(maxx, maxy, maxz);
-
+        transformExact(x, y, z, 2);
     }
     catch (pdal::pdal_error&)
     {
         return;
     }
 
-    Bounds<double> newBounds(minx, miny, minz, maxx, maxy, maxz);
+    Bounds<double> newBounds(x[0], y[0], z[0], x[1], y[1], z[1]);
 
     setBounds(newBounds);
 
@@ -239,23 +249,42 @@ void Reprojection::checkImpedance()
 }
 
 
-void Reprojection::transform(double& x, double& y, double& z) const
+void Reprojection::transform(double* x, double* y, double* z, boost::uint32_t count) const
+{
+    boost::mutex::scoped_lock lock(m_transformMutex);
+
+    if (m_approximation)
+        m_approximation->transform(x, y, z, count);
+    else
+        transformExact(x, y, z, count);
+
+    return;
+}
+
+
+void Reprojection::transformExact(double* x, double* y, double* z, boost::uint32_t count) const
 {
 
 #ifdef PDAL_HAVE_GDAL
-    int ret = 0;
+    if (count == 0)
+        return;
+
+    std::vector<int> success(count, 0);
+    int ret = OCTTransformEx(m_transform_ptr.get(), static_cast<int>(count), x, y, z, &success.front());
 
-    ret = OCTTransform(m_transform_ptr.get(), 1, &x, &y, &z);
-    if (!ret)
+    std::vector<int>::const_iterator failed = std::find(success.begin(), success.end(), 0);
+    if (!ret || failed != success.end())
     {
         std::ostringstream msg;
-        msg << "Could not project point for ReprojectionTransform::" << CPLGetLastErrorMsg() << ret;
+        msg << "Could not project point " << (failed - success.begin()) << " of " << count
+            << " for ReprojectionTransform::" << CPLGetLastErrorMsg() << ret;
         throw pdal_error(msg.str());
     }
 #else
     boost::ignore_unused_variable_warning(x);
     boost::ignore_unused_variable_warning(y);
     boost::ignore_unused_variable_warning(z);
+    boost::ignore_unused_variable_warning(count);
 #endif
 
     return;
@@ -265,6 +294,8 @@ void Reprojection::transform(double& x, double& y, double& z) const
 void Reprojection::processBuffer(PointBuffer& data) const
 {
     const boost::uint32_t numPoints = data.getNumPoints();
+    if (numPoints == 0)
+        return;
 
     const Schema& schema = data.getSchema();
 
@@ -272,22 +303,31 @@ void Reprojection::processBuffer(PointBuffer& data) const
     Dimension const& dimY = schema.getDimension("Y");
     Dimension const& dimZ = schema.getDimension("Z");
 
+    // Gather the whole buffer so the transformer is called once per
+    // buffer instead of once per point.
+    std::vector<double> x(numPoints);
+    std::vector<double> y(numPoints);
+    std::vector<double> z(numPoints);
 
     for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
     {
-        double x = data.getField<double>(dimX, pointIndex);
-        double y = data.getField<double>(dimY, pointIndex);
-        double z = data.getField<double>(dimZ, pointIndex);
-
-        this->transform(x,y,z);
+        x[pointIndex] = data.getField<double>(dimX, pointIndex);
+        y[pointIndex] = data.getField<double>(dimY, pointIndex);
+        z[pointIndex] = data.getField<double>(dimZ, pointIndex);
+    }
 
-        data.setField<double>(dimX, pointIndex, x);
-        data.setField<double>(dimY, pointIndex, y);
-        data.setField<double>(dimZ, pointIndex, z);
+    this->transform(&x.front(), &y.front(), &z.front(), numPoints);
 
-        data.setNumPoints(pointIndex+1);
+    for (boost::uint32_t pointIndex=0; pointIndex<numPoints; pointIndex++)
+    {
+        data.setField<double>(dimX, pointIndex, x[pointIndex]);
+        data.setField<double>(dimY, pointIndex, y[pointIndex]);
+        data.setField<double>(dimZ, pointIndex, z[pointIndex]);
     }
 
+    // whatever extent the buffer carried is in the input SRS
+    data.setSpatialBounds(Bounds<double>());
+
     return;
 }
 
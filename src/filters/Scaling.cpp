@@ -36,6 +36,10 @@
 
 #include <pdal/PointBuffer.hpp>
 
+#include <pdal/Utils.hpp>
+
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <map>
 
@@ -251,433 +255,277 @@ dimension::Interpretation Scaling::getInterpretation(std::string const& t) const
 
 }
 
-boost::uint32_t Scaling::readBufferImpl(PointBuffer& buffer)
+namespace
 {
-    const Schema& schema = buffer.getSchema();
 
-    const boost::uint32_t numRead = getPrevIterator().read(buffer);
+// Points are rescaled a block at a time: the source column is gathered
+// into doubles, rescaled in one contiguous pass the compiler can
+// vectorize, and converted back out to the destination column.
+const boost::uint32_t kScalingBlockSize = 256;
+
+inline void rescale(double* values, boost::uint32_t count, scaling::Operation const& op)
+{
+    const double fromScale = op.fromScale;
+    const double fromOffset = op.fromOffset;
+    const double toScale = op.toScale;
+    const double toOffset = op.toOffset;
+    for (boost::uint32_t i = 0; i < count; ++i)
+        values[i] = (values[i] * fromScale + fromOffset - toOffset) / toScale;
 
-    for (boost::uint32_t pointIndex=0; pointIndex<numRead; pointIndex++)
+    return;
+}
+
+template <typename S>
+inline void gather(boost::uint8_t const* src, std::size_t stride, boost::uint32_t count, double* values)
+{
+    for (boost::uint32_t i = 0; i < count; ++i)
     {
-        std::map<dimension::id, dimension::id>::const_iterator d;
-        for (d = m_scale_map.begin(); d != m_scale_map.end(); ++d)
-        {
-            Dimension const& from_dimension = schema.getDimension(d->first);
-            Dimension const& to_dimension = schema.getDimension(d->second);
-            writeScaledData(buffer, from_dimension, to_dimension, pointIndex);
-        }
+        S value;
+        std::memcpy(&value, src + i * stride, sizeof(S));
+        values[i] = static_cast<double>(value);
     }
-    return numRead;
+
+    return;
 }
 
 
 #ifdef PDAL_COMPILER_MSVC
-// the writeScaledData function causes lots of conversion warnings which
-// are real but which we will ignore: blame the filter's user for casting badly
+// the conversions below are real but which we will ignore: blame the
+// filter's user for casting badly
 #  pragma warning(push)
 #  pragma warning(disable: 4244)  // conversion from T1 to T2, possible loss of data
 #endif
 
-void Scaling::writeScaledData(PointBuffer& buffer,
-                              Dimension const& from_dimension,
-                              Dimension const& to_dimension,
-                              boost::uint32_t pointIndex)
+// Float to SignedInteger or Float, and SignedInteger to SignedInteger:
+// the rescaled value is truncated to the source type, then converted to
+// the destination type.
+template <typename S, typename D>
+void truncateColumn(boost::uint8_t const* src, boost::uint8_t* dst, std::size_t stride,
+                    boost::uint32_t count, scaling::Operation const& op)
 {
-    if (from_dimension.getInterpretation() == dimension::Float)
+    double values[kScalingBlockSize];
+
+    for (boost::uint32_t first = 0; first < count; first += kScalingBlockSize)
     {
-        if (from_dimension.getByteSize() == 4)
+        const boost::uint32_t n = (std::min)(kScalingBlockSize, count - first);
+        const std::size_t base = first * stride;
+
+        gather<S>(src + base, stride, n, values);
+        rescale(values, n, op);
+        for (boost::uint32_t i = 0; i < n; ++i)
         {
-            float v = buffer.getField<float>(from_dimension, pointIndex);
-            scale(from_dimension,
-                  to_dimension,
-                  v);
-            if (to_dimension.getInterpretation() == dimension::SignedInteger)
-            {
-                if (to_dimension.getByteSize() == 1)
-                    buffer.setField<boost::int8_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 2)
-                    buffer.setField<boost::int16_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 4)
-                    buffer.setField<boost::int32_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<boost::int64_t>(to_dimension, pointIndex, v);
-                else
-                    throw pdal_error("Unable to convert dimension::Float to dimension::SignedInteger of size >8");
-                return;
-            }
+            const D value = static_cast<D>(static_cast<S>(values[i]));
+            std::memcpy(dst + base + i * stride, &value, sizeof(D));
         }
-        else if (from_dimension.getByteSize() == 8)
-        {
-            double v = buffer.getField<double>(from_dimension, pointIndex);
-            scale(from_dimension,
-                  to_dimension,
-                  v);
-            if (to_dimension.getInterpretation() == dimension::SignedInteger)
-            {
-                if (to_dimension.getByteSize() == 1)
-                    buffer.setField<boost::int8_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 2)
-                    buffer.setField<boost::int16_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 4)
-                    buffer.setField<boost::int32_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<boost::int64_t>(to_dimension, pointIndex, v);
-                else
-                    throw pdal_error("Unable to convert dimension::Float to dimension::SignedInteger of size >8");
-                return;
-            }
-        }
-        else
+    }
+
+    return;
+}
+
+// SignedInteger to Float, and UnsignedInteger to UnsignedInteger or
+// Float: the rescaled value is rounded, as Dimension::removeScaling does.
+template <typename S, typename D>
+void roundColumn(boost::uint8_t const* src, boost::uint8_t* dst, std::size_t stride,
+                 boost::uint32_t count, scaling::Operation const& op)
+{
+    double values[kScalingBlockSize];
+
+    for (boost::uint32_t first = 0; first < count; first += kScalingBlockSize)
+    {
+        const boost::uint32_t n = (std::min)(kScalingBlockSize, count - first);
+        const std::size_t base = first * stride;
+
+        gather<S>(src + base, stride, n, values);
+        rescale(values, n, op);
+        for (boost::uint32_t i = 0; i < n; ++i)
         {
-            std::ostringstream oss;
-            oss << "Unable to interpret Float of size '" << from_dimension.getByteSize() <<"'";
-            throw pdal_error(oss.str());
+            const D value = static_cast<D>(Utils::sround(values[i]));
+            std::memcpy(dst + base + i * stride, &value, sizeof(D));
         }
     }
 
-    if (from_dimension.getInterpretation() == dimension::SignedInteger)
+    return;
+}
+
+#ifdef PDAL_COMPILER_MSVC
+#  pragma warning(pop)
+#endif
+
+
+template <typename S>
+scaling::Operation::Function selectTruncating(Dimension const& to)
+{
+    const boost::uint32_t size = to.getByteSize();
+    if (to.getInterpretation() == dimension::SignedInteger)
+    {
+        if (size == 1)
+            return &truncateColumn<S, boost::int8_t>;
+        else if (size == 2)
+            return &truncateColumn<S, boost::int16_t>;
+        else if (size == 4)
+            return &truncateColumn<S, boost::int32_t>;
+        else if (size == 8)
+            return &truncateColumn<S, boost::int64_t>;
+    }
+    else if (to.getInterpretation() == dimension::Float)
+    {
+        if (size == 4)
+            return &truncateColumn<S, float>;
+        else if (size == 8)
+            return &truncateColumn<S, double>;
+    }
+
+    std::ostringstream oss;
+    oss << "Unable to scale dimension '" << to.getName() << "' to "
+        << to.getInterpretation() << " of size " << size;
+    throw pdal_error(oss.str());
+}
+
+
+template <typename S>
+scaling::Operation::Function selectRounding(Dimension const& to)
+{
+    const boost::uint32_t size = to.getByteSize();
+    if (to.getInterpretation() == dimension::UnsignedInteger)
     {
+        if (size == 1)
+            return &roundColumn<S, boost::uint8_t>;
+        else if (size == 2)
+            return &roundColumn<S, boost::uint16_t>;
+        else if (size == 4)
+            return &roundColumn<S, boost::uint32_t>;
+        else if (size == 8)
+            return &roundColumn<S, boost::uint64_t>;
+    }
+    else if (to.getInterpretation() == dimension::Float)
+    {
+        if (size == 4)
+            return &roundColumn<S, float>;
+        else if (size == 8)
+            return &roundColumn<S, double>;
+    }
 
-        if (to_dimension.getInterpretation() == dimension::SignedInteger)
-        {
-            if (from_dimension.getByteSize() == 1)
-            {
-                boost::int8_t v = buffer.getField<boost::int8_t>(from_dimension, pointIndex);
-                scale(from_dimension,
-                      to_dimension,
-                      v);
-                if (to_dimension.getByteSize() == 1)
-                    buffer.setField<boost::int8_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 2)
-                    buffer.setField<boost::int16_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 4)
-                    buffer.setField<boost::int32_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<boost::int64_t>(to_dimension, pointIndex, v);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 1 to SignedInteger of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 2)
-            {
-                boost::int16_t v = buffer.getField<boost::int16_t>(from_dimension, pointIndex);
-                scale(from_dimension,
-                      to_dimension,
-                      v);
-                if (to_dimension.getByteSize() == 1)
-                    buffer.setField<boost::int8_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 2)
-                    buffer.setField<boost::int16_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 4)
-                    buffer.setField<boost::int32_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<boost::int64_t>(to_dimension, pointIndex, v);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 2 to SignedInteger of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 4)
-            {
-                boost::int32_t v = buffer.getField<boost::int32_t>(from_dimension, pointIndex);
-                scale(from_dimension,
-                      to_dimension,
-                      v);
-                if (to_dimension.getByteSize() == 1)
-                    buffer.setField<boost::int8_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 2)
-                    buffer.setField<boost::int16_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 4)
-                    buffer.setField<boost::int32_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<boost::int64_t>(to_dimension, pointIndex, v);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 4 to SignedInteger of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 8)
-            {
-                boost::int64_t v = buffer.getField<boost::int64_t>(from_dimension, pointIndex);
-                scale(from_dimension,
-                      to_dimension,
-                      v);
-                if (to_dimension.getByteSize() == 1)
-                    buffer.setField<boost::int8_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 2)
-                    buffer.setField<boost::int16_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 4)
-                    buffer.setField<boost::int32_t>(to_dimension, pointIndex, v);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<boost::int64_t>(to_dimension, pointIndex, v);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 8 to SignedInteger of size > 8");
-                return;
-            }
-            else
-            {
-                throw pdal_error("Unable to convert dimension::SignedInteger >8 to dimension::SignedInteger of size >8");
-            }
+    std::ostringstream oss;
+    oss << "Unable to scale dimension '" << to.getName() << "' to "
+        << to.getInterpretation() << " of size " << size;
+    throw pdal_error(oss.str());
+}
 
-        }
-        else if (to_dimension.getInterpretation() == dimension::Float)
-        {
 
-            if (from_dimension.getByteSize() == 1)
-            {
-                boost::int8_t v = buffer.getField<boost::int8_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 1 to Float of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 2)
-            {
-                boost::int16_t v = buffer.getField<boost::int16_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 2 to Float of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 4)
-            {
-                boost::int32_t v = buffer.getField<boost::int32_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 4 to Float of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 8)
+scaling::Operation::Function selectFunction(Dimension const& from, Dimension const& to)
+{
+    const boost::uint32_t size = from.getByteSize();
+    switch (from.getInterpretation())
+    {
+        case dimension::Float:
+            if (size == 4)
+                return selectTruncating<float>(to);
+            else if (size == 8)
+                return selectTruncating<double>(to);
+            break;
+
+        case dimension::SignedInteger:
+            if (to.getInterpretation() == dimension::Float)
             {
-                boost::int64_t v = buffer.getField<boost::int64_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from SignedInteger 8 to Float of size > 8");
-                return;
+                if (size == 1)
+                    return selectRounding<boost::int8_t>(to);
+                else if (size == 2)
+                    return selectRounding<boost::int16_t>(to);
+                else if (size == 4)
+                    return selectRounding<boost::int32_t>(to);
+                else if (size == 8)
+                    return selectRounding<boost::int64_t>(to);
             }
             else
             {
-                throw pdal_error("Unable to convert dimension::SignedInteger >8 to dimension::Float of size >8");
+                if (size == 1)
+                    return selectTruncating<boost::int8_t>(to);
+                else if (size == 2)
+                    return selectTruncating<boost::int16_t>(to);
+                else if (size == 4)
+                    return selectTruncating<boost::int32_t>(to);
+                else if (size == 8)
+                    return selectTruncating<boost::int64_t>(to);
             }
-
-        }
+            break;
+
+        case dimension::UnsignedInteger:
+            if (size == 1)
+                return selectRounding<boost::uint8_t>(to);
+            else if (size == 2)
+                return selectRounding<boost::uint16_t>(to);
+            else if (size == 4)
+                return selectRounding<boost::uint32_t>(to);
+            else if (size == 8)
+                return selectRounding<boost::uint64_t>(to);
+            break;
+
+        default:
+            break;
     }
 
-    if (from_dimension.getInterpretation() == dimension::UnsignedInteger)
+    std::ostringstream oss;
+    oss << "Unable to scale dimension '" << from.getName() << "' from "
+        << from.getInterpretation() << " of size " << size;
+    throw pdal_error(oss.str());
+}
+
+} // anonymous namespace
+
+
+void Scaling::compile(Schema const& schema)
+{
+    m_plan.clear();
+
+    std::map<dimension::id, dimension::id>::const_iterator d;
+    for (d = m_scale_map.begin(); d != m_scale_map.end(); ++d)
     {
+        Dimension const& from_dimension = schema.getDimension(d->first);
+        Dimension const& to_dimension = schema.getDimension(d->second);
+
+        scaling::Operation op;
+        op.function = selectFunction(from_dimension, to_dimension);
+        op.srcOffset = from_dimension.getByteOffset();
+        op.dstOffset = to_dimension.getByteOffset();
+        op.fromScale = from_dimension.getNumericScale();
+        op.fromOffset = from_dimension.getNumericOffset();
+        op.toScale = to_dimension.getNumericScale();
+        op.toOffset = to_dimension.getNumericOffset();
+        m_plan.push_back(op);
+    }
 
-        if (to_dimension.getInterpretation() == dimension::UnsignedInteger)
-        {
-            if (from_dimension.getByteSize() == 1)
-            {
-                boost::uint8_t v = buffer.getField<boost::uint8_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
+    return;
+}
 
-                if (to_dimension.getByteSize() == 1)
-                {
-                    boost::uint8_t i = to_dimension.removeScaling<boost::uint8_t>(d);
-                    buffer.setField<boost::uint8_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 2)
-                {
-                    boost::uint16_t i = to_dimension.removeScaling<boost::uint16_t>(d);
-                    buffer.setField<boost::uint16_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 4)
-                {
-                    boost::uint32_t i = to_dimension.removeScaling<boost::uint32_t>(d);
-                    buffer.setField<boost::uint32_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 8)
-                {
-                    boost::uint64_t i = to_dimension.removeScaling<boost::uint64_t>(d);
-                    buffer.setField<boost::uint64_t>(to_dimension, pointIndex, i);
-                }
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 8 to UnsignedInteger of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 2)
-            {
-                boost::uint16_t v = buffer.getField<boost::uint16_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
 
-                if (to_dimension.getByteSize() == 1)
-                {
-                    boost::uint8_t i = to_dimension.removeScaling<boost::uint8_t>(d);
-                    buffer.setField<boost::uint8_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 2)
-                {
-                    boost::uint16_t i = to_dimension.removeScaling<boost::uint16_t>(d);
-                    buffer.setField<boost::uint16_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 4)
-                {
-                    boost::uint32_t i = to_dimension.removeScaling<boost::uint32_t>(d);
-                    buffer.setField<boost::uint32_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 8)
-                {
-                    boost::uint64_t i = to_dimension.removeScaling<boost::uint64_t>(d);
-                    buffer.setField<boost::uint64_t>(to_dimension, pointIndex, i);
-                }
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 2 to UnsignedInteger of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 4)
-            {
-                boost::uint32_t v = buffer.getField<boost::uint32_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
+void Scaling::readBufferBeginImpl(PointBuffer& buffer)
+{
+    // We'll assume you're not changing the schema per-read call
+    if (m_plan.size() != m_scale_map.size())
+        compile(buffer.getSchema());
 
-                if (to_dimension.getByteSize() == 1)
-                {
-                    boost::uint8_t i = to_dimension.removeScaling<boost::uint8_t>(d);
-                    buffer.setField<boost::uint8_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 2)
-                {
-                    boost::uint16_t i = to_dimension.removeScaling<boost::uint16_t>(d);
-                    buffer.setField<boost::uint16_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 4)
-                {
-                    boost::uint32_t i = to_dimension.removeScaling<boost::uint32_t>(d);
-                    buffer.setField<boost::uint32_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 8)
-                {
-                    boost::uint64_t i = to_dimension.removeScaling<boost::uint64_t>(d);
-                    buffer.setField<boost::uint64_t>(to_dimension, pointIndex, i);
-                }
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 4 to UnsignedInteger of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 8)
-            {
-                boost::uint64_t v = buffer.getField<boost::uint64_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
+    return;
+}
 
-                if (to_dimension.getByteSize() == 1)
-                {
-                    boost::uint8_t i = to_dimension.removeScaling<boost::uint8_t>(d);
-                    buffer.setField<boost::uint8_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 2)
-                {
-                    boost::uint16_t i = to_dimension.removeScaling<boost::uint16_t>(d);
-                    buffer.setField<boost::uint16_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 4)
-                {
-                    boost::uint32_t i = to_dimension.removeScaling<boost::uint32_t>(d);
-                    buffer.setField<boost::uint32_t>(to_dimension, pointIndex, i);
-                }
-                else if (to_dimension.getByteSize() == 8)
-                {
-                    boost::uint64_t i = to_dimension.removeScaling<boost::uint64_t>(d);
-                    buffer.setField<boost::uint64_t>(to_dimension, pointIndex, i);
-                }
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 8 to UnsignedInteger of size > 8");
-                return;
-            }
-            else
-            {
-                throw pdal_error("Unable to convert dimension::UnsignedInteger >8 to dimension::UnsignedInteger of size >8");
-            }
 
-        }
-        else if (to_dimension.getInterpretation() == dimension::Float)
-        {
+boost::uint32_t Scaling::readBufferImpl(PointBuffer& buffer)
+{
+    const boost::uint32_t numRead = getPrevIterator().read(buffer);
+    if (numRead == 0)
+        return numRead;
 
-            if (from_dimension.getByteSize() == 1)
-            {
-                boost::uint8_t v = buffer.getField<boost::uint8_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 1 to Float of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 2)
-            {
-                boost::uint16_t v = buffer.getField<boost::uint16_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 2 to Float of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 4)
-            {
-                boost::uint32_t v = buffer.getField<boost::uint32_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 4 to Float of size > 8");
-                return;
-            }
-            else if (from_dimension.getByteSize() == 8)
-            {
-                boost::uint64_t v = buffer.getField<boost::uint64_t>(from_dimension, pointIndex);
-                double d = from_dimension.applyScaling<double>(v);
-                d = to_dimension.removeScaling<double>(d);
-                if (to_dimension.getByteSize() == 4)
-                    buffer.setField<float>(to_dimension, pointIndex, (float)d);
-                else if (to_dimension.getByteSize() == 8)
-                    buffer.setField<double>(to_dimension, pointIndex, d);
-                else
-                    throw pdal_error("Unable to convert dimension from UnsignedInteger 8 to Float of size > 8");
-                return;
-            }
-            else
-            {
-                throw pdal_error("Unable to convert dimension::UnsignedInteger >8 to dimension::Float of size >8");
-            }
+    const std::size_t stride = buffer.getSchema().getByteSize();
+    boost::uint8_t* data = buffer.getData(0);
 
-        }
+    std::vector<scaling::Operation>::const_iterator op;
+    for (op = m_plan.begin(); op != m_plan.end(); ++op)
+    {
+        op->function(data + op->srcOffset, data + op->dstOffset, stride, numRead, *op);
     }
 
-    throw pdal_error("Dimension data type unable to be scaled because it is Undefined");
+    return numRead;
 }
 
-#ifdef PDAL_COMPILER_MSVC
-#  pragma warning(pop)
-#endif
-
 
 boost::uint64_t Scaling::skipImpl(boost::uint64_t count)
 {
@@ -52,6 +52,7 @@ namespace filters
 Selector::Selector(Stage& prevStage, const Options& options)
     : Filter(prevStage, options)
     , m_ignoreDefault(true)
+    , m_packIgnored(false)
 {
     return;
 }
@@ -72,6 +73,7 @@ void Selector::checkImpedance()
     Options& options = getOptions();
     
     m_ignoreDefault = options.getValueOrDefault<bool>("ignore_default", true);
+    m_packIgnored = options.getValueOrDefault<bool>("pack", false);
     std::vector<Option>::const_iterator i;
     
     try
@@ -131,6 +133,8 @@ const Options Selector::getDefaultOptions() const
 {
     Options options;
     Option ignore("ignore", "DimensionName", "An Options set with entries of name 'dimension' names to ignore");
+    Option pack("pack", false, "Remove ignored dimensions from the buffer entirely so that upstream readers neither decode nor store them");
+    options.add(pack);
     return options;
 }
 
@@ -207,6 +211,12 @@ void Selector::alterSchema(PointBuffer& buffer)
 
     }
 
+    // Packing drops the ignored dimensions from the layout altogether. The
+    // upstream readers only decode what is in the buffer they are handed,
+    // so they skip the ignored fields and we only allocate what is kept.
+    if (m_selectorFilter.doPackIgnoredDimensions())
+        new_schema = new_schema.pack();
+
     buffer = PointBuffer(new_schema, buffer.getCapacity());
 }
 
@@ -37,6 +37,12 @@
 
 #include <pdal/PointBuffer.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace pdal
 {
@@ -48,6 +54,664 @@ namespace stats
 {
 
 
+//---------------------------------------------------------------------------
+// Moments
+
+Moments::Moments()
+    : m_count(0)
+    , m_mean(0.0)
+    , m_m2(0.0)
+    , m_minimum((std::numeric_limits<double>::max)())
+    , m_maximum(-(std::numeric_limits<double>::max)())
+{
+    return;
+}
+
+
+void Moments::insert(double const* first, double const* last)
+{
+    if (first == last)
+        return;
+
+    Moments block;
+    block.m_count = static_cast<boost::uint64_t>(last - first);
+
+    double sum(0.0);
+    double lo(*first);
+    double hi(*first);
+    for (double const* v = first; v != last; ++v)
+    {
+        sum += *v;
+        lo = *v < lo ? *v : lo;
+        hi = *v > hi ? *v : hi;
+    }
+    block.m_mean = sum / static_cast<double>(block.m_count);
+    block.m_minimum = lo;
+    block.m_maximum = hi;
+
+    double m2(0.0);
+    for (double const* v = first; v != last; ++v)
+    {
+        const double delta = *v - block.m_mean;
+        m2 += delta * delta;
+    }
+    block.m_m2 = m2;
+
+    merge(block);
+    return;
+}
+
+
+void Moments::merge(Moments const& other)
+{
+    if (other.m_count == 0)
+        return;
+    if (m_count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    const double na = static_cast<double>(m_count);
+    const double nb = static_cast<double>(other.m_count);
+    const double n = na + nb;
+    const double delta = other.m_mean - m_mean;
+
+    m_mean += delta * nb / n;
+    m_m2 += other.m_m2 + delta * delta * na * nb / n;
+    m_count += other.m_count;
+    m_minimum = (std::min)(m_minimum, other.m_minimum);
+    m_maximum = (std::max)(m_maximum, other.m_maximum);
+
+    return;
+}
+
+
+void Moments::reset()
+{
+    *this = Moments();
+    return;
+}
+
+
+double Moments::variance() const
+{
+    if (m_count == 0)
+        return 0.0;
+    return m_m2 / static_cast<double>(m_count);
+}
+
+
+double Moments::stddev() const
+{
+    return std::sqrt(variance());
+}
+
+
+//---------------------------------------------------------------------------
+// Histogram
+
+Histogram::Histogram(boost::uint32_t numBins,
+                     boost::uint32_t cacheSize,
+                     bool logSpaced)
+    : m_numBins(numBins)
+    , m_cacheSize(cacheSize)
+    , m_logSpaced(logSpaced)
+    , m_isFixed(false)
+    , m_isExact(true)
+    , m_lower(0.0)
+    , m_upper(0.0)
+    , m_binScale(0.0)
+    , m_counts(numBins + 2, 0)
+{
+    if (numBins == 0)
+        throw pdal_error("histogram needs at least one bin");
+    if (m_cacheSize == 0)
+        m_cacheSize = 1;
+
+    return;
+}
+
+
+Histogram Histogram::fixed(double lower,
+                           double upper,
+                           boost::uint32_t numBins,
+                           bool logSpaced)
+{
+    if (!(upper > lower))
+        throw pdal_error("histogram upper bound must be greater than its lower bound");
+    if (logSpaced && !(lower > 0.0))
+        throw pdal_error("log-spaced histogram needs a positive lower bound");
+
+    Histogram h(numBins, 1, logSpaced);
+    h.setRange(lower, upper);
+
+    return h;
+}
+
+
+void Histogram::setRange(double lower, double upper)
+{
+    m_lower = lower;
+    m_upper = upper;
+    m_isFixed = true;
+
+    if (m_logSpaced)
+        m_binScale = m_numBins / std::log(upper / lower);
+    else
+        m_binScale = m_numBins / (upper - lower);
+
+    return;
+}
+
+
+void Histogram::fixRange()
+{
+    if (m_isFixed)
+        return;
+
+    double lower(0.0);
+    double upper(0.0);
+    if (m_cache.size())
+    {
+        lower = *std::min_element(m_cache.begin(), m_cache.end());
+        upper = *std::max_element(m_cache.begin(), m_cache.end());
+    }
+
+    // Values that are not all positive can't be log-binned; such
+    // streams fall back to linear bins.
+    if (m_logSpaced && !(lower > 0.0))
+        m_logSpaced = false;
+
+    if (!(upper > lower))
+        upper = m_logSpaced ? lower * 2.0 : lower + 1.0;
+
+    setRange(lower, upper);
+
+    std::vector<double> cache;
+    cache.swap(m_cache);
+    for (std::vector<double>::const_iterator i = cache.begin(); i != cache.end(); ++i)
+        m_counts[getBin(*i)]++;
+
+    return;
+}
+
+
+boost::uint32_t Histogram::getBin(double value) const
+{
+    if (value < m_lower)
+        return 0;
+    if (value > m_upper)
+        return m_numBins + 1;
+
+    double position(0.0);
+    if (m_logSpaced)
+        position = std::log(value / m_lower) * m_binScale;
+    else
+        position = (value - m_lower) * m_binScale;
+
+    // compared before the cast, which a NaN position (from an infinite
+    // range) would make undefined
+    boost::uint32_t bin = m_numBins - 1;
+    if (position < static_cast<double>(bin))
+        bin = (position > 0.0) ? static_cast<boost::uint32_t>(position) : 0;
+
+    return bin + 1;
+}
+
+
+double Histogram::getEdge(boost::uint32_t edge) const
+{
+    const double fraction = static_cast<double>(edge) / static_cast<double>(m_numBins);
+    if (m_logSpaced)
+        return m_lower * std::pow(m_upper / m_lower, fraction);
+    return m_lower + (m_upper - m_lower) * fraction;
+}
+
+
+std::vector<std::pair<double, boost::uint64_t> > Histogram::getBins() const
+{
+    if (!m_isFixed)
+    {
+        Histogram h(*this);
+        h.fixRange();
+        return h.getBins();
+    }
+
+    std::vector<std::pair<double, boost::uint64_t> > bins;
+    bins.reserve(m_numBins + 2);
+
+    // The underflow bin is reported one bin width below the range.
+    const double below = m_logSpaced ?
+                         m_lower * m_lower / getEdge(1) :
+                         2.0 * m_lower - getEdge(1);
+    bins.push_back(std::make_pair(below, m_counts[0]));
+    for (boost::uint32_t i = 0; i < m_numBins; ++i)
+        bins.push_back(std::make_pair(getEdge(i), m_counts[i + 1]));
+    bins.push_back(std::make_pair(m_upper, m_counts[m_numBins + 1]));
+
+    return bins;
+}
+
+
+void Histogram::insert(double const* first, double const* last)
+{
+    for (; first != last && !m_isFixed; ++first)
+        insert(*first);
+
+    for (; first != last; ++first)
+    {
+        if (!boost::math::isnan(*first))
+            m_counts[getBin(*first)]++;
+    }
+
+    return;
+}
+
+
+bool Histogram::hasSameEdges(Histogram const& other) const
+{
+    return m_numBins == other.m_numBins &&
+           m_logSpaced == other.m_logSpaced &&
+           Utils::compare_approx(m_lower, other.m_lower, 0.0) &&
+           Utils::compare_approx(m_upper, other.m_upper, 0.0);
+}
+
+
+void Histogram::merge(Histogram const& other)
+{
+    if (!other.m_isFixed)
+    {
+        for (std::vector<double>::const_iterator i = other.m_cache.begin(); i != other.m_cache.end(); ++i)
+            insert(*i);
+        return;
+    }
+
+    if (!m_isFixed)
+    {
+        std::vector<double> cache;
+        cache.swap(m_cache);
+        *this = other;
+        for (std::vector<double>::const_iterator i = cache.begin(); i != cache.end(); ++i)
+            insert(*i);
+        return;
+    }
+
+    if (hasSameEdges(other))
+    {
+        for (boost::uint32_t i = 0; i < m_counts.size(); ++i)
+            m_counts[i] += other.m_counts[i];
+        m_isExact = m_isExact && other.m_isExact;
+        return;
+    }
+
+    redistribute(other);
+    return;
+}
+
+
+void Histogram::redistribute(Histogram const& other)
+{
+    // Out-of-range counts land in the bin holding the other side's range
+    // boundary: we know no better place for them.
+    m_counts[getBin(other.m_lower)] += other.m_counts[0];
+    m_counts[getBin(other.m_upper)] += other.m_counts[other.m_numBins + 1];
+
+    for (boost::uint32_t i = 0; i < other.m_numBins; ++i)
+    {
+        const boost::uint64_t cnt = other.m_counts[i + 1];
+        if (cnt == 0)
+            continue;
+
+        const double lo = other.getEdge(i);
+        const double hi = other.getEdge(i + 1);
+        const double width = hi - lo;
+
+        // Spread cnt over the bins that [lo, hi] overlaps, rounding the
+        // running total so the sum stays exactly cnt.
+        const boost::uint32_t first = getBin(lo);
+        const boost::uint32_t last = getBin(hi);
+        double covered(0.0);
+        boost::uint64_t assigned(0);
+        for (boost::uint32_t b = first; b <= last; ++b)
+        {
+            double binLo = (b == 0) ? lo : getEdge(b - 1);
+            double binHi = (b == m_numBins + 1) ? hi : getEdge(b);
+            if (b == 0) binHi = m_lower;
+            if (b == m_numBins + 1) binLo = m_upper;
+
+            const double overlap = (std::min)(hi, binHi) - (std::max)(lo, binLo);
+            if (overlap > 0.0 && width > 0.0)
+                covered += overlap / width;
+            if (b == last)
+                covered = 1.0;
+
+            const boost::uint64_t total = static_cast<boost::uint64_t>(Utils::sround(covered * static_cast<double>(cnt)));
+            m_counts[b] += total - assigned;
+            assigned = total;
+        }
+    }
+
+    m_isExact = false;
+    return;
+}
+
+
+void Histogram::reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_cache.clear();
+    m_isExact = true;
+    return;
+}
+
+
+//---------------------------------------------------------------------------
+// QuantileSketch
+
+QuantileSketch::QuantileSketch(boost::uint32_t k)
+    : m_k(k < 2 ? 2 : k)
+    , m_count(0)
+    , m_compactions(0)
+    , m_levels(1)
+{
+    m_levels[0].reserve(m_k);
+    return;
+}
+
+
+void QuantileSketch::compress()
+{
+    for (std::vector<std::vector<double> >::size_type h = 0; h < m_levels.size(); ++h)
+    {
+        if (m_levels[h].size() < m_k)
+            continue;
+
+        if (h + 1 == m_levels.size())
+            m_levels.push_back(std::vector<double>());
+
+        std::vector<double>& level = m_levels[h];
+        std::sort(level.begin(), level.end());
+
+        // An odd item out stays behind so the total weight is kept.
+        double leftover(0.0);
+        const bool odd = (level.size() % 2) != 0;
+        if (odd)
+        {
+            leftover = level.back();
+            level.pop_back();
+        }
+
+        const std::vector<double>::size_type offset = m_compactions++ % 2;
+        std::vector<double>& next = m_levels[h + 1];
+        for (std::vector<double>::size_type i = offset; i < level.size(); i += 2)
+            next.push_back(level[i]);
+
+        level.clear();
+        if (odd)
+            level.push_back(leftover);
+    }
+
+    return;
+}
+
+
+void QuantileSketch::insert(double const* first, double const* last)
+{
+    while (first != last)
+    {
+        std::vector<double>& level = m_levels[0];
+        const std::size_t room = m_k - level.size();
+        const std::size_t n = (std::min)(room, static_cast<std::size_t>(last - first));
+        level.insert(level.end(), first, first + n);
+        first += n;
+        m_count += n;
+        if (level.size() >= m_k)
+            compress();
+    }
+
+    return;
+}
+
+
+void QuantileSketch::merge(QuantileSketch const& other)
+{
+    if (m_levels.size() < other.m_levels.size())
+        m_levels.resize(other.m_levels.size());
+
+    for (std::vector<std::vector<double> >::size_type h = 0; h < other.m_levels.size(); ++h)
+        m_levels[h].insert(m_levels[h].end(), other.m_levels[h].begin(), other.m_levels[h].end());
+
+    m_count += other.m_count;
+    compress();
+
+    return;
+}
+
+
+void QuantileSketch::reset()
+{
+    m_levels.assign(1, std::vector<double>());
+    m_count = 0;
+    m_compactions = 0;
+    return;
+}
+
+
+double QuantileSketch::quantile(double q) const
+{
+    if (m_count == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    std::vector<std::pair<double, boost::uint64_t> > items;
+    for (std::vector<std::vector<double> >::size_type h = 0; h < m_levels.size(); ++h)
+    {
+        const boost::uint64_t weight = static_cast<boost::uint64_t>(1) << h;
+        for (std::vector<double>::const_iterator i = m_levels[h].begin(); i != m_levels[h].end(); ++i)
+            items.push_back(std::make_pair(*i, weight));
+    }
+    std::sort(items.begin(), items.end());
+
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    const double target = q * static_cast<double>(m_count);
+
+    boost::uint64_t cumulative(0);
+    for (std::vector<std::pair<double, boost::uint64_t> >::const_iterator i = items.begin(); i != items.end(); ++i)
+    {
+        cumulative += i->second;
+        if (static_cast<double>(cumulative) >= target)
+            return i->first;
+    }
+
+    return items.back().first;
+}
+
+
+//---------------------------------------------------------------------------
+// Reservoir
+
+Reservoir::Reservoir(boost::uint32_t size, boost::uint32_t seed)
+    : m_size(size)
+    , m_seen(0)
+    , m_skip(0)
+{
+    if (seed != 0)
+        m_rng.seed(seed);
+    return;
+}
+
+
+boost::uint64_t Reservoir::draw(boost::uint64_t n)
+{
+    boost::random::uniform_int_distribution<boost::uint64_t> dist(0, n - 1);
+    return dist(m_rng);
+}
+
+
+boost::uint64_t Reservoir::nextSkip()
+{
+    // an empty reservoir takes nothing, and the loop below would not end
+    if (m_size == 0)
+        return 0;
+
+    // Algorithm X: the chance that none of the next s values is picked
+    // is the product of (t + 1 - size) / (t + 1) over those values.
+    boost::random::uniform_01<double> uniform;
+    const double v = uniform(m_rng);
+
+    const double size = static_cast<double>(m_size);
+    double t = static_cast<double>(m_seen);
+    double quot = (t + 1.0 - size) / (t + 1.0);
+    boost::uint64_t skip(0);
+    while (quot > v)
+    {
+        ++skip;
+        t += 1.0;
+        quot *= (t + 1.0 - size) / (t + 1.0);
+    }
+
+    return skip;
+}
+
+
+void Reservoir::merge(Reservoir const& other)
+{
+    if (other.m_seen == 0)
+        return;
+
+    const boost::uint64_t total = m_seen + other.m_seen;
+    std::vector<double> const& theirs = other.m_sample;
+
+    if (m_size == 0)
+    {
+        m_seen = total;
+        return;
+    }
+
+    if (m_sample.size() + theirs.size() <= m_size)
+    {
+        m_sample.insert(m_sample.end(), theirs.begin(), theirs.end());
+        m_seen = total;
+        if (m_sample.size() == m_size)
+            m_skip = nextSkip();
+        return;
+    }
+
+    // Decide how many of the m_size slots each side gets by drawing
+    // without replacement from the combined population, then take that
+    // many items from each side's (already uniform) sample.
+    boost::uint64_t ours_left = m_seen;
+    boost::uint64_t theirs_left = other.m_seen;
+    boost::uint32_t from_ours(0);
+    for (boost::uint32_t i = 0; i < m_size; ++i)
+    {
+        if (draw(ours_left + theirs_left) < ours_left)
+        {
+            ++from_ours;
+            --ours_left;
+        }
+        else
+        {
+            --theirs_left;
+        }
+    }
+    const boost::uint32_t from_theirs = m_size - from_ours;
+
+    std::vector<double> mine(m_sample);
+    std::vector<double> other_copy(theirs);
+    std::vector<double> merged;
+    merged.reserve(m_size);
+
+    // partial Fisher-Yates shuffles pick the items
+    for (boost::uint32_t i = 0; i < from_ours; ++i)
+    {
+        std::swap(mine[i], mine[i + static_cast<std::vector<double>::size_type>(draw(mine.size() - i))]);
+        merged.push_back(mine[i]);
+    }
+    for (boost::uint32_t i = 0; i < from_theirs; ++i)
+    {
+        std::swap(other_copy[i], other_copy[i + static_cast<std::vector<double>::size_type>(draw(other_copy.size() - i))]);
+        merged.push_back(other_copy[i]);
+    }
+
+    m_sample.swap(merged);
+    m_seen = total;
+    m_skip = nextSkip();
+
+    return;
+}
+
+
+void Reservoir::reset()
+{
+    m_sample.clear();
+    m_seen = 0;
+    m_skip = 0;
+    return;
+}
+
+
+//---------------------------------------------------------------------------
+// Summary
+
+Summary::Summary(boost::uint32_t num_bins,
+                 boost::uint32_t sample_size,
+                 boost::uint32_t cache_size,
+                 boost::uint32_t seed,
+                 bool log_bins,
+                 boost::uint32_t sketch_size)
+    : m_histogram(num_bins, cache_size, log_bins)
+    , m_quantiles(sketch_size)
+    , m_sample(sample_size, seed)
+{
+    return;
+}
+
+
+Summary::Summary(Histogram const& histogram,
+                 boost::uint32_t sample_size,
+                 boost::uint32_t seed,
+                 boost::uint32_t sketch_size)
+    : m_histogram(histogram)
+    , m_quantiles(sketch_size)
+    , m_sample(sample_size, seed)
+{
+    return;
+}
+
+
+void Summary::insert(double const* first, double const* last)
+{
+    m_moments.insert(first, last);
+    m_histogram.insert(first, last);
+    m_quantiles.insert(first, last);
+    for (double const* v = first; v != last; ++v)
+        m_sample.insert(*v);
+    return;
+}
+
+
+void Summary::merge(Summary const& other)
+{
+    m_moments.merge(other.m_moments);
+    m_histogram.merge(other.m_histogram);
+    m_quantiles.merge(other.m_quantiles);
+    m_sample.merge(other.m_sample);
+    return;
+}
+
+
+void Summary::reset()
+{
+    m_moments.reset();
+    m_histogram.reset();
+    m_quantiles.reset();
+    m_sample.reset();
+    return;
+}
+
+
 boost::property_tree::ptree Summary::toPTree() const
 {
     boost::property_tree::ptree tree;
@@ -57,14 +721,24 @@ boost::property_tree::ptree Summary::toPTree() const
     tree.put("minimum", minimum());
     tree.put("maximum", maximum());
     tree.put("average", average());
+    tree.put("stddev", stddev());
+
+    if (cnt)
+    {
+        boost::property_tree::ptree quartiles;
+        quartiles.put("q1", quantile(0.25));
+        quartiles.put("median", quantile(0.5));
+        quartiles.put("q3", quantile(0.75));
+        tree.add_child("quartiles", quartiles);
+    }
 
     boost::property_tree::ptree bins;
-    histogram_type hist = histogram();
-    for (boost::int32_t i = 0; i < hist.size(); ++i)
+    std::vector<std::pair<double, boost::uint64_t> > hist = m_histogram.getBins();
+    for (std::vector<std::pair<double, boost::uint64_t> >::size_type i = 0; i < hist.size(); ++i)
     {
         boost::property_tree::ptree bin;
         bin.add("lower_bound", hist[i].first);
-        bin.add("count", Utils::sround(hist[i].second*cnt));
+        bin.add("count", hist[i].second);
         std::ostringstream binname;
         binname << "bin-" <<i;
         bins.add_child(binname.str(), bin);
@@ -72,9 +746,10 @@ boost::property_tree::ptree Summary::toPTree() const
     tree.add_child("histogram", bins);
 
     std::ostringstream sample;
-    for (std::vector<double>::size_type i =0; i < m_sample.size(); ++i)
+    std::vector<double> const& values = m_sample.sample();
+    for (std::vector<double>::size_type i =0; i < values.size(); ++i)
     {
-        sample << m_sample[i] << " ";
+        sample << values[i] << " ";
     };
 
     tree.add("sample", sample.str());
@@ -99,7 +774,7 @@ Stats::Stats(Stage& prevStage, const Options& options)
     metadata.addEntry<boost::uint32_t>("num_bins",
                                        getOptions().getValueOrDefault<boost::uint32_t>("num_bins", 20));
     metadata.addEntry<boost::uint32_t>("stats_cache_size",
-                                       getOptions().getValueOrDefault<boost::uint32_t>("num_bins", 20));
+                                       getOptions().getValueOrDefault<boost::uint32_t>("stats_cache_size", 1000));
 
     return;
 }
@@ -116,7 +791,7 @@ Stats::Stats(Stage& prevStage)
     metadata.addEntry<boost::uint32_t>("num_bins",
                                        getOptions().getValueOrDefault<boost::uint32_t>("num_bins", 20));
     metadata.addEntry<boost::uint32_t>("stats_cache_size",
-                                       getOptions().getValueOrDefault<boost::uint32_t>("num_bins", 20));
+                                       getOptions().getValueOrDefault<boost::uint32_t>("stats_cache_size", 1000));
 
     return;
 }
@@ -141,11 +816,15 @@ const Options Stats::getDefaultOptions() const
     Option num_bins("num_bins", 20, "Number of bins to use for histogram");
     Option stats_cache_size("stats_cache_size", 100000, "Number of points to use for histogram bin determination. Defaults to total number of points read if no option is specified.");
     Option seed("seed", 0, "Seed to use for repeatable random sample. A seed value of 0 means no seed is used");
+    Option log_bins("log_bins", false, "Space histogram bins logarithmically. Dimensions with non-positive values fall back to linear bins");
+    Option sketch_size("sketch_size", 200, "Number of values kept per level of the quantile sketch. Larger values give more accurate quartiles");
 
     options.add(sample_size);
     options.add(num_bins);
     options.add(stats_cache_size);
     options.add(seed);
+    options.add(log_bins);
+    options.add(sketch_size);
     return options;
 }
 
@@ -154,77 +833,86 @@ pdal::StageSequentialIterator* Stats::createSequentialIterator(PointBuffer& buff
     return new pdal::filters::iterators::sequential::Stats(*this, buffer);
 }
 
-namespace iterators
+pdal::StageRandomIterator* Stats::createRandomIterator(PointBuffer& buffer) const
 {
-namespace sequential
+    return new pdal::filters::iterators::random::Stats(*this, buffer);
+}
+
+
+//---------------------------------------------------------------------------
+namespace stats
 {
 
-Stats::Stats(const pdal::filters::Stats& filter, PointBuffer& buffer)
-    : pdal::FilterSequentialIterator(filter, buffer)
-    , m_statsFilter(filter)
+Collector::Collector(const pdal::filters::Stats& filter)
+    : m_filter(filter)
 {
     return;
 }
 
 
-boost::uint32_t Stats::readBufferImpl(PointBuffer& data)
+namespace
 {
-    const boost::uint32_t numRead = getPrevIterator().read(data);
 
-    const boost::uint32_t numPoints = data.getNumPoints();
+// Points are converted and summarized this many at a time.
+const boost::uint32_t kStatsBlockSize = 1024;
 
-    for (boost::uint32_t pointIndex=0; pointIndex < numPoints; pointIndex++)
+template<typename T>
+void convertValues(boost::uint8_t const* data,
+                   std::size_t stride,
+                   boost::uint32_t count,
+                   double scale,
+                   double offset,
+                   double* values)
+{
+    for (boost::uint32_t i = 0; i < count; ++i)
     {
-        std::multimap<DimensionPtr, stats::SummaryPtr>::const_iterator p;
-        for (p = m_stats.begin(); p != m_stats.end(); ++p)
-        {
+        T value;
+        std::memcpy(&value, data + i * stride, sizeof(T));
+        values[i] = static_cast<double>(value) * scale + offset;
+    }
+    return;
+}
+
+} // anonymous namespace
+
+
+void Collector::accumulate(PointBuffer const& data)
+{
+    const boost::uint32_t numPoints = data.getNumPoints();
+    const std::size_t stride = data.getSchema().getByteSize();
 
-            DimensionPtr d = p->first;
-            stats::SummaryPtr c = p->second;
+    if (m_values.size() < kStatsBlockSize)
+        m_values.resize(kStatsBlockSize);
+    double* values = &m_values.front();
 
-            double output = getValue(data, *d, pointIndex);
-            c->insert(output);
+    for (boost::uint32_t first = 0; first < numPoints; first += kStatsBlockSize)
+    {
+        const boost::uint32_t count = (std::min)(kStatsBlockSize, numPoints - first);
+        boost::uint8_t const* block = data.getData(first);
+
+        for (std::vector<Kernel>::const_iterator k = m_kernels.begin(); k != m_kernels.end(); ++k)
+        {
+            k->convert(block + k->byteOffset, stride, count, k->scale, k->offset, values);
+            k->summary->insert(values, values + count);
         }
     }
-    return numRead;
+
+    return;
 }
 
-double Stats::getValue(PointBuffer& data, Dimension& d, boost::uint32_t pointIndex)
+Collector::ConvertFunction Collector::getConvertFunction(Dimension const& d)
 {
-    double output(0.0);
-
-    float flt(0.0);
-    boost::int8_t i8(0);
-    boost::uint8_t u8(0);
-    boost::int16_t i16(0);
-    boost::uint16_t u16(0);
-    boost::int32_t i32(0);
-    boost::uint32_t u32(0);
-    boost::int64_t i64(0);
-    boost::uint64_t u64(0);
-
     switch (d.getInterpretation())
     {
         case dimension::SignedByte:
-            i8 = data.getField<boost::int8_t>(d, pointIndex);
-            output = d.applyScaling<boost::int8_t>(i8);
-            break;
+            return &convertValues<boost::int8_t>;
         case dimension::UnsignedByte:
-            u8 = data.getField<boost::uint8_t>(d, pointIndex);
-            output = d.applyScaling<boost::uint8_t>(u8);
-            break;
+            return &convertValues<boost::uint8_t>;
         case dimension::Float:
             if (d.getByteSize() == 4)
-            {
-                flt = data.getField<float>(d, pointIndex);
-                output = static_cast<double>(flt);
-                break;
-            }
+                return &convertValues<float>;
             else if (d.getByteSize() == 8)
-            {
-                output = data.getField<double>(d, pointIndex);
-                break;
-            }
+                return &convertValues<double>;
             else
             {
                 std::ostringstream oss;
@@ -234,29 +922,13 @@ double Stats::getValue(PointBuffer& data, Dimension& d, boost::uint32_t pointInd
 
         case dimension::SignedInteger:
             if (d.getByteSize() == 1)
-            {
-                i8 = data.getField<boost::int8_t>(d, pointIndex);
-                output = d.applyScaling<boost::int8_t>(i8);
-                break;
-            }
+                return &convertValues<boost::int8_t>;
             else if (d.getByteSize() == 2)
-            {
-                i16 = data.getField<boost::int16_t>(d, pointIndex);
-                output = d.applyScaling<boost::int16_t>(i16);
-                break;
-            }
+                return &convertValues<boost::int16_t>;
             else if (d.getByteSize() == 4)
-            {
-                i32 = data.getField<boost::int32_t>(d, pointIndex);
-                output = d.applyScaling<boost::int32_t>(i32);
-                break;
-            }
+                return &convertValues<boost::int32_t>;
             else if (d.getByteSize() == 8)
-            {
-                i64 = data.getField<boost::int64_t>(d, pointIndex);
-                output = d.applyScaling<boost::int64_t>(i64);
-                break;
-            }
+                return &convertValues<boost::int64_t>;
             else
             {
                 std::ostringstream oss;
@@ -265,29 +937,13 @@ double Stats::getValue(PointBuffer& data, Dimension& d, boost::uint32_t pointInd
             }
         case dimension::UnsignedInteger:
             if (d.getByteSize() == 1)
-            {
-                u8 = data.getField<boost::uint8_t>(d, pointIndex);
-                output = d.applyScaling<boost::uint8_t>(u8);
-                break;
-            }
+                return &convertValues<boost::uint8_t>;
             else if (d.getByteSize() == 2)
-            {
-                u16 = data.getField<boost::uint16_t>(d, pointIndex);
-                output = d.applyScaling<boost::uint16_t>(u16);
-                break;
-            }
+                return &convertValues<boost::uint16_t>;
             else if (d.getByteSize() == 4)
-            {
-                u32 = data.getField<boost::uint32_t>(d, pointIndex);
-                output = d.applyScaling<boost::uint32_t>(u32);
-                break;
-            }
+                return &convertValues<boost::uint32_t>;
             else if (d.getByteSize() == 8)
-            {
-                u64 = data.getField<boost::uint64_t>(d, pointIndex);
-                output = d.applyScaling<boost::uint64_t>(u64);
-                break;
-            }
+                return &convertValues<boost::uint64_t>;
             else
             {
                 std::ostringstream oss;
@@ -297,39 +953,27 @@ double Stats::getValue(PointBuffer& data, Dimension& d, boost::uint32_t pointInd
 
         case dimension::Pointer:    // stored as 64 bits, even on a 32-bit box
         case dimension::Undefined:
-            throw pdal_error("Dimension data type unable to be summarized");
+            break;
     }
 
-    return output;
-}
-boost::uint64_t Stats::skipImpl(boost::uint64_t count)
-{
-    getPrevIterator().skip(count);
-    return count;
+    throw pdal_error("Dimension data type unable to be summarized");
 }
 
-
-bool Stats::atEndImpl() const
-{
-    return getPrevIterator().atEnd();
-}
-
-void Stats::readBufferBeginImpl(PointBuffer& buffer)
+void Collector::bind(Schema const& schema)
 {
     // We'll assume you're not changing the schema per-read call
 
-    if (m_stats.size() == 0)
+    if (m_kernels.size() == 0)
     {
-        Schema const& schema = buffer.getSchema();
 
-        boost::uint64_t numPoints = getStage().getPrevStage().getNumPoints();
+        boost::uint64_t numPoints = m_filter.getPrevStage().getNumPoints();
         boost::uint32_t stats_cache_size(1000);
 
 
         try
         {
-            stats_cache_size = getStage().getOptions().getValueOrThrow<boost::uint32_t>("stats_cache_size");
-            getStage().log()->get(logDEBUG2) << "Using " << stats_cache_size << "for histogram cache size set from option" << std::endl;
+            stats_cache_size = m_filter.getOptions().getValueOrThrow<boost::uint32_t>("stats_cache_size");
+            m_filter.log()->get(logDEBUG2) << "Using " << stats_cache_size << "for histogram cache size set from option" << std::endl;
 
         }
         catch (pdal::option_not_found const&)
@@ -341,38 +985,107 @@ void Stats::readBufferBeginImpl(PointBuffer& buffer)
                     throw std::out_of_range("too many points for the histogram cache");
                 }
                 stats_cache_size = static_cast<boost::uint32_t>(numPoints);
-                getStage().log()->get(logDEBUG2) << "Using point count, " << numPoints << ", for histogram cache size" << std::endl;
+                m_filter.log()->get(logDEBUG2) << "Using point count, " << numPoints << ", for histogram cache size" << std::endl;
 
             }
         }
 
-        boost::uint32_t sample_size = getStage().getOptions().getValueOrDefault<boost::uint32_t>("sample_size", 1000);
-        boost::uint32_t seed = getStage().getOptions().getValueOrDefault<boost::uint32_t>("seed", 0);
-
-        getStage().log()->get(logDEBUG2) << "Using " << sample_size << " for sample size" << std::endl;
-        getStage().log()->get(logDEBUG2) << "Using " << seed << " for sample seed" << std::endl;
-
-
-        boost::uint32_t bin_count = getStage().getOptions().getValueOrDefault<boost::uint32_t>("num_bins", 20);
-
         schema::index_by_index const& dims = schema.getDimensions().get<schema::index>();
 
         for (schema::index_by_index::const_iterator iter = dims.begin(); iter != dims.end(); ++iter)
         {
             DimensionPtr d = boost::shared_ptr<Dimension>(new Dimension(*iter));
-            getStage().log()->get(logDEBUG2) << "Cumulating stats for dimension " << d->getName() << std::endl;
-            stats::SummaryPtr c = boost::shared_ptr<stats::Summary>(new stats::Summary(bin_count, sample_size, stats_cache_size));
+            m_filter.log()->get(logDEBUG2) << "Cumulating stats for dimension " << d->getName() << std::endl;
+
+            // Summaries merged in before our first read are added to.
+            SummaryPtr c = findStats(*d);
+            const bool merged = static_cast<bool>(c);
+            if (!merged)
+                c = createSummary(*d, stats_cache_size);
+
+            // Floats were never scaled; integers get the dimension's
+            // scale and offset applied.
+            Kernel kernel;
+            kernel.byteOffset = d->getByteOffset();
+            kernel.scale = 1.0;
+            kernel.offset = 0.0;
+            if (d->getInterpretation() != dimension::Float)
+            {
+                kernel.scale = d->getNumericScale();
+                kernel.offset = d->getNumericOffset();
+            }
+            kernel.convert = getConvertFunction(*d);
+            kernel.summary = c;
 
-            std::pair<DimensionPtr, stats::SummaryPtr> p(d,c);
-            m_dimensions.push_back(d);
-            m_stats.insert(p);
+            if (!merged)
+            {
+                std::pair<DimensionPtr, SummaryPtr> p(d,c);
+                m_dimensions.push_back(d);
+                m_stats.insert(p);
+            }
+            m_kernels.push_back(kernel);
         }
 
     }
 
 }
 
-boost::property_tree::ptree Stats::toPTree() const
+SummaryPtr Collector::createSummary(Dimension const& dim, boost::uint32_t stats_cache_size) const
+{
+    Options const& options = m_filter.getOptions();
+
+    boost::uint32_t sample_size = options.getValueOrDefault<boost::uint32_t>("sample_size", 1000);
+    boost::uint32_t seed = options.getValueOrDefault<boost::uint32_t>("seed", 0);
+    boost::uint32_t sketch_size = options.getValueOrDefault<boost::uint32_t>("sketch_size", 200);
+    boost::uint32_t bin_count = options.getValueOrDefault<boost::uint32_t>("num_bins", 20);
+    bool log_bins = options.getValueOrDefault<bool>("log_bins", false);
+
+    // A dimension may be given a fixed histogram range, e.g.
+    //   <Option name="dimension">Z
+    //     <Options>
+    //       <Option name="histogram_min">0</Option>
+    //       <Option name="histogram_max">500</Option>
+    //     </Options>
+    //   </Option>
+    // Histograms with the same fixed range merge exactly across runs.
+    std::vector<Option> dimensions = options.getOptions("dimension");
+    for (std::vector<Option>::const_iterator i = dimensions.begin(); i != dimensions.end(); ++i)
+    {
+        if (!boost::iequals(i->getValue<std::string>(), dim.getName()))
+            continue;
+
+        boost::optional<Options const&> dimensionOptions = i->getOptions();
+        if (!dimensionOptions)
+            continue;
+
+        bin_count = dimensionOptions->getValueOrDefault<boost::uint32_t>("num_bins", bin_count);
+        log_bins = dimensionOptions->getValueOrDefault<bool>("log_bins", log_bins);
+
+        const bool hasLower = dimensionOptions->hasOption("histogram_min");
+        const bool hasUpper = dimensionOptions->hasOption("histogram_max");
+        if (hasLower && hasUpper)
+        {
+            const double lower = dimensionOptions->getValueOrThrow<double>("histogram_min");
+            const double upper = dimensionOptions->getValueOrThrow<double>("histogram_max");
+            m_filter.log()->get(logDEBUG2) << "Using fixed histogram range [" << lower << ", " << upper << "] for dimension " << dim.getName() << std::endl;
+            stats::Histogram histogram = stats::Histogram::fixed(lower, upper, bin_count, log_bins);
+            return SummaryPtr(new Summary(histogram, sample_size, seed, sketch_size));
+        }
+        if (hasLower || hasUpper)
+        {
+            std::ostringstream oss;
+            oss << "Both histogram_min and histogram_max must be given for dimension '" << dim.getName() << "'";
+            throw pdal_error(oss.str());
+        }
+    }
+
+    m_filter.log()->get(logDEBUG2) << "Using " << sample_size << " for sample size" << std::endl;
+    m_filter.log()->get(logDEBUG2) << "Using " << seed << " for sample seed" << std::endl;
+
+    return SummaryPtr(new Summary(bin_count, sample_size, stats_cache_size, seed, log_bins, sketch_size));
+}
+
+boost::property_tree::ptree Collector::toPTree() const
 {
     boost::property_tree::ptree tree;
 
@@ -380,12 +1093,12 @@ boost::property_tree::ptree Stats::toPTree() const
     boost::uint32_t position(0);
     for (p = m_dimensions.begin(); p != m_dimensions.end(); ++p)
     {
-        std::multimap<DimensionPtr, stats::SummaryPtr>::const_iterator i;
+        std::multimap<DimensionPtr, SummaryPtr>::const_iterator i;
         DimensionPtr d = *p;
         i = m_stats.find(d);
         if (i == m_stats.end())
             throw pdal_error("unable to find dimension in summary!");
-        const stats::SummaryPtr stat = i->second;
+        const SummaryPtr stat = i->second;
 
         boost::property_tree::ptree subtree = stat->toPTree();
         subtree.add("position", position);
@@ -396,27 +1109,145 @@ boost::property_tree::ptree Stats::toPTree() const
     return tree;
 }
 
-stats::Summary const& Stats::getStats(Dimension const& dim) const
+SummaryPtr Collector::findStats(Dimension const& dim) const
 {
     // FIXME: do this smarter
-    std::multimap<DimensionPtr, stats::SummaryPtr>::const_iterator p;
+    std::multimap<DimensionPtr, SummaryPtr>::const_iterator p;
     for (p = m_stats.begin(); p != m_stats.end(); ++p)
     {
         if (dim == *p->first)
-            return *p->second;
+            return p->second;
     }
+    return SummaryPtr();
+}
+
+Summary const& Collector::getStats(Dimension const& dim) const
+{
+    SummaryPtr summary = findStats(dim);
+    if (summary)
+        return *summary;
+
     std::ostringstream oss;
     oss <<"Dimension with name '" << dim.getName() << "' not found";
     throw pdal_error(oss.str());
 }
 
-void Stats::reset()
+void Collector::reset()
 {
     m_stats.clear();
+    m_dimensions.clear();
+    m_kernels.clear();
+}
+
+
+void Collector::merge(Collector const& other)
+{
+    std::vector<DimensionPtr>::const_iterator p;
+    for (p = other.m_dimensions.begin(); p != other.m_dimensions.end(); ++p)
+    {
+        SummaryPtr theirs = other.findStats(**p);
+        if (!theirs)
+            throw pdal_error("unable to find dimension in summary!");
+
+        SummaryPtr ours = findStats(**p);
+        if (ours)
+        {
+            ours->merge(*theirs);
+            continue;
+        }
+
+        DimensionPtr d = boost::shared_ptr<Dimension>(new Dimension(**p));
+        SummaryPtr c = boost::shared_ptr<Summary>(new Summary(*theirs));
+        m_dimensions.push_back(d);
+        m_stats.insert(std::pair<DimensionPtr, SummaryPtr>(d, c));
+    }
+
+    return;
+}
+
+} // namespace stats
+
+
+//---------------------------------------------------------------------------
+namespace iterators
+{
+namespace sequential
+{
+
+Stats::Stats(const pdal::filters::Stats& filter, PointBuffer& buffer)
+    : pdal::FilterSequentialIterator(filter, buffer)
+    , m_collector(filter)
+{
+    return;
+}
+
+
+boost::uint32_t Stats::readBufferImpl(PointBuffer& data)
+{
+    const boost::uint32_t numRead = getPrevIterator().read(data);
+    m_collector.accumulate(data);
+    return numRead;
+}
+
+
+boost::uint64_t Stats::skipImpl(boost::uint64_t count)
+{
+    getPrevIterator().skip(count);
+    return count;
+}
+
+
+bool Stats::atEndImpl() const
+{
+    return getPrevIterator().atEnd();
+}
+
+
+void Stats::readBufferBeginImpl(PointBuffer& buffer)
+{
+    m_collector.bind(buffer.getSchema());
+    return;
 }
 
 }
 } // iterators::sequential
 
+
+namespace iterators
+{
+namespace random
+{
+
+Stats::Stats(const pdal::filters::Stats& filter, PointBuffer& buffer)
+    : pdal::FilterRandomIterator(filter, buffer)
+    , m_collector(filter)
+{
+    return;
+}
+
+
+boost::uint32_t Stats::readBufferImpl(PointBuffer& data)
+{
+    const boost::uint32_t numRead = getPrevIterator().read(data);
+    m_collector.accumulate(data);
+    return numRead;
+}
+
+
+boost::uint64_t Stats::seekImpl(boost::uint64_t count)
+{
+    return getPrevIterator().seek(count);
+}
+
+
+void Stats::readBufferBeginImpl(PointBuffer& buffer)
+{
+    m_collector.bind(buffer.getSchema());
+    return;
+}
+
+}
+} // iterators::random
+
 }
 } // namespaces
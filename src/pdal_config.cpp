@@ -58,6 +58,10 @@
 #include <laszip/laszip.hpp>
 #endif
 
+#ifdef PDAL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 namespace pdal
 {
 
@@ -141,6 +145,10 @@ std::string GetFullVersionString()
        << LASZIP_VERSION_REVISION;
 #endif
 
+#ifdef PDAL_HAVE_ZLIB
+    os << " zlib " << ZLIB_VERSION;
+#endif
+
     std::string info(os.str());
     os.str("");
     os << "PDAL " << PDAL_VERSION_STRING;
@@ -48,31 +48,53 @@ namespace plang
 {
 
 
-BufferedInvocation::BufferedInvocation(const Script& script)
+BufferedInvocation::BufferedInvocation(const Script& script, bool namedDimensionsOnly)
     : Invocation(script)
+    , m_schemaCompiled(false)
+    , m_namedDimensionsOnly(namedDimensionsOnly)
 {
     return;
 }
 
 
-void BufferedInvocation::beginChunk(PointBuffer& buffer)
+void BufferedInvocation::compileSchema(Schema const& schema)
 {
-    const Schema& schema = buffer.getSchema();
+    m_schema = schema;
+    m_schemaCompiled = true;
+    m_inputs.clear();
+    m_dimensions.clear();
 
     schema::Map const& map = schema.getDimensions();
     schema::index_by_index const& idx = map.get<schema::index>();
     for (schema::index_by_index::const_iterator iter = idx.begin(); iter != idx.end(); ++iter)
     {
         const Dimension& dim = *iter;
-        const std::string& name = dim.getName();
+        if (!m_namedDimensionsOnly || usesName(dim.getName()))
+        {
+            m_inputs.push_back(dim);
+        }
+        m_dimensions.insert(std::make_pair(dim.getName(), dim));
+    }
 
-        boost::uint8_t* data = buffer.getData(0) + dim.getByteOffset();
+    return;
+}
 
-        const boost::uint32_t numPoints = buffer.getNumPoints();
-        const boost::uint32_t stride = buffer.getSchema().getByteSize();
-        const dimension::Interpretation datatype = dim.getInterpretation();
-        const boost::uint32_t numBytes = dim.getByteSize();
-        this->insertArgument(name, data, numPoints, stride, datatype, numBytes);
+
+void BufferedInvocation::beginChunk(PointBuffer& buffer)
+{
+    const Schema& schema = buffer.getSchema();
+    if (!m_schemaCompiled || !(m_schema == schema))
+    {
+        compileSchema(schema);
+    }
+
+    const boost::uint32_t numPoints = buffer.getNumPoints();
+    const boost::uint32_t stride = schema.getByteSize();
+
+    for (std::vector<Dimension>::const_iterator dim = m_inputs.begin(); dim != m_inputs.end(); ++dim)
+    {
+        boost::uint8_t* data = buffer.getData(0) + dim->getByteOffset();
+        this->insertArgument(dim->getName(), data, numPoints, stride, dim->getInterpretation(), dim->getByteSize());
     }
 
     return;
@@ -89,29 +111,22 @@ void BufferedInvocation::endChunk(PointBuffer& buffer)
     std::vector<std::string> names;
     getOutputNames(names);
 
-    const Schema& schema = buffer.getSchema();
+    const boost::uint32_t numPoints = buffer.getNumPoints();
+    const boost::uint32_t stride = buffer.getSchema().getByteSize();
 
     for (unsigned int i=0; i<names.size(); i++)
     {
-        schema::Map map = schema.getDimensions();
-        schema::index_by_name& name_index = map.get<schema::name>();
-        schema::index_by_name::const_iterator it = name_index.find(names[i]);
-        if (it != name_index.end())
+        std::map<std::string, Dimension>::const_iterator it = m_dimensions.find(names[i]);
+        if (it != m_dimensions.end())
         {
-            const Dimension& dim = *it;
+            const Dimension& dim = it->second;
             const std::string& name = dim.getName();
 
             assert(name == names[i]);
             assert(hasOutputVariable(name));
 
-            {
-                boost::uint8_t* data = buffer.getData(0) + dim.getByteOffset();
-                const boost::uint32_t numPoints = buffer.getNumPoints();
-                const boost::uint32_t stride = buffer.getSchema().getByteSize();
-                const dimension::Interpretation datatype = dim.getInterpretation();
-                const boost::uint32_t numBytes = dim.getByteSize();
-                extractResult(name, data, numPoints, stride, datatype, numBytes);
-            }
+            boost::uint8_t* data = buffer.getData(0) + dim.getByteOffset();
+            extractResult(name, data, numPoints, stride, dim.getInterpretation(), dim.getByteSize());
         }
     }
 
@@ -55,6 +55,36 @@ namespace pdal
 namespace plang
 {
 
+namespace
+{
+
+// Points an array made by PyArray_New over borrowed memory at other memory
+// of the same layout.
+void setArrayData(PyArrayObject* arr, void* data, npy_intp len)
+{
+#if NPY_API_VERSION >= 0x00000007
+    ((PyArrayObject_fields*)arr)->data = (char*)data;
+#else
+    arr->data = (char*)data;
+#endif
+    PyArray_DIMS(arr)[0] = len;
+    PyArray_UpdateFlags(arr, NPY_CONTIGUOUS | NPY_FORTRAN | NPY_ALIGNED);
+
+    return;
+}
+
+// dict methods that hand back names the script didn't spell out
+const char* const s_enumerators[] =
+{
+    "keys", "values", "items",
+    "iterkeys", "itervalues", "iteritems",
+    "viewkeys", "viewvalues", "viewitems",
+    "copy", "update"
+};
+
+} // anonymous namespace
+
+
 
 void Invocation::numpy_init()
 {
@@ -77,6 +107,7 @@ Invocation::Invocation(const Script& script)
     , m_varsOut(NULL)
     , m_scriptArgs(NULL)
     , m_scriptResult(NULL)
+    , m_usesAllNames(true)
 {
     resetArguments();
 
@@ -87,6 +118,13 @@ Invocation::Invocation(const Script& script)
 Invocation::~Invocation()
 {
     cleanup();
+
+    for (std::map<std::string, View>::iterator i = m_views.begin(); i != m_views.end(); ++i)
+    {
+        Py_XDECREF(i->second.array);
+    }
+    m_views.clear();
+
     return;
 }
 
@@ -100,6 +138,10 @@ void Invocation::compile()
     m_module = PyImport_ExecCodeModule(const_cast<char*>(m_script.module()), m_bytecode);
     if (!m_module) m_environment.handleError();
 
+    m_scriptNames.clear();
+    m_usesAllNames = false;
+    findScriptNames(m_bytecode);
+
     m_dictionary = PyModule_GetDict(m_module);
 
     m_function = PyDict_GetItemString(m_dictionary, m_script.function());
@@ -114,21 +156,83 @@ void Invocation::compile()
 }
 
 
+// Collects the string constants of a code object and of the functions
+// defined in it, and notes whether it calls any of the dict enumerators.
+void Invocation::findScriptNames(PyObject* code)
+{
+    PyObject* consts = PyObject_GetAttrString(code, "co_consts");
+    if (consts && PyTuple_Check(consts))
+    {
+        const Py_ssize_t numConsts = PyTuple_Size(consts);
+        for (Py_ssize_t i = 0; i < numConsts; ++i)
+        {
+            PyObject* item = PyTuple_GetItem(consts, i);
+            if (PyString_Check(item))
+            {
+                m_scriptNames.insert(PyString_AsString(item));
+            }
+            else if (PyUnicode_Check(item))
+            {
+                PyObject* utf8 = PyUnicode_AsUTF8String(item);
+                if (utf8)
+                {
+                    m_scriptNames.insert(PyString_AsString(utf8));
+                    Py_DECREF(utf8);
+                }
+                PyErr_Clear();
+            }
+            else if (PyObject_HasAttrString(item, "co_consts"))
+            {
+                // a function or class body
+                findScriptNames(item);
+            }
+        }
+    }
+    Py_XDECREF(consts);
+
+    PyObject* names = PyObject_GetAttrString(code, "co_names");
+    if (names && PyTuple_Check(names))
+    {
+        const Py_ssize_t numNames = PyTuple_Size(names);
+        for (Py_ssize_t i = 0; i < numNames; ++i)
+        {
+            PyObject* item = PyTuple_GetItem(names, i);
+            if (!PyString_Check(item))
+                continue;
+            const std::string name(PyString_AsString(item));
+            for (std::size_t j = 0; j < sizeof(s_enumerators) / sizeof(s_enumerators[0]); ++j)
+            {
+                if (name == s_enumerators[j])
+                    m_usesAllNames = true;
+            }
+        }
+    }
+    Py_XDECREF(names);
+
+    PyErr_Clear();
+
+    return;
+}
+
+
+bool Invocation::usesName(const std::string& name) const
+{
+    return m_usesAllNames || m_scriptNames.count(name) != 0;
+}
+
+
 void Invocation::cleanup()
 {
     Py_XDECREF(m_varsIn);
     Py_XDECREF(m_varsOut);
+    m_varsIn = NULL;
+    m_varsOut = NULL;
 
     Py_XDECREF(m_scriptResult);
+    m_scriptResult = NULL;
 
     Py_XDECREF(m_scriptArgs); // also decrements script and vars
-
-    for (unsigned int i=0; i<m_pyInputArrays.size(); i++)
-    {
-        PyObject* obj = m_pyInputArrays[i];
-        Py_XDECREF(obj);
-    }
-    m_pyInputArrays.clear();
+    m_scriptArgs = NULL;
 
     return;
 }
@@ -145,25 +249,71 @@ void Invocation::resetArguments()
 }
 
 
-void Invocation::insertArgument(const std::string& name,
-                                boost::uint8_t* data,
-                                boost::uint32_t data_len,
-                                boost::uint32_t data_stride,
-                                dimension::Interpretation dataType,
-                                boost::uint32_t numBytes)
+// Returns the array for name, pointed at data.  The array from the last
+// chunk is re-pointed if nothing but us holds it and its layout is the
+// same; otherwise a new one is made.
+PyObject* Invocation::getView(const std::string& name,
+                              boost::uint8_t* data,
+                              boost::uint32_t data_len,
+                              boost::uint32_t data_stride,
+                              dimension::Interpretation dataType,
+                              boost::uint32_t numBytes)
 {
+    const int pyDataType = getPythonDataType(dataType, numBytes);
+    if (pyDataType < 0)
+    {
+        throw python_error("plang variable '" + name + "' has a type numpy can't represent");
+    }
+
+    std::map<std::string, View>::iterator i = m_views.find(name);
+    if (i != m_views.end())
+    {
+        View& view = i->second;
+        PyArrayObject* arr = (PyArrayObject*)view.array;
+        if (view.dataType == pyDataType && PyArray_STRIDES(arr)[0] == (npy_intp)data_stride)
+        {
+            if (PyArray_DATA(arr) == (void*)data && PyArray_DIMS(arr)[0] == (npy_intp)data_len)
+            {
+                return view.array;
+            }
+            if (Py_REFCNT(view.array) == 1)
+            {
+                setArrayData(arr, data, data_len);
+                return view.array;
+            }
+        }
+
+        Py_DECREF(view.array);
+        m_views.erase(i);
+    }
+
     npy_intp mydims = data_len;
     int nd = 1;
     npy_intp* dims = &mydims;
     npy_intp stride = data_stride;
     npy_intp* strides = &stride;
-    int flags = NPY_CARRAY; // NPY_BEHAVED
-
-    const int pyDataType = getPythonDataType(dataType, numBytes);
+    int flags = NPY_WRITEABLE;
 
     PyObject* pyArray = PyArray_New(&PyArray_Type, nd, dims, pyDataType, strides, data, 0, flags, NULL);
+    if (!pyArray) m_environment.handleError();
+
+    View view;
+    view.array = pyArray;
+    view.dataType = pyDataType;
+    m_views.insert(std::make_pair(name, view));
+
+    return pyArray;
+}
 
-    m_pyInputArrays.push_back(pyArray);
+
+void Invocation::insertArgument(const std::string& name,
+                                boost::uint8_t* data,
+                                boost::uint32_t data_len,
+                                boost::uint32_t data_stride,
+                                dimension::Interpretation dataType,
+                                boost::uint32_t numBytes)
+{
+    PyObject* pyArray = getView(name, data, data_len, data_stride, dataType, numBytes);
 
     PyDict_SetItemString(m_varsIn, name.c_str(), pyArray);
 
@@ -189,107 +339,29 @@ void Invocation::extractResult(const std::string& name,
     }
 
     PyArrayObject* arr = (PyArrayObject*)xarr;
-
-    npy_intp one=0;
-    const int pyDataType = getPythonDataType(dataType, numBytes);
-
-    boost::uint8_t* p = dst;
-
-    if (pyDataType == PyArray_DOUBLE)
-    {
-        double* src = (double*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(double*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_FLOAT)
-    {
-        float* src = (float*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(float*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_BYTE)
-    {
-        boost::int8_t* src = (boost::int8_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::int8_t*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_UBYTE)
-    {
-        boost::uint8_t* src = (boost::uint8_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::uint8_t*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_SHORT)
-    {
-        boost::int16_t* src = (boost::int16_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::int16_t*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_USHORT)
+    if (PyArray_SIZE(arr) != (npy_intp)data_len)
     {
-        boost::uint16_t* src = (boost::uint16_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::uint16_t*)p = src[i];
-            p += data_stride;
-        }
+        throw python_error("plang output variable '" + name + "' has the wrong number of elements");
     }
-    else if (pyDataType == PyArray_INT)
-    {
-        boost::int32_t* src = (boost::int32_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::int32_t*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_UINT)
-    {
-        boost::uint32_t* src = (boost::uint32_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::uint32_t*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_LONGLONG)
-    {
-        boost::int64_t* src = (boost::int64_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::int64_t*)p = src[i];
-            p += data_stride;
-        }
-    }
-    else if (pyDataType == PyArray_ULONGLONG)
+
+    // the script may hand back the view we gave it, after writing through it
+    PyObject* view = getView(name, dst, data_len, data_stride, dataType, numBytes);
+    if (view == xarr)
     {
-        boost::uint64_t* src = (boost::uint64_t*)PyArray_GetPtr(arr, &one);
-        for (unsigned int i=0; i<data_len; i++)
-        {
-            *(boost::uint64_t*)p = src[i];
-            p += data_stride;
-        }
+        return;
     }
-    else
+    PyArrayObject* viewArr = (PyArrayObject*)view;
+    if (PyArray_NDIM(arr) == 1 &&
+        PyArray_DATA(arr) == PyArray_DATA(viewArr) &&
+        PyArray_STRIDES(arr)[0] == PyArray_STRIDES(viewArr)[0] &&
+        PyArray_TYPE(arr) == PyArray_TYPE(viewArr))
     {
-        assert(0);
+        return;
     }
 
+    // numpy does the striding and any conversion
+    if (PyArray_CopyInto(viewArr, arr) < 0) m_environment.handleError();
+
     return;
 }
 
@@ -389,6 +461,10 @@ bool Invocation::execute()
         throw python_error("no code has been compiled");
     }
 
+    Py_XDECREF(m_scriptResult);
+    m_scriptResult = NULL;
+    Py_XDECREF(m_scriptArgs);
+
     Py_INCREF(m_varsIn);
     Py_INCREF(m_varsOut);
     m_scriptArgs = PyTuple_New(2);
@@ -0,0 +1,294 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include "Benchmark.hpp"
+
+#include <pdal/pdal_config.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/StageProfile.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <limits>
+
+
+BenchmarkSuite::BenchmarkSuite()
+    : m_filter("")
+    , m_iterations(3)
+    , m_outputFile("")
+    , m_tempDir(".")
+{
+    m_sizes.push_back(10000);
+    m_sizes.push_back(100000);
+    m_sizes.push_back(1000000);
+
+    return;
+}
+
+
+static void usage()
+{
+    std::cerr << "usage: pdal_bench [options]" << std::endl
+              << "  --filter <text>       only run benchmarks whose name contains <text>" << std::endl
+              << "  --iterations <n>      times to run each workload (default 3)" << std::endl
+              << "  --sizes <n,n,...>     point counts for the sized workloads" << std::endl
+              << "                        (default 10000,100000,1000000)" << std::endl
+              << "  --output <file>       write the JSON results here instead of stdout" << std::endl
+              << "  --tempdir <dir>       where to put scratch files (default .)" << std::endl;
+}
+
+
+bool BenchmarkSuite::parseArgs(int argc, char* argv[])
+{
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg(argv[i]);
+
+            if (arg == "--help" || arg == "-h")
+            {
+                usage();
+                return false;
+            }
+
+            if (i + 1 >= argc)
+            {
+                std::cerr << "missing value for " << arg << std::endl;
+                usage();
+                return false;
+            }
+            const std::string value(argv[++i]);
+
+            if (arg == "--filter")
+            {
+                m_filter = value;
+            }
+            else if (arg == "--iterations")
+            {
+                m_iterations = std::max<boost::uint32_t>(1, boost::lexical_cast<boost::uint32_t>(value));
+            }
+            else if (arg == "--sizes")
+            {
+                std::vector<std::string> tokens;
+                boost::split(tokens, value, boost::is_any_of(","));
+                m_sizes.clear();
+                for (std::vector<std::string>::const_iterator iter = tokens.begin(); iter != tokens.end(); ++iter)
+                {
+                    m_sizes.push_back(boost::lexical_cast<boost::uint64_t>(boost::trim_copy(*iter)));
+                }
+            }
+            else if (arg == "--output")
+            {
+                m_outputFile = value;
+            }
+            else if (arg == "--tempdir")
+            {
+                m_tempDir = value;
+            }
+            else
+            {
+                std::cerr << "unknown option: " << arg << std::endl;
+                usage();
+                return false;
+            }
+        }
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        std::cerr << "bad numeric value" << std::endl;
+        usage();
+        return false;
+    }
+
+    return true;
+}
+
+
+std::string BenchmarkSuite::getTempPath(const std::string& filename) const
+{
+    return m_tempDir + "/" + filename;
+}
+
+
+bool BenchmarkSuite::wants(const std::string& name) const
+{
+    return m_filter.empty() || name.find(m_filter) != std::string::npos;
+}
+
+
+void BenchmarkSuite::run(const std::string& name,
+                         const Params& params,
+                         boost::uint64_t numPoints,
+                         boost::uint32_t pointSize,
+                         const boost::function<void ()>& workload)
+{
+    if (!wants(name)) return;
+
+    Result result;
+    result.name = name;
+    result.params = params;
+    result.numPoints = numPoints;
+    result.numBytes = numPoints * pointSize;
+    result.bestTime = (std::numeric_limits<double>::max)();
+    result.meanTime = 0.0;
+
+    std::cerr << name;
+    for (Params::const_iterator iter = params.begin(); iter != params.end(); ++iter)
+    {
+        std::cerr << " " << iter->first << "=" << iter->second;
+    }
+    std::cerr << " ... " << std::flush;
+
+    try
+    {
+        for (boost::uint32_t i = 0; i < m_iterations; ++i)
+        {
+            const double start = pdal::StageProfile::getWallClock();
+            workload();
+            const double elapsed = pdal::StageProfile::getWallClock() - start;
+
+            result.bestTime = std::min(result.bestTime, elapsed);
+            result.meanTime += elapsed / m_iterations;
+        }
+        std::cerr << result.bestTime << "s" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        result.error = e.what();
+        std::cerr << "failed: " << result.error << std::endl;
+    }
+
+    m_results.push_back(result);
+
+    return;
+}
+
+
+static void writeString(std::ostream& ostr, const std::string& s)
+{
+    ostr << '"';
+    for (std::string::const_iterator iter = s.begin(); iter != s.end(); ++iter)
+    {
+        const char c = *iter;
+        if (c == '"' || c == '\\')
+        {
+            ostr << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            ostr << ' ';
+        }
+        else
+        {
+            ostr << c;
+        }
+    }
+    ostr << '"';
+}
+
+
+void BenchmarkSuite::write(std::ostream& ostr) const
+{
+    ostr << std::setprecision(6);
+
+    ostr << "{" << std::endl;
+    ostr << "  \"pdal_version\": ";
+    writeString(ostr, pdal::GetVersionString());
+    ostr << "," << std::endl;
+    ostr << "  \"iterations\": " << m_iterations << "," << std::endl;
+    ostr << "  \"benchmarks\": [" << std::endl;
+
+    for (std::vector<Result>::size_type i = 0; i < m_results.size(); ++i)
+    {
+        const Result& result = m_results[i];
+
+        ostr << "    {\"name\": ";
+        writeString(ostr, result.name);
+
+        ostr << ", \"params\": {";
+        for (Params::size_type j = 0; j < result.params.size(); ++j)
+        {
+            if (j > 0) ostr << ", ";
+            writeString(ostr, result.params[j].first);
+            ostr << ": ";
+            writeString(ostr, result.params[j].second);
+        }
+        ostr << "}";
+
+        ostr << ", \"points\": " << result.numPoints;
+        ostr << ", \"bytes\": " << result.numBytes;
+
+        if (result.error.empty())
+        {
+            const double best = std::max(result.bestTime, 1.0e-9);
+            ostr << ", \"best_seconds\": " << result.bestTime
+                 << ", \"mean_seconds\": " << result.meanTime
+                 << ", \"points_per_second\": " << result.numPoints / best
+                 << ", \"megabytes_per_second\": " << result.numBytes / best / 1.0e6;
+        }
+        else
+        {
+            ostr << ", \"error\": ";
+            writeString(ostr, result.error);
+        }
+
+        ostr << "}";
+        if (i + 1 < m_results.size()) ostr << ",";
+        ostr << std::endl;
+    }
+
+    ostr << "  ]" << std::endl;
+    ostr << "}" << std::endl;
+
+    return;
+}
+
+
+void BenchmarkSuite::write() const
+{
+    if (m_outputFile.empty())
+    {
+        write(std::cout);
+        return;
+    }
+
+    std::ostream* ostr = pdal::FileUtils::createFile(m_outputFile, false);
+    write(*ostr);
+    pdal::FileUtils::closeFile(ostr);
+
+    return;
+}
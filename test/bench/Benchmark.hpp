@@ -0,0 +1,118 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#ifndef INCLUDED_BENCH_BENCHMARK_HPP
+#define INCLUDED_BENCH_BENCHMARK_HPP
+
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A tiny harness for timing fixed workloads and reporting the results as
+// JSON, so that runs can be diffed against each other mechanically.
+//
+// Each workload is run a few times and we report both the best and the
+// mean time; the best time is the one to compare across runs.
+class BenchmarkSuite
+{
+public:
+    typedef std::vector<std::pair<std::string, std::string> > Params;
+
+    BenchmarkSuite();
+
+    // parses --filter, --iterations, --sizes, --output and --tempdir;
+    // returns false (after printing the usage) if the args are bad
+    bool parseArgs(int argc, char* argv[]);
+
+    // number of points to run the size-dependent workloads at
+    const std::vector<boost::uint64_t>& getSizes() const
+    {
+        return m_sizes;
+    }
+
+    // where to put scratch files
+    std::string getTempPath(const std::string& filename) const;
+
+    // true if --filter was not given, or the name contains it
+    bool wants(const std::string& name) const;
+
+    // Time workload(), which processes numPoints points of pointSize
+    // bytes each.  Exceptions from the workload are recorded as the
+    // result rather than propagated.
+    void run(const std::string& name,
+             const Params& params,
+             boost::uint64_t numPoints,
+             boost::uint32_t pointSize,
+             const boost::function<void ()>& workload);
+
+    // write the results (to --output, or stdout)
+    void write() const;
+    void write(std::ostream& ostr) const;
+
+private:
+    struct Result
+    {
+        std::string name;
+        Params params;
+        boost::uint64_t numPoints;
+        boost::uint64_t numBytes;
+        double bestTime;
+        double meanTime;
+        std::string error;
+    };
+
+    std::vector<Result> m_results;
+
+    std::string m_filter;
+    boost::uint32_t m_iterations;
+    std::vector<boost::uint64_t> m_sizes;
+    std::string m_outputFile;
+    std::string m_tempDir;
+};
+
+
+template <typename T>
+inline BenchmarkSuite::Params& addParam(BenchmarkSuite::Params& params, const std::string& key, const T& value)
+{
+    params.push_back(std::make_pair(key, boost::lexical_cast<std::string>(value)));
+    return params;
+}
+
+
+#endif
@@ -0,0 +1,684 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+// pdal_bench: a fixed set of throughput benchmarks for the core data paths.
+//
+// The results are written as JSON (see Benchmark.hpp), so that two runs --
+// say, before and after a boost or compiler upgrade -- can be compared by
+// a script.  Run "pdal_bench --help" for the options.
+
+#include <pdal/pdal_internal.hpp>
+#include <pdal/Dimension.hpp>
+#include <pdal/Environment.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/Schema.hpp>
+#include <pdal/SpatialReference.hpp>
+#include <pdal/StageIterator.hpp>
+#include <pdal/drivers/columnar/Codec.hpp>
+#include <pdal/drivers/columnar/Reader.hpp>
+#include <pdal/drivers/columnar/Writer.hpp>
+#include <pdal/drivers/faux/Reader.hpp>
+#include <pdal/drivers/las/Reader.hpp>
+#include <pdal/drivers/las/Writer.hpp>
+#include <pdal/drivers/text/Reader.hpp>
+#include <pdal/drivers/text/Writer.hpp>
+#include <pdal/filters/Chipper.hpp>
+#include <pdal/filters/Crop.hpp>
+#include <pdal/filters/Expression.hpp>
+#include <pdal/filters/Reprojection.hpp>
+#include <pdal/filters/Scaling.hpp>
+#include <pdal/filters/Stats.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <iostream>
+
+#include "Benchmark.hpp"
+
+using namespace pdal;
+
+
+// results are accumulated here so the compiler can't throw the loops away
+static volatile double s_sink = 0.0;
+
+// the faux data lives in a one-degree square, so reprojection makes sense
+static const Bounds<double> s_bounds(-95.0, 40.0, 0.0, -94.0, 41.0, 100.0);
+
+
+//---------------------------------------------------------------------------
+//
+// PointBuffer access
+//
+//---------------------------------------------------------------------------
+
+template <typename T> struct BenchType;
+
+#define PDAL_BENCH_TYPE(T, label, interp) \
+    template <> struct BenchType<T> \
+    { \
+        static const char* name() { return label; } \
+        static Dimension dimension() { return Dimension(label, dimension::interp, sizeof(T)); } \
+    };
+
+PDAL_BENCH_TYPE(boost::int8_t, "int8", SignedInteger)
+PDAL_BENCH_TYPE(boost::uint8_t, "uint8", UnsignedInteger)
+PDAL_BENCH_TYPE(boost::int16_t, "int16", SignedInteger)
+PDAL_BENCH_TYPE(boost::uint16_t, "uint16", UnsignedInteger)
+PDAL_BENCH_TYPE(boost::int32_t, "int32", SignedInteger)
+PDAL_BENCH_TYPE(boost::uint32_t, "uint32", UnsignedInteger)
+PDAL_BENCH_TYPE(boost::int64_t, "int64", SignedInteger)
+PDAL_BENCH_TYPE(boost::uint64_t, "uint64", UnsignedInteger)
+PDAL_BENCH_TYPE(float, "float", Float)
+PDAL_BENCH_TYPE(double, "double", Float)
+
+#undef PDAL_BENCH_TYPE
+
+
+static Schema makeAllTypesSchema()
+{
+    Schema schema;
+
+    schema.appendDimension(BenchType<boost::int8_t>::dimension());
+    schema.appendDimension(BenchType<boost::uint8_t>::dimension());
+    schema.appendDimension(BenchType<boost::int16_t>::dimension());
+    schema.appendDimension(BenchType<boost::uint16_t>::dimension());
+    schema.appendDimension(BenchType<boost::int32_t>::dimension());
+    schema.appendDimension(BenchType<boost::uint32_t>::dimension());
+    schema.appendDimension(BenchType<boost::int64_t>::dimension());
+    schema.appendDimension(BenchType<boost::uint64_t>::dimension());
+    schema.appendDimension(BenchType<float>::dimension());
+    schema.appendDimension(BenchType<double>::dimension());
+
+    return schema;
+}
+
+
+template <typename T>
+static void setFieldLoop(PointBuffer& buffer, const Dimension& dim)
+{
+    const boost::uint32_t numPoints = buffer.getCapacity();
+
+    for (boost::uint32_t i = 0; i < numPoints; ++i)
+    {
+        // small positive values, so every conversion is in range
+        buffer.setField<T>(dim, i, static_cast<T>(i % 100));
+    }
+    buffer.setNumPoints(numPoints);
+
+    return;
+}
+
+
+template <typename T>
+static void getFieldLoop(const PointBuffer& buffer, const Dimension& dim)
+{
+    const boost::uint32_t numPoints = buffer.getNumPoints();
+
+    double sum = 0.0;
+    for (boost::uint32_t i = 0; i < numPoints; ++i)
+    {
+        sum += static_cast<double>(buffer.getField<T>(dim, i));
+    }
+    s_sink = s_sink + sum;
+
+    return;
+}
+
+
+template <typename T>
+static void fillField(PointBuffer& buffer)
+{
+    setFieldLoop<T>(buffer, buffer.getSchema().getDimension(BenchType<T>::name()));
+}
+
+
+// read every dimension of the buffer as a T
+template <typename T>
+static void benchGetFieldAs(BenchmarkSuite& suite, const PointBuffer& buffer)
+{
+    const Schema& schema = buffer.getSchema();
+    const schema::index_by_index& dims = schema.getDimensions().get<schema::index>();
+
+    for (schema::index_by_index::const_iterator iter = dims.begin(); iter != dims.end(); ++iter)
+    {
+        BenchmarkSuite::Params params;
+        addParam(params, "dimension", iter->getName());
+        addParam(params, "as", BenchType<T>::name());
+
+        suite.run("pointbuffer.getField", params, buffer.getNumPoints(), iter->getByteSize(),
+                  boost::bind(&getFieldLoop<T>, boost::cref(buffer), boost::cref(*iter)));
+    }
+
+    return;
+}
+
+
+template <typename T>
+static void benchSetField(BenchmarkSuite& suite, PointBuffer& buffer)
+{
+    const Dimension& dim = buffer.getSchema().getDimension(BenchType<T>::name());
+
+    BenchmarkSuite::Params params;
+    addParam(params, "dimension", BenchType<T>::name());
+    addParam(params, "as", BenchType<T>::name());
+
+    suite.run("pointbuffer.setField", params, buffer.getCapacity(), dim.getByteSize(),
+              boost::bind(&setFieldLoop<T>, boost::ref(buffer), boost::cref(dim)));
+
+    return;
+}
+
+
+static void copyPointsLoop(PointBuffer& dst, const PointBuffer& src)
+{
+    dst.copyPointsFast(0, 0, src, src.getNumPoints());
+    dst.setNumPoints(src.getNumPoints());
+
+    return;
+}
+
+
+static void benchPointBuffer(BenchmarkSuite& suite, boost::uint64_t size)
+{
+    if (!suite.wants("pointbuffer")) return;
+
+    const boost::uint32_t numPoints = static_cast<boost::uint32_t>(size);
+    const Schema schema = makeAllTypesSchema();
+
+    PointBuffer buffer(schema, numPoints);
+
+    // setField, for each type into its own dimension (setField does not
+    // convert between types)
+    benchSetField<boost::int8_t>(suite, buffer);
+    benchSetField<boost::uint8_t>(suite, buffer);
+    benchSetField<boost::int16_t>(suite, buffer);
+    benchSetField<boost::uint16_t>(suite, buffer);
+    benchSetField<boost::int32_t>(suite, buffer);
+    benchSetField<boost::uint32_t>(suite, buffer);
+    benchSetField<boost::int64_t>(suite, buffer);
+    benchSetField<boost::uint64_t>(suite, buffer);
+    benchSetField<float>(suite, buffer);
+    benchSetField<double>(suite, buffer);
+
+    // make sure every field is filled in, even if setField was filtered out
+    fillField<boost::int8_t>(buffer);
+    fillField<boost::uint8_t>(buffer);
+    fillField<boost::int16_t>(buffer);
+    fillField<boost::uint16_t>(buffer);
+    fillField<boost::int32_t>(buffer);
+    fillField<boost::uint32_t>(buffer);
+    fillField<boost::int64_t>(buffer);
+    fillField<boost::uint64_t>(buffer);
+    fillField<float>(buffer);
+    fillField<double>(buffer);
+
+    // getField, for every (stored type, requested type) pair
+    benchGetFieldAs<boost::int8_t>(suite, buffer);
+    benchGetFieldAs<boost::uint8_t>(suite, buffer);
+    benchGetFieldAs<boost::int16_t>(suite, buffer);
+    benchGetFieldAs<boost::uint16_t>(suite, buffer);
+    benchGetFieldAs<boost::int32_t>(suite, buffer);
+    benchGetFieldAs<boost::uint32_t>(suite, buffer);
+    benchGetFieldAs<boost::int64_t>(suite, buffer);
+    benchGetFieldAs<boost::uint64_t>(suite, buffer);
+    benchGetFieldAs<float>(suite, buffer);
+    benchGetFieldAs<double>(suite, buffer);
+
+    PointBuffer dst(schema, numPoints);
+    BenchmarkSuite::Params params;
+    suite.run("pointbuffer.copyPointsFast", params, numPoints, static_cast<boost::uint32_t>(schema.getByteSize()),
+              boost::bind(&copyPointsLoop, boost::ref(dst), boost::cref(buffer)));
+
+    return;
+}
+
+
+//---------------------------------------------------------------------------
+//
+// Stages
+//
+//---------------------------------------------------------------------------
+
+// pull every point out of the stage, the way a writer would
+static boost::uint64_t readAll(const Stage& stage)
+{
+    PointBuffer buffer(stage.getSchema(), 65536);
+    boost::scoped_ptr<StageSequentialIterator> iter(stage.createSequentialIterator(buffer));
+
+    boost::uint64_t numRead = 0;
+    while (!iter->atEnd())
+    {
+        buffer.setNumPoints(0);
+        const boost::uint32_t n = iter->read(buffer);
+        if (n == 0) break;
+        numRead += n;
+    }
+
+    return numRead;
+}
+
+
+static boost::uint32_t getLasPointSize(boost::uint32_t format)
+{
+    switch (format)
+    {
+        case 0: return 20;
+        case 1: return 28;
+        case 2: return 26;
+        case 3: return 34;
+    }
+    return 0;
+}
+
+
+static void writeLas(const std::string& filename, boost::uint64_t numPoints, boost::uint32_t format, bool compressed)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    Options options;
+    options.add("filename", filename);
+    options.add("format", format);
+    options.add("compression", compressed);
+
+    {
+        drivers::las::Writer writer(reader, options);
+        writer.initialize();
+        writer.write(0);
+    }
+
+    return;
+}
+
+
+static void readLas(const std::string& filename)
+{
+    drivers::las::Reader reader(filename);
+    reader.initialize();
+    readAll(reader);
+
+    return;
+}
+
+
+static void benchLas(BenchmarkSuite& suite, boost::uint64_t size)
+{
+    if (!suite.wants("las")) return;
+
+    std::vector<bool> compression;
+    compression.push_back(false);
+#ifdef PDAL_HAVE_LASZIP
+    compression.push_back(true);
+#endif
+
+    for (boost::uint32_t format = 0; format <= 3; ++format)
+    {
+        for (std::vector<bool>::size_type c = 0; c < compression.size(); ++c)
+        {
+            const bool compressed = compression[c];
+            const std::string filename = suite.getTempPath(compressed ? "pdal_bench.laz" : "pdal_bench.las");
+
+            BenchmarkSuite::Params params;
+            addParam(params, "format", format);
+            addParam(params, "compressed", compressed ? "true" : "false");
+
+            suite.run("las.write", params, size, getLasPointSize(format),
+                      boost::bind(&writeLas, filename, size, format, compressed));
+
+            if (suite.wants("las.read"))
+            {
+                // make sure there is something to read, even if las.write was filtered out
+                if (!suite.wants("las.write"))
+                {
+                    writeLas(filename, size, format, compressed);
+                }
+
+                suite.run("las.read", params, size, getLasPointSize(format),
+                          boost::bind(&readLas, filename));
+            }
+
+            FileUtils::deleteFile(filename);
+        }
+    }
+
+    return;
+}
+
+
+static void writeText(const std::string& filename, boost::uint64_t numPoints, boost::uint32_t threads)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    Options options;
+    options.add("filename", filename);
+    options.add("threads", threads);
+
+    {
+        drivers::text::Writer writer(reader, options);
+        writer.initialize();
+        writer.write(0);
+    }
+
+    return;
+}
+
+
+static void readText(const std::string& filename, boost::uint32_t threads)
+{
+    Options options;
+    options.add("filename", filename);
+    options.add("threads", threads);
+
+    drivers::text::Reader reader(options);
+    reader.initialize();
+    readAll(reader);
+
+    return;
+}
+
+
+static void benchText(BenchmarkSuite& suite, boost::uint64_t size)
+{
+    if (!suite.wants("text")) return;
+
+    drivers::faux::Reader probe(s_bounds, 1, drivers::faux::Reader::Ramp);
+    probe.initialize();
+    const boost::uint32_t pointSize = static_cast<boost::uint32_t>(probe.getSchema().getByteSize());
+
+    std::vector<boost::uint32_t> threads;
+    threads.push_back(1);
+    if (boost::thread::hardware_concurrency() > 1)
+        threads.push_back(boost::thread::hardware_concurrency());
+
+    const std::string filename = suite.getTempPath("pdal_bench.txt");
+
+    for (std::vector<boost::uint32_t>::size_type t = 0; t < threads.size(); ++t)
+    {
+        BenchmarkSuite::Params params;
+        addParam(params, "threads", threads[t]);
+
+        suite.run("text.write", params, size, pointSize,
+                  boost::bind(&writeText, filename, size, threads[t]));
+
+        if (suite.wants("text.read"))
+        {
+            // make sure there is something to read, even if text.write was filtered out
+            if (!suite.wants("text.write"))
+            {
+                writeText(filename, size, threads[t]);
+            }
+
+            suite.run("text.read", params, size, pointSize,
+                      boost::bind(&readText, filename, threads[t]));
+        }
+    }
+
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+static void writeColumnar(const std::string& filename, boost::uint64_t numPoints, const std::string& compression)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    Options options;
+    options.add("filename", filename);
+    options.add("compression", compression);
+
+    {
+        drivers::columnar::Writer writer(reader, options);
+        writer.initialize();
+        writer.write(0);
+    }
+
+    return;
+}
+
+
+static void readColumnar(const std::string& filename)
+{
+    Options options;
+    options.add("filename", filename);
+
+    drivers::columnar::Reader reader(options);
+    reader.initialize();
+    readAll(reader);
+
+    return;
+}
+
+
+static void benchColumnar(BenchmarkSuite& suite, boost::uint64_t size)
+{
+    if (!suite.wants("columnar")) return;
+
+    drivers::faux::Reader probe(s_bounds, 1, drivers::faux::Reader::Ramp);
+    probe.initialize();
+    const boost::uint32_t pointSize = static_cast<boost::uint32_t>(probe.getSchema().getByteSize());
+
+    std::vector<std::string> compressions;
+    compressions.push_back("none");
+    compressions.push_back("delta");
+    compressions.push_back("auto");
+    if (drivers::columnar::isCodecAvailable(drivers::columnar::codec::Shuffle))
+        compressions.push_back("shuffle");
+
+    const std::string filename = suite.getTempPath("pdal_bench.pcol");
+
+    for (std::vector<std::string>::size_type c = 0; c < compressions.size(); ++c)
+    {
+        BenchmarkSuite::Params params;
+        addParam(params, "compression", compressions[c]);
+
+        suite.run("columnar.write", params, size, pointSize,
+                  boost::bind(&writeColumnar, filename, size, compressions[c]));
+
+        if (suite.wants("columnar.read"))
+        {
+            // make sure there is something to read, even if columnar.write was filtered out
+            if (!suite.wants("columnar.write"))
+            {
+                writeColumnar(filename, size, compressions[c]);
+            }
+
+            suite.run("columnar.read", params, size, pointSize,
+                      boost::bind(&readColumnar, filename));
+        }
+    }
+
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+static void readFaux(boost::uint64_t numPoints)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+    reader.initialize();
+    readAll(reader);
+
+    return;
+}
+
+
+static void runCrop(boost::uint64_t numPoints)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    // keep the lower half
+    const Bounds<double> half(-95.0, 40.0, 0.0, -94.5, 40.5, 100.0);
+    filters::Crop filter(reader, half);
+    filter.initialize();
+    readAll(filter);
+
+    return;
+}
+
+
+static void runExpression(boost::uint64_t numPoints)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    // rewrite one dimension and keep about half of the points
+    filters::Expression filter(reader, "Z = Z * 0.5 + 1; X < -94.5 && Z > 0");
+    filter.initialize();
+    readAll(filter);
+
+    return;
+}
+
+
+static void runScaling(boost::uint64_t numPoints)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    Options options;
+    const char* names[] = { "X", "Y", "Z" };
+    for (int i = 0; i < 3; ++i)
+    {
+        Options dimOptions;
+        dimOptions.add("scale", 0.0000001);
+        dimOptions.add("offset", 0);
+        dimOptions.add("size", 4);
+        dimOptions.add<std::string>("type", "SignedInteger");
+
+        Option dim("dimension", std::string(names[i]));
+        dim.setOptions(dimOptions);
+        options.add(dim);
+    }
+
+    filters::Scaling filter(reader, options);
+    filter.initialize();
+    readAll(filter);
+
+    return;
+}
+
+
+static void runReprojection(boost::uint64_t numPoints)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    filters::Reprojection filter(reader, SpatialReference("EPSG:4326"), SpatialReference("EPSG:26915"));
+    filter.initialize();
+    readAll(filter);
+
+    return;
+}
+
+
+static void runStats(boost::uint64_t numPoints)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    filters::Stats filter(reader);
+    filter.initialize();
+    readAll(filter);
+
+    return;
+}
+
+
+static void runChipper(boost::uint64_t numPoints)
+{
+    drivers::faux::Reader reader(s_bounds, numPoints, drivers::faux::Reader::Ramp);
+
+    Options options;
+    options.add("capacity", 1000);
+
+    filters::Chipper filter(reader, options);
+    filter.initialize();
+    filter.Chip();
+
+    return;
+}
+
+
+static void benchFilters(BenchmarkSuite& suite, boost::uint64_t size)
+{
+    // The faux reader generates the data on the fly; "faux.read" is the
+    // cost of that alone, to be subtracted from the filter numbers.
+    drivers::faux::Reader probe(s_bounds, 1, drivers::faux::Reader::Ramp);
+    probe.initialize();
+    const boost::uint32_t pointSize = static_cast<boost::uint32_t>(probe.getSchema().getByteSize());
+
+    BenchmarkSuite::Params params;
+
+    suite.run("faux.read", params, size, pointSize, boost::bind(&readFaux, size));
+    suite.run("filters.crop", params, size, pointSize, boost::bind(&runCrop, size));
+    suite.run("filters.expression", params, size, pointSize, boost::bind(&runExpression, size));
+    suite.run("filters.scaling", params, size, pointSize, boost::bind(&runScaling, size));
+    suite.run("filters.reprojection", params, size, pointSize, boost::bind(&runReprojection, size));
+    suite.run("filters.stats", params, size, pointSize, boost::bind(&runStats, size));
+    suite.run("filters.chipper", params, size, pointSize, boost::bind(&runChipper, size));
+
+    return;
+}
+
+
+int main(int argc, char* argv[])
+{
+    BenchmarkSuite suite;
+
+    if (!suite.parseArgs(argc, argv))
+    {
+        return 1;
+    }
+
+    pdal::Environment::startup();
+
+    const std::vector<boost::uint64_t>& sizes = suite.getSizes();
+
+    for (std::vector<boost::uint64_t>::const_iterator iter = sizes.begin(); iter != sizes.end(); ++iter)
+    {
+        benchPointBuffer(suite, *iter);
+        benchLas(suite, *iter);
+        benchText(suite, *iter);
+        benchColumnar(suite, *iter);
+        benchFilters(suite, *iter);
+    }
+
+    suite.write();
+
+    pdal::Environment::shutdown();
+
+    return 0;
+}
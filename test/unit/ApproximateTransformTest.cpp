@@ -0,0 +1,187 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+
+#include <pdal/ApproximateTransform.hpp>
+
+#include <cmath>
+#include <vector>
+
+using namespace pdal;
+
+namespace
+{
+
+// a smooth, non-linear stand-in for a reprojection
+void curved(double* x, double* y, double* z, boost::uint32_t count)
+{
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        const double xx = x[i];
+        const double yy = y[i];
+        x[i] = 2.0 * xx + 2e-5 * yy * yy + 10.0;
+        y[i] = yy - 2e-5 * xx * xx;
+        z[i] = z[i] + 1e-3 * xx * yy;
+    }
+}
+
+void failing(double*, double*, double*, boost::uint32_t)
+{
+    throw pdal_error("out of domain");
+}
+
+void makeGrid(std::vector<double>& x, std::vector<double>& y, std::vector<double>& z)
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        for (int j = 0; j < 100; ++j)
+        {
+            x.push_back(i * 1.01);
+            y.push_back(j * 0.99);
+            z.push_back((i + j) % 7);
+        }
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ApproximateTransformTest)
+
+BOOST_AUTO_TEST_CASE(test_within_error)
+{
+    std::vector<double> x, y, z;
+    makeGrid(x, y, z);
+    std::vector<double> ex(x), ey(y), ez(z);
+    const boost::uint32_t count = static_cast<boost::uint32_t>(x.size());
+
+    curved(&ex.front(), &ey.front(), &ez.front(), count);
+
+    const double maxError = 0.01;
+    ApproximateTransform approx(&curved, maxError);
+    approx.transform(&x.front(), &y.front(), &z.front(), count);
+
+    double worst = 0.0;
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        worst = std::max(worst, std::fabs(x[i] - ex[i]));
+        worst = std::max(worst, std::fabs(y[i] - ey[i]));
+        worst = std::max(worst, std::fabs(z[i] - ez[i]));
+    }
+    // a quadratic's error is largest at the cell centre, where it is tested
+    BOOST_CHECK(worst <= maxError);
+
+    BOOST_CHECK(approx.getNumInterpolatedPoints() == count);
+    BOOST_CHECK(approx.getNumExactPoints() < count / 10);
+    BOOST_CHECK(approx.getNumExactCalls() <= 5);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_fixed_extent)
+{
+    std::vector<double> x, y, z;
+    makeGrid(x, y, z);
+    // one point outside the extent, one not a number
+    x.push_back(500.0);
+    y.push_back(0.0);
+    z.push_back(0.0);
+    x.push_back(std::sqrt(-1.0));
+    y.push_back(0.0);
+    z.push_back(0.0);
+    std::vector<double> ex(x), ey(y), ez(z);
+    const boost::uint32_t count = static_cast<boost::uint32_t>(x.size());
+
+    curved(&ex.front(), &ey.front(), &ez.front(), count);
+
+    ApproximateTransform approx(&curved, 0.01, Bounds<double>(0, 0, 0, 100, 100, 6));
+
+    // transform in small batches: cells built for earlier batches are reused
+    const boost::uint32_t batch = 1000;
+    for (boost::uint32_t start = 0; start < count; start += batch)
+    {
+        const boost::uint32_t n = std::min(batch, count - start);
+        approx.transform(&x[start], &y[start], &z[start], n);
+    }
+    const boost::uint64_t calls = approx.getNumExactCalls();
+
+    for (boost::uint32_t i = 0; i < count - 2; ++i)
+    {
+        BOOST_CHECK(std::fabs(x[i] - ex[i]) <= 0.01);
+        BOOST_CHECK(std::fabs(y[i] - ey[i]) <= 0.01);
+        BOOST_CHECK(std::fabs(z[i] - ez[i]) <= 0.01);
+    }
+    BOOST_CHECK_EQUAL(x[count - 2], ex[count - 2]);
+    BOOST_CHECK_EQUAL(y[count - 2], ey[count - 2]);
+    BOOST_CHECK(approx.getNumInterpolatedPoints() == count - 2);
+
+    // a second pass needs only the cell evaluations already made
+    std::vector<double> x2(1, 50.0), y2(1, 50.0), z2(1, 3.0);
+    approx.transform(&x2.front(), &y2.front(), &z2.front(), 1);
+    BOOST_CHECK_EQUAL(approx.getNumExactCalls(), calls);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_exact_fallback)
+{
+    std::vector<double> x, y, z;
+    makeGrid(x, y, z);
+    std::vector<double> ex(x), ey(y), ez(z);
+    const boost::uint32_t count = static_cast<boost::uint32_t>(x.size());
+
+    curved(&ex.front(), &ey.front(), &ez.front(), count);
+
+    // a zero error can't be met by interpolation: every point is exact
+    ApproximateTransform approx(&curved, 0.0, Bounds<double>(), 2);
+    approx.transform(&x.front(), &y.front(), &z.front(), count);
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        BOOST_CHECK_EQUAL(x[i], ex[i]);
+        BOOST_CHECK_EQUAL(y[i], ey[i]);
+        BOOST_CHECK_EQUAL(z[i], ez[i]);
+    }
+    BOOST_CHECK(approx.getNumInterpolatedPoints() == 0);
+
+    // errors from the exact transform still reach the caller
+    ApproximateTransform bad(&failing, 0.01);
+    BOOST_CHECK_THROW(bad.transform(&x.front(), &y.front(), &z.front(), count), pdal_error);
+
+    BOOST_CHECK_THROW(ApproximateTransform(&curved, -1.0), pdal_error);
+
+    return;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -38,6 +38,11 @@
 
 #include <pdal/PipelineManager.hpp>
 #include <pdal/FileUtils.hpp>
+#include <pdal/Reader.hpp>
+#include <pdal/Filter.hpp>
+#include <pdal/Writer.hpp>
+
+#include <boost/property_tree/ptree.hpp>
 
 using namespace pdal;
 
@@ -154,4 +159,61 @@ BOOST_AUTO_TEST_CASE(PipelineManagerTest_test2)
     return;
 }
 
+BOOST_AUTO_TEST_CASE(PipelineManagerTest_test_profile)
+{
+    FileUtils::deleteFile("temp.las");
+
+    {
+        PipelineManager mgr;
+
+        Options optsR;
+        optsR.add("filename", Support::datapath("1.2-with-color.las"));
+        Reader* reader = mgr.addReader("drivers.las.reader", optsR);
+
+        Options optsF;
+        optsF.add("step", 10);
+        Filter* filter = mgr.addFilter("filters.decimation", *reader, optsF);
+
+        Options optsW;
+        optsW.add("filename", "temp.las", "file to write to");
+        mgr.addWriter("drivers.las.writer", *filter, optsW);
+
+        const boost::uint64_t np = mgr.execute();
+        BOOST_CHECK(np == 107);
+
+        const boost::property_tree::ptree profile = mgr.getProfile();
+        BOOST_CHECK(profile.get<double>("wall_time") >= 0.0);
+
+        const boost::property_tree::ptree& stages = profile.get_child("stages");
+        BOOST_CHECK(stages.size() == 3);
+
+        boost::property_tree::ptree::const_iterator iter = stages.begin();
+        const boost::property_tree::ptree& r = (iter++)->second;
+        const boost::property_tree::ptree& f = (iter++)->second;
+        const boost::property_tree::ptree& w = (iter++)->second;
+
+        BOOST_CHECK(r.get<std::string>("name") == "drivers.las.reader");
+        BOOST_CHECK(f.get<std::string>("name") == "filters.decimation");
+        BOOST_CHECK(w.get<std::string>("name") == "drivers.las.writer");
+
+        // the decimation filter reads only the points it keeps
+        BOOST_CHECK(r.get<boost::uint64_t>("points_in") == 0);
+        BOOST_CHECK(r.get<boost::uint64_t>("points_out") == 107);
+        BOOST_CHECK(f.get<boost::uint64_t>("points_in") == 107);
+        BOOST_CHECK(f.get<boost::uint64_t>("points_out") == 107);
+        BOOST_CHECK(w.get<boost::uint64_t>("points_in") == 107);
+        BOOST_CHECK(w.get<boost::uint64_t>("points_out") == 107);
+
+        BOOST_CHECK(r.get<boost::uint64_t>("bytes") == 107 * reader->getSchema().getByteSize());
+        BOOST_CHECK(w.get<boost::uint64_t>("buffers_allocated") >= 1);
+
+        BOOST_CHECK(r.get<double>("wall_time") >= 0.0);
+        BOOST_CHECK(w.get<double>("inclusive.wall_time") >= r.get<double>("inclusive.wall_time"));
+    }
+
+    FileUtils::deleteFile("temp.las");
+
+    return;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
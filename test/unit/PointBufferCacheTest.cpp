@@ -94,4 +94,88 @@ BOOST_AUTO_TEST_CASE(test1)
 }
 
 
+
+BOOST_AUTO_TEST_CASE(test_shards_and_bytes)
+{
+    Schema schema;
+    schema.appendDimension(Dimension("X", dimension::SignedInteger, 4));
+
+    // 4 blocks of 10 points, 40 bytes each, but only 100 bytes, in 2 shards
+    PointBufferCache lru(4, 100, 2);
+    BOOST_CHECK(lru.getNumShards() == 2);
+    BOOST_CHECK(lru.getMaxBytes() == 100);
+
+    PointBufferCache::Block b0 = lru.share(0, new PointBuffer(schema, 10));
+    lru.share(2, new PointBuffer(schema, 10));
+    BOOST_CHECK(lru.getNumBytes() == 40);   // shard 0 holds 50 bytes
+    BOOST_CHECK(lru.lookup(0) == NULL);
+    BOOST_CHECK(lru.lookup(2) != NULL);
+
+    lru.share(1, new PointBuffer(schema, 10));
+    lru.share(3, new PointBuffer(schema, 10));
+    BOOST_CHECK(lru.getNumBytes() == 80);
+    BOOST_CHECK(lru.lookup(1) == NULL);
+    BOOST_CHECK(lru.lookup(3) != NULL);
+
+    // an evicted block stays alive while it is shared
+    BOOST_CHECK(b0->getCapacity() == 10);
+
+    // racing inserts of the same key end up with one block
+    PointBuffer* dup = new PointBuffer(schema, 10);
+    PointBufferCache::Block b3 = lru.share(3, dup);
+    BOOST_CHECK(b3.get() == lru.lookup(3));
+    BOOST_CHECK(b3.get() != dup);
+
+    std::vector<boost::uint64_t> keys;
+    lru.get_keys(std::back_inserter(keys));
+    BOOST_CHECK(keys.size() == 2);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_spill)
+{
+    Schema schema;
+    schema.appendDimension(Dimension("X", dimension::SignedInteger, 4));
+    const Dimension& dimX = schema.getDimension("X");
+
+    boost::shared_ptr<PointBufferSpill> spill(new PointBufferSpill(schema, 10, 100));
+    BOOST_CHECK(spill->getNumSlots() == 2);
+
+    PointBufferCache lru(1);
+    lru.setSpill(spill);
+
+    for (int k = 0; k < 4; ++k)
+    {
+        PointBuffer* item = new PointBuffer(schema, 10);
+        for (int i = 0; i < 10 - k; i++)
+            item->setField(dimX, i, k * 10 + i);
+        item->setNumPoints(10 - k);
+        lru.insert(k, item);
+    }
+
+    // 3 in memory, 2 and 1 spilled, 0 spilled and dropped again
+    BOOST_CHECK(spill->getNumBlocks() == 2);
+    BOOST_CHECK(lru.lookup(0) == NULL);
+
+    PointBuffer* item = lru.lookup(1);
+    BOOST_CHECK(item != NULL);
+    BOOST_CHECK(item->getNumPoints() == 9);
+    BOOST_CHECK(item->getField<boost::int32_t>(dimX, 8) == 18);
+
+    boost::uint64_t misses, hits, writes;
+    spill->getSpillStats(misses, hits, writes);
+    BOOST_CHECK(misses == 1);
+    BOOST_CHECK(hits == 1);
+    BOOST_CHECK(writes == 4);
+
+    // bringing 1 back freed its slot for 3, which it pushed out
+    BOOST_CHECK(spill->getNumBlocks() == 2);
+    BOOST_CHECK(lru.lookup(2) != NULL);
+    BOOST_CHECK(lru.lookup(3) != NULL);
+
+    return;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
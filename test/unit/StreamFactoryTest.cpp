@@ -37,7 +37,9 @@
 
 #include <boost/test/unit_test.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/thread/thread.hpp>
 #include <iostream>
+#include <iterator>
 
 #include <pdal/StreamFactory.hpp>
 #include <pdal/FileUtils.hpp>
@@ -198,4 +200,111 @@ BOOST_AUTO_TEST_CASE(test2)
     return;
 }
 
+
+BOOST_AUTO_TEST_CASE(test_positional)
+{
+    const std::string nam = Support::datapath("text.txt");
+
+    {
+        PositionalStreamFactory f(nam);
+
+        std::istream& s1 = f.allocate();
+        std::istream& s2 = f.allocate();
+
+        check_contents(s1);
+        check_contents(s2);
+
+        // a returned stream comes back rewound
+        f.deallocate(s1);
+        std::istream& s3 = f.allocate();
+        BOOST_CHECK(&s3 == &s1);
+        BOOST_CHECK(f.getNumStreams() == 2);
+        check_contents(s3);
+
+        f.deallocate(s3);
+        BOOST_REQUIRE_THROW(f.deallocate(s3), pdal_error);
+        // f.deallocate(s2);   // let the dtor do it for us
+    }
+
+    {
+        PositionalStreamFactory f(nam, 2, 4, 2);
+
+        std::istream& s1 = f.allocate();
+        std::istream& s2 = f.allocate();
+
+        check_contents_sub(s1);
+        check_contents_sub(s2);
+
+        f.deallocate(s1);
+        f.deallocate(s2);
+    }
+
+    {
+        PositionalStreamFactory f(Support::datapath("no-such-file.txt"));
+        BOOST_REQUIRE_THROW(f.allocate(), pdal_error);
+    }
+
+    return;
+}
+
+
+namespace
+{
+
+struct ReadWhole
+{
+    ReadWhole(PositionalStreamFactory& factory, const std::string& expected, bool& ok)
+        : m_factory(factory), m_expected(expected), m_ok(ok)
+    {}
+
+    void operator()()
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            std::istream& s = m_factory.allocate();
+            const std::string contents((std::istreambuf_iterator<char>(s)),
+                                       std::istreambuf_iterator<char>());
+            if (contents != m_expected)
+                m_ok = false;
+
+            // and from the middle
+            s.clear();
+            s.seekg(static_cast<std::streamoff>(m_expected.size() / 2 + i));
+            std::vector<char> buf(100);
+            s.read(&buf.front(), 100);
+            if (std::string(buf.begin(), buf.end()) != m_expected.substr(m_expected.size() / 2 + i, 100))
+                m_ok = false;
+
+            m_factory.deallocate(s);
+        }
+    }
+
+    PositionalStreamFactory& m_factory;
+    const std::string& m_expected;
+    bool& m_ok;
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_positional_threads)
+{
+    const std::string nam = Support::datapath("1.2-with-color.las");
+    const std::string expected = FileUtils::readFileIntoString(nam);
+
+    PositionalStreamFactory f(nam, 4096);
+
+    bool ok[4] = { true, true, true, true };
+    boost::thread_group threads;
+    for (int i = 0; i < 4; ++i)
+        threads.create_thread(ReadWhole(f, expected, ok[i]));
+    threads.join_all();
+
+    for (int i = 0; i < 4; ++i)
+        BOOST_CHECK(ok[i]);
+    BOOST_CHECK(f.getNumStreams() <= 4);
+
+    return;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
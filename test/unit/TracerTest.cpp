@@ -0,0 +1,107 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <pdal/Tracer.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/StageIterator.hpp>
+#include <pdal/drivers/faux/Reader.hpp>
+#include <pdal/drivers/faux/Writer.hpp>
+
+using namespace pdal;
+
+BOOST_AUTO_TEST_SUITE(TracerTest)
+
+
+static void runPipeline()
+{
+    Bounds<double> bounds(1.0, 2.0, 3.0, 101.0, 102.0, 103.0);
+    pdal::drivers::faux::Reader reader(bounds, 1000, pdal::drivers::faux::Reader::Constant);
+    pdal::drivers::faux::Writer writer(reader, Options::none());
+    writer.setChunkSize(300);
+    writer.initialize();
+
+    boost::uint64_t numWritten = writer.write(0);
+    BOOST_CHECK(numWritten == 1000);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_disabled)
+{
+    Tracer::disable();
+    Tracer::clear();
+
+    runPipeline();
+
+    BOOST_CHECK(Tracer::getNumEvents() == 0);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_enabled)
+{
+    Tracer::enable();
+    runPipeline();
+    Tracer::disable();
+
+    // readBegin, 4 x readBuffer, writeBegin, 4 x writeBuffer, writeEnd
+    BOOST_CHECK(Tracer::getNumEvents() == 11);
+
+    std::ostringstream ostr;
+    Tracer::write(ostr);
+    const std::string json = ostr.str();
+
+    BOOST_CHECK(json.find("{\"traceEvents\":[") == 0);
+    BOOST_CHECK(json.find("\"name\":\"drivers.faux.reader readBuffer\"") != std::string::npos);
+    BOOST_CHECK(json.find("\"name\":\"drivers.faux.writer writeBuffer\"") != std::string::npos);
+    BOOST_CHECK(json.find("\"ph\":\"X\"") != std::string::npos);
+
+    // disabling keeps the events around, but stops recording more
+    runPipeline();
+    BOOST_CHECK(Tracer::getNumEvents() == 11);
+
+    Tracer::clear();
+    BOOST_CHECK(Tracer::getNumEvents() == 0);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -193,4 +193,49 @@ BOOST_AUTO_TEST_CASE(pc2pc_test_switches)
 }
 
 
+#ifndef PDAL_COMPILER_MSVC
+BOOST_AUTO_TEST_CASE(pc2pc_test_stream)
+{
+    const std::string cmd = appName();
+
+    std::string inputLas = Support::datapath("apps/simple.las");
+    std::string outputLas = Support::temppath("temp_stream.las");
+
+    // one pc2pc streams the points to another over a pipe
+    std::string output;
+    int stat = Support::run_command(cmd + " -i " + inputLas + " -o - | " + cmd + " -i - -o " + outputLas, output);
+    BOOST_CHECK_EQUAL(stat, 0);
+    BOOST_CHECK(fileIsOkay(outputLas));
+
+    pdal::drivers::las::Reader input(inputLas);
+    input.initialize();
+    pdal::drivers::las::Reader streamed(outputLas);
+    streamed.initialize();
+    BOOST_CHECK_EQUAL(streamed.getNumPoints(), input.getNumPoints());
+
+    pdal::FileUtils::deleteFile(outputLas);
+
+    // with the points on stdout, everything else pc2pc says goes to stderr
+    std::string outputStream = Support::temppath("temp_stream.pdalstream");
+    stat = Support::run_command(cmd + " -i " + inputLas + " --timer -o - 2>&1 > " + outputStream, output);
+    BOOST_CHECK_EQUAL(stat, 0);
+    BOOST_CHECK(output.find("Wrote ") != std::string::npos);
+    BOOST_CHECK(output.find("Elapsed time") != std::string::npos);
+
+    // and the stream ends with its end frame
+    std::istream* stream = pdal::FileUtils::openFile(outputStream);
+    stream->seekg(-4, std::ios::end);
+    char end[4] = { 1, 1, 1, 1 };
+    stream->read(end, 4);
+    BOOST_CHECK(stream->gcount() == 4);
+    BOOST_CHECK(end[0] == 0 && end[1] == 0 && end[2] == 0 && end[3] == 0);
+    pdal::FileUtils::closeFile(stream);
+
+    pdal::FileUtils::deleteFile(outputStream);
+
+    return;
+}
+#endif
+
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -208,4 +208,40 @@ BOOST_AUTO_TEST_CASE(pcinfo_test_dumps)
 }
 
 
+BOOST_AUTO_TEST_CASE(pcinfo_test_stats_modes)
+{
+    const std::string cmd = appName();
+
+    const std::string inputLas = Support::datapath("1.2-with-color.las");
+
+    std::string output;
+
+    // header only: bounds and return counts, no points read
+    int stat = Support::run_command(cmd + " --stats --stats_mode header " + inputLas, output);
+    BOOST_CHECK_EQUAL(stat, 0);
+    BOOST_CHECK(output.find("\"accuracy\": \"header\"") != std::string::npos);
+    BOOST_CHECK(output.find("\"ReturnNumber\"") != std::string::npos);
+    BOOST_CHECK(output.find("635619.8") != std::string::npos);
+    BOOST_CHECK(output.find("\"histogram\"") != std::string::npos);
+
+    // a random subset of the points
+    stat = Support::run_command(cmd + " --stats --stats_mode sample --sample_points 300 --seed 1234 " + inputLas, output);
+    BOOST_CHECK_EQUAL(stat, 0);
+    BOOST_CHECK(output.find("\"accuracy\": \"estimate\"") != std::string::npos);
+    BOOST_CHECK(output.find("\"count\": \"300\"") != std::string::npos);
+    BOOST_CHECK(output.find("\"total_points\": \"1065\"") != std::string::npos);
+
+    // asking for more than half the file reads all of it
+    stat = Support::run_command(cmd + " --stats --stats_mode sample --sample_points 1000 " + inputLas, output);
+    BOOST_CHECK_EQUAL(stat, 0);
+    BOOST_CHECK(output.find("\"accuracy\": \"exact\"") != std::string::npos);
+    BOOST_CHECK(output.find("\"count\": \"1065\"") != std::string::npos);
+
+    stat = Support::run_command(cmd + " --stats --stats_mode bogus " + inputLas, output);
+    BOOST_CHECK_EQUAL(stat, 1);
+
+    return;
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,183 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+
+#include <pdal/drivers/columnar/Codec.hpp>
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace pdal;
+using namespace pdal::drivers::columnar;
+
+BOOST_AUTO_TEST_SUITE(ColumnarCodecTest)
+
+
+// Ramps, runs, noise and the extremes of T, in blocks of 100.
+template <typename T>
+static std::vector<char> makeValues(boost::uint32_t count)
+{
+    std::vector<char> values(count * sizeof(T));
+    boost::uint32_t seed = 12345;
+    for (boost::uint32_t i = 0; i < count; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+
+        T v;
+        switch ((i / 100) % 4)
+        {
+            case 0: v = static_cast<T>(i * 3); break;
+            case 1: v = static_cast<T>(i / 37); break;
+            case 2: v = static_cast<T>(seed); break;
+            default: v = (i & 1) ? std::numeric_limits<T>::max() : std::numeric_limits<T>::min(); break;
+        }
+        std::memcpy(&values[i * sizeof(T)], &v, sizeof(T));
+    }
+    return values;
+}
+
+
+template <typename T>
+static void checkRoundTrip(codec::Type type, boost::uint32_t count)
+{
+    const std::vector<char> values = makeValues<T>(count);
+
+    std::vector<char> encoded;
+    encodeColumn(type, values.empty() ? 0 : &values[0], count, sizeof(T), encoded);
+
+    std::vector<char> decoded(values.size());
+    decodeColumn(type, encoded.empty() ? 0 : &encoded[0], encoded.size(), count, sizeof(T),
+                 decoded.empty() ? 0 : &decoded[0]);
+
+    BOOST_CHECK(decoded == values);
+
+    return;
+}
+
+
+template <typename T>
+static void checkAllCounts(codec::Type type)
+{
+    const boost::uint32_t counts[] = { 0, 1, 2, 127, 128, 129, 1000, 4096 };
+    for (std::size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+        checkRoundTrip<T>(type, counts[i]);
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_round_trip)
+{
+    const codec::Type types[] = { codec::None, codec::Delta, codec::RunLength, codec::Deflate, codec::Shuffle };
+    for (std::size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t)
+    {
+        if (!isCodecAvailable(types[t]))
+            continue;
+
+        checkAllCounts<boost::uint8_t>(types[t]);
+        checkAllCounts<boost::int16_t>(types[t]);
+        checkAllCounts<boost::int32_t>(types[t]);
+        checkAllCounts<boost::uint32_t>(types[t]);
+        checkAllCounts<boost::int64_t>(types[t]);
+        checkAllCounts<double>(types[t]);
+    }
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_sizes)
+{
+    // a ramp packs into two bits a step, plus the header
+    std::vector<boost::int32_t> ramp(1024);
+    for (std::size_t i = 0; i < ramp.size(); ++i)
+        ramp[i] = 1000000 + static_cast<boost::int32_t>(i) * 2;
+
+    std::vector<char> encoded;
+    encodeColumn(codec::Delta, static_cast<const char*>(static_cast<const void*>(&ramp[0])),
+                 1024, 4, encoded);
+    BOOST_CHECK_EQUAL(encoded.size(), 8u + 8u + 8u * 2u * 3u * 8u);
+
+    // runs of a classification
+    std::vector<boost::uint8_t> classes(1000, 2);
+    std::fill(classes.begin() + 600, classes.end(), 6);
+    encodeColumn(codec::RunLength, static_cast<const char*>(static_cast<const void*>(&classes[0])),
+                 1000, 1, encoded);
+    BOOST_CHECK_EQUAL(encoded.size(), 10u);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_names_and_errors)
+{
+    BOOST_CHECK(getCodec("delta") == codec::Delta);
+    BOOST_CHECK(getCodec("RLE") == codec::RunLength);
+    BOOST_CHECK(getCodec("auto") == codec::Auto);
+    BOOST_CHECK_EQUAL(getCodecName(codec::Shuffle), "shuffle");
+    BOOST_CHECK_THROW(getCodec("laszip"), columnar_error);
+
+    Dimension classification("Classification", dimension::UnsignedInteger, 1);
+    Dimension x("X", dimension::SignedInteger, 4);
+    BOOST_CHECK(chooseCodec(classification) == codec::RunLength);
+    BOOST_CHECK(chooseCodec(x) == codec::Delta);
+
+    const std::vector<char> values = makeValues<boost::int32_t>(500);
+    std::vector<char> encoded;
+    encodeColumn(codec::Delta, &values[0], 500, 4, encoded);
+
+    std::vector<char> decoded(values.size());
+    BOOST_CHECK_THROW(decodeColumn(codec::Delta, &encoded[0], encoded.size() - 8, 500, 4, &decoded[0]),
+                      columnar_error);
+    BOOST_CHECK_THROW(decodeColumn(codec::Delta, &encoded[0], 12, 500, 4, &decoded[0]), columnar_error);
+
+    encodeColumn(codec::RunLength, &values[0], 500, 4, encoded);
+    BOOST_CHECK_THROW(decodeColumn(codec::RunLength, &encoded[0], encoded.size(), 499, 4, &decoded[0]),
+                      columnar_error);
+    BOOST_CHECK_THROW(decodeColumn(codec::RunLength, &encoded[0], encoded.size() - 1, 500, 4, &decoded[0]),
+                      columnar_error);
+
+    BOOST_CHECK_THROW(encodeColumn(codec::Delta, &values[0], 100, 3, encoded), columnar_error);
+
+#ifndef PDAL_HAVE_ZLIB
+    BOOST_CHECK_THROW(encodeColumn(codec::Deflate, &values[0], 500, 4, encoded), columnar_error);
+#endif
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,196 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <pdal/StageIterator.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/drivers/columnar/Reader.hpp>
+#include <pdal/drivers/columnar/Support.hpp>
+#include <pdal/drivers/columnar/Writer.hpp>
+#include <pdal/drivers/faux/Reader.hpp>
+#include "Support.hpp"
+
+#include <cstring>
+
+#ifdef PDAL_COMPILER_GCC
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+#endif
+
+using namespace pdal;
+
+BOOST_AUTO_TEST_SUITE(ColumnarReaderTest)
+
+
+// Faux points whose Time is their index, in chunks of 1000.
+static std::string writeColumnar(boost::uint64_t numPoints)
+{
+    const std::string filename = Support::temppath("columnar_reader.pcol");
+
+    Bounds<double> bounds(1.0, 2.0, 3.0, 101.0, 102.0, 103.0);
+    drivers::faux::Reader faux(bounds, numPoints, drivers::faux::Reader::Constant);
+
+    Options options;
+    options.add("filename", filename);
+    options.add("chunk_size", 1000);
+
+    drivers::columnar::Writer writer(faux, options);
+    writer.initialize();
+    writer.write(0);
+
+    return filename;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_random_and_subset)
+{
+    const std::string filename = writeColumnar(4500);
+
+    {
+        Options options;
+        options.add("filename", filename);
+        drivers::columnar::Reader reader(options);
+        reader.initialize();
+
+        BOOST_CHECK_EQUAL(reader.getNumPoints(), 4500u);
+        BOOST_CHECK_EQUAL(reader.getNumChunks(), 5u);
+        BOOST_CHECK_EQUAL(reader.getBounds().getMinimum(0), 1.0);
+        BOOST_CHECK_EQUAL(reader.getBounds().getMaximum(2), 3.0);
+
+        const Schema& schema = reader.getSchema();
+        Dimension const& time = schema.getDimension("Time");
+
+        // Reads that cross chunks, from anywhere.
+        PointBuffer data(schema, 1500);
+        boost::scoped_ptr<StageRandomIterator> iter(reader.createRandomIterator(data));
+        BOOST_CHECK_EQUAL(iter->seek(2900), 2900u);
+        BOOST_CHECK_EQUAL(iter->read(data), 1500u);
+        for (boost::uint32_t i = 0; i < 1500; ++i)
+            BOOST_CHECK_EQUAL(data.getField<boost::uint64_t>(time, i), 2900u + i);
+        BOOST_CHECK_EQUAL(iter->read(data), 100u);
+        BOOST_CHECK_EQUAL(data.getField<boost::uint64_t>(time, 99), 4499u);
+
+        BOOST_CHECK_EQUAL(iter->seek(17), 17u);
+        BOOST_CHECK_EQUAL(iter->read(data), 1500u);
+        BOOST_CHECK_EQUAL(data.getField<boost::uint64_t>(time, 0), 17u);
+
+        // Columns come straight from the file.
+        const boost::uint8_t* column = reader.getColumn(3, time);
+        boost::uint64_t value;
+        std::memcpy(&value, column + 5 * sizeof(value), sizeof(value));
+        BOOST_CHECK_EQUAL(value, 3005u);
+
+        // A buffer with only some of the columns gets only those.
+        Schema subset;
+        subset.appendDimension(time);
+        PointBuffer small(subset, 10);
+        boost::scoped_ptr<StageSequentialIterator> seq(reader.createSequentialIterator(small));
+        BOOST_CHECK_EQUAL(seq->skip(999), 999u);
+        BOOST_CHECK_EQUAL(seq->read(small), 10u);
+        BOOST_CHECK_EQUAL(small.getField<boost::uint64_t>(subset.getDimension("Time"), 1), 1000u);
+    }
+
+    {
+        Options options;
+        options.add("filename", filename);
+        options.add("dimensions", "Z, Time");
+        drivers::columnar::Reader reader(options);
+        reader.initialize();
+
+        const Schema& schema = reader.getSchema();
+        BOOST_CHECK_EQUAL(schema.getDimensions().size(), 2u);
+        BOOST_CHECK_EQUAL(schema.getByteSize(), 16u);
+
+        PointBuffer data(schema, 10);
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+        BOOST_CHECK_EQUAL(iter->read(data), 10u);
+        BOOST_CHECK_EQUAL(data.getField<double>(schema.getDimension("Z"), 3), 3.0);
+        BOOST_CHECK_EQUAL(data.getField<boost::uint64_t>(schema.getDimension("Time"), 3), 3u);
+    }
+
+    {
+        Options options;
+        options.add("filename", filename);
+        options.add("dimensions", "Intensity");
+        drivers::columnar::Reader reader(options);
+        BOOST_CHECK_THROW(reader.initialize(), drivers::columnar::columnar_error);
+    }
+
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_bad_file)
+{
+    Options options;
+    options.add("filename", Support::datapath("autzen-point-format-3.txt"));
+    drivers::columnar::Reader reader(options);
+    BOOST_CHECK_THROW(reader.initialize(), drivers::columnar::columnar_error);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_corrupt_bounds)
+{
+    drivers::columnar::Footer footer;
+    std::vector<char> bytes;
+    footer.encode(bytes);
+    // the chunk's bounds count follows its offset and point count
+    const std::size_t position = bytes.size() + 8 + 4;
+
+    drivers::columnar::ChunkInfo chunk;
+    chunk.bounds = Bounds<double>(1.0, 2.0, 3.0, 101.0, 102.0, 103.0);
+    footer.chunks.push_back(chunk);
+    footer.encode(bytes);
+
+    drivers::columnar::Footer decoded;
+    BOOST_CHECK(decoded.decode(&bytes[0], &bytes[0] + bytes.size()) == &bytes[0] + bytes.size());
+    BOOST_CHECK(decoded.chunks.size() == 1);
+    BOOST_CHECK(decoded.chunks[0].bounds == chunk.bounds);
+
+    std::memset(&bytes[position], 0xff, 4);
+    BOOST_CHECK_THROW(decoded.decode(&bytes[0], &bytes[0] + bytes.size()), drivers::columnar::columnar_error);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
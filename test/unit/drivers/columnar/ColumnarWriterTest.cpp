@@ -0,0 +1,236 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <pdal/StageIterator.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/drivers/columnar/Reader.hpp>
+#include <pdal/drivers/columnar/Writer.hpp>
+#include <pdal/drivers/columnar/Codec.hpp>
+#include <pdal/drivers/las/Reader.hpp>
+#include "Support.hpp"
+
+#include <cstring>
+
+using namespace pdal;
+
+BOOST_AUTO_TEST_SUITE(ColumnarWriterTest)
+
+
+// Checks that reader holds the same points as the LAS reader.
+static void checkPoints(const Stage& lasReader, const Stage& reader)
+{
+    const Schema& lasSchema = lasReader.getSchema();
+    const Schema& schema = reader.getSchema();
+    BOOST_CHECK_EQUAL(schema.getDimensions().size(), lasSchema.getDimensions().size());
+
+    PointBuffer lasData(lasSchema, 200);
+    boost::scoped_ptr<StageSequentialIterator> lasIter(lasReader.createSequentialIterator(lasData));
+    BOOST_CHECK_EQUAL(lasIter->read(lasData), 106u);
+
+    PointBuffer data(schema, 200);
+    boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+    BOOST_CHECK_EQUAL(iter->read(data), 106u);
+    BOOST_CHECK(iter->atEnd());
+
+    schema::index_by_index const& dims = lasSchema.getDimensions().get<schema::index>();
+    for (schema::index_by_index::const_iterator dim = dims.begin(); dim != dims.end(); ++dim)
+    {
+        Dimension const& other = schema.getDimension(dim->getName(), dim->getNamespace());
+        BOOST_CHECK_EQUAL(other.getByteSize(), dim->getByteSize());
+        for (boost::uint32_t i = 0; i < 106; ++i)
+        {
+            BOOST_CHECK(std::memcmp(data.getData(i) + other.getByteOffset(),
+                                    lasData.getData(i) + dim->getByteOffset(),
+                                    dim->getByteSize()) == 0);
+        }
+    }
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_round_trip)
+{
+    const std::string filename = Support::temppath("columnar_writer.pcol");
+
+    Options lasOptions;
+    lasOptions.add("filename", Support::datapath("autzen-point-format-3.las"));
+    drivers::las::Reader lasReader(lasOptions);
+
+    {
+        Options options;
+        options.add("filename", filename);
+        options.add("chunk_size", 40);
+
+        drivers::columnar::Writer writer(lasReader, options);
+        BOOST_CHECK_EQUAL(writer.getName(), "drivers.columnar.writer");
+        writer.initialize();
+        BOOST_CHECK_EQUAL(writer.write(0), 106u);
+    }
+
+    Options options;
+    options.add("filename", filename);
+    drivers::columnar::Reader reader(options);
+    BOOST_CHECK_EQUAL(reader.getName(), "drivers.columnar.reader");
+    reader.initialize();
+
+    BOOST_CHECK_EQUAL(reader.getNumPoints(), 106u);
+    BOOST_CHECK_EQUAL(reader.getNumChunks(), 3u);
+    BOOST_CHECK_EQUAL(reader.getChunkNumPoints(2), 26u);
+    BOOST_CHECK_EQUAL(reader.getChunkStart(2), 80u);
+
+    // Every dimension comes back, with its namespace and id.
+    Dimension const& lasX = lasReader.getSchema().getDimension("X");
+    Dimension const& x = reader.getSchema().getDimension("X");
+    BOOST_CHECK_EQUAL(x.getNamespace(), lasX.getNamespace());
+    BOOST_CHECK(x.getUUID() == lasX.getUUID());
+    BOOST_CHECK_CLOSE(x.getNumericScale(), lasX.getNumericScale(), 0.000001);
+
+    checkPoints(lasReader, reader);
+
+    PointBuffer data(reader.getSchema(), 200);
+    boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+    BOOST_CHECK_EQUAL(iter->read(data), 106u);
+
+    // The chunk bounds hold the chunk's points.
+    Bounds<double> const& bounds = reader.getChunkBounds(1);
+    BOOST_CHECK_EQUAL(bounds.size(), 3u);
+    for (boost::uint32_t i = 40; i < 80; ++i)
+    {
+        const double v = x.applyScaling(data.getField<boost::int32_t>(x, i));
+        BOOST_CHECK(v >= bounds.getMinimum(0));
+        BOOST_CHECK(v <= bounds.getMaximum(0));
+    }
+
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_codecs)
+{
+    const std::string plain = Support::temppath("columnar_plain.pcol");
+    const std::string filename = Support::temppath("columnar_codecs.pcol");
+
+    Options lasOptions;
+    lasOptions.add("filename", Support::datapath("autzen-point-format-3.las"));
+    drivers::las::Reader lasReader(lasOptions);
+
+    {
+        drivers::las::Reader lasPlain(lasOptions);
+
+        Options options;
+        options.add("filename", plain);
+
+        drivers::columnar::Writer writer(lasPlain, options);
+        writer.initialize();
+        writer.write(0);
+    }
+
+    {
+        Options options;
+        options.add("filename", filename);
+        options.add("chunk_size", 64);
+        options.add("compression", "auto");
+        options.add("codecs", "Intensity:rle, Time:delta");
+
+        drivers::columnar::Writer writer(lasReader, options);
+        writer.initialize();
+        BOOST_CHECK_EQUAL(writer.write(0), 106u);
+    }
+    BOOST_CHECK(FileUtils::fileSize(filename) < FileUtils::fileSize(plain));
+
+    Options options;
+    options.add("filename", filename);
+    drivers::columnar::Reader reader(options);
+    reader.initialize();
+    BOOST_CHECK_EQUAL(reader.getNumChunks(), 2u);
+
+    checkPoints(lasReader, reader);
+
+    Dimension const& x = reader.getSchema().getDimension("X");
+    Dimension const& edge = reader.getSchema().getDimension("EdgeOfFlightLine");
+    Dimension const& intensity = reader.getSchema().getDimension("Intensity");
+    BOOST_CHECK(reader.getColumnCodec(0, x) == drivers::columnar::codec::Delta);
+    BOOST_CHECK(reader.getColumnCodec(1, edge) == drivers::columnar::codec::RunLength);
+    // runs of intensity would be bigger than the values
+    BOOST_CHECK(reader.getColumnCodec(1, intensity) == drivers::columnar::codec::None);
+    BOOST_CHECK_THROW(reader.getColumn(0, x), drivers::columnar::columnar_error);
+
+    std::vector<boost::uint8_t> column;
+    reader.decodeColumn(1, x, column);
+    BOOST_CHECK_EQUAL(column.size(), 42u * 4u);
+
+    PointBuffer data(reader.getSchema(), 200);
+    boost::scoped_ptr<StageRandomIterator> iter(reader.createRandomIterator(data));
+    iter->seek(64);
+    BOOST_CHECK_EQUAL(iter->read(data), 42u);
+    for (boost::uint32_t i = 0; i < 42; ++i)
+        BOOST_CHECK(std::memcmp(&column[i * 4], data.getData(i) + x.getByteOffset(), 4) == 0);
+
+    {
+        Options bad;
+        bad.add("filename", filename);
+        bad.add("codecs", "Nothing:delta");
+
+        drivers::las::Reader lasBad(lasOptions);
+        drivers::columnar::Writer writer(lasBad, bad);
+        writer.initialize();
+        BOOST_CHECK_THROW(writer.write(0), drivers::columnar::columnar_error);
+    }
+    {
+        Options bad;
+        bad.add("filename", filename);
+        bad.add("compression", "laszip");
+
+        drivers::las::Reader lasBad(lasOptions);
+        drivers::columnar::Writer writer(lasBad, bad);
+        BOOST_CHECK_THROW(writer.initialize(), drivers::columnar::columnar_error);
+    }
+
+    FileUtils::deleteFile(plain);
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
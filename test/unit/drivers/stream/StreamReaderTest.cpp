@@ -0,0 +1,171 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <pdal/StageIterator.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/drivers/las/Reader.hpp>
+#include <pdal/drivers/stream/Reader.hpp>
+#include <pdal/drivers/stream/Writer.hpp>
+#include "Support.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace pdal;
+
+BOOST_AUTO_TEST_SUITE(StreamReaderTest)
+
+
+BOOST_AUTO_TEST_CASE(test_round_trip)
+{
+    const std::string filename = Support::temppath("stream_reader.pdalstream");
+
+    Options lasOptions;
+    lasOptions.add("filename", Support::datapath("autzen-point-format-3.las"));
+    drivers::las::Reader lasReader(lasOptions);
+
+    {
+        Options options;
+        options.add("filename", filename);
+        options.add("chunk_size", 50);
+
+        drivers::stream::Writer writer(lasReader, options);
+        writer.initialize();
+        BOOST_CHECK_EQUAL(writer.write(0), 106u);
+    }
+
+    Options options;
+    options.add("filename", filename);
+    drivers::stream::Reader reader(options);
+    BOOST_CHECK_EQUAL(reader.getName(), "drivers.stream.reader");
+    reader.initialize();
+
+    BOOST_CHECK_EQUAL(reader.getNumPoints(), 106u);
+    BOOST_CHECK(reader.getPointCountType() == PointCount_Fixed);
+    BOOST_CHECK(reader.getBounds() == lasReader.getBounds());
+
+    const Schema& lasSchema = lasReader.getSchema();
+    const Schema& schema = reader.getSchema();
+    BOOST_CHECK_EQUAL(schema.getByteSize(), lasSchema.getByteSize());
+
+    PointBuffer lasData(lasSchema, 200);
+    boost::scoped_ptr<StageSequentialIterator> lasIter(lasReader.createSequentialIterator(lasData));
+    BOOST_CHECK_EQUAL(lasIter->read(lasData), 106u);
+
+    // The points come as they were, across frames.
+    PointBuffer data(schema, 80);
+    boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+    BOOST_CHECK_EQUAL(iter->read(data), 80u);
+    BOOST_CHECK(std::memcmp(data.getData(0), lasData.getData(0), 80 * schema.getByteSize()) == 0);
+    BOOST_CHECK_EQUAL(iter->read(data), 26u);
+    BOOST_CHECK(std::memcmp(data.getData(0), lasData.getData(80), 26 * schema.getByteSize()) == 0);
+    BOOST_CHECK_EQUAL(iter->read(data), 0u);
+    BOOST_CHECK(iter->atEnd());
+
+    // A file can be read again, into a buffer with only some of the dimensions.
+    Schema subset;
+    subset.appendDimension(schema.getDimension("Z"));
+    subset.appendDimension(schema.getDimension("Classification"));
+    PointBuffer small(subset, 10);
+    boost::scoped_ptr<StageSequentialIterator> second(reader.createSequentialIterator(small));
+    BOOST_CHECK_EQUAL(second->skip(55), 55u);
+    BOOST_CHECK_EQUAL(second->read(small), 10u);
+
+    Dimension const& lasZ = lasSchema.getDimension("Z");
+    Dimension const& lasClass = lasSchema.getDimension("Classification");
+    for (boost::uint32_t i = 0; i < 10; ++i)
+    {
+        BOOST_CHECK_EQUAL(small.getField<boost::int32_t>(subset.getDimension("Z"), i),
+                          lasData.getField<boost::int32_t>(lasZ, 55 + i));
+        BOOST_CHECK_EQUAL(small.getField<boost::uint8_t>(subset.getDimension("Classification"), i),
+                          lasData.getField<boost::uint8_t>(lasClass, 55 + i));
+    }
+
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_truncated)
+{
+    const std::string filename = Support::temppath("stream_truncated.pdalstream");
+
+    Options lasOptions;
+    lasOptions.add("filename", Support::datapath("autzen-point-format-3.las"));
+    drivers::las::Reader lasReader(lasOptions);
+
+    std::ostringstream ostr;
+    {
+        drivers::stream::Writer writer(lasReader, &ostr);
+        writer.initialize();
+        writer.write(0);
+    }
+
+    // everything but the end frame and a few bytes of the last point
+    {
+        const std::string bytes = ostr.str();
+        std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 10));
+    }
+
+    Options options;
+    options.add("filename", filename);
+    drivers::stream::Reader reader(options);
+    reader.initialize();
+
+    PointBuffer data(reader.getSchema(), 200);
+    boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+    BOOST_CHECK_THROW(iter->read(data), drivers::stream::stream_error);
+
+    Options bad;
+    bad.add("filename", Support::datapath("autzen-point-format-3.las"));
+    drivers::stream::Reader badReader(bad);
+    BOOST_CHECK_THROW(badReader.initialize(), drivers::stream::stream_error);
+
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+
+#include <pdal/Options.hpp>
+#include <pdal/drivers/faux/Reader.hpp>
+#include <pdal/drivers/stream/Writer.hpp>
+#include "Support.hpp"
+
+#include <cstring>
+#include <sstream>
+
+#ifdef PDAL_COMPILER_GCC
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+#endif
+
+using namespace pdal;
+
+BOOST_AUTO_TEST_SUITE(StreamWriterTest)
+
+
+BOOST_AUTO_TEST_CASE(test_frames)
+{
+    Bounds<double> bounds(1.0, 2.0, 3.0, 101.0, 102.0, 103.0);
+    drivers::faux::Reader faux(bounds, 1000, drivers::faux::Reader::Ramp);
+
+    std::ostringstream ostr;
+    {
+        drivers::stream::Writer writer(faux, &ostr);
+        BOOST_CHECK_EQUAL(writer.getName(), "drivers.stream.writer");
+        writer.setChunkSize(300);
+        writer.initialize();
+        BOOST_CHECK_EQUAL(writer.write(0), 1000u);
+    }
+    const std::string bytes = ostr.str();
+
+    std::istringstream istr(bytes);
+    drivers::stream::Header header;
+    header.read(istr);
+    BOOST_CHECK_EQUAL(header.numPoints, 1000u);
+    BOOST_CHECK(header.pointCountType == PointCount_Fixed);
+    BOOST_CHECK_EQUAL(header.bounds.getMaximum(1), 102.0);
+    BOOST_CHECK_EQUAL(header.schema.dimensions.size(), 4u);
+    BOOST_CHECK_EQUAL(header.schema.dimensions[3].getName(), "Time");
+
+    // frames of 300, 300, 300 and 100 points, then the end
+    const std::size_t pointSize = faux.getSchema().getByteSize();
+    std::size_t position = static_cast<std::size_t>(istr.tellg());
+    const boost::uint32_t expected[] = { 300, 300, 300, 100, 0 };
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+        boost::uint32_t numPoints = 0;
+        BOOST_REQUIRE(position + sizeof(numPoints) <= bytes.size());
+        std::memcpy(&numPoints, bytes.data() + position, sizeof(numPoints));
+        BOOST_CHECK_EQUAL(numPoints, expected[i]);
+        position += sizeof(numPoints) + numPoints * pointSize;
+    }
+    BOOST_CHECK_EQUAL(position, bytes.size());
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_bad_header)
+{
+    std::istringstream empty("");
+    drivers::stream::Header header;
+    BOOST_CHECK_THROW(header.read(empty), drivers::stream::stream_error);
+
+    std::istringstream other("PDALCOLS and then some more bytes");
+    BOOST_CHECK_THROW(header.read(other), drivers::stream::stream_error);
+
+    std::istringstream truncated(std::string("PDALSTRM\x01\0\0", 11));
+    BOOST_CHECK_THROW(header.read(truncated), drivers::stream::stream_error);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,340 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <pdal/StageIterator.hpp>
+#include <pdal/Options.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/FileUtils.hpp>
+#include <pdal/drivers/las/Reader.hpp>
+#include <pdal/drivers/text/Reader.hpp>
+#include "Support.hpp"
+
+#include <fstream>
+
+#ifdef PDAL_COMPILER_GCC
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+#endif
+
+using namespace pdal;
+
+BOOST_AUTO_TEST_SUITE(TextReaderTest)
+
+
+static std::string writeText(std::string const& name, std::string const& text)
+{
+    const std::string filename = Support::temppath(name);
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+    out << text;
+    return filename;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_csv)
+{
+    Options options;
+    options.add("filename", Support::datapath("autzen-point-format-3.txt"));
+    options.add("scale_x", 0.01);
+    options.add("scale_y", 0.01);
+    options.add("scale_z", 0.01);
+
+    drivers::text::Reader reader(options);
+    BOOST_CHECK_EQUAL(reader.getDescription(), "Text Reader");
+    BOOST_CHECK_EQUAL(reader.getName(), "drivers.text.reader");
+    reader.initialize();
+
+    BOOST_CHECK_EQUAL(reader.getNumPoints(), 106u);
+    BOOST_CHECK_EQUAL(reader.getDelimiter(), ',');
+
+    const Schema& schema = reader.getSchema();
+    BOOST_CHECK_EQUAL(schema.getDimensions().size(), 16u);
+    Dimension const& dimX = schema.getDimension("X");
+    BOOST_CHECK_EQUAL(dimX.getInterpretation(), dimension::SignedInteger);
+    BOOST_CHECK_EQUAL(dimX.getByteSize(), 4u);
+    BOOST_CHECK_EQUAL(dimX.getNumericScale(), 0.01);
+    BOOST_CHECK_EQUAL(schema.getDimension("Intensity").getByteSize(), 2u);
+    BOOST_CHECK_EQUAL(schema.getDimension("ScanAngleRank").getInterpretation(), dimension::SignedInteger);
+    BOOST_CHECK_EQUAL(schema.getDimension("Time").getInterpretation(), dimension::Float);
+
+    PointBuffer data(schema, 200);
+    boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+    BOOST_CHECK_EQUAL(iter->read(data), 106u);
+    BOOST_CHECK(iter->atEnd());
+
+    Options lasOptions;
+    lasOptions.add("filename", Support::datapath("autzen-point-format-3.las"));
+    drivers::las::Reader lasReader(lasOptions);
+    lasReader.initialize();
+
+    const Schema& lasSchema = lasReader.getSchema();
+    PointBuffer lasData(lasSchema, 200);
+    boost::scoped_ptr<StageSequentialIterator> lasIter(lasReader.createSequentialIterator(lasData));
+    BOOST_CHECK_EQUAL(lasIter->read(lasData), 106u);
+
+    const char* coordinates[] = { "X", "Y", "Z" };
+    const char* fields[] = { "Intensity", "ReturnNumber", "Classification",
+                             "ScanAngleRank", "PointSourceId", "Red" };
+    for (boost::uint32_t i = 0; i < 106; ++i)
+    {
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            Dimension const& dim = schema.getDimension(coordinates[c]);
+            Dimension const& lasDim = lasSchema.getDimension(coordinates[c]);
+            BOOST_CHECK_CLOSE(dim.applyScaling(data.getField<boost::int32_t>(dim, i)),
+                              lasDim.applyScaling(lasData.getField<boost::int32_t>(lasDim, i)),
+                              0.000001);
+        }
+        for (std::size_t c = 0; c < 6; ++c)
+        {
+            BOOST_CHECK_EQUAL(data.getField<boost::int32_t>(schema.getDimension(fields[c]), i),
+                              lasData.getField<boost::int32_t>(lasSchema.getDimension(fields[c]), i));
+        }
+    }
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_xyz_and_pts)
+{
+    const std::string xyz = writeText("text_reader_xyz.txt",
+                                      "# exported points\r\n"
+                                      "\r\n"
+                                      "  1.5\t-2 3e2 \r\n"
+                                      "\r\n"
+                                      "4 5.25   -6.125\r\n");
+    {
+        Options options;
+        options.add("filename", xyz);
+        options.add("skip", 1);
+
+        drivers::text::Reader reader(options);
+        reader.initialize();
+        BOOST_CHECK_EQUAL(reader.getNumPoints(), 2u);
+        BOOST_CHECK_EQUAL(reader.getDelimiter(), 0);
+
+        const Schema& schema = reader.getSchema();
+        BOOST_CHECK_EQUAL(schema.getDimensions().size(), 3u);
+
+        PointBuffer data(schema, 10);
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+        BOOST_CHECK_EQUAL(iter->read(data), 2u);
+
+        Dimension const& dimX = schema.getDimension("X");
+        Dimension const& dimY = schema.getDimension("Y");
+        Dimension const& dimZ = schema.getDimension("Z");
+        BOOST_CHECK_EQUAL(data.getField<double>(dimX, 0), 1.5);
+        BOOST_CHECK_EQUAL(data.getField<double>(dimY, 0), -2.0);
+        BOOST_CHECK_EQUAL(data.getField<double>(dimZ, 0), 300.0);
+        BOOST_CHECK_EQUAL(data.getField<double>(dimX, 1), 4.0);
+        BOOST_CHECK_EQUAL(data.getField<double>(dimY, 1), 5.25);
+        BOOST_CHECK_EQUAL(data.getField<double>(dimZ, 1), -6.125);
+    }
+
+    const std::string pts = writeText("text_reader_pts.txt",
+                                      "2\n"
+                                      "1 2 3 -1500 255 128 0\n"
+                                      "4 5 6 70000 1 2 3\n");
+    {
+        Options options;
+        options.add("filename", pts);
+
+        drivers::text::Reader reader(options);
+        reader.initialize();
+        BOOST_CHECK_EQUAL(reader.getNumPoints(), 2u);
+
+        const Schema& schema = reader.getSchema();
+        BOOST_CHECK_EQUAL(schema.getDimensions().size(), 7u);
+
+        PointBuffer data(schema, 10);
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+        BOOST_CHECK_EQUAL(iter->read(data), 2u);
+
+        // Intensity saturates at the limits of its type.
+        Dimension const& intensity = schema.getDimension("Intensity");
+        BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(intensity, 0), 0u);
+        BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(intensity, 1), 65535u);
+        BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(schema.getDimension("Red"), 0), 255u);
+        BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(schema.getDimension("Blue"), 1), 3u);
+    }
+
+    // The columns option names and types the columns.
+    {
+        Options options;
+        options.add("filename", pts);
+        options.add("skip", 1);
+        options.add("columns", "x,y,z,Value:int32,a:uint8,b:float,c");
+
+        drivers::text::Reader reader(options);
+        reader.initialize();
+
+        const Schema& schema = reader.getSchema();
+        BOOST_CHECK_EQUAL(schema.getDimension("Value").getByteSize(), 4u);
+        BOOST_CHECK_EQUAL(schema.getDimension("b").getByteSize(), 4u);
+        BOOST_CHECK_EQUAL(schema.getDimension("c").getByteSize(), 8u);
+
+        PointBuffer data(schema, 10);
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+        BOOST_CHECK_EQUAL(iter->read(data), 2u);
+        BOOST_CHECK_EQUAL(data.getField<boost::int32_t>(schema.getDimension("Value"), 0), -1500);
+        BOOST_CHECK_EQUAL(data.getField<double>(schema.getDimension("Z"), 1), 6.0);
+    }
+
+    FileUtils::deleteFile(xyz);
+    FileUtils::deleteFile(pts);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_errors)
+{
+    const std::string bad = writeText("text_reader_bad.txt",
+                                      "X;Y;Z\n"
+                                      "1;2;3\n"
+                                      "1;2,5;3\n");
+    {
+        Options options;
+        options.add("filename", bad);
+
+        drivers::text::Reader reader(options);
+        reader.initialize();
+        BOOST_CHECK_EQUAL(reader.getDelimiter(), ';');
+        BOOST_CHECK_EQUAL(reader.getNumPoints(), 2u);
+
+        PointBuffer data(reader.getSchema(), 10);
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+        BOOST_CHECK_THROW(iter->read(data), drivers::text::text_driver_error);
+    }
+
+    const std::string ragged = writeText("text_reader_ragged.txt",
+                                         "1,2,3\n"
+                                         "1,2\n");
+    {
+        Options options;
+        options.add("filename", ragged);
+
+        drivers::text::Reader reader(options);
+        reader.initialize();
+
+        PointBuffer data(reader.getSchema(), 10);
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+        BOOST_CHECK_THROW(iter->read(data), drivers::text::text_driver_error);
+    }
+
+    FileUtils::deleteFile(bad);
+    FileUtils::deleteFile(ragged);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_threads_and_seek)
+{
+    const boost::uint32_t numPoints = 150000;
+
+    std::ostringstream oss;
+    oss << "x y z\n";
+    for (boost::uint32_t i = 0; i < numPoints; ++i)
+    {
+        oss << i << " " << i << ".25 -" << i << "e-2\n";
+        if (i % 1000 == 0)
+            oss << "\n";
+    }
+    const std::string filename = writeText("text_reader_threads.txt", oss.str());
+
+    Options options;
+    options.add("filename", filename);
+    options.add("threads", 4);
+
+    drivers::text::Reader reader(options);
+    reader.initialize();
+    BOOST_CHECK_EQUAL(reader.getNumPoints(), numPoints);
+    BOOST_CHECK_EQUAL(reader.getNumThreads(), 4u);
+
+    const Schema& schema = reader.getSchema();
+    Dimension const& dimX = schema.getDimension("X");
+    Dimension const& dimY = schema.getDimension("Y");
+    Dimension const& dimZ = schema.getDimension("Z");
+
+    PointBuffer data(schema, 100000);
+    {
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(data));
+
+        boost::uint32_t index = 0;
+        while (!iter->atEnd())
+        {
+            const boost::uint32_t numRead = iter->read(data);
+            for (boost::uint32_t i = 0; i < numRead; ++i, ++index)
+            {
+                BOOST_REQUIRE_EQUAL(data.getField<double>(dimX, i), index);
+                BOOST_REQUIRE_EQUAL(data.getField<double>(dimY, i), index + 0.25);
+                BOOST_REQUIRE_EQUAL(data.getField<double>(dimZ, i), -(index / 100.0));
+            }
+        }
+        BOOST_CHECK_EQUAL(index, numPoints);
+    }
+
+    PointBuffer small(schema, 10);
+    {
+        boost::scoped_ptr<StageSequentialIterator> iter(reader.createSequentialIterator(small));
+        BOOST_CHECK_EQUAL(iter->skip(70001), 70001u);
+        BOOST_CHECK_EQUAL(iter->read(small), 10u);
+        BOOST_CHECK_EQUAL(small.getField<double>(dimX, 0), 70001.0);
+    }
+    {
+        boost::scoped_ptr<StageRandomIterator> iter(reader.createRandomIterator(small));
+        BOOST_CHECK_EQUAL(iter->seek(131072), 131072u);
+        BOOST_CHECK_EQUAL(iter->read(small), 10u);
+        BOOST_CHECK_EQUAL(small.getField<double>(dimX, 9), 131081.0);
+
+        BOOST_CHECK_EQUAL(iter->seek(3), 3u);
+        BOOST_CHECK_EQUAL(iter->read(small), 10u);
+        BOOST_CHECK_EQUAL(small.getField<double>(dimY, 0), 3.25);
+
+        BOOST_CHECK_EQUAL(iter->seek(numPoints - 4), numPoints - 4);
+        BOOST_CHECK_EQUAL(iter->read(small), 4u);
+        BOOST_CHECK_EQUAL(small.getField<double>(dimX, 3), numPoints - 1.0);
+    }
+
+    FileUtils::deleteFile(filename);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
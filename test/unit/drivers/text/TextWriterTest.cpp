@@ -38,6 +38,10 @@
 #include <pdal/PipelineReader.hpp>
 #include <pdal/PipelineManager.hpp>
 #include <pdal/Utils.hpp>
+#include <pdal/drivers/text/Reader.hpp>
+#include <pdal/drivers/text/Writer.hpp>
+
+#include <fstream>
 
 #include "Support.hpp"
 
@@ -84,4 +88,46 @@ BOOST_AUTO_TEST_CASE(TextWriterTest_test_1)
 }
 
 
+BOOST_AUTO_TEST_CASE(TextWriterTest_test_shortest_and_threads)
+{
+    // The fast formatting path writes these the way the text reader
+    // reads them, so the file makes a round trip unchanged, and the
+    // threads write their runs of points back in order.
+    const std::string input_file(Support::temppath("text_writer_input.txt"));
+    const std::string output_file(Support::temppath("text_writer_output.txt"));
+    {
+        std::ofstream out(input_file.c_str(), std::ios::out | std::ios::binary);
+        out << "X,Y,Z\n";
+        for (boost::uint32_t i = 0; i < 50000; ++i)
+        {
+            out << i << ".5," << -static_cast<boost::int32_t>(i) << ".125,"
+                << (i % 7) << "\n";
+        }
+        out << "0.1,-0,1234567.891\n";
+    }
+
+    pdal::Options readerOptions;
+    readerOptions.add("filename", input_file);
+    pdal::drivers::text::Reader reader(readerOptions);
+
+    pdal::Options writerOptions;
+    writerOptions.add("filename", output_file);
+    writerOptions.add("quote_header", false);
+    writerOptions.add("float_format", "shortest");
+    writerOptions.add("threads", 4);
+    {
+        pdal::drivers::text::Writer writer(reader, writerOptions);
+        writer.initialize();
+        BOOST_CHECK_EQUAL(writer.write(0), 50001u);
+    }
+
+    BOOST_CHECK(Support::compare_text_files(input_file, output_file));
+
+    pdal::FileUtils::deleteFile(input_file);
+    pdal::FileUtils::deleteFile(output_file);
+
+    return;
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
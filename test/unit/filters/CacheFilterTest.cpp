@@ -34,11 +34,14 @@
 
 #include <boost/test/unit_test.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <pdal/PointBuffer.hpp>
 #include <pdal/StageIterator.hpp>
 #include <pdal/drivers/faux/Reader.hpp>
+#include <pdal/FileUtils.hpp>
 #include <pdal/filters/Cache.hpp>
+#include <pdal/filters/PointBufferSpill.hpp>
 
 using namespace pdal;
 
@@ -144,4 +147,329 @@ BOOST_AUTO_TEST_CASE(CacheFilterTest_test_options)
     return;
 }
 
+
+static bool checkTimes(const PointBuffer& data, boost::uint64_t first)
+{
+    const Dimension& dim = data.getSchema().getDimension("Time");
+    for (boost::uint32_t i = 0; i < data.getNumPoints(); ++i)
+    {
+        if (data.getField<boost::uint64_t>(dim, i) != first + i)
+            return false;
+    }
+    return true;
+}
+
+
+BOOST_AUTO_TEST_CASE(CacheFilterTest_test_stitch)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Constant);
+
+    pdal::filters::Cache cache(reader, 8, 100);
+    cache.initialize();
+
+    const Schema& schema = cache.getSchema();
+    PointBuffer data(schema, 250);
+
+    // a read across three blocks, starting in the middle of one
+    StageRandomIterator* iter = cache.createRandomIterator(data);
+    iter->seek(50);
+    BOOST_CHECK(iter->read(data) == 250);
+    BOOST_CHECK(iter->getIndex() == 300);
+    BOOST_CHECK(checkTimes(data, 50));
+    BOOST_CHECK(cache.getNumPointsRead() == 300);
+
+    // all of it cached now, in pieces of any size
+    PointBuffer small(schema, 7);
+    iter->seek(93);
+    BOOST_CHECK(iter->read(small) == 7);
+    BOOST_CHECK(checkTimes(small, 93));
+    iter->seek(0);
+    BOOST_CHECK(iter->read(data) == 250);
+    BOOST_CHECK(checkTimes(data, 0));
+    BOOST_CHECK(cache.getNumPointsRead() == 300);
+
+    // a sequential read may start in the middle of a block too, and the
+    // points run out in the middle of the last one
+    PointBuffer odd(schema, 333);
+    StageSequentialIterator* seq = cache.createSequentialIterator(odd);
+    seq->skip(10);
+    boost::uint64_t total = 0;
+    while (!seq->atEnd())
+    {
+        const boost::uint32_t numRead = seq->read(odd);
+        BOOST_CHECK(checkTimes(odd, 10 + total));
+        total += numRead;
+    }
+    BOOST_CHECK(total == 990);
+    BOOST_CHECK(cache.getNumPointsRead() == 1000);
+
+    iter->seek(990);
+    BOOST_CHECK(iter->read(data) == 10);
+    BOOST_CHECK(checkTimes(data, 990));
+    BOOST_CHECK(iter->seek(2000) == 1000);
+    BOOST_CHECK(iter->read(data) == 0);
+
+    delete iter;
+    delete seq;
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(CacheFilterTest_test_other_schema)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Constant);
+
+    pdal::filters::Cache cache(reader, 8, 100);
+    cache.initialize();
+
+    // the same dimensions and size as the stage schema, laid out backwards
+    const Schema& schema = cache.getSchema();
+    Schema reversed;
+    for (std::size_t i = schema.size(); i > 0; --i)
+        reversed.appendDimension(schema.getDimension(i - 1));
+    BOOST_CHECK(reversed.getByteSize() == schema.getByteSize());
+
+    PointBuffer data(reversed, 250);
+
+    StageRandomIterator* iter = cache.createRandomIterator(data);
+    iter->seek(50);
+    BOOST_CHECK(iter->read(data) == 250);
+    BOOST_CHECK(checkTimes(data, 50));
+
+    StageSequentialIterator* seq = cache.createSequentialIterator(data);
+    seq->skip(10);
+    BOOST_CHECK(seq->read(data) == 250);
+    BOOST_CHECK(checkTimes(data, 10));
+    BOOST_CHECK(seq->read(data) == 250);
+    BOOST_CHECK(checkTimes(data, 260));
+
+    // none of it went into the cache
+    PointBuffer same(schema, 250);
+    iter->seek(50);
+    BOOST_CHECK(iter->read(same) == 250);
+    BOOST_CHECK(checkTimes(same, 50));
+    BOOST_CHECK(cache.getNumPointsRead() == 750 + 300);
+
+    delete iter;
+    delete seq;
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(CacheFilterTest_test_limits)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Constant);
+
+    // X, Y, Z and Time, 8 bytes each
+    const boost::uint64_t blockBytes = 32 * 100;
+
+    Options opts;
+    opts.add("max_cache_blocks", 100);
+    opts.add("cache_block_size", 100);
+    opts.add("max_cache_bytes", blockBytes * 3);
+    opts.add("cache_shards", 8);
+    opts.add("prefetch_blocks", 1);
+    pdal::filters::Cache cache(reader, opts);
+    cache.initialize();
+    BOOST_CHECK(cache.getSchema().getByteSize() * 100 == blockBytes);
+
+    // no more shards than blocks the byte budget holds
+    BOOST_CHECK(cache.getNumCacheShards() == 3);
+
+    PointBuffer data(cache.getSchema(), 1);
+    StageRandomIterator* iter = cache.createRandomIterator(data);
+
+    // a miss reads the block after it as well
+    iter->seek(420);
+    BOOST_CHECK(iter->read(data) == 1);
+    BOOST_CHECK(checkTimes(data, 420));
+    BOOST_CHECK(cache.getNumPointsRead() == 200);
+    iter->seek(512);
+    BOOST_CHECK(iter->read(data) == 1);
+    BOOST_CHECK(checkTimes(data, 512));
+    BOOST_CHECK(cache.getNumPointsRead() == 200);
+
+    for (boost::uint64_t i = 0; i < 1000; i += 37)
+    {
+        iter->seek(i);
+        BOOST_CHECK(iter->read(data) == 1);
+        BOOST_CHECK(checkTimes(data, i));
+        BOOST_CHECK(cache.getCacheBytes() <= blockBytes * 3);
+    }
+
+    delete iter;
+
+    return;
+}
+
+
+
+BOOST_AUTO_TEST_CASE(CacheFilterTest_test_spill)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Constant);
+
+    Options opts;
+    opts.add("max_cache_blocks", 1);
+    opts.add("cache_block_size", 100);
+    opts.add("spill_bytes", 32 * 100 * 4);
+    pdal::filters::Cache cache(reader, opts);
+    cache.initialize();
+
+    const PointBufferSpill* spill = cache.getSpill();
+    BOOST_CHECK(spill != NULL);
+    BOOST_CHECK(spill->getNumSlots() == 4);
+    const std::string filename = spill->getFilename();
+    BOOST_CHECK(FileUtils::fileExists(filename));
+
+    PointBuffer data(cache.getSchema(), 10);
+    StageRandomIterator* iter = cache.createRandomIterator(data);
+
+    // blocks 0 to 5 pass through memory, and the last four evicted stay on disk
+    for (boost::uint64_t i = 0; i < 600; i += 100)
+    {
+        iter->seek(i);
+        BOOST_CHECK(iter->read(data) == 10);
+    }
+    BOOST_CHECK(cache.getNumPointsRead() == 600);
+    BOOST_CHECK(spill->getNumBlocks() == 4);
+
+    // so blocks 1 to 4 come back from the file, and block 0 from upstream
+    for (boost::uint64_t i = 450; i > 50; i -= 100)
+    {
+        iter->seek(i);
+        BOOST_CHECK(iter->read(data) == 10);
+        BOOST_CHECK(checkTimes(data, i));
+    }
+    BOOST_CHECK(cache.getNumPointsRead() == 600);
+    iter->seek(0);
+    BOOST_CHECK(iter->read(data) == 10);
+    BOOST_CHECK(checkTimes(data, 0));
+    BOOST_CHECK(cache.getNumPointsRead() == 700);
+
+    boost::uint64_t misses, hits, writes;
+    spill->getSpillStats(misses, hits, writes);
+    BOOST_CHECK(hits == 4);
+    BOOST_CHECK(misses == 6 + 1);
+
+    delete iter;
+
+    // the file goes with the cache
+    cache.resetCache();
+    BOOST_CHECK(!FileUtils::fileExists(filename));
+
+    return;
+}
+
+
+namespace
+{
+
+struct RandomReads
+{
+    RandomReads(const pdal::filters::Cache& cache, boost::uint32_t seed, bool& ok)
+        : m_cache(cache), m_seed(seed), m_ok(ok)
+    {}
+
+    void operator()()
+    {
+        PointBuffer data(m_cache.getSchema(), 150);
+        StageRandomIterator* iter = m_cache.createRandomIterator(data);
+        boost::uint32_t state = m_seed;
+        for (int i = 0; i < 200; ++i)
+        {
+            state = state * 1103515245u + 12345u;
+            const boost::uint64_t start = (state >> 8) % 5000;
+            iter->seek(start);
+            const boost::uint32_t numRead = iter->read(data);
+            if (numRead != std::min<boost::uint64_t>(150, 5000 - start) ||
+                    !checkTimes(data, start))
+                m_ok = false;
+        }
+        delete iter;
+    }
+
+    const pdal::filters::Cache& m_cache;
+    boost::uint32_t m_seed;
+    bool& m_ok;
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE(CacheFilterTest_test_prefetch_held)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 100, pdal::drivers::faux::Reader::Constant);
+
+    Options opts;
+    opts.add("max_cache_blocks", 4);
+    opts.add("cache_block_size", 10);
+    opts.add("prefetch_blocks", 2);
+    pdal::filters::Cache cache(reader, opts);
+    cache.initialize();
+
+    PointBuffer one(cache.getSchema(), 1);
+    StageRandomIterator* random = cache.createRandomIterator(one);
+    const boost::uint64_t setup[] = { 10, 20, 10, 60, 10 };
+    for (std::size_t i = 0; i < sizeof(setup) / sizeof(setup[0]); ++i)
+    {
+        random->seek(setup[i]);
+        BOOST_CHECK(random->read(one) == 1);
+    }
+
+    // Block 1 is cached and block 2 is not, so a miss on block 0 finds
+    // block 1 and then reads block 2, taking the previous stage past 1.
+    PointBuffer data(cache.getSchema(), 10);
+    StageSequentialIterator* seq = cache.createSequentialIterator(data);
+    BOOST_CHECK(seq->read(data) == 10);
+    BOOST_CHECK(checkTimes(data, 0));
+    BOOST_CHECK(cache.getNumPointsRead() == 80);
+
+    // the other iterator evicts block 1 before the sequential one gets to it
+    random->seek(40);
+    BOOST_CHECK(random->read(one) == 1);
+
+    boost::uint64_t total = 10;
+    while (!seq->atEnd())
+    {
+        const boost::uint32_t numRead = seq->read(data);
+        BOOST_CHECK(checkTimes(data, total));
+        total += numRead;
+    }
+    BOOST_CHECK(total == 100);
+
+    delete seq;
+    delete random;
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(CacheFilterTest_test_threads)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 5000, pdal::drivers::faux::Reader::Constant);
+
+    pdal::filters::Cache cache(reader, 12, 256);
+    cache.initialize();
+
+    bool ok[4] = { true, true, true, true };
+    boost::thread_group threads;
+    for (boost::uint32_t i = 0; i < 4; ++i)
+        threads.create_thread(RandomReads(cache, i + 1, ok[i]));
+    threads.join_all();
+
+    for (int i = 0; i < 4; ++i)
+        BOOST_CHECK(ok[i]);
+    BOOST_CHECK(cache.getNumPointsRequested() == 4 * 200 * 150);
+
+    return;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
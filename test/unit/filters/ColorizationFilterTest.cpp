@@ -41,11 +41,86 @@
 #include <pdal/Schema.hpp>
 #include <pdal/PointBuffer.hpp>
 
+#include <boost/bind.hpp>
+
 #include "Support.hpp"
 
+namespace
+{
+
+// a 10x6 raster with two bands: 100*line + pixel, and its negative
+void loadTile(boost::int32_t blockX, boost::int32_t blockY, double* data,
+              boost::int32_t blockXSize, boost::int32_t blockYSize, int* loads)
+{
+    for (boost::int32_t y = 0; y < blockYSize; ++y)
+    {
+        for (boost::int32_t x = 0; x < blockXSize; ++x)
+        {
+            const boost::int32_t pixel = blockX * blockXSize + x;
+            const boost::int32_t line = blockY * blockYSize + y;
+            if (pixel >= 10 || line >= 6)
+                continue;
+            data[y * blockXSize + x] = 100.0 * line + pixel;
+            data[blockXSize * blockYSize + y * blockXSize + x] = -(100.0 * line + pixel);
+        }
+    }
+    ++*loads;
+}
+
+}
+
 BOOST_AUTO_TEST_SUITE(ColorizationFilterTest)
 
 
+BOOST_AUTO_TEST_CASE(ColorizationFilterTest_tile_cache)
+{
+    int loads(0);
+    pdal::filters::colorization::TileCache cache(
+        boost::bind(&loadTile, _1, _2, _3, 4, 4, &loads), 10, 6, 4, 4, 2, 2);
+
+    double values[2];
+    BOOST_CHECK(cache.getNearest(5.5, 1.2, values));
+    BOOST_CHECK_EQUAL(values[0], 105.0);
+    BOOST_CHECK_EQUAL(values[1], -105.0);
+    BOOST_CHECK(cache.getNearest(9.9, 5.9, values));
+    BOOST_CHECK_EQUAL(values[0], 509.0);
+    BOOST_CHECK(!cache.getNearest(10.0, 0.0, values));
+    BOOST_CHECK(!cache.getNearest(-0.1, 0.0, values));
+    BOOST_CHECK_EQUAL(loads, 2);
+
+    // the same tile again is a hit
+    BOOST_CHECK(cache.getNearest(4.0, 0.0, values));
+    BOOST_CHECK_EQUAL(values[0], 4.0);
+    BOOST_CHECK_EQUAL(loads, 2);
+
+    // a third tile evicts the least recently used, (2, 1)
+    BOOST_CHECK(cache.getNearest(0.0, 0.0, values));
+    BOOST_CHECK_EQUAL(loads, 3);
+    BOOST_CHECK(cache.getNearest(4.0, 0.0, values));
+    BOOST_CHECK_EQUAL(loads, 3);
+    BOOST_CHECK(cache.getNearest(9.0, 5.0, values));
+    BOOST_CHECK_EQUAL(loads, 4);
+    BOOST_CHECK_EQUAL(cache.getNumMisses(), 4u);
+
+    // bilinear between pixel centres, across tiles, and clamped at edges
+    BOOST_CHECK(cache.getBilinear(4.0, 1.5, values));
+    BOOST_CHECK_CLOSE(values[0], 103.5, 1e-9);
+    BOOST_CHECK_CLOSE(values[1], -103.5, 1e-9);
+    BOOST_CHECK(cache.getBilinear(3.5, 4.0, values));
+    BOOST_CHECK_CLOSE(values[0], 353.0, 1e-9);
+    BOOST_CHECK(cache.getBilinear(0.2, 0.2, values));
+    BOOST_CHECK_EQUAL(values[0], 0.0);
+    BOOST_CHECK(!cache.getBilinear(0.0, 6.0, values));
+
+    BOOST_CHECK(cache.getTileIndex(1.0, 1.0) == cache.getTileIndex(3.9, 3.9));
+    BOOST_CHECK(cache.getTileIndex(1.0, 1.0) != cache.getTileIndex(4.0, 1.0));
+    BOOST_CHECK(cache.getTileIndex(1.0, 1.0) != cache.getTileIndex(1.0, 4.0));
+
+    return;
+}
+
+
+
 #ifdef PDAL_HAVE_GDAL
 
 
@@ -37,10 +37,76 @@
 
 #include <pdal/drivers/faux/Reader.hpp>
 #include <pdal/drivers/faux/Writer.hpp>
+#include <pdal/drivers/las/Reader.hpp>
 #include <pdal/filters/Crop.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/StageIterator.hpp>
+
+#include "Support.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
 
 using namespace pdal;
 
+namespace
+{
+
+// reads every point of stage, returning its scaled X, Y and Z
+boost::uint32_t readScaled(Stage& stage, std::vector<double>& xyz)
+{
+    PointBuffer data(stage.getSchema(), 2000);
+    StageSequentialIterator* iter = stage.createSequentialIterator(data);
+    const boost::uint32_t numRead = iter->read(data);
+
+    Schema const& schema = data.getSchema();
+    Dimension const& dimX = schema.getDimension("X");
+    Dimension const& dimY = schema.getDimension("Y");
+    Dimension const& dimZ = schema.getDimension("Z");
+    for (boost::uint32_t i = 0; i < numRead; ++i)
+    {
+        xyz.push_back(dimX.applyScaling(data.getField<boost::int32_t>(dimX, i)));
+        xyz.push_back(dimY.applyScaling(data.getField<boost::int32_t>(dimY, i)));
+        xyz.push_back(dimZ.applyScaling(data.getField<boost::int32_t>(dimZ, i)));
+    }
+
+    delete iter;
+    return numRead;
+}
+
+// the textbook even-odd test over every edge of the rings
+bool pnpoly(std::vector<std::vector<double> > const& rings, double x, double y)
+{
+    bool inside(false);
+    for (std::size_t r = 0; r < rings.size(); ++r)
+    {
+        std::vector<double> const& ring = rings[r];
+        const std::size_t n = ring.size() / 2;
+        for (std::size_t i = 0, j = n - 1; i < n; j = i++)
+        {
+            const double xi = ring[2 * i];
+            const double yi = ring[2 * i + 1];
+            const double xj = ring[2 * j];
+            const double yj = ring[2 * j + 1];
+            if (((yi > y) != (yj > y)) && (x < xi + (y - yi) * (xj - xi) / (yj - yi)))
+                inside = !inside;
+        }
+    }
+    return inside;
+}
+
+boost::uint32_t cropLas(Bounds<double> const& bounds, std::vector<double>& xyz)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+    pdal::filters::Crop filter(reader, bounds);
+    filter.initialize();
+
+    return readScaled(filter, xyz);
+}
+
+}
+
 BOOST_AUTO_TEST_SUITE(CropFilterTest)
 
 BOOST_AUTO_TEST_CASE(test_crop)
@@ -89,4 +155,263 @@ BOOST_AUTO_TEST_CASE(test_crop)
     return;
 }
 
+BOOST_AUTO_TEST_CASE(test_crop_negative)
+{
+    // faux buffers carry no extent of their own, so a box below zero must
+    // still be decided point by point
+    Bounds<double> srcBounds(-120.0, -40.0, -100.0, -110.0, -30.0, 0.0);
+    Bounds<double> dstBounds(-117.5, -40.0, -100.0, -112.5, -30.0, 0.0);
+
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Ramp);
+    pdal::filters::Crop filter(reader, dstBounds);
+    pdal::drivers::faux::Writer writer(filter, Options::none());
+    writer.initialize();
+
+    boost::uint64_t numWritten = writer.write(1000);
+    BOOST_CHECK(Utils::compare_approx<double>(static_cast<double>(numWritten), 500, 6));
+
+    const double delX = 10.0 / 999.0;
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getMinX(), -117.5, delX));
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getAvgX(), -115.0, delX));
+
+    pdal::drivers::faux::Reader reader2(srcBounds, 1000, pdal::drivers::faux::Reader::Ramp);
+    Options options;
+    options.add("bounds", dstBounds);
+    options.add("outside", true);
+    pdal::filters::Crop outside(reader2, options);
+    pdal::drivers::faux::Writer writer2(outside, Options::none());
+    writer2.initialize();
+
+    BOOST_CHECK_EQUAL(writer2.write(1000), 1000 - numWritten);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_crop_raw)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+    reader.initialize();
+    std::vector<double> all;
+    const boost::uint32_t numPoints = readScaled(reader, all);
+    BOOST_CHECK_EQUAL(numPoints, 1065u);
+
+    // a box whose lower corner is exactly on a point, so the raw
+    // limits must agree with the scaled comparison at the edges
+    const Bounds<double>& extent = reader.getBounds();
+    const double midX = (extent.getMinimum(0) + extent.getMaximum(0)) / 2.0;
+    const double midY = (extent.getMinimum(1) + extent.getMaximum(1)) / 2.0;
+    const Bounds<double> box(all[30], all[31], all[32],
+                             midX + 0.005, midY, extent.getMaximum(2));
+
+    std::vector<double> expected;
+    for (boost::uint32_t i = 0; i < numPoints; ++i)
+    {
+        Vector<double> point(all[3 * i], all[3 * i + 1], all[3 * i + 2]);
+        if (box.contains(point))
+        {
+            expected.push_back(all[3 * i]);
+            expected.push_back(all[3 * i + 1]);
+            expected.push_back(all[3 * i + 2]);
+        }
+    }
+
+    std::vector<double> cropped;
+    const boost::uint32_t numCropped = cropLas(box, cropped);
+    BOOST_CHECK(numCropped > 0);
+    BOOST_CHECK(numCropped < numPoints);
+    BOOST_CHECK_EQUAL(numCropped * 3, expected.size());
+    BOOST_CHECK(cropped == expected);
+
+    // two dimensional bounds crop on X and Y only
+    const Bounds<double> box2d(box.getMinimum(0), box.getMinimum(1),
+                               box.getMaximum(0), box.getMaximum(1));
+    std::vector<double> cropped2d;
+    BOOST_CHECK(cropLas(box2d, cropped2d) >= numCropped);
+
+    // the reader reports the file's extent with each buffer, so these are
+    // decided without testing points
+    std::vector<double> inside;
+    Bounds<double> bigger(extent);
+    bigger.grow(Vector<double>(extent.getMinimum(0) - 1, extent.getMinimum(1) - 1, extent.getMinimum(2) - 1));
+    BOOST_CHECK_EQUAL(cropLas(bigger, inside), numPoints);
+    BOOST_CHECK(inside == all);
+
+    std::vector<double> outside;
+    const Bounds<double> disjoint(0, 0, 0, 1, 1, 1);
+    BOOST_CHECK_EQUAL(cropLas(disjoint, outside), 0u);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_polygon)
+{
+    // a square with a triangular hole, and a separate diamond
+    const std::string wkt("MULTIPOLYGON (((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 8 2, 5 8, 2 2)),"
+                          " ((20 5, 25 0, 30 5, 25 10, 20 5)))");
+    std::vector<std::vector<double> > rings(3);
+    const double square[] = { 0, 0, 10, 0, 10, 10, 0, 10 };
+    const double hole[] = { 2, 2, 8, 2, 5, 8 };
+    const double diamond[] = { 20, 5, 25, 0, 30, 5, 25, 10 };
+    rings[0].assign(square, square + 8);
+    rings[1].assign(hole, hole + 6);
+    rings[2].assign(diamond, diamond + 8);
+
+    const pdal::filters::crop::Polygon polygon(wkt);
+    BOOST_CHECK(!polygon.empty());
+    BOOST_CHECK(polygon.getBounds() == Bounds<double>(0, 0, 30, 10));
+
+    BOOST_CHECK(polygon.contains(1, 1));
+    BOOST_CHECK(!polygon.contains(5, 4));
+    BOOST_CHECK(polygon.contains(25, 5));
+    BOOST_CHECK(!polygon.contains(15, 5));
+    BOOST_CHECK(!polygon.contains(-1, 5));
+
+    boost::uint32_t numMismatched = 0;
+    for (int i = 0; i < 317; ++i)
+    {
+        for (int j = 0; j < 113; ++j)
+        {
+            const double x = -1.0 + i * 0.1013;
+            const double y = -1.0 + j * 0.1097;
+            if (polygon.contains(x, y) != pnpoly(rings, x, y))
+                ++numMismatched;
+        }
+    }
+    BOOST_CHECK_EQUAL(numMismatched, 0u);
+
+    BOOST_CHECK(pdal::filters::crop::Polygon("POLYGON Z ((0 0 1, 1 0 1, 1 1 1, 0 0 1))").contains(0.75, 0.25));
+    BOOST_CHECK(pdal::filters::crop::Polygon("POLYGON EMPTY").empty());
+    BOOST_CHECK_THROW(pdal::filters::crop::Polygon("POLYGON ((0 0, 1 1))"), pdal_error);
+    BOOST_CHECK_THROW(pdal::filters::crop::Polygon("LINESTRING (0 0, 1 1)"), pdal_error);
+    BOOST_CHECK_THROW(pdal::filters::crop::Polygon("POLYGON ((0 0, 1 0, 1 1, 0 0)"), pdal_error);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_router)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Random);
+    reader.initialize();
+
+    PointBuffer data(reader.getSchema(), 1000);
+    StageSequentialIterator* iter = reader.createSequentialIterator(data);
+    BOOST_CHECK_EQUAL(iter->read(data), 1000u);
+    delete iter;
+
+    // four quadrants, and one region overlapping all of them
+    std::vector<pdal::filters::crop::Polygon> regions;
+    regions.push_back(pdal::filters::crop::Polygon("POLYGON ((0 0, 50 0, 50 50, 0 50, 0 0))"));
+    regions.push_back(pdal::filters::crop::Polygon("POLYGON ((50 0, 100 0, 100 50, 50 50, 50 0))"));
+    regions.push_back(pdal::filters::crop::Polygon("POLYGON ((0 50, 50 50, 50 100, 0 100, 0 50))"));
+    regions.push_back(pdal::filters::crop::Polygon("POLYGON ((50 50, 100 50, 100 100, 50 100, 50 50))"));
+    regions.push_back(pdal::filters::crop::Polygon("POLYGON ((25 25, 75 25, 75 75, 25 75, 25 25))"));
+    const pdal::filters::crop::Router router(regions);
+    BOOST_CHECK_EQUAL(router.getNumRegions(), 5u);
+
+    std::vector<PointBuffer*> outputs;
+    for (std::size_t i = 0; i < regions.size(); ++i)
+        outputs.push_back(new PointBuffer(data.getSchema(), 1000));
+
+    BOOST_CHECK_EQUAL(router.route(data, outputs), 1000u);
+
+    // the quadrants share their edges, so a few points may land in two
+    boost::uint32_t numQuadrants = 0;
+    for (std::size_t i = 0; i < 4; ++i)
+        numQuadrants += outputs[i]->getNumPoints();
+    BOOST_CHECK(numQuadrants >= 1000u);
+    BOOST_CHECK(numQuadrants < 1010u);
+    BOOST_CHECK(outputs[4]->getNumPoints() > 150u);
+    BOOST_CHECK(outputs[4]->getNumPoints() < 350u);
+
+    Schema const& schema = data.getSchema();
+    Dimension const& dimX = schema.getDimension("X");
+    Dimension const& dimY = schema.getDimension("Y");
+    for (std::size_t r = 0; r < regions.size(); ++r)
+    {
+        for (boost::uint32_t i = 0; i < outputs[r]->getNumPoints(); ++i)
+        {
+            const double x = outputs[r]->getField<double>(dimX, i);
+            const double y = outputs[r]->getField<double>(dimY, i);
+            BOOST_CHECK(regions[r].contains(x, y));
+        }
+    }
+
+    PointBuffer* last = outputs.back();
+    outputs.pop_back();
+    BOOST_CHECK_THROW(router.route(data, outputs), pdal_error);
+    outputs.push_back(last);
+
+    for (std::size_t i = 0; i < outputs.size(); ++i)
+        delete outputs[i];
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_crop_polygon)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+    reader.initialize();
+    std::vector<double> all;
+    const boost::uint32_t numPoints = readScaled(reader, all);
+
+    // a triangle over the middle of the file
+    const Bounds<double>& extent = reader.getBounds();
+    const double x0 = extent.getMinimum(0);
+    const double y0 = extent.getMinimum(1);
+    const double w = extent.getMaximum(0) - x0;
+    const double h = extent.getMaximum(1) - y0;
+    std::vector<std::vector<double> > rings(1);
+    rings[0].push_back(x0 + 0.1 * w);
+    rings[0].push_back(y0 + 0.1 * h);
+    rings[0].push_back(x0 + 0.9 * w);
+    rings[0].push_back(y0 + 0.2 * h);
+    rings[0].push_back(x0 + 0.4 * w);
+    rings[0].push_back(y0 + 0.9 * h);
+
+    std::ostringstream wkt;
+    wkt.precision(15);
+    wkt << "POLYGON ((";
+    for (std::size_t i = 0; i < 4; ++i)
+        wkt << (i ? ", " : "") << rings[0][2 * (i % 3)] << " " << rings[0][2 * (i % 3) + 1];
+    wkt << "))";
+
+    std::vector<double> inside;
+    std::vector<double> outside;
+    for (boost::uint32_t i = 0; i < numPoints; ++i)
+    {
+        std::vector<double>& expected = pnpoly(rings, all[3 * i], all[3 * i + 1]) ? inside : outside;
+        expected.insert(expected.end(), all.begin() + 3 * i, all.begin() + 3 * i + 3);
+    }
+    BOOST_CHECK(inside.size() > 0);
+    BOOST_CHECK(outside.size() > 0);
+
+    {
+        Options options;
+        options.add("polygon", wkt.str());
+        pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+        pdal::filters::Crop filter(reader, options);
+        filter.initialize();
+
+        std::vector<double> cropped;
+        BOOST_CHECK_EQUAL(readScaled(filter, cropped) * 3, inside.size());
+        BOOST_CHECK(cropped == inside);
+    }
+
+    {
+        Options options;
+        options.add("polygon", wkt.str());
+        options.add("outside", true);
+        pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+        pdal::filters::Crop filter(reader, options);
+        filter.initialize();
+
+        std::vector<double> cropped;
+        BOOST_CHECK_EQUAL(readScaled(filter, cropped) * 3, outside.size());
+        BOOST_CHECK(cropped == outside);
+    }
+
+    return;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
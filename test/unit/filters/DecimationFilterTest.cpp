@@ -34,16 +34,49 @@
 
 #include <boost/test/unit_test.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <pdal/StageIterator.hpp>
 #include <pdal/Schema.hpp>
 #include <pdal/PointBuffer.hpp>
 #include <pdal/drivers/faux/Reader.hpp>
 #include <pdal/drivers/faux/Writer.hpp>
+#include <pdal/drivers/las/Reader.hpp>
 #include <pdal/filters/Decimation.hpp>
+#include <pdal/filters/Expression.hpp>
+
+#include "Support.hpp"
+
+#include <cmath>
+#include <set>
 
 using namespace pdal;
 
+namespace
+{
+
+// the voxel of each point of a buffer with scaled integer coordinates
+std::set<std::vector<double> > getVoxels(PointBuffer const& data, double size)
+{
+    Schema const& schema = data.getSchema();
+    Dimension const& dimX = schema.getDimension("X");
+    Dimension const& dimY = schema.getDimension("Y");
+    Dimension const& dimZ = schema.getDimension("Z");
+
+    std::set<std::vector<double> > voxels;
+    for (boost::uint32_t i = 0; i < data.getNumPoints(); ++i)
+    {
+        std::vector<double> voxel;
+        voxel.push_back(std::floor(dimX.applyScaling(data.getField<boost::int32_t>(dimX, i)) / size));
+        voxel.push_back(std::floor(dimY.applyScaling(data.getField<boost::int32_t>(dimY, i)) / size));
+        voxel.push_back(std::floor(dimZ.applyScaling(data.getField<boost::int32_t>(dimZ, i)) / size));
+        voxels.insert(voxel);
+    }
+    return voxels;
+}
+
+}
+
 BOOST_AUTO_TEST_SUITE(DecimationFilterTest)
 
 BOOST_AUTO_TEST_CASE(DecimationFilterTest_test1)
@@ -117,4 +150,208 @@ BOOST_AUTO_TEST_CASE(DecimationFilterTest_test_options)
 }
 
 
+BOOST_AUTO_TEST_CASE(DecimationFilterTest_test_strided_las)
+{
+    // the LAS reader supports random access, so decimation should be
+    // pushed down into a strided read -- the answers must not change
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+    pdal::filters::Decimation filter(reader, 7);
+    filter.initialize();
+
+    const Schema& schema = filter.getSchema();
+    const boost::uint32_t numPoints = static_cast<boost::uint32_t>(reader.getNumPoints());
+
+    PointBuffer all(schema, numPoints);
+    boost::scoped_ptr<StageSequentialIterator> allIter(reader.createSequentialIterator(all));
+    BOOST_CHECK(allIter->read(all) == numPoints);
+
+    const boost::uint32_t numWanted = (numPoints + 6) / 7;
+    PointBuffer data(schema, 50);
+    boost::scoped_ptr<StageSequentialIterator> iter(filter.createSequentialIterator(data));
+
+    Dimension const& dimX = schema.getDimension("X");
+    Dimension const& dimTime = schema.getDimension("Time");
+    Dimension const& dimRed = schema.getDimension("Red");
+
+    boost::uint32_t seen = 0;
+    while (!iter->atEnd())
+    {
+        data.setNumPoints(0);
+        boost::uint32_t numRead = iter->read(data);
+        BOOST_CHECK(numRead > 0);
+        if (numRead == 0) break;
+
+        for (boost::uint32_t i = 0; i < numRead; ++i)
+        {
+            const boost::uint32_t src = (seen + i) * 7;
+            BOOST_CHECK_EQUAL(data.getField<boost::int32_t>(dimX, i), all.getField<boost::int32_t>(dimX, src));
+            BOOST_CHECK_EQUAL(data.getField<double>(dimTime, i), all.getField<double>(dimTime, src));
+            BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(dimRed, i), all.getField<boost::uint16_t>(dimRed, src));
+        }
+        seen += numRead;
+    }
+
+    BOOST_CHECK_EQUAL(seen, numWanted);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(DecimationFilterTest_test_strided_sequential)
+{
+    // an expression with a condition has no random access and no fixed
+    // count, so the stride is taken on the sequential path
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Ramp);
+    pdal::filters::Expression expression(reader, "X >= 0");
+    pdal::filters::Decimation filter(expression, 10);
+    filter.initialize();
+
+    PointBuffer data(filter.getSchema(), 25);
+    boost::scoped_ptr<StageSequentialIterator> iter(filter.createSequentialIterator(data));
+    Dimension const& dimT = data.getSchema().getDimension("Time");
+
+    boost::uint64_t seen = 0;
+    while (!iter->atEnd())
+    {
+        data.setNumPoints(0);
+        const boost::uint32_t numRead = iter->read(data);
+        if (numRead == 0) break;
+
+        for (boost::uint32_t i = 0; i < numRead; ++i)
+            BOOST_CHECK_EQUAL(data.getField<boost::uint64_t>(dimT, i), (seen + i) * 10);
+        seen += numRead;
+    }
+    BOOST_CHECK_EQUAL(seen, 100u);
+
+    // reads of up to a full buffer each, not ever smaller ones as the
+    // room left shrinks
+    BOOST_CHECK(expression.getProfile().getNumBuffers() <= 1000 / 25 + 4);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(DecimationFilterTest_test_voxel)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+    reader.initialize();
+    const boost::uint32_t numPoints = static_cast<boost::uint32_t>(reader.getNumPoints());
+
+    PointBuffer all(reader.getSchema(), numPoints);
+    boost::scoped_ptr<StageSequentialIterator> allIter(reader.createSequentialIterator(all));
+    BOOST_CHECK(allIter->read(all) == numPoints);
+
+    const double size = 250.0;
+    const std::set<std::vector<double> > expected = getVoxels(all, size);
+    BOOST_CHECK(expected.size() > 1);
+    BOOST_CHECK(expected.size() < numPoints / 2);
+
+    Options options;
+    options.add("mode", "voxel");
+    options.add("voxel_size", size);
+    pdal::drivers::las::Reader reader2(Support::datapath("1.2-with-color.las"));
+    pdal::filters::Decimation filter(reader2, options);
+    filter.initialize();
+    BOOST_CHECK(filter.getPointCountType() == PointCount_Unknown);
+
+    // read in small buffers: the occupied voxels are remembered across them
+    PointBuffer kept(filter.getSchema(), numPoints);
+    PointBuffer data(filter.getSchema(), 10);
+    boost::scoped_ptr<StageSequentialIterator> iter(filter.createSequentialIterator(data));
+    while (!iter->atEnd())
+    {
+        data.setNumPoints(0);
+        const boost::uint32_t numRead = iter->read(data);
+        if (numRead == 0) break;
+        kept.copyPointsFast(kept.getNumPoints(), 0, data, numRead);
+        kept.setNumPoints(kept.getNumPoints() + numRead);
+    }
+
+    BOOST_CHECK_EQUAL(kept.getNumPoints(), expected.size());
+    BOOST_CHECK(getVoxels(kept, size) == expected);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(DecimationFilterTest_test_voxel_centroid)
+{
+    // 1000 points on a diagonal line through a 100 unit cube; voxels of
+    // 50 hold the two halves of it
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Ramp);
+
+    Options options;
+    options.add("mode", "voxel");
+    options.add("voxel_size", 50.0);
+    options.add("voxel_method", "centroid");
+    pdal::filters::Decimation filter(reader, options);
+    filter.initialize();
+
+    PointBuffer data(filter.getSchema(), 1000);
+    boost::scoped_ptr<StageSequentialIterator> iter(filter.createSequentialIterator(data));
+    const boost::uint32_t numRead = iter->read(data);
+
+    Dimension const& dimX = data.getSchema().getDimension("X");
+    Dimension const& dimZ = data.getSchema().getDimension("Z");
+    Dimension const& dimT = data.getSchema().getDimension("Time");
+    BOOST_CHECK_EQUAL(numRead, 3u);
+    if (numRead == 3)
+    {
+        BOOST_CHECK(Utils::compare_approx<double>(data.getField<double>(dimX, 0), 25.0, 0.1));
+        BOOST_CHECK(Utils::compare_approx<double>(data.getField<double>(dimZ, 0), 25.0, 0.1));
+        BOOST_CHECK(Utils::compare_approx<double>(data.getField<double>(dimX, 1), 75.0, 0.1));
+        BOOST_CHECK(Utils::compare_approx<double>(data.getField<double>(dimX, 2), 100.0, 0.0001));
+        // the other fields come from the first point of each voxel
+        BOOST_CHECK_EQUAL(data.getField<boost::uint64_t>(dimT, 0), 0u);
+        BOOST_CHECK_EQUAL(data.getField<boost::uint64_t>(dimT, 1), 500u);
+    }
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(DecimationFilterTest_test_random)
+{
+    Bounds<double> srcBounds(0.0, 0.0, 0.0, 100.0, 100.0, 100.0);
+    pdal::drivers::faux::Reader reader(srcBounds, 1000, pdal::drivers::faux::Reader::Random);
+
+    Options options;
+    options.add("mode", "random");
+    options.add("count", 100);
+    options.add("seed", 17);
+    pdal::filters::Decimation filter(reader, options);
+    filter.initialize();
+    BOOST_CHECK_EQUAL(filter.getNumPoints(), 100u);
+
+    std::vector<boost::uint64_t> times[2];
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        PointBuffer data(filter.getSchema(), 30);
+        boost::scoped_ptr<StageSequentialIterator> iter(filter.createSequentialIterator(data));
+        Dimension const& dimT = data.getSchema().getDimension("Time");
+        while (!iter->atEnd())
+        {
+            data.setNumPoints(0);
+            const boost::uint32_t numRead = iter->read(data);
+            if (numRead == 0) break;
+            for (boost::uint32_t i = 0; i < numRead; ++i)
+                times[pass].push_back(data.getField<boost::uint64_t>(dimT, i));
+        }
+    }
+
+    // exactly count points, in order, and the same ones for the same seed
+    BOOST_CHECK_EQUAL(times[0].size(), 100u);
+    for (std::size_t i = 1; i < times[0].size(); ++i)
+        BOOST_CHECK(times[0][i - 1] < times[0][i]);
+    BOOST_CHECK(times[0] == times[1]);
+
+    // spread over the whole stream, not bunched at its start
+    BOOST_CHECK(times[0].back() > 500u);
+
+    return;
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,245 @@
+/******************************************************************************
+* Copyright (c) 2012, Michael P. Gerlek (mpg@flaxen.com)
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following
+* conditions are met:
+*
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in
+*       the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of Hobu, Inc. or Flaxen Geo Consulting nor the
+*       names of its contributors may be used to endorse or promote
+*       products derived from this software without specific prior
+*       written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+* OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+* OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+* OF SUCH DAMAGE.
+****************************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <pdal/StageFactory.hpp>
+#include <pdal/StageIterator.hpp>
+#include <pdal/PointBuffer.hpp>
+#include <pdal/drivers/faux/Reader.hpp>
+#include <pdal/drivers/las/Reader.hpp>
+#include <pdal/filters/Crop.hpp>
+#include <pdal/filters/Expression.hpp>
+
+#include "Support.hpp"
+
+using namespace pdal;
+
+namespace
+{
+
+// reads every point of stage
+boost::uint32_t readAll(Stage& stage, PointBuffer& data)
+{
+    boost::scoped_ptr<StageSequentialIterator> iter(stage.createSequentialIterator(data));
+    return iter->read(data);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ExpressionFilterTest)
+
+BOOST_AUTO_TEST_CASE(test_parse)
+{
+    using pdal::filters::expression::Program;
+
+    Program program("Classification == 2 && Z > 100");
+    BOOST_CHECK(program.hasCondition());
+    BOOST_CHECK_EQUAL(program.getStatements().size(), 1u);
+
+    Program assignment("Intensity = Intensity * 0.5;");
+    BOOST_CHECK(!assignment.hasCondition());
+    BOOST_CHECK_EQUAL(assignment.getStatements().size(), 1u);
+    BOOST_CHECK(assignment.getStatements()[0].target == "Intensity");
+
+    Program both("Z = -min(Z, 2) + abs(X); !(X <= 3) || Y != 4");
+    BOOST_CHECK(both.hasCondition());
+    BOOST_CHECK_EQUAL(both.getStatements().size(), 2u);
+
+    BOOST_CHECK_THROW(Program(""), pdal_error);
+    BOOST_CHECK_THROW(Program("X >"), pdal_error);
+    BOOST_CHECK_THROW(Program("(X > 1"), pdal_error);
+    BOOST_CHECK_THROW(Program("X > 1 Y"), pdal_error);
+    BOOST_CHECK_THROW(Program("frobnicate(X)"), pdal_error);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_values)
+{
+    // one point, with X = 2; each expression is assigned to Y
+    Bounds<double> bounds(2.0, 0.0, 0.0, 2.0, 0.0, 0.0);
+
+    const char* expressions[] =
+    {
+        "1 + 2 * 3", "(1 + 2) * 3", "10 - 4 - 3", "X / 4", "-X * 3",
+        "X > 1 && X < 3", "X >= 3 || X <= 1", "!(X == 2)", "X != 2", "3 - -X",
+        "min(X, 1) + max(X, 5)", "abs(0 - X)", "sqrt(X * 8)", "floor(2.5) + ceil(2.5)", "round(-X - 0.5)"
+    };
+    const double expected[] = { 7, 9, 3, 0.5, -6, 1, 0, 0, 0, 5, 6, 2, 4, 5, -3 };
+
+    for (std::size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i)
+    {
+        pdal::drivers::faux::Reader reader(bounds, 1, pdal::drivers::faux::Reader::Constant);
+        pdal::filters::Expression filter(reader, std::string("Y = ") + expressions[i]);
+        filter.initialize();
+
+        PointBuffer data(filter.getSchema(), 1);
+        BOOST_CHECK_EQUAL(readAll(filter, data), 1u);
+        const double y = data.getField<double>(data.getSchema().getDimension("Y"), 0);
+        BOOST_CHECK_MESSAGE(Utils::compare_approx<double>(y, expected[i], 1e-12),
+                            expressions[i] << " gave " << y << ", not " << expected[i]);
+    }
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_las)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+    reader.initialize();
+    const boost::uint32_t numPoints = static_cast<boost::uint32_t>(reader.getNumPoints());
+
+    PointBuffer all(reader.getSchema(), numPoints);
+    BOOST_CHECK_EQUAL(readAll(reader, all), numPoints);
+
+    Schema const& schema = all.getSchema();
+    Dimension const& dimZ = schema.getDimension("Z");
+    Dimension const& dimClass = schema.getDimension("Classification");
+    Dimension const& dimIntensity = schema.getDimension("Intensity");
+
+    // condition and assignment together, on scaled Z and integer fields
+    pdal::drivers::las::Reader reader2(Support::datapath("1.2-with-color.las"));
+    Options options;
+    options.add("expression", "Intensity = Intensity * 0.5 + 1; Classification == 2 && Z > 420");
+    pdal::filters::Expression filter(reader2, options);
+    filter.initialize();
+    BOOST_CHECK(filter.getPointCountType() == PointCount_Unknown);
+
+    std::vector<boost::uint32_t> expected;
+    for (boost::uint32_t i = 0; i < numPoints; ++i)
+    {
+        const double z = dimZ.applyScaling(all.getField<boost::int32_t>(dimZ, i));
+        if (all.getField<boost::uint8_t>(dimClass, i) == 2 && z > 420)
+            expected.push_back(i);
+    }
+    BOOST_CHECK(expected.size() > 0);
+    BOOST_CHECK(expected.size() < numPoints);
+
+    // read in small buffers
+    PointBuffer data(filter.getSchema(), 100);
+    boost::scoped_ptr<StageSequentialIterator> iter(filter.createSequentialIterator(data));
+    std::size_t seen = 0;
+    while (!iter->atEnd())
+    {
+        data.setNumPoints(0);
+        const boost::uint32_t numRead = iter->read(data);
+        if (numRead == 0) break;
+
+        for (boost::uint32_t i = 0; i < numRead && seen + i < expected.size(); ++i)
+        {
+            const boost::uint32_t src = expected[seen + i];
+            BOOST_CHECK_EQUAL(data.getField<boost::int32_t>(dimZ, i), all.getField<boost::int32_t>(dimZ, src));
+            const boost::uint16_t intensity = all.getField<boost::uint16_t>(dimIntensity, src);
+            BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(dimIntensity, i),
+                              static_cast<boost::uint16_t>(intensity / 2 + (intensity % 2) + 1));
+        }
+        seen += numRead;
+    }
+    BOOST_CHECK_EQUAL(seen, expected.size());
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_moved_then_cropped)
+{
+    // the LAS reader hands each buffer the file's extent, which no longer
+    // holds once X is moved, so filters.crop must not decide from it
+    const std::string path = Support::datapath("1.2-with-color.las");
+    pdal::drivers::las::Reader reader(path);
+    reader.initialize();
+    const boost::uint32_t numPoints = static_cast<boost::uint32_t>(reader.getNumPoints());
+    const Bounds<double>& extent = reader.getBounds();
+
+    Bounds<double> moved(extent.getMinimum(0) + 100000 - 1, extent.getMinimum(1) - 1, extent.getMinimum(2) - 1,
+                         extent.getMaximum(0) + 100000 + 1, extent.getMaximum(1) + 1, extent.getMaximum(2) + 1);
+    Bounds<double> original(extent.getMinimum(0) - 1, extent.getMinimum(1) - 1, extent.getMinimum(2) - 1,
+                            extent.getMaximum(0) + 1, extent.getMaximum(1) + 1, extent.getMaximum(2) + 1);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        pdal::drivers::las::Reader reader2(path);
+        pdal::filters::Expression expression(reader2, "X = X + 100000");
+        pdal::filters::Crop crop(expression, i == 0 ? moved : original);
+        crop.initialize();
+
+        PointBuffer data(crop.getSchema(), 100);
+        boost::scoped_ptr<StageSequentialIterator> iter(crop.createSequentialIterator(data));
+        boost::uint32_t seen = 0;
+        while (!iter->atEnd())
+        {
+            data.setNumPoints(0);
+            const boost::uint32_t numRead = iter->read(data);
+            if (numRead == 0) break;
+            seen += numRead;
+        }
+        BOOST_CHECK_EQUAL(seen, i == 0 ? numPoints : 0u);
+    }
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(test_saturate_and_errors)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+
+    // integers saturate rather than wrap
+    pdal::filters::Expression filter(reader, "Classification = Classification + 1000; Intensity = -5");
+    filter.initialize();
+
+    PointBuffer data(filter.getSchema(), 10);
+    BOOST_CHECK_EQUAL(readAll(filter, data), 10u);
+    Schema const& schema = data.getSchema();
+    BOOST_CHECK_EQUAL(data.getField<boost::uint8_t>(schema.getDimension("Classification"), 3), 255u);
+    BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(schema.getDimension("Intensity"), 3), 0u);
+
+    // unknown names are found at initialize()
+    pdal::drivers::las::Reader reader2(Support::datapath("1.2-with-color.las"));
+    pdal::filters::Expression bad(reader2, "Frobnication > 3");
+    BOOST_CHECK_THROW(bad.initialize(), pdal_error);
+
+    // and the stage can be made by name
+    pdal::drivers::las::Reader reader3(Support::datapath("1.2-with-color.las"));
+    StageFactory factory;
+    Options options;
+    options.add("expression", "Z > 0");
+    boost::scoped_ptr<Filter> made(factory.createFilter("filters.expression", reader3, options));
+    BOOST_CHECK(made->getName() == "filters.expression");
+
+    return;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
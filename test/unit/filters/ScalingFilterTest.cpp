@@ -187,5 +187,62 @@ BOOST_AUTO_TEST_CASE(ScalingFilterFloat_test)
 }
 
 
+BOOST_AUTO_TEST_CASE(ScalingFilterFloatToFloat_test)
+{
+    const Bounds<double> bounds(1.0, 2.0, 3.0, 101.0, 102.0, 103.0);
+    Option opt1("bounds", bounds);
+    Option opt2("mode", "ramp");
+    Option opt3("num_points", 1000);
+    Options opts;
+    opts.add(opt1);
+    opts.add(opt2);
+    opts.add(opt3);
+
+    Option scalez("scale", 0.5, "fpscale");
+    Option offsetz("offset", 1.0, "offset");
+    Option sizez("size", 8, "size");
+    Option typez("type", "Float", "type");
+    Option zdim("dimension", "Z", "dimension to scale");
+    Options zs;
+    zs.add(scalez);
+    zs.add(offsetz);
+    zs.add(sizez);
+    zs.add(typez);
+    zdim.setOptions(zs);
+    opts.add(zdim);
+
+    pdal::drivers::faux::Reader reader(opts);
+    pdal::filters::Scaling scaling(reader, opts);
+    scaling.initialize();
+
+    const Schema& schema = scaling.getSchema();
+
+    // more points than one block of the scaling plan
+    PointBuffer data(schema, 1000);
+
+    StageSequentialIterator* iter = scaling.createSequentialIterator(data);
+    boost::uint32_t numRead = iter->read(data);
+
+    BOOST_CHECK_EQUAL(numRead, 1000u);
+
+    Schema const& buffer_schema = data.getSchema();
+    boost::optional<Dimension const&> dimZ = buffer_schema.getDimension("Z", "drivers.faux.reader");
+    boost::optional<Dimension const&> scaledZ = buffer_schema.getDimension("Z", "filters.scaling");
+    BOOST_CHECK(dimZ);
+    BOOST_CHECK(scaledZ);
+
+    for (boost::uint32_t i=0; i<numRead; i++)
+    {
+        double z = data.getField<double>(*dimZ, i);
+        double scaled = data.getField<double>(*scaledZ, i);
+
+        BOOST_CHECK_EQUAL(scaled, (z - 1.0) / 0.5);
+    }
+
+    delete iter;
+
+    return;
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -36,6 +36,7 @@
 
 #include <pdal/SpatialReference.hpp>
 #include <pdal/drivers/pipeline/Reader.hpp>
+#include <pdal/drivers/las/Reader.hpp>
 #include <pdal/filters/Selector.hpp>
 #include <pdal/StageIterator.hpp>
 #include <pdal/Schema.hpp>
@@ -81,5 +82,53 @@ BOOST_AUTO_TEST_CASE(test1)
 }
 
 
+BOOST_AUTO_TEST_CASE(test_pack)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+
+    pdal::Option keep("keep", "");
+    pdal::Options keepO;
+    keepO.add(pdal::Option("dimension", "X", ""));
+    keepO.add(pdal::Option("dimension", "Y", ""));
+    keepO.add(pdal::Option("dimension", "Red", ""));
+    keep.setOptions(keepO);
+
+    pdal::Options options;
+    options.add(keep);
+    options.add(pdal::Option("pack", true, ""));
+
+    pdal::filters::Selector selector(reader, options);
+    selector.initialize();
+
+    pdal::PointBuffer data(selector.getSchema(), 10);
+    boost::scoped_ptr<pdal::StageSequentialIterator> iter(selector.createSequentialIterator(data));
+    boost::uint32_t numRead = iter->read(data);
+    BOOST_CHECK_EQUAL(numRead, 10u);
+
+    // Only the kept dimensions are left in the buffer
+    pdal::Schema const& packed = data.getSchema();
+    BOOST_CHECK_EQUAL(packed.size(), 3u);
+    BOOST_CHECK_EQUAL(packed.getByteSize(), 10u);
+    BOOST_CHECK_THROW(packed.getDimension("Z"), pdal::dimension_not_found);
+
+    // ...and they carry the same values a full read does
+    pdal::PointBuffer full(reader.getSchema(), 10);
+    boost::scoped_ptr<pdal::StageSequentialIterator> fullIter(reader.createSequentialIterator(full));
+    fullIter->read(full);
+
+    pdal::Schema const& schema = full.getSchema();
+    for (boost::uint32_t i = 0; i < numRead; ++i)
+    {
+        BOOST_CHECK_EQUAL(data.getField<boost::int32_t>(packed.getDimension("X"), i),
+                          full.getField<boost::int32_t>(schema.getDimension("X"), i));
+        BOOST_CHECK_EQUAL(data.getField<boost::int32_t>(packed.getDimension("Y"), i),
+                          full.getField<boost::int32_t>(schema.getDimension("Y"), i));
+        BOOST_CHECK_EQUAL(data.getField<boost::uint16_t>(packed.getDimension("Red"), i),
+                          full.getField<boost::uint16_t>(schema.getDimension("Red"), i));
+    }
+
+    return;
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
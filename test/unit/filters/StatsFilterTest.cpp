@@ -37,8 +37,13 @@
 #include <boost/scoped_ptr.hpp>
 
 #include <pdal/drivers/faux/Reader.hpp>
+#include <pdal/drivers/las/Reader.hpp>
 #include <pdal/filters/Stats.hpp>
 
+#include "Support.hpp"
+
+#include <limits>
+
 #ifdef PDAL_COMPILER_GCC
 #pragma GCC diagnostic ignored "-Wfloat-equal"
 #endif
@@ -92,4 +97,271 @@ BOOST_AUTO_TEST_CASE(StatsFilterTest_test1)
     return;
 }
 
+BOOST_AUTO_TEST_CASE(StatsFilterTest_test_merge)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+
+    Options options;
+    options.add("seed", 42);
+    Option zOption("dimension", std::string("Z"));
+    Options zOptions;
+    zOptions.add("histogram_min", 400.0);
+    zOptions.add("histogram_max", 500.0);
+    zOption.setOptions(zOptions);
+    options.add(zOption);
+
+    pdal::filters::Stats filter(reader, options);
+    filter.initialize();
+
+    const Schema& schema = filter.getSchema();
+
+    // one pass over everything
+    PointBuffer all(schema, 1065);
+    boost::scoped_ptr<pdal::StageSequentialIterator> iterAll(filter.createSequentialIterator(all));
+    BOOST_CHECK_EQUAL(iterAll->read(all), 1065u);
+
+    // the same stream in two halves, summarized separately
+    PointBuffer half(schema, 500);
+    boost::scoped_ptr<pdal::StageSequentialIterator> iterFirst(filter.createSequentialIterator(half));
+    BOOST_CHECK_EQUAL(iterFirst->read(half), 500u);
+
+    boost::scoped_ptr<pdal::StageSequentialIterator> iterSecond(filter.createSequentialIterator(half));
+    iterSecond->skip(500);
+    half.setNumPoints(0);
+    BOOST_CHECK_EQUAL(iterSecond->read(half), 500u);
+    half.setNumPoints(0);
+    BOOST_CHECK_EQUAL(iterSecond->read(half), 65u);
+
+    typedef pdal::filters::iterators::sequential::Stats StatsIterator;
+    StatsIterator* whole = static_cast<StatsIterator*>(iterAll.get());
+    StatsIterator* merged = static_cast<StatsIterator*>(iterFirst.get());
+    merged->merge(*static_cast<StatsIterator*>(iterSecond.get()));
+
+    const char* names[] = { "X", "Y", "Z" };
+    for (int n = 0; n < 3; ++n)
+    {
+        const Dimension& dim = schema.getDimension(names[n]);
+        const pdal::filters::stats::Summary& a = whole->getStats(dim);
+        const pdal::filters::stats::Summary& b = merged->getStats(dim);
+
+        BOOST_CHECK_EQUAL(a.count(), 1065u);
+        BOOST_CHECK_EQUAL(b.count(), 1065u);
+        BOOST_CHECK_EQUAL(a.minimum(), b.minimum());
+        BOOST_CHECK_EQUAL(a.maximum(), b.maximum());
+        BOOST_CHECK_CLOSE(a.average(), b.average(), 0.0001);
+        BOOST_CHECK_CLOSE(a.stddev(), b.stddev(), 0.0001);
+
+        // both histograms are exact: auto-ranged ones merge their caches,
+        // the fixed Z ranges share edges
+        std::vector<std::pair<double, boost::uint64_t> > binsA = a.histogram().getBins();
+        std::vector<std::pair<double, boost::uint64_t> > binsB = b.histogram().getBins();
+        BOOST_CHECK_EQUAL(binsA.size(), 22u);
+        BOOST_CHECK_EQUAL(binsB.size(), 22u);
+        for (std::size_t i = 0; i < binsA.size() && i < binsB.size(); ++i)
+        {
+            BOOST_CHECK_CLOSE(binsA[i].first, binsB[i].first, 0.0001);
+            BOOST_CHECK_EQUAL(binsA[i].second, binsB[i].second);
+        }
+        BOOST_CHECK(b.histogram().isExact());
+
+        // quantile sketches compact differently for different splits,
+        // but stay within a few ranks of each other
+        const double spread = a.maximum() - a.minimum();
+        BOOST_CHECK_SMALL(a.quantile(0.5) - b.quantile(0.5), 0.05 * spread);
+
+        BOOST_CHECK_EQUAL(b.sample().size(), 1000u);
+    }
+
+    const Dimension& dimZ = schema.getDimension("Z");
+    BOOST_CHECK(merged->getStats(dimZ).histogram().isFixed());
+    BOOST_CHECK_CLOSE(merged->getStats(dimZ).histogram().getLower(), 400.0, 0.0001);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(StatsFilterTest_test_sketches)
+{
+    using namespace pdal::filters::stats;
+
+    // Histograms with different edges still merge, approximately, and
+    // keep every count.
+    Histogram a = Histogram::fixed(0.0, 100.0, 10);
+    Histogram b = Histogram::fixed(50.0, 150.0, 4);
+    for (int i = 0; i < 100; ++i)
+    {
+        a.insert(static_cast<double>(i));
+        b.insert(static_cast<double>(i + 50));
+    }
+    a.merge(b);
+    BOOST_CHECK(!a.isExact());
+
+    std::vector<std::pair<double, boost::uint64_t> > bins = a.getBins();
+    boost::uint64_t total(0);
+    for (std::size_t i = 0; i < bins.size(); ++i)
+        total += bins[i].second;
+    BOOST_CHECK_EQUAL(total, 200u);
+    BOOST_CHECK_EQUAL(bins[1].second, 10u);
+    BOOST_CHECK_EQUAL(bins[11].second, 50u);
+
+    Histogram logs = Histogram::fixed(1.0, 1000.0, 3, true);
+    BOOST_CHECK_EQUAL(logs.getBin(5.0), 1u);
+    BOOST_CHECK_EQUAL(logs.getBin(50.0), 2u);
+    BOOST_CHECK_EQUAL(logs.getBin(500.0), 3u);
+    BOOST_CHECK_EQUAL(logs.getBin(5000.0), 4u);
+    BOOST_CHECK_EQUAL(logs.getBin(0.5), 0u);
+
+    // NaNs are dropped, whether cached or binned
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double values[] = { 1.0, nan, 2.0, nan, 3.0 };
+    Histogram cached(4, 3);
+    cached.insert(values, values + 5);
+    cached.insert(nan);
+    BOOST_CHECK(cached.isFixed());
+    BOOST_CHECK_EQUAL(cached.getLower(), 1.0);
+    BOOST_CHECK_EQUAL(cached.getUpper(), 3.0);
+    bins = cached.getBins();
+    total = 0;
+    for (std::size_t i = 0; i < bins.size(); ++i)
+        total += bins[i].second;
+    BOOST_CHECK_EQUAL(total, 3u);
+
+    // Quantiles of a sketch built from shuffled pieces
+    QuantileSketch q1;
+    QuantileSketch q2;
+    for (int i = 0; i < 100000; ++i)
+    {
+        const double v = static_cast<double>((i * 7919) % 100000);
+        if (i % 3)
+            q1.insert(v);
+        else
+            q2.insert(v);
+    }
+    q1.merge(q2);
+    BOOST_CHECK_EQUAL(q1.count(), 100000u);
+    BOOST_CHECK_SMALL(q1.quantile(0.5) - 50000.0, 2000.0);
+    BOOST_CHECK_SMALL(q1.quantile(0.9) - 90000.0, 2000.0);
+
+    // Merged reservoirs stay bounded and see the whole population
+    Reservoir r1(100, 1);
+    Reservoir r2(100, 2);
+    for (int i = 0; i < 1000; ++i)
+    {
+        r1.insert(0.0);
+        r2.insert(1.0);
+    }
+    r1.merge(r2);
+    BOOST_CHECK_EQUAL(r1.seen(), 2000u);
+    BOOST_CHECK_EQUAL(r1.sample().size(), 100u);
+    double ones(0.0);
+    for (std::size_t i = 0; i < r1.sample().size(); ++i)
+        ones += r1.sample()[i];
+    BOOST_CHECK(ones > 20.0 && ones < 80.0);
+
+    // an empty reservoir only counts
+    Reservoir none1(0, 1);
+    Reservoir none2(0, 2);
+    none1.insert(1.0);
+    none2.insert(2.0);
+    none1.merge(none2);
+    BOOST_CHECK_EQUAL(none1.seen(), 2u);
+    BOOST_CHECK(none1.sample().empty());
+
+    // Welford moments merge like a single pass
+    Moments m1;
+    Moments m2;
+    Moments m;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const double v = 1.0e6 + static_cast<double>(i % 17);
+        m.insert(v);
+        if (i < 300)
+            m1.insert(v);
+        else
+            m2.insert(v);
+    }
+    m1.merge(m2);
+    BOOST_CHECK_EQUAL(m1.count(), m.count());
+    BOOST_CHECK_CLOSE(m1.mean(), m.mean(), 1e-10);
+    BOOST_CHECK_CLOSE(m1.variance(), m.variance(), 1e-6);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(StatsFilterTest_test_scaled_las)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+
+    pdal::filters::Stats filter(reader, Options::none());
+    filter.initialize();
+
+    const Schema& schema = filter.getSchema();
+    PointBuffer data(schema, 1065);
+
+    boost::scoped_ptr<pdal::StageSequentialIterator> iter(filter.createSequentialIterator(data));
+    BOOST_CHECK_EQUAL(iter->read(data), 1065u);
+
+    pdal::filters::iterators::sequential::Stats* iterator = static_cast<pdal::filters::iterators::sequential::Stats*>(iter.get());
+
+    // X is a scaled int32, Intensity an unscaled uint16
+    const Dimension& dimX = schema.getDimension("X");
+    const Dimension& dimIntensity = schema.getDimension("Intensity");
+
+    double minX = (std::numeric_limits<double>::max)();
+    double maxX = -(std::numeric_limits<double>::max)();
+    double sumIntensity(0.0);
+    for (boost::uint32_t i = 0; i < data.getNumPoints(); ++i)
+    {
+        const double x = dimX.applyScaling<boost::int32_t>(data.getField<boost::int32_t>(dimX, i));
+        minX = (std::min)(minX, x);
+        maxX = (std::max)(maxX, x);
+        sumIntensity += data.getField<boost::uint16_t>(dimIntensity, i);
+    }
+
+    const pdal::filters::stats::Summary& statsX = iterator->getStats(dimX);
+    const pdal::filters::stats::Summary& statsIntensity = iterator->getStats(dimIntensity);
+
+    BOOST_CHECK_EQUAL(statsX.minimum(), minX);
+    BOOST_CHECK_EQUAL(statsX.maximum(), maxX);
+    BOOST_CHECK_CLOSE(statsIntensity.average(), sumIntensity / 1065.0, 0.0001);
+
+    return;
+}
+
+BOOST_AUTO_TEST_CASE(StatsFilterTest_test_random)
+{
+    pdal::drivers::las::Reader reader(Support::datapath("1.2-with-color.las"));
+
+    pdal::filters::Stats filter(reader, Options::none());
+    filter.initialize();
+    BOOST_CHECK(filter.supportsIterator(StageIterator_Random));
+
+    const Schema& schema = filter.getSchema();
+    PointBuffer data(schema, 10);
+
+    boost::scoped_ptr<pdal::StageRandomIterator> iter(filter.createRandomIterator(data));
+
+    // only the points actually read are summarized
+    iter->seek(100);
+    BOOST_CHECK_EQUAL(iter->read(data), 10u);
+    iter->seek(1000);
+    data.setNumPoints(0);
+    BOOST_CHECK_EQUAL(iter->read(data), 10u);
+
+    PointBuffer check(schema, 1);
+    boost::scoped_ptr<pdal::StageRandomIterator> readerIter(reader.createRandomIterator(check));
+    readerIter->seek(1000);
+    readerIter->read(check);
+    const Dimension& dimX = schema.getDimension("X");
+    const double x = dimX.applyScaling<boost::int32_t>(check.getField<boost::int32_t>(dimX, 0));
+
+    pdal::filters::iterators::random::Stats* iterator = static_cast<pdal::filters::iterators::random::Stats*>(iter.get());
+    const pdal::filters::stats::Summary& statsX = iterator->getStats(dimX);
+    BOOST_CHECK_EQUAL(statsX.count(), 20u);
+    BOOST_CHECK(statsX.minimum() <= x);
+    BOOST_CHECK(statsX.maximum() >= x);
+
+    return;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
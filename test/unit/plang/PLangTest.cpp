@@ -319,6 +319,76 @@ BOOST_AUTO_TEST_CASE(PLangTest_aliases)
 }
 
 
+BOOST_AUTO_TEST_CASE(PLangTest_views)
+{
+    // X and Y interleaved, as in a point buffer
+    double chunk1[6] = {1.0, 10.0, 2.0, 20.0, 3.0, 30.0};
+    double chunk2[6] = {4.0, 40.0, 5.0, 50.0, 6.0, 60.0};
+
+    const char* source =
+        "import numpy as np\n"
+        "def yow(ins,outs):\n"
+        "  X = ins['X']\n"
+        "  X *= 2\n"
+        "  outs['X'] = X\n"
+        "  return True\n"
+        ;
+    pdal::plang::Script script(source, "MyTest", "yow");
+
+    pdal::plang::Invocation meth(script);
+    meth.compile();
+
+    BOOST_CHECK(meth.usesName("X"));
+    BOOST_CHECK(!meth.usesName("Y"));
+
+    // the script writes through its view, so the result is already in place,
+    // and the same array serves the second chunk
+    double* chunks[2] = { chunk1, chunk2 };
+    for (int i = 0; i < 2; ++i)
+    {
+        meth.resetArguments();
+        meth.insertArgument("X", (boost::uint8_t*)chunks[i], 3, 16, pdal::dimension::Float, 8);
+        meth.execute();
+        meth.extractResult("X", (boost::uint8_t*)chunks[i], 3, 16, pdal::dimension::Float, 8);
+    }
+
+    BOOST_CHECK_CLOSE(chunk1[0], 2.0, 0.00001);
+    BOOST_CHECK_CLOSE(chunk1[1], 10.0, 0.00001);
+    BOOST_CHECK_CLOSE(chunk1[4], 6.0, 0.00001);
+    BOOST_CHECK_CLOSE(chunk2[0], 8.0, 0.00001);
+    BOOST_CHECK_CLOSE(chunk2[3], 50.0, 0.00001);
+    BOOST_CHECK_CLOSE(chunk2[4], 12.0, 0.00001);
+
+    // results of another type and layout are converted on the way out
+    float result[3];
+    meth.extractResult("X", (boost::uint8_t*)result, 3, 4, pdal::dimension::Float, 4);
+    BOOST_CHECK_CLOSE(result[2], 12.0f, 0.00001);
+
+    return;
+}
+
+
+BOOST_AUTO_TEST_CASE(PLangTest_enumerated_names)
+{
+    const char* source =
+        "def yow(ins,outs):\n"
+        "  for k, v in ins.items():\n"
+        "    outs[k] = v\n"
+        "  return True\n"
+        ;
+    pdal::plang::Script script(source, "MyTest", "yow");
+
+    pdal::plang::Invocation meth(script);
+    meth.compile();
+
+    // the script may touch any name
+    BOOST_CHECK(meth.usesName("X"));
+    BOOST_CHECK(meth.usesName("Intensity"));
+
+    return;
+}
+
+
 BOOST_AUTO_TEST_CASE(PLangTest_returntrue)
 {
     const char* source =
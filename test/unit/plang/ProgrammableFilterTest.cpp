@@ -104,5 +104,43 @@ BOOST_AUTO_TEST_CASE(ProgrammableFilterTest_test1)
     return;
 }
 
+BOOST_AUTO_TEST_CASE(ProgrammableFilterTest_iterated_ins)
+{
+    Bounds<double> bounds(0.0, 0.0, 0.0, 1.0, 1.0, 1.0);
+    pdal::drivers::faux::Reader reader(bounds, 10, pdal::drivers::faux::Reader::Ramp);
+
+    // no dimension is named in the script, so all of them must be passed
+    const pdal::Option source("source",
+                              "import numpy as np\n"
+                              "def myfunc(ins,outs):\n"
+                              "  for k in ins:\n"
+                              "    outs[k] = ins[k] + 10.0\n"
+                              "  return True\n"
+                             );
+    const pdal::Option module("module", "MyModule");
+    const pdal::Option function("function", "myfunc");
+    pdal::Options opts;
+    opts.add(source);
+    opts.add(module);
+    opts.add(function);
+
+    pdal::filters::Programmable filter(reader, opts);
+    pdal::drivers::faux::Writer writer(filter, Options::none());
+    writer.initialize();
+
+    boost::uint64_t numWritten = writer.write(10);
+
+    BOOST_CHECK(numWritten == 10);
+
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getMinX(), 10.0, 0.001));
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getMaxX(), 11.0, 0.001));
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getMinY(), 10.0, 0.001));
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getMaxY(), 11.0, 0.001));
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getMinZ(), 10.0, 0.001));
+    BOOST_CHECK(Utils::compare_approx<double>(writer.getMaxZ(), 11.0, 0.001));
+
+    return;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif